@@ -0,0 +1,826 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-audio-convert.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+/*
+ * nscaudioconvert changes the sample format of interleaved audio
+ * between S16, S24_32, S32 and F32, and mono to stereo or back, in
+ * one pass over the data.  Each block of frames is unpacked to float,
+ * mixed and packed again while it is still in the cache, with SSE2,
+ * AVX2 or NEON kernels where the processor has them.
+ *
+ * Every kernel rounds to nearest, ties to even, which is what the
+ * SSE2 and AVX2 conversions do in the default rounding mode, so the
+ * output doesn't depend on the processor.
+ *
+ * It covers what decoders and encoders disagree on most often, and
+ * leaves everything else (surround downmixes, resampling) to the
+ * stock audioconvert and audioresample.
+ */
+
+#include <config.h>
+
+#include <math.h>
+#include <string.h>
+#include <glib.h>
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+#include <gst/base/gstbasetransform.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_AVX2_KERNELS 1
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#include "nsc-audio-convert.h"
+
+/* Frames converted at a time, so the float copy stays in the cache */
+#define BLOCK_FRAMES 1024
+
+typedef void (*UnpackFunc) (const guint8 *src, gfloat *dst, guint n);
+typedef void (*PackFunc)   (const gfloat *src, guint8 *dst, guint n);
+typedef void (*MixFunc)    (const gfloat *src, gfloat *dst, guint frames);
+
+enum {
+	FORMAT_S16,
+	FORMAT_S24_32,
+	FORMAT_S32,
+	FORMAT_F32,
+	N_FORMATS
+};
+
+#define FORMATS "{ " GST_AUDIO_NE (F32) ", " GST_AUDIO_NE (S32) ", " \
+		GST_AUDIO_NE (S24_32) ", " GST_AUDIO_NE (S16) " }"
+
+#define CAPS_STR "audio/x-raw, "		\
+	"format = (string) " FORMATS ", "	\
+	"rate = (int) [ 1, MAX ], "		\
+	"channels = (int) [ 1, MAX ], "		\
+	"layout = (string) interleaved"
+
+static GstStaticPadTemplate sink_template =
+	GST_STATIC_PAD_TEMPLATE ("sink", GST_PAD_SINK, GST_PAD_ALWAYS,
+				 GST_STATIC_CAPS (CAPS_STR));
+static GstStaticPadTemplate src_template =
+	GST_STATIC_PAD_TEMPLATE ("src", GST_PAD_SRC, GST_PAD_ALWAYS,
+				 GST_STATIC_CAPS (CAPS_STR));
+
+/* The fastest kernels this processor runs, picked in class_init */
+static UnpackFunc unpack_funcs[N_FORMATS];
+static PackFunc   pack_funcs[N_FORMATS];
+static MixFunc    downmix_func;
+static MixFunc    upmix_func;
+
+struct NscAudioConvertPrivate {
+	GstAudioInfo  in_info;
+	GstAudioInfo  out_info;
+
+	/* The kernels for the negotiated formats, mix is NULL if the
+	 * number of channels does not change */
+	UnpackFunc    unpack;
+	PackFunc      pack;
+	MixFunc       mix;
+
+	/* BLOCK_FRAMES of float samples before and after mixing */
+	gfloat       *unpacked;
+	gfloat       *mixed;
+};
+
+G_DEFINE_TYPE (NscAudioConvert, nsc_audio_convert, GST_TYPE_BASE_TRANSFORM);
+
+#define NSC_AUDIO_CONVERT_GET_PRIVATE(o)				\
+	((NscAudioConvertPrivate *)((NSC_AUDIO_CONVERT(o))->priv))
+
+/*
+ * Scalar kernels, which also finish off the samples left over by
+ * the vector ones.
+ */
+static void
+unpack_s16_c (const guint8 *src, gfloat *dst, guint n)
+{
+	const gint16 *s = (const gint16 *) src;
+	guint         i;
+
+	for (i = 0; i < n; i++)
+		dst[i] = s[i] * (1.0f / 32768.0f);
+}
+
+static void
+unpack_s24_32_c (const guint8 *src, gfloat *dst, guint n)
+{
+	const gint32 *s = (const gint32 *) src;
+	guint         i;
+
+	/* Only the low 24 bits are meaningful, sign extend them */
+	for (i = 0; i < n; i++)
+		dst[i] = ((gint32) ((guint32) s[i] << 8) >> 8) * (1.0f / 8388608.0f);
+}
+
+static void
+unpack_s32_c (const guint8 *src, gfloat *dst, guint n)
+{
+	const gint32 *s = (const gint32 *) src;
+	guint         i;
+
+	for (i = 0; i < n; i++)
+		dst[i] = s[i] * (1.0f / 2147483648.0f);
+}
+
+static void
+unpack_f32_c (const guint8 *src, gfloat *dst, guint n)
+{
+	memcpy (dst, src, n * sizeof (gfloat));
+}
+
+static inline gint32
+round_clamp (gfloat x, gfloat min, gfloat max)
+{
+	if (x <= min)
+		return (gint32) min;
+	if (x >= max)
+		return (gint32) max;
+	return (gint32) lrintf (x);
+}
+
+static void
+pack_s16_c (const gfloat *src, guint8 *dst, guint n)
+{
+	gint16 *d = (gint16 *) dst;
+	guint   i;
+
+	for (i = 0; i < n; i++)
+		d[i] = round_clamp (src[i] * 32768.0f, -32768.0f, 32767.0f);
+}
+
+static void
+pack_s24_32_c (const gfloat *src, guint8 *dst, guint n)
+{
+	gint32 *d = (gint32 *) dst;
+	guint   i;
+
+	for (i = 0; i < n; i++)
+		d[i] = round_clamp (src[i] * 8388608.0f, -8388608.0f, 8388607.0f);
+}
+
+static void
+pack_s32_c (const gfloat *src, guint8 *dst, guint n)
+{
+	gint32 *d = (gint32 *) dst;
+	guint   i;
+
+	/* 2147483520 is the largest float below 2^31 */
+	for (i = 0; i < n; i++)
+		d[i] = round_clamp (src[i] * 2147483648.0f, -2147483648.0f, 2147483520.0f);
+}
+
+static void
+pack_f32_c (const gfloat *src, guint8 *dst, guint n)
+{
+	memcpy (dst, src, n * sizeof (gfloat));
+}
+
+static void
+downmix_c (const gfloat *src, gfloat *dst, guint frames)
+{
+	guint i;
+
+	for (i = 0; i < frames; i++)
+		dst[i] = (src[2 * i] + src[2 * i + 1]) * 0.5f;
+}
+
+static void
+upmix_c (const gfloat *src, gfloat *dst, guint frames)
+{
+	guint i;
+
+	for (i = 0; i < frames; i++)
+		dst[2 * i] = dst[2 * i + 1] = src[i];
+}
+
+#if defined(__SSE2__)
+static void
+unpack_s16_sse2 (const guint8 *src, gfloat *dst, guint n)
+{
+	const __m128 scale = _mm_set1_ps (1.0f / 32768.0f);
+	guint        i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *) (src + i * 2));
+		/* Each sample in the top half of a 32 bit lane, then shifted
+		 * down again to sign extend it */
+		__m128i lo = _mm_srai_epi32 (_mm_unpacklo_epi16 (v, v), 16);
+		__m128i hi = _mm_srai_epi32 (_mm_unpackhi_epi16 (v, v), 16);
+
+		_mm_storeu_ps (dst + i, _mm_mul_ps (_mm_cvtepi32_ps (lo), scale));
+		_mm_storeu_ps (dst + i + 4, _mm_mul_ps (_mm_cvtepi32_ps (hi), scale));
+	}
+	unpack_s16_c (src + i * 2, dst + i, n - i);
+}
+
+static void
+unpack_s24_32_sse2 (const guint8 *src, gfloat *dst, guint n)
+{
+	const __m128 scale = _mm_set1_ps (1.0f / 8388608.0f);
+	guint        i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *) (src + i * 4));
+
+		v = _mm_srai_epi32 (_mm_slli_epi32 (v, 8), 8);
+		_mm_storeu_ps (dst + i, _mm_mul_ps (_mm_cvtepi32_ps (v), scale));
+	}
+	unpack_s24_32_c (src + i * 4, dst + i, n - i);
+}
+
+static void
+unpack_s32_sse2 (const guint8 *src, gfloat *dst, guint n)
+{
+	const __m128 scale = _mm_set1_ps (1.0f / 2147483648.0f);
+	guint        i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *) (src + i * 4));
+
+		_mm_storeu_ps (dst + i, _mm_mul_ps (_mm_cvtepi32_ps (v), scale));
+	}
+	unpack_s32_c (src + i * 4, dst + i, n - i);
+}
+
+/* Scale, clamp and round four samples to nearest, ties to even */
+static inline __m128i
+pack4_sse2 (const gfloat *src, __m128 scale, __m128 min, __m128 max)
+{
+	__m128 v = _mm_mul_ps (_mm_loadu_ps (src), scale);
+
+	return _mm_cvtps_epi32 (_mm_min_ps (_mm_max_ps (v, min), max));
+}
+
+static void
+pack_s16_sse2 (const gfloat *src, guint8 *dst, guint n)
+{
+	const __m128 scale = _mm_set1_ps (32768.0f);
+	const __m128 min = _mm_set1_ps (-32768.0f);
+	const __m128 max = _mm_set1_ps (32767.0f);
+	guint        i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m128i a = pack4_sse2 (src + i, scale, min, max);
+		__m128i b = pack4_sse2 (src + i + 4, scale, min, max);
+
+		_mm_storeu_si128 ((__m128i *) (dst + i * 2), _mm_packs_epi32 (a, b));
+	}
+	pack_s16_c (src + i, dst + i * 2, n - i);
+}
+
+static void
+pack_s24_32_sse2 (const gfloat *src, guint8 *dst, guint n)
+{
+	const __m128 scale = _mm_set1_ps (8388608.0f);
+	const __m128 min = _mm_set1_ps (-8388608.0f);
+	const __m128 max = _mm_set1_ps (8388607.0f);
+	guint        i;
+
+	for (i = 0; i + 4 <= n; i += 4)
+		_mm_storeu_si128 ((__m128i *) (dst + i * 4),
+				  pack4_sse2 (src + i, scale, min, max));
+	pack_s24_32_c (src + i, dst + i * 4, n - i);
+}
+
+static void
+pack_s32_sse2 (const gfloat *src, guint8 *dst, guint n)
+{
+	const __m128 scale = _mm_set1_ps (2147483648.0f);
+	const __m128 min = _mm_set1_ps (-2147483648.0f);
+	const __m128 max = _mm_set1_ps (2147483520.0f);
+	guint        i;
+
+	for (i = 0; i + 4 <= n; i += 4)
+		_mm_storeu_si128 ((__m128i *) (dst + i * 4),
+				  pack4_sse2 (src + i, scale, min, max));
+	pack_s32_c (src + i, dst + i * 4, n - i);
+}
+
+static void
+downmix_sse2 (const gfloat *src, gfloat *dst, guint frames)
+{
+	const __m128 half = _mm_set1_ps (0.5f);
+	guint        i;
+
+	for (i = 0; i + 4 <= frames; i += 4) {
+		__m128 a = _mm_loadu_ps (src + 2 * i);
+		__m128 b = _mm_loadu_ps (src + 2 * i + 4);
+		__m128 left = _mm_shuffle_ps (a, b, _MM_SHUFFLE (2, 0, 2, 0));
+		__m128 right = _mm_shuffle_ps (a, b, _MM_SHUFFLE (3, 1, 3, 1));
+
+		_mm_storeu_ps (dst + i, _mm_mul_ps (_mm_add_ps (left, right), half));
+	}
+	downmix_c (src + 2 * i, dst + i, frames - i);
+}
+
+static void
+upmix_sse2 (const gfloat *src, gfloat *dst, guint frames)
+{
+	guint i;
+
+	for (i = 0; i + 4 <= frames; i += 4) {
+		__m128 v = _mm_loadu_ps (src + i);
+
+		_mm_storeu_ps (dst + 2 * i, _mm_unpacklo_ps (v, v));
+		_mm_storeu_ps (dst + 2 * i + 4, _mm_unpackhi_ps (v, v));
+	}
+	upmix_c (src + i, dst + 2 * i, frames - i);
+}
+#endif /* __SSE2__ */
+
+#if defined(HAVE_AVX2_KERNELS)
+/*
+ * 16 bit samples are by far the most common, so they get AVX2
+ * versions, picked at run time as the build may not assume AVX2.
+ */
+__attribute__ ((target ("avx2"))) static void
+unpack_s16_avx2 (const guint8 *src, gfloat *dst, guint n)
+{
+	const __m256 scale = _mm256_set1_ps (1.0f / 32768.0f);
+	guint        i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *) (src + i * 2));
+
+		_mm256_storeu_ps (dst + i,
+				  _mm256_mul_ps (_mm256_cvtepi32_ps (_mm256_cvtepi16_epi32 (v)),
+						 scale));
+	}
+	unpack_s16_c (src + i * 2, dst + i, n - i);
+}
+
+__attribute__ ((target ("avx2"))) static void
+pack_s16_avx2 (const gfloat *src, guint8 *dst, guint n)
+{
+	const __m256 scale = _mm256_set1_ps (32768.0f);
+	const __m256 min = _mm256_set1_ps (-32768.0f);
+	const __m256 max = _mm256_set1_ps (32767.0f);
+	guint        i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		__m256 a = _mm256_mul_ps (_mm256_loadu_ps (src + i), scale);
+		__m256 b = _mm256_mul_ps (_mm256_loadu_ps (src + i + 8), scale);
+		__m256i packed;
+
+		a = _mm256_min_ps (_mm256_max_ps (a, min), max);
+		b = _mm256_min_ps (_mm256_max_ps (b, min), max);
+		packed = _mm256_packs_epi32 (_mm256_cvtps_epi32 (a),
+					     _mm256_cvtps_epi32 (b));
+		/* packs works within each 128 bit lane, put them in order */
+		packed = _mm256_permute4x64_epi64 (packed, _MM_SHUFFLE (3, 1, 2, 0));
+		_mm256_storeu_si256 ((__m256i *) (dst + i * 2), packed);
+	}
+	pack_s16_c (src + i, dst + i * 2, n - i);
+}
+#endif /* HAVE_AVX2_KERNELS */
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+static void
+unpack_s16_neon (const guint8 *src, gfloat *dst, guint n)
+{
+	guint i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		int16x8_t v = vld1q_s16 ((const int16_t *) (src + i * 2));
+
+		vst1q_f32 (dst + i,
+			   vmulq_n_f32 (vcvtq_f32_s32 (vmovl_s16 (vget_low_s16 (v))),
+					1.0f / 32768.0f));
+		vst1q_f32 (dst + i + 4,
+			   vmulq_n_f32 (vcvtq_f32_s32 (vmovl_s16 (vget_high_s16 (v))),
+					1.0f / 32768.0f));
+	}
+	unpack_s16_c (src + i * 2, dst + i, n - i);
+}
+
+/*
+ * Scale, clamp and round four 16 bit samples to nearest, ties to
+ * even.  ARMv7 has no rounding conversion, but adding and taking
+ * away 1.5 * 2^23 leaves a float that small rounded the same way.
+ */
+static inline int32x4_t
+pack4_neon (const gfloat *src, gfloat scale, gfloat min, gfloat max)
+{
+	float32x4_t v = vmulq_n_f32 (vld1q_f32 (src), scale);
+
+	v = vminq_f32 (vmaxq_f32 (v, vdupq_n_f32 (min)), vdupq_n_f32 (max));
+#if defined(__aarch64__)
+	return vcvtnq_s32_f32 (v);
+#else
+	v = vsubq_f32 (vaddq_f32 (v, vdupq_n_f32 (12582912.0f)),
+		       vdupq_n_f32 (12582912.0f));
+
+	return vcvtq_s32_f32 (v);
+#endif
+}
+
+static void
+pack_s16_neon (const gfloat *src, guint8 *dst, guint n)
+{
+	guint i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		int32x4_t a = pack4_neon (src + i, 32768.0f, -32768.0f, 32767.0f);
+		int32x4_t b = pack4_neon (src + i + 4, 32768.0f, -32768.0f, 32767.0f);
+
+		vst1q_s16 ((int16_t *) (dst + i * 2),
+			   vcombine_s16 (vqmovn_s32 (a), vqmovn_s32 (b)));
+	}
+	pack_s16_c (src + i, dst + i * 2, n - i);
+}
+
+static void
+downmix_neon (const gfloat *src, gfloat *dst, guint frames)
+{
+	guint i;
+
+	for (i = 0; i + 4 <= frames; i += 4) {
+		float32x4x2_t v = vld2q_f32 (src + 2 * i);
+
+		vst1q_f32 (dst + i, vmulq_n_f32 (vaddq_f32 (v.val[0], v.val[1]), 0.5f));
+	}
+	downmix_c (src + 2 * i, dst + i, frames - i);
+}
+
+static void
+upmix_neon (const gfloat *src, gfloat *dst, guint frames)
+{
+	guint i;
+
+	for (i = 0; i + 4 <= frames; i += 4) {
+		float32x4x2_t v;
+
+		v.val[0] = v.val[1] = vld1q_f32 (src + i);
+		vst2q_f32 (dst + 2 * i, v);
+	}
+	upmix_c (src + i, dst + 2 * i, frames - i);
+}
+#endif /* __ARM_NEON */
+
+static void
+init_kernels (void)
+{
+	unpack_funcs[FORMAT_S16] = unpack_s16_c;
+	unpack_funcs[FORMAT_S24_32] = unpack_s24_32_c;
+	unpack_funcs[FORMAT_S32] = unpack_s32_c;
+	unpack_funcs[FORMAT_F32] = unpack_f32_c;
+	pack_funcs[FORMAT_S16] = pack_s16_c;
+	pack_funcs[FORMAT_S24_32] = pack_s24_32_c;
+	pack_funcs[FORMAT_S32] = pack_s32_c;
+	pack_funcs[FORMAT_F32] = pack_f32_c;
+	downmix_func = downmix_c;
+	upmix_func = upmix_c;
+
+#if defined(__SSE2__)
+	unpack_funcs[FORMAT_S16] = unpack_s16_sse2;
+	unpack_funcs[FORMAT_S24_32] = unpack_s24_32_sse2;
+	unpack_funcs[FORMAT_S32] = unpack_s32_sse2;
+	pack_funcs[FORMAT_S16] = pack_s16_sse2;
+	pack_funcs[FORMAT_S24_32] = pack_s24_32_sse2;
+	pack_funcs[FORMAT_S32] = pack_s32_sse2;
+	downmix_func = downmix_sse2;
+	upmix_func = upmix_sse2;
+#endif
+#if defined(HAVE_AVX2_KERNELS)
+	__builtin_cpu_init ();
+	if (__builtin_cpu_supports ("avx2")) {
+		unpack_funcs[FORMAT_S16] = unpack_s16_avx2;
+		pack_funcs[FORMAT_S16] = pack_s16_avx2;
+	}
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+	unpack_funcs[FORMAT_S16] = unpack_s16_neon;
+	pack_funcs[FORMAT_S16] = pack_s16_neon;
+	downmix_func = downmix_neon;
+	upmix_func = upmix_neon;
+#endif
+}
+
+static gint
+format_index (GstAudioFormat format)
+{
+	switch (format) {
+	case GST_AUDIO_FORMAT_S16:
+		return FORMAT_S16;
+	case GST_AUDIO_FORMAT_S24_32:
+		return FORMAT_S24_32;
+	case GST_AUDIO_FORMAT_S32:
+		return FORMAT_S32;
+	case GST_AUDIO_FORMAT_F32:
+		return FORMAT_F32;
+	default:
+		return -1;
+	}
+}
+
+/*
+ * GstBaseTransform methods
+ */
+
+/*
+ * Any of our formats, and mono or stereo for mono or stereo.  The
+ * caps as they are come first, so the element passes through when
+ * the other side takes them.
+ */
+static GstCaps *
+nsc_audio_convert_transform_caps (GstBaseTransform *trans,
+				  GstPadDirection   direction,
+				  GstCaps          *caps,
+				  GstCaps          *filter)
+{
+	GstCaps *result, *converted;
+	GValue   formats = G_VALUE_INIT;
+	GValue   format = G_VALUE_INIT;
+	guint    i;
+
+	g_value_init (&formats, GST_TYPE_LIST);
+	g_value_init (&format, G_TYPE_STRING);
+	g_value_set_static_string (&format, GST_AUDIO_NE (F32));
+	gst_value_list_append_value (&formats, &format);
+	g_value_set_static_string (&format, GST_AUDIO_NE (S32));
+	gst_value_list_append_value (&formats, &format);
+	g_value_set_static_string (&format, GST_AUDIO_NE (S24_32));
+	gst_value_list_append_value (&formats, &format);
+	g_value_set_static_string (&format, GST_AUDIO_NE (S16));
+	gst_value_list_append_value (&formats, &format);
+	g_value_unset (&format);
+
+	converted = gst_caps_new_empty ();
+	for (i = 0; i < gst_caps_get_size (caps); i++) {
+		GstStructure *structure;
+		gint          channels;
+
+		structure = gst_structure_copy (gst_caps_get_structure (caps, i));
+		gst_structure_set_value (structure, "format", &formats);
+		if (gst_structure_get_int (structure, "channels", &channels) &&
+		    channels <= 2) {
+			gst_structure_set (structure, "channels",
+					   GST_TYPE_INT_RANGE, 1, 2, NULL);
+			gst_structure_remove_field (structure, "channel-mask");
+		}
+		gst_caps_append_structure (converted, structure);
+	}
+	g_value_unset (&formats);
+
+	result = gst_caps_merge (gst_caps_ref (caps), converted);
+
+	if (filter != NULL) {
+		GstCaps *intersection;
+
+		intersection = gst_caps_intersect_full (filter, result,
+							GST_CAPS_INTERSECT_FIRST);
+		gst_caps_unref (result);
+		result = intersection;
+	}
+
+	return result;
+}
+
+/* Keep the format and number of channels if the other side allows */
+static GstCaps *
+nsc_audio_convert_fixate_caps (GstBaseTransform *trans,
+			       GstPadDirection   direction,
+			       GstCaps          *caps,
+			       GstCaps          *othercaps)
+{
+	GstStructure *in, *out;
+	const gchar  *format;
+	gint          channels;
+	guint         i, best = 0;
+
+	in = gst_caps_get_structure (caps, 0);
+	format = gst_structure_get_string (in, "format");
+
+	/* Prefer a structure that allows the same format */
+	for (i = 0; format != NULL && i < gst_caps_get_size (othercaps); i++) {
+		GstStructure *structure = gst_caps_get_structure (othercaps, i);
+		const GValue *value = gst_structure_get_value (structure, "format");
+		GValue        same = G_VALUE_INIT;
+		gboolean      allowed;
+
+		if (value == NULL)
+			continue;
+
+		g_value_init (&same, G_TYPE_STRING);
+		g_value_set_string (&same, format);
+		allowed = gst_value_can_intersect (value, &same);
+		g_value_unset (&same);
+
+		if (allowed) {
+			best = i;
+			break;
+		}
+	}
+
+	out = gst_structure_copy (gst_caps_get_structure (othercaps, best));
+	gst_caps_unref (othercaps);
+	othercaps = gst_caps_new_full (out, NULL);
+
+	if (format != NULL)
+		gst_structure_fixate_field_string (out, "format", format);
+	if (gst_structure_get_int (in, "channels", &channels))
+		gst_structure_fixate_field_nearest_int (out, "channels", channels);
+
+	return gst_caps_fixate (othercaps);
+}
+
+static gboolean
+nsc_audio_convert_get_unit_size (GstBaseTransform *trans,
+				 GstCaps          *caps,
+				 gsize            *size)
+{
+	GstAudioInfo info;
+
+	if (!gst_audio_info_from_caps (&info, caps))
+		return FALSE;
+
+	*size = GST_AUDIO_INFO_BPF (&info);
+
+	return TRUE;
+}
+
+static gboolean
+nsc_audio_convert_set_caps (GstBaseTransform *trans,
+			    GstCaps          *incaps,
+			    GstCaps          *outcaps)
+{
+	NscAudioConvertPrivate *priv = NSC_AUDIO_CONVERT_GET_PRIVATE (trans);
+	gint                    in_format, out_format;
+	gint                    in_channels, out_channels;
+
+	if (!gst_audio_info_from_caps (&priv->in_info, incaps) ||
+	    !gst_audio_info_from_caps (&priv->out_info, outcaps))
+		return FALSE;
+
+	in_format = format_index (GST_AUDIO_INFO_FORMAT (&priv->in_info));
+	out_format = format_index (GST_AUDIO_INFO_FORMAT (&priv->out_info));
+	in_channels = GST_AUDIO_INFO_CHANNELS (&priv->in_info);
+	out_channels = GST_AUDIO_INFO_CHANNELS (&priv->out_info);
+
+	if (in_format < 0 || out_format < 0)
+		return FALSE;
+
+	if (in_channels == out_channels)
+		priv->mix = NULL;
+	else if (in_channels == 2 && out_channels == 1)
+		priv->mix = downmix_func;
+	else if (in_channels == 1 && out_channels == 2)
+		priv->mix = upmix_func;
+	else
+		return FALSE;
+
+	priv->unpack = unpack_funcs[in_format];
+	priv->pack = pack_funcs[out_format];
+
+	g_free (priv->unpacked);
+	g_free (priv->mixed);
+	priv->unpacked = g_new (gfloat, BLOCK_FRAMES * in_channels);
+	priv->mixed = g_new (gfloat, BLOCK_FRAMES * out_channels);
+
+	gst_base_transform_set_passthrough (trans,
+					    in_format == out_format &&
+					    priv->mix == NULL);
+
+	return TRUE;
+}
+
+static GstFlowReturn
+nsc_audio_convert_transform (GstBaseTransform *trans,
+			     GstBuffer        *inbuf,
+			     GstBuffer        *outbuf)
+{
+	NscAudioConvertPrivate *priv = NSC_AUDIO_CONVERT_GET_PRIVATE (trans);
+	GstMapInfo              in_map, out_map;
+	gint                    in_channels, out_channels;
+	gint                    in_bpf, out_bpf;
+	gsize                   frames, done;
+
+	in_channels = GST_AUDIO_INFO_CHANNELS (&priv->in_info);
+	out_channels = GST_AUDIO_INFO_CHANNELS (&priv->out_info);
+	in_bpf = GST_AUDIO_INFO_BPF (&priv->in_info);
+	out_bpf = GST_AUDIO_INFO_BPF (&priv->out_info);
+
+	if (!gst_buffer_map (inbuf, &in_map, GST_MAP_READ))
+		return GST_FLOW_ERROR;
+	if (!gst_buffer_map (outbuf, &out_map, GST_MAP_WRITE)) {
+		gst_buffer_unmap (inbuf, &in_map);
+		return GST_FLOW_ERROR;
+	}
+
+	frames = MIN (in_map.size / in_bpf, out_map.size / out_bpf);
+	for (done = 0; done < frames; done += BLOCK_FRAMES) {
+		guint   n = MIN (BLOCK_FRAMES, frames - done);
+		gfloat *samples = priv->unpacked;
+
+		priv->unpack (in_map.data + done * in_bpf, samples, n * in_channels);
+		if (priv->mix != NULL) {
+			priv->mix (samples, priv->mixed, n);
+			samples = priv->mixed;
+		}
+		priv->pack (samples, out_map.data + done * out_bpf, n * out_channels);
+	}
+
+	gst_buffer_unmap (outbuf, &out_map);
+	gst_buffer_unmap (inbuf, &in_map);
+
+	return GST_FLOW_OK;
+}
+
+/*
+ * GObject methods
+ */
+
+static void
+nsc_audio_convert_finalize (GObject *object)
+{
+	NscAudioConvertPrivate *priv = NSC_AUDIO_CONVERT_GET_PRIVATE (object);
+
+	if (priv != NULL) {
+		g_free (priv->unpacked);
+		g_free (priv->mixed);
+		g_free (priv);
+
+		(NSC_AUDIO_CONVERT (object))->priv = NULL;
+	}
+
+	G_OBJECT_CLASS (nsc_audio_convert_parent_class)->finalize (object);
+}
+
+static void
+nsc_audio_convert_class_init (NscAudioConvertClass *klass)
+{
+	GObjectClass          *object_class = G_OBJECT_CLASS (klass);
+	GstElementClass       *element_class = GST_ELEMENT_CLASS (klass);
+	GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS (klass);
+
+	object_class->finalize = nsc_audio_convert_finalize;
+
+	gst_element_class_add_pad_template (element_class,
+					    gst_static_pad_template_get (&src_template));
+	gst_element_class_add_pad_template (element_class,
+					    gst_static_pad_template_get (&sink_template));
+	gst_element_class_set_static_metadata (element_class,
+					       "Audio format converter",
+					       "Filter/Converter/Audio",
+					       "Converts sample formats and mono to stereo in one pass",
+					       "agent <agent@local>");
+
+	trans_class->transform_caps = nsc_audio_convert_transform_caps;
+	trans_class->fixate_caps = nsc_audio_convert_fixate_caps;
+	trans_class->get_unit_size = nsc_audio_convert_get_unit_size;
+	trans_class->set_caps = nsc_audio_convert_set_caps;
+	trans_class->transform = nsc_audio_convert_transform;
+
+	init_kernels ();
+}
+
+static void
+nsc_audio_convert_init (NscAudioConvert *self)
+{
+	self->priv = g_malloc0 (sizeof (NscAudioConvertPrivate));
+}
+
+/*
+ * Public Methods
+ */
+
+/**
+ * Make nscaudioconvert available to gst_element_factory_make(),
+ * without a plugin of its own.
+ */
+gboolean
+nsc_audio_convert_register (void)
+{
+	return gst_element_register (NULL, NSC_AUDIO_CONVERT_NAME,
+				     GST_RANK_NONE, NSC_TYPE_AUDIO_CONVERT);
+}
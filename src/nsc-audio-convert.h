@@ -0,0 +1,61 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-audio-convert.h
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+#ifndef NSC_AUDIO_CONVERT_H
+#define NSC_AUDIO_CONVERT_H
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gst/base/gstbasetransform.h>
+
+G_BEGIN_DECLS
+
+#define NSC_TYPE_AUDIO_CONVERT            (nsc_audio_convert_get_type ())
+#define NSC_AUDIO_CONVERT(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), NSC_TYPE_AUDIO_CONVERT, NscAudioConvert))
+#define NSC_AUDIO_CONVERT_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), NSC_TYPE_AUDIO_CONVERT, NscAudioConvertClass))
+#define NSC_IS_AUDIO_CONVERT(obj)         (G_TYPE_CHECK_INSTANCE_TYPE (obj, NSC_TYPE_AUDIO_CONVERT))
+#define NSC_IS_AUDIO_CONVERT_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), NSC_TYPE_AUDIO_CONVERT))
+
+/* The element name it is registered under */
+#define NSC_AUDIO_CONVERT_NAME "nscaudioconvert"
+
+typedef struct NscAudioConvertPrivate NscAudioConvertPrivate;
+
+typedef struct {
+	/* Parent object */
+	GstBaseTransform element;
+	/* Private data pointer */
+	gpointer         priv;
+} NscAudioConvert;
+
+typedef struct {
+	GstBaseTransformClass parent_class;
+} NscAudioConvertClass;
+
+GType    nsc_audio_convert_get_type (void);
+gboolean nsc_audio_convert_register (void);
+
+G_END_DECLS
+
+#endif /* NSC_AUDIO_CONVERT_H */
@@ -0,0 +1,253 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-checksum.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+/*
+ * The file is decoded in a thread of its own, with the audio
+ * converted to the caps the encoder was given, so that a lossless
+ * file yields the same bytes as went into it.
+ */
+
+#include <config.h>
+
+#include <glib/gi18n.h>
+#include <gio/gio.h>
+#include <gst/gst.h>
+
+#include "nsc-checksum.h"
+#include "nsc-error.h"
+
+/* How often the decoding thread looks at the cancellable */
+#define POLL_INTERVAL (100 * GST_MSECOND)
+
+typedef struct {
+	GFile   *file;
+	GstCaps *caps;
+} Request;
+
+/*
+ * Private Methods
+ */
+static void
+request_free (Request *request)
+{
+	g_object_unref (request->file);
+	gst_caps_unref (request->caps);
+	g_free (request);
+}
+
+static GstPadProbeReturn
+buffer_probe_cb (GstPad          *pad,
+		 GstPadProbeInfo *info,
+		 gpointer         user_data)
+{
+	nsc_checksum_add_buffer (user_data, GST_PAD_PROBE_INFO_BUFFER (info));
+
+	return GST_PAD_PROBE_OK;
+}
+
+static void
+pad_added_cb (GstElement *decodebin,
+	      GstPad     *pad,
+	      gpointer    user_data)
+{
+	GstPad *sink_pad;
+
+	sink_pad = gst_element_get_static_pad (GST_ELEMENT (user_data), "sink");
+	if (!gst_pad_is_linked (sink_pad))
+		gst_pad_link (pad, sink_pad);
+	gst_object_unref (sink_pad);
+}
+
+static GstElement *
+build_pipeline (Request   *request,
+		GChecksum *checksum)
+{
+	GstElement *pipeline, *src, *decode, *convert, *filter, *sink;
+	GstCaps    *caps;
+	GstPad     *pad;
+
+	pipeline = gst_pipeline_new ("checksum");
+	src = gst_element_factory_make ("giosrc", NULL);
+	decode = gst_element_factory_make ("decodebin", NULL);
+	convert = gst_element_factory_make ("audioconvert", NULL);
+	filter = gst_element_factory_make ("capsfilter", NULL);
+	sink = gst_element_factory_make ("fakesink", NULL);
+
+	if (src == NULL || decode == NULL || convert == NULL ||
+	    filter == NULL || sink == NULL) {
+		if (src)
+			gst_object_unref (src);
+		if (decode)
+			gst_object_unref (decode);
+		if (convert)
+			gst_object_unref (convert);
+		if (filter)
+			gst_object_unref (filter);
+		if (sink)
+			gst_object_unref (sink);
+		gst_object_unref (pipeline);
+		return NULL;
+	}
+
+	gst_bin_add_many (GST_BIN (pipeline), src, decode, convert,
+			  filter, sink, NULL);
+
+	g_object_set (src, "file", request->file, NULL);
+
+	caps = gst_caps_new_empty_simple ("audio/x-raw");
+	g_object_set (decode, "caps", caps, "expose-all-streams", FALSE, NULL);
+	gst_caps_unref (caps);
+
+	/* Any difference is to show, not to be smoothed over */
+	gst_util_set_object_arg (G_OBJECT (convert), "dithering", "none");
+	gst_util_set_object_arg (G_OBJECT (convert), "noise-shaping", "none");
+	g_object_set (filter, "caps", request->caps, NULL);
+	g_object_set (sink, "sync", FALSE, NULL);
+
+	if (!gst_element_link (src, decode) ||
+	    !gst_element_link_many (convert, filter, sink, NULL)) {
+		gst_object_unref (pipeline);
+		return NULL;
+	}
+
+	g_signal_connect (decode, "pad-added", G_CALLBACK (pad_added_cb), convert);
+
+	pad = gst_element_get_static_pad (sink, "sink");
+	gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+			   buffer_probe_cb, checksum, NULL);
+	gst_object_unref (pad);
+
+	return pipeline;
+}
+
+static void
+checksum_thread (GTask        *task,
+		 gpointer      source_object,
+		 gpointer      task_data,
+		 GCancellable *cancellable)
+{
+	GstElement *pipeline;
+	GstBus     *bus;
+	GstMessage *msg = NULL;
+	GChecksum  *checksum;
+	GError     *error = NULL;
+
+	checksum = g_checksum_new (G_CHECKSUM_MD5);
+
+	pipeline = build_pipeline (task_data, checksum);
+	if (pipeline == NULL) {
+		g_task_return_new_error (task, NSC_ERROR, NSC_ERROR_INTERNAL_ERROR,
+					 _("Could not create GStreamer pipeline to verify the file"));
+		g_checksum_free (checksum);
+		return;
+	}
+
+	bus = gst_element_get_bus (pipeline);
+	gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+	while (msg == NULL) {
+		if (g_cancellable_set_error_if_cancelled (cancellable, &error))
+			break;
+
+		msg = gst_bus_timed_pop_filtered (bus, POLL_INTERVAL,
+						  GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+	}
+
+	if (msg != NULL && GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+		gst_message_parse_error (msg, &error, NULL);
+
+	/* Stopping joins the streaming threads, so checksum is ours again */
+	gst_element_set_state (pipeline, GST_STATE_NULL);
+
+	if (error != NULL)
+		g_task_return_error (task, error);
+	else
+		g_task_return_pointer (task, g_strdup (g_checksum_get_string (checksum)),
+				       g_free);
+
+	if (msg != NULL)
+		gst_message_unref (msg);
+	gst_object_unref (bus);
+	gst_object_unref (pipeline);
+	g_checksum_free (checksum);
+}
+
+/*
+ * Public Methods
+ */
+
+/**
+ * Add the samples in the buffer to the checksum.
+ */
+void
+nsc_checksum_add_buffer (GChecksum *checksum,
+			 GstBuffer *buffer)
+{
+	GstMapInfo map;
+
+	if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+		return;
+
+	g_checksum_update (checksum, map.data, map.size);
+	gst_buffer_unmap (buffer, &map);
+}
+
+/**
+ * Decode the file and work out the MD5 of its audio as caps, which
+ * must be fixed raw audio caps.
+ */
+void
+nsc_checksum_file_async (GFile               *file,
+			 GstCaps             *caps,
+			 GCancellable        *cancellable,
+			 GAsyncReadyCallback  callback,
+			 gpointer             user_data)
+{
+	GTask   *task;
+	Request *request;
+
+	g_return_if_fail (G_IS_FILE (file));
+	g_return_if_fail (GST_IS_CAPS (caps));
+
+	request = g_new0 (Request, 1);
+	request->file = g_object_ref (file);
+	request->caps = gst_caps_ref (caps);
+
+	task = g_task_new (NULL, cancellable, callback, user_data);
+	g_task_set_task_data (task, request, (GDestroyNotify) request_free);
+	g_task_run_in_thread (task, checksum_thread);
+	g_object_unref (task);
+}
+
+/**
+ * Returns the MD5 as a hex string to be freed, or NULL with error set.
+ */
+gchar *
+nsc_checksum_file_finish (GAsyncResult  *result,
+			  GError       **error)
+{
+	g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+
+	return g_task_propagate_pointer (G_TASK (result), error);
+}
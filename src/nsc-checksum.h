@@ -0,0 +1,49 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-checksum.h
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+#ifndef NSC_CHECKSUM_H
+#define NSC_CHECKSUM_H
+
+#include <gio/gio.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/*
+ * MD5 of decoded audio, used to check that a lossless file decodes
+ * to exactly the samples that were given to its encoder.
+ */
+void   nsc_checksum_add_buffer  (GChecksum           *checksum,
+				 GstBuffer           *buffer);
+void   nsc_checksum_file_async  (GFile               *file,
+				 GstCaps             *caps,
+				 GCancellable        *cancellable,
+				 GAsyncReadyCallback  callback,
+				 gpointer             user_data);
+gchar *nsc_checksum_file_finish (GAsyncResult        *result,
+				 GError             **error);
+
+G_END_DECLS
+
+#endif /* NSC_CHECKSUM_H */
@@ -0,0 +1,460 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-cli.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+/*
+ * caja-sound-converter converts one stream from the command line,
+ * by default from stdin to stdout, so it can sit in the middle of a
+ * shell pipeline.  Data is only read as fast as the encoder takes
+ * it, so memory use stays bounded by GStreamer's own queues however
+ * long the stream is.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <locale.h>
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <gio/gio.h>
+#include <gio/gunixinputstream.h>
+#include <gio/gunixoutputstream.h>
+#include <gst/gst.h>
+
+#include "nsc-gstreamer.h"
+#include "nsc-history.h"
+#include "rb-gst-media-types.h"
+
+#define DEFAULT_PROFILE "audio/x-vorbis"
+
+static GMainLoop *loop = NULL;
+static gint       exit_status = EXIT_SUCCESS;
+
+static gchar     *profile_name = NULL;
+static gchar     *preset = NULL;
+static gint       resample_quality = -1;
+static gboolean   list_profiles = FALSE;
+static gboolean   show_history = FALSE;
+static gint       history_days = 0;
+
+static const GOptionEntry entries[] = {
+	{ "profile", 'p', 0, G_OPTION_ARG_STRING, &profile_name,
+	  N_("Encoding profile, by name or media type"), N_("PROFILE") },
+	{ "preset", 0, 0, G_OPTION_ARG_STRING, &preset,
+	  N_("Encoder preset: fast, balanced or smallest"), N_("PRESET") },
+	{ "resample-quality", 0, 0, G_OPTION_ARG_INT, &resample_quality,
+	  N_("Sample rate conversion quality, from 0 (fastest) to 10"), N_("QUALITY") },
+	{ "list-profiles", 'l', 0, G_OPTION_ARG_NONE, &list_profiles,
+	  N_("List the encoding profiles"), NULL },
+	{ "history", 0, 0, G_OPTION_ARG_NONE, &show_history,
+	  N_("Summarise the conversions done from Caja"), NULL },
+	{ "history-days", 0, 0, G_OPTION_ARG_INT, &history_days,
+	  N_("Only summarise the last DAYS days of history"), N_("DAYS") },
+	{ NULL }
+};
+
+static void
+completion_cb (NscGStreamer *gst, gpointer user_data)
+{
+	g_main_loop_quit (loop);
+}
+
+static void
+error_cb (NscGStreamer *gst, GError *error, gpointer user_data)
+{
+	g_printerr ("%s\n", error->message);
+	exit_status = EXIT_FAILURE;
+	g_main_loop_quit (loop);
+}
+
+static void
+print_profiles (void)
+{
+	GstEncodingTarget *target;
+	const GList       *p;
+
+	target = rb_gst_get_default_encoding_target ();
+	if (target == NULL)
+		return;
+
+	for (p = gst_encoding_target_get_profiles (target); p != NULL; p = p->next) {
+		GstEncodingProfile *profile = p->data;
+		gchar              *media_type;
+
+		media_type = rb_gst_encoding_profile_get_media_type (profile);
+		g_print ("%-12s %-16s %s\n",
+			 gst_encoding_profile_get_name (profile),
+			 media_type ? media_type : "",
+			 gst_encoding_profile_get_description (profile));
+		g_free (media_type);
+	}
+
+	gst_encoding_target_unref (target);
+}
+
+static GstEncodingProfile *
+find_profile (const gchar *name)
+{
+	GstEncodingProfile *profile;
+
+	profile = rb_gst_get_encoding_profile_by_name (name);
+	if (profile == NULL)
+		profile = rb_gst_get_encoding_profile (name);
+
+	return profile;
+}
+
+/*
+ * History summary
+ */
+
+/* What the jobs of one source format, target profile or device took */
+typedef struct {
+	gchar   *label;
+	guint    jobs;
+	guint    failed;
+	gdouble  audio;
+	gdouble  wall;
+	gdouble  cpu;
+	guint64  peak_rss;
+	guint64  bytes_read;
+	guint64  bytes_written;
+} HistoryStats;
+
+/* The fields the history is broken down by */
+static const struct {
+	const gchar *field;
+	const gchar *title;
+} history_groups[] = {
+	{ "source_type", N_("By source format") },
+	{ "target",      N_("By encoding profile") },
+	{ "device",      N_("By source file system") },
+};
+
+typedef struct {
+	gint64      since;
+	GHashTable *groups[G_N_ELEMENTS (history_groups)];
+} HistorySummary;
+
+static void
+history_stats_free (HistoryStats *stats)
+{
+	g_free (stats->label);
+	g_free (stats);
+}
+
+static guint64
+record_get_uint (GHashTable *record, const gchar *field)
+{
+	const gchar *value = g_hash_table_lookup (record, field);
+
+	return value ? g_ascii_strtoull (value, NULL, 10) : 0;
+}
+
+static gdouble
+record_get_double (GHashTable *record, const gchar *field)
+{
+	const gchar *value = g_hash_table_lookup (record, field);
+
+	return value ? g_ascii_strtod (value, NULL) : 0;
+}
+
+/* File system ids mean nothing to people, so show a folder on it */
+static gchar *
+history_label (GHashTable *record, const gchar *field, const gchar *key)
+{
+	const gchar *uri;
+	GFile       *file, *parent;
+	gchar       *label;
+
+	uri = g_hash_table_lookup (record, "source");
+	if (g_strcmp0 (field, "device") != 0 || uri == NULL)
+		return g_strdup (key);
+
+	file = g_file_new_for_uri (uri);
+	parent = g_file_get_parent (file);
+	label = g_file_get_parse_name (parent ? parent : file);
+	g_clear_object (&parent);
+	g_object_unref (file);
+
+	return label;
+}
+
+static void
+history_cb (GHashTable *record, gpointer user_data)
+{
+	HistorySummary *summary = user_data;
+	guint           i;
+
+	if ((gint64) record_get_uint (record, "time") < summary->since)
+		return;
+
+	for (i = 0; i < G_N_ELEMENTS (history_groups); i++) {
+		const gchar  *field = history_groups[i].field;
+		const gchar  *key;
+		HistoryStats *stats;
+
+		key = g_hash_table_lookup (record, field);
+		if (key == NULL)
+			key = _("unknown");
+
+		stats = g_hash_table_lookup (summary->groups[i], key);
+		if (stats == NULL) {
+			stats = g_new0 (HistoryStats, 1);
+			stats->label = history_label (record, field, key);
+			g_hash_table_insert (summary->groups[i], g_strdup (key), stats);
+		}
+
+		stats->jobs++;
+		if (g_strcmp0 (g_hash_table_lookup (record, "outcome"), "ok") != 0)
+			stats->failed++;
+		stats->audio += record_get_double (record, "duration");
+		stats->wall += record_get_double (record, "wall");
+		stats->cpu += record_get_double (record, "cpu");
+		stats->peak_rss = MAX (stats->peak_rss,
+				       record_get_uint (record, "peak_rss"));
+		stats->bytes_read += record_get_uint (record, "bytes_read");
+		stats->bytes_written += record_get_uint (record, "bytes_written");
+	}
+}
+
+/* The costliest first */
+static gint
+compare_stats (gconstpointer a, gconstpointer b)
+{
+	const HistoryStats *sa = a, *sb = b;
+
+	return (sa->cpu < sb->cpu) - (sa->cpu > sb->cpu);
+}
+
+static gchar *
+format_time (gdouble seconds)
+{
+	gint secs = seconds + 0.5;
+
+	return g_strdup_printf ("%d:%02d:%02d",
+				secs / 3600, secs / 60 % 60, secs % 60);
+}
+
+static void
+print_stats (const HistoryStats *stats)
+{
+	gchar *audio, *wall, *rss, *read, *written;
+	gchar  speed[16] = "-", cpu[16] = "-";
+
+	audio = format_time (stats->audio);
+	wall = format_time (stats->wall);
+	rss = g_format_size (stats->peak_rss * 1024);
+	read = g_format_size (stats->bytes_read);
+	written = g_format_size (stats->bytes_written);
+
+	/* Times real time, and CPU seconds per minute of audio */
+	if (stats->wall > 0)
+		g_snprintf (speed, sizeof (speed), "%.1fx", stats->audio / stats->wall);
+	if (stats->audio > 0)
+		g_snprintf (cpu, sizeof (cpu), "%.1f", stats->cpu * 60 / stats->audio);
+
+	g_print ("  %-32s %6u %6u %10s %10s %7s %7s %10s %10s %10s\n",
+		 stats->label, stats->jobs, stats->failed, audio, wall,
+		 speed, cpu, rss, read, written);
+
+	g_free (audio);
+	g_free (wall);
+	g_free (rss);
+	g_free (read);
+	g_free (written);
+}
+
+static gint
+print_history (void)
+{
+	HistorySummary  summary;
+	GError         *error = NULL;
+	gboolean        ok;
+	guint           i;
+
+	summary.since = 0;
+	if (history_days > 0)
+		summary.since = g_get_real_time () / G_USEC_PER_SEC -
+				(gint64) history_days * 24 * 60 * 60;
+
+	for (i = 0; i < G_N_ELEMENTS (history_groups); i++)
+		summary.groups[i] = g_hash_table_new_full (g_str_hash, g_str_equal,
+							   g_free,
+							   (GDestroyNotify) history_stats_free);
+
+	ok = nsc_history_foreach (history_cb, &summary, &error);
+	if (ok) {
+		for (i = 0; i < G_N_ELEMENTS (history_groups); i++) {
+			GList *stats, *l;
+
+			g_print ("%s\n", _(history_groups[i].title));
+			g_print ("  %-32s %6s %6s %10s %10s %7s %7s %10s %10s %10s\n",
+				 "", _("Jobs"), _("Failed"), _("Audio"), _("Wall"),
+				 _("Speed"), _("CPU/min"), _("Peak RSS"),
+				 _("Read"), _("Written"));
+
+			stats = g_hash_table_get_values (summary.groups[i]);
+			stats = g_list_sort (stats, compare_stats);
+			for (l = stats; l != NULL; l = l->next)
+				print_stats (l->data);
+			g_list_free (stats);
+
+			g_print ("\n");
+		}
+	} else {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+	}
+
+	for (i = 0; i < G_N_ELEMENTS (history_groups); i++)
+		g_hash_table_unref (summary.groups[i]);
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* "-" is stdin or stdout */
+static GInputStream *
+open_input (const gchar *arg, GError **error)
+{
+	GFile        *file;
+	GInputStream *stream;
+
+	if (arg == NULL || g_strcmp0 (arg, "-") == 0)
+		return g_unix_input_stream_new (0, FALSE);
+
+	file = g_file_new_for_commandline_arg (arg);
+	stream = G_INPUT_STREAM (g_file_read (file, NULL, error));
+	g_object_unref (file);
+
+	return stream;
+}
+
+static GOutputStream *
+open_output (const gchar *arg, GError **error)
+{
+	GFile         *file;
+	GOutputStream *stream;
+
+	if (arg == NULL || g_strcmp0 (arg, "-") == 0)
+		return g_unix_output_stream_new (1, FALSE);
+
+	file = g_file_new_for_commandline_arg (arg);
+	stream = G_OUTPUT_STREAM (g_file_replace (file, NULL, FALSE,
+						  G_FILE_CREATE_NONE,
+						  NULL, error));
+	g_object_unref (file);
+
+	return stream;
+}
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext     *context;
+	GstEncodingProfile *profile;
+	NscGStreamer       *gst;
+	GInputStream       *input = NULL;
+	GOutputStream      *output = NULL;
+	GError             *error = NULL;
+
+	setlocale (LC_ALL, "");
+	bindtextdomain (GETTEXT_PACKAGE, MATELOCALEDIR);
+	bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
+	textdomain (GETTEXT_PACKAGE);
+
+	context = g_option_context_new (_("[INPUT [OUTPUT]]"));
+	g_option_context_set_summary (context,
+				      _("Convert INPUT to OUTPUT, or stdin to stdout."));
+	g_option_context_add_main_entries (context, entries, GETTEXT_PACKAGE);
+	g_option_context_add_group (context, gst_init_get_option_group ());
+
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+	g_option_context_free (context);
+
+	if (list_profiles) {
+		print_profiles ();
+		return EXIT_SUCCESS;
+	}
+
+	if (show_history)
+		return print_history ();
+
+	profile = find_profile (profile_name ? profile_name : DEFAULT_PROFILE);
+	if (profile == NULL) {
+		g_printerr (_("Unknown encoding profile %s\n"),
+			    profile_name ? profile_name : DEFAULT_PROFILE);
+		return EXIT_FAILURE;
+	}
+
+	input = open_input (argc > 1 ? argv[1] : NULL, &error);
+	if (input != NULL)
+		output = open_output (argc > 2 ? argv[2] : NULL, &error);
+	if (output == NULL) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		return EXIT_FAILURE;
+	}
+
+	loop = g_main_loop_new (NULL, FALSE);
+
+	gst = nsc_gstreamer_new (profile);
+	gst_encoding_profile_unref (profile);
+	if (preset != NULL)
+		g_object_set (G_OBJECT (gst), "preset", preset, NULL);
+	if (resample_quality >= 0)
+		g_object_set (G_OBJECT (gst), "resample-quality",
+			      CLAMP (resample_quality, 0, 10), NULL);
+
+	g_signal_connect (G_OBJECT (gst), "completion",
+			  (GCallback) completion_cb, NULL);
+	g_signal_connect (G_OBJECT (gst), "error",
+			  (GCallback) error_cb, NULL);
+
+	nsc_gstreamer_convert_stream (gst, input, output, &error);
+	if (error != NULL) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		exit_status = EXIT_FAILURE;
+	} else {
+		g_main_loop_run (loop);
+	}
+
+	if (!g_output_stream_close (output, NULL, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		exit_status = EXIT_FAILURE;
+	}
+
+	g_object_unref (gst);
+	g_object_unref (input);
+	g_object_unref (output);
+	g_main_loop_unref (loop);
+
+	return exit_status;
+}
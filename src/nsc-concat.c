@@ -0,0 +1,818 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-concat.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+/*
+ * Joins the parts of a long file that were encoded in parallel
+ * back into one file, without decoding them.
+ *
+ * FLAC: the first part's metadata is kept, less its seek table,
+ * and every frame is rewritten as a variable block size frame
+ * numbered by its first sample across the whole file, so the last
+ * frame of each part is valid in the middle of the stream.  Parts
+ * are cut at NSC_CONCAT_BLOCK, so that frame is normally a full one;
+ * one under the 16 samples FLAC allows anywhere but at the very end
+ * fails the join.
+ * STREAMINFO is patched afterwards; the MD5 signature is cleared,
+ * as each part's only covers its own samples.
+ *
+ * Ogg: the parts are chained, which the Ogg format allows.  Each
+ * link keeps its own headers and granule positions, and only needs
+ * a serial number no earlier link uses.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <gio/gio.h>
+#include <gst/gst.h>
+
+#include "nsc-concat.h"
+#include "nsc-error.h"
+#include "rb-gst-media-types.h"
+
+#define READ_SIZE (64 * 1024)
+
+/* FLAC metadata block types */
+#define FLAC_STREAMINFO  0
+#define FLAC_SEEKTABLE   3
+
+/* Sync, coded sample number, block size, sample rate and CRC-8 */
+#define FLAC_MAX_HEADER  16
+
+/* The shortest block allowed before the last one */
+#define FLAC_MIN_BLOCK   16
+
+#define OGG_HEADER       27
+
+static guint8  crc8_table[256];
+static guint16 crc16_table[256];
+static guint32 ogg_crc_table[256];
+
+static gpointer
+init_crc_tables (gpointer data)
+{
+	guint i, j;
+
+	for (i = 0; i < 256; i++) {
+		guint8  c8 = i;
+		guint16 c16 = i << 8;
+		guint32 c32 = i << 24;
+
+		for (j = 0; j < 8; j++) {
+			c8 = (c8 & 0x80) ? (c8 << 1) ^ 0x07 : c8 << 1;
+			c16 = (c16 & 0x8000) ? (c16 << 1) ^ 0x8005 : c16 << 1;
+			c32 = (c32 & 0x80000000) ? (c32 << 1) ^ 0x04c11db7 : c32 << 1;
+		}
+
+		crc8_table[i] = c8;
+		crc16_table[i] = c16;
+		ogg_crc_table[i] = c32;
+	}
+
+	return NULL;
+}
+
+static guint8
+crc8 (const guint8 *data, gsize length)
+{
+	guint8 crc = 0;
+
+	while (length--)
+		crc = crc8_table[crc ^ *data++];
+
+	return crc;
+}
+
+#define CRC16_UPDATE(crc, byte) \
+	((guint16) (((crc) << 8) ^ crc16_table[((crc) >> 8) ^ (byte)]))
+
+static guint16
+crc16 (guint16 crc, const guint8 *data, gsize length)
+{
+	while (length--)
+		crc = CRC16_UPDATE (crc, *data++);
+
+	return crc;
+}
+
+static guint32
+ogg_crc (const guint8 *data, gsize length)
+{
+	guint32 crc = 0;
+
+	while (length--)
+		crc = (crc << 8) ^ ogg_crc_table[((crc >> 24) & 0xff) ^ *data++];
+
+	return crc;
+}
+
+/*
+ * Buffered reading of one part.  DATA() is only valid until the
+ * next reader_fill().
+ */
+typedef struct {
+	GInputStream *in;
+	GByteArray   *buf;
+	guint         pos;
+	gboolean      eof;
+} Reader;
+
+#define AVAIL(r) ((r)->buf->len - (r)->pos)
+#define DATA(r)  ((r)->buf->data + (r)->pos)
+
+static gboolean
+reader_open (Reader        *r,
+	     GFile         *file,
+	     GCancellable  *cancellable,
+	     GError       **error)
+{
+	r->in = G_INPUT_STREAM (g_file_read (file, cancellable, error));
+	r->buf = g_byte_array_new ();
+	r->pos = 0;
+	r->eof = FALSE;
+
+	return r->in != NULL;
+}
+
+static void
+reader_close (Reader *r)
+{
+	if (r->in)
+		g_object_unref (r->in);
+	g_byte_array_free (r->buf, TRUE);
+}
+
+/* Make at least want bytes available, unless the part ends first */
+static gboolean
+reader_fill (Reader        *r,
+	     gsize          want,
+	     GCancellable  *cancellable,
+	     GError       **error)
+{
+	while (AVAIL (r) < want && !r->eof) {
+		guint  old;
+		gssize n;
+
+		if (r->pos > 0) {
+			g_byte_array_remove_range (r->buf, 0, r->pos);
+			r->pos = 0;
+		}
+
+		old = r->buf->len;
+		g_byte_array_set_size (r->buf, old + READ_SIZE);
+		n = g_input_stream_read (r->in, r->buf->data + old, READ_SIZE,
+					 cancellable, error);
+		g_byte_array_set_size (r->buf, old + MAX (n, 0));
+
+		if (n < 0)
+			return FALSE;
+		if (n == 0)
+			r->eof = TRUE;
+	}
+
+	return TRUE;
+}
+
+static void
+set_corrupt_error (GError **error, GFile *part)
+{
+	gchar *name;
+
+	name = g_file_get_parse_name (part);
+	g_set_error (error, NSC_ERROR, NSC_ERROR_INTERNAL_ERROR,
+		     _("The converted part %s is damaged"), name);
+	g_free (name);
+}
+
+/*
+ * FLAC
+ */
+typedef struct {
+	guint   length;
+	guint   number_length;
+	guint32 block_size;
+} FlacFrameHeader;
+
+typedef struct {
+	GOutputStream *out;
+	guint8         streaminfo[34];
+	guint64        samples;
+	guint32        min_block;
+	guint32        max_block;
+	guint32        min_frame;
+	guint32        max_frame;
+
+	/* Block size of the frame written last */
+	guint32        last_block;
+} FlacConcat;
+
+static gboolean
+flac_parse_frame_header (const guint8    *p,
+			 gsize            n,
+			 FlacFrameHeader *h)
+{
+	guint bs_code, rate_code, extra, i;
+
+	if (n < 5 || p[0] != 0xFF || (p[1] & 0xFE) != 0xF8)
+		return FALSE;
+
+	bs_code = p[2] >> 4;
+	rate_code = p[2] & 0x0F;
+	if (bs_code == 0 || rate_code == 15 || (p[3] >> 4) >= 11 ||
+	    ((p[3] >> 1) & 0x07) == 3 || ((p[3] >> 1) & 0x07) == 7 || (p[3] & 0x01))
+		return FALSE;
+
+	/* The frame or sample number, coded like UTF-8 */
+	if (!(p[4] & 0x80))
+		h->number_length = 1;
+	else if ((p[4] & 0xE0) == 0xC0)
+		h->number_length = 2;
+	else if ((p[4] & 0xF0) == 0xE0)
+		h->number_length = 3;
+	else if ((p[4] & 0xF8) == 0xF0)
+		h->number_length = 4;
+	else if ((p[4] & 0xFC) == 0xF8)
+		h->number_length = 5;
+	else if ((p[4] & 0xFE) == 0xFC)
+		h->number_length = 6;
+	else if (p[4] == 0xFE)
+		h->number_length = 7;
+	else
+		return FALSE;
+
+	extra = (bs_code == 6) ? 1 : (bs_code == 7) ? 2 : 0;
+	extra += (rate_code == 12) ? 1 : (rate_code == 13 || rate_code == 14) ? 2 : 0;
+
+	h->length = 4 + h->number_length + extra + 1;
+	if (h->length > n)
+		return FALSE;
+
+	for (i = 1; i < h->number_length; i++)
+		if ((p[4 + i] & 0xC0) != 0x80)
+			return FALSE;
+
+	if (crc8 (p, h->length - 1) != p[h->length - 1])
+		return FALSE;
+
+	i = 4 + h->number_length;
+	if (bs_code == 1)
+		h->block_size = 192;
+	else if (bs_code <= 5)
+		h->block_size = 576 << (bs_code - 2);
+	else if (bs_code == 6)
+		h->block_size = p[i] + 1;
+	else if (bs_code == 7)
+		h->block_size = ((p[i] << 8) | p[i + 1]) + 1;
+	else
+		h->block_size = 256 << (bs_code - 8);
+
+	return TRUE;
+}
+
+static guint
+flac_code_number (guint64 number, guint8 *out)
+{
+	guint length, i;
+
+	if (number < 0x80) {
+		out[0] = number;
+		return 1;
+	}
+
+	for (length = 2; length < 7; length++)
+		if (number < (G_GUINT64_CONSTANT (1) << (5 * length + 1)))
+			break;
+
+	for (i = length - 1; i > 0; i--) {
+		out[i] = 0x80 | (number & 0x3F);
+		number >>= 6;
+	}
+	out[0] = ((0xFF << (8 - length)) & 0xFF) | number;
+
+	return length;
+}
+
+/* Renumber a frame by its first sample and write it out */
+static gboolean
+flac_write_frame (FlacConcat            *fc,
+		  const guint8          *frame,
+		  gsize                  length,
+		  const FlacFrameHeader *h,
+		  GCancellable          *cancellable,
+		  GError               **error)
+{
+	guint8  header[FLAC_MAX_HEADER];
+	guint8  footer[2];
+	guint   n, extra;
+	guint16 crc;
+	gsize   body, frame_length;
+
+	n = 0;
+	header[n++] = 0xFF;
+	header[n++] = 0xF9;
+	header[n++] = frame[2];
+	header[n++] = frame[3];
+	n += flac_code_number (fc->samples, header + n);
+
+	/* Explicit block size and sample rate, if any */
+	extra = h->length - 5 - h->number_length;
+	memcpy (header + n, frame + 4 + h->number_length, extra);
+	n += extra;
+	header[n] = crc8 (header, n);
+	n++;
+
+	body = length - h->length - 2;
+	crc = crc16 (0, header, n);
+	crc = crc16 (crc, frame + h->length, body);
+	footer[0] = crc >> 8;
+	footer[1] = crc & 0xFF;
+
+	if (!g_output_stream_write_all (fc->out, header, n, NULL, cancellable, error) ||
+	    !g_output_stream_write_all (fc->out, frame + h->length, body, NULL, cancellable, error) ||
+	    !g_output_stream_write_all (fc->out, footer, 2, NULL, cancellable, error))
+		return FALSE;
+
+	/* Only the very last frame may be shorter than the minimum */
+	if (fc->last_block)
+		fc->min_block = MIN (fc->min_block, fc->last_block);
+	fc->last_block = h->block_size;
+	fc->max_block = MAX (fc->max_block, h->block_size);
+
+	frame_length = n + body + 2;
+	fc->min_frame = MIN (fc->min_frame, frame_length);
+	fc->max_frame = MAX (fc->max_frame, frame_length);
+
+	fc->samples += h->block_size;
+
+	return TRUE;
+}
+
+static gboolean
+flac_write_metadata (FlacConcat    *fc,
+		     Reader        *r,
+		     gboolean       first,
+		     GFile         *part,
+		     GCancellable  *cancellable,
+		     GError       **error)
+{
+	GByteArray *metadata;
+	gboolean    last = FALSE, ret = FALSE;
+	guint       last_header = 0;
+
+	metadata = g_byte_array_new ();
+
+	while (!last) {
+		guint8 *p;
+		guint   type, length;
+
+		if (!reader_fill (r, 4, cancellable, error))
+			goto out;
+		if (AVAIL (r) < 4) {
+			set_corrupt_error (error, part);
+			goto out;
+		}
+
+		p = DATA (r);
+		last = (p[0] & 0x80) != 0;
+		type = p[0] & 0x7F;
+		length = (p[1] << 16) | (p[2] << 8) | p[3];
+
+		if (!reader_fill (r, 4 + length, cancellable, error))
+			goto out;
+		if (AVAIL (r) < 4 + length ||
+		    (metadata->len == 0 && type != FLAC_STREAMINFO) ||
+		    (type == FLAC_STREAMINFO && length != sizeof (fc->streaminfo))) {
+			set_corrupt_error (error, part);
+			goto out;
+		}
+		p = DATA (r);
+
+		if (first && type == FLAC_STREAMINFO)
+			memcpy (fc->streaminfo, p + 4, length);
+
+		/* Its offsets would point into the first part only */
+		if (type != FLAC_SEEKTABLE) {
+			last_header = metadata->len;
+			g_byte_array_append (metadata, p, 4 + length);
+			metadata->data[last_header] &= 0x7F;
+		}
+
+		r->pos += 4 + length;
+	}
+
+	if (first) {
+		metadata->data[last_header] |= 0x80;
+		if (!g_output_stream_write_all (fc->out, "fLaC", 4, NULL, cancellable, error) ||
+		    !g_output_stream_write_all (fc->out, metadata->data, metadata->len,
+						NULL, cancellable, error))
+			goto out;
+	}
+
+	ret = TRUE;
+ out:
+	g_byte_array_free (metadata, TRUE);
+	return ret;
+}
+
+static gboolean
+flac_copy_part (FlacConcat    *fc,
+		GFile         *part,
+		gboolean       first,
+		GCancellable  *cancellable,
+		GError       **error)
+{
+	Reader   r;
+	gboolean ret = FALSE;
+
+	if (!reader_open (&r, part, cancellable, error) ||
+	    !reader_fill (&r, 4, cancellable, error))
+		goto out;
+
+	if (AVAIL (&r) < 4 || memcmp (DATA (&r), "fLaC", 4) != 0) {
+		set_corrupt_error (error, part);
+		goto out;
+	}
+	r.pos += 4;
+
+	if (!flac_write_metadata (fc, &r, first, part, cancellable, error) ||
+	    !reader_fill (&r, FLAC_MAX_HEADER, cancellable, error))
+		goto out;
+
+	while (AVAIL (&r) > 0) {
+		FlacFrameHeader h, next;
+		guint16         crc = 0;
+		gsize           i = 0;
+
+		if (!flac_parse_frame_header (DATA (&r), AVAIL (&r), &h)) {
+			set_corrupt_error (error, part);
+			goto out;
+		}
+
+		/* The previous part ended on a block too short to go on */
+		if (fc->last_block != 0 && fc->last_block < FLAC_MIN_BLOCK) {
+			gchar *name;
+
+			name = g_file_get_parse_name (part);
+			g_set_error (error, NSC_ERROR, NSC_ERROR_INTERNAL_ERROR,
+				     _("The part before %s ends on a block of %u samples, too short to join"),
+				     name, fc->last_block);
+			g_free (name);
+			goto out;
+		}
+
+		/*
+		 * Frames have no length field: a frame ends where the
+		 * CRC-16 of everything so far comes out as zero and a
+		 * valid frame header follows, or at the end of the part.
+		 */
+		for (;;) {
+			if (!reader_fill (&r, i + 1 + FLAC_MAX_HEADER, cancellable, error))
+				goto out;
+
+			if (i == AVAIL (&r)) {
+				if (crc != 0) {
+					set_corrupt_error (error, part);
+					goto out;
+				}
+				break;
+			}
+
+			crc = CRC16_UPDATE (crc, DATA (&r)[i]);
+			i++;
+
+			if (crc == 0 && i >= h.length + 2 && i < AVAIL (&r) &&
+			    flac_parse_frame_header (DATA (&r) + i, AVAIL (&r) - i, &next))
+				break;
+		}
+
+		if (!flac_write_frame (fc, DATA (&r), i, &h, cancellable, error))
+			goto out;
+		r.pos += i;
+
+		if (!reader_fill (&r, FLAC_MAX_HEADER, cancellable, error))
+			goto out;
+	}
+
+	ret = TRUE;
+ out:
+	reader_close (&r);
+	return ret;
+}
+
+static gboolean
+flac_concat (GPtrArray     *parts,
+	     GOutputStream *out,
+	     GCancellable  *cancellable,
+	     GError       **error)
+{
+	FlacConcat fc;
+	guint8    *si;
+	guint      i;
+
+	memset (&fc, 0, sizeof (fc));
+	fc.out = out;
+	fc.min_block = G_MAXUINT32;
+	fc.min_frame = G_MAXUINT32;
+
+	for (i = 0; i < parts->len; i++)
+		if (!flac_copy_part (&fc, g_ptr_array_index (parts, i), i == 0,
+				     cancellable, error))
+			return FALSE;
+
+	/* A single frame has no minimum but its own */
+	if (fc.min_block == G_MAXUINT32)
+		fc.min_block = fc.last_block;
+	if (fc.min_frame == G_MAXUINT32)
+		fc.min_frame = 0;
+
+	si = fc.streaminfo;
+	si[0] = fc.min_block >> 8;
+	si[1] = fc.min_block;
+	si[2] = fc.max_block >> 8;
+	si[3] = fc.max_block;
+	si[4] = fc.min_frame >> 16;
+	si[5] = fc.min_frame >> 8;
+	si[6] = fc.min_frame;
+	si[7] = fc.max_frame >> 16;
+	si[8] = fc.max_frame >> 8;
+	si[9] = fc.max_frame;
+	si[13] = (si[13] & 0xF0) | ((fc.samples >> 32) & 0x0F);
+	si[14] = fc.samples >> 24;
+	si[15] = fc.samples >> 16;
+	si[16] = fc.samples >> 8;
+	si[17] = fc.samples;
+	memset (si + 18, 0, 16);
+
+	/* STREAMINFO is always the first block, right after "fLaC" */
+	if (!g_seekable_seek (G_SEEKABLE (out), 8, G_SEEK_SET, cancellable, error))
+		return FALSE;
+
+	return g_output_stream_write_all (out, si, sizeof (fc.streaminfo),
+					  NULL, cancellable, error);
+}
+
+/*
+ * Ogg
+ */
+static gboolean
+ogg_copy_part (GOutputStream *out,
+	       GFile         *part,
+	       GHashTable    *serials,
+	       GCancellable  *cancellable,
+	       GError       **error)
+{
+	Reader   r;
+	guint32  serial_in = 0, serial_out = 0;
+	gboolean first_page = TRUE, ret = FALSE;
+
+	if (!reader_open (&r, part, cancellable, error))
+		goto out;
+
+	for (;;) {
+		guint8 *p;
+		guint   segments, length, i;
+		guint32 serial;
+
+		if (!reader_fill (&r, OGG_HEADER, cancellable, error))
+			goto out;
+		if (AVAIL (&r) == 0)
+			break;
+		if (AVAIL (&r) < OGG_HEADER || memcmp (DATA (&r), "OggS", 4) != 0) {
+			set_corrupt_error (error, part);
+			goto out;
+		}
+
+		segments = DATA (&r)[26];
+		if (!reader_fill (&r, OGG_HEADER + segments, cancellable, error))
+			goto out;
+		if (AVAIL (&r) < OGG_HEADER + segments) {
+			set_corrupt_error (error, part);
+			goto out;
+		}
+
+		length = OGG_HEADER + segments;
+		for (i = 0; i < segments; i++)
+			length += DATA (&r)[OGG_HEADER + i];
+
+		if (!reader_fill (&r, length, cancellable, error))
+			goto out;
+		if (AVAIL (&r) < length) {
+			set_corrupt_error (error, part);
+			goto out;
+		}
+
+		p = DATA (&r);
+		memcpy (&serial, p + 14, 4);
+		serial = GUINT32_FROM_LE (serial);
+
+		if (first_page) {
+			serial_in = serial_out = serial;
+			while (g_hash_table_contains (serials, GUINT_TO_POINTER (serial_out)))
+				serial_out = g_random_int ();
+			g_hash_table_add (serials, GUINT_TO_POINTER (serial_out));
+			first_page = FALSE;
+		} else if (serial != serial_in) {
+			/* Parts only ever hold the one audio stream */
+			set_corrupt_error (error, part);
+			goto out;
+		}
+
+		if (serial_out != serial_in) {
+			guint32 crc;
+
+			serial = GUINT32_TO_LE (serial_out);
+			memcpy (p + 14, &serial, 4);
+			memset (p + 22, 0, 4);
+			crc = GUINT32_TO_LE (ogg_crc (p, length));
+			memcpy (p + 22, &crc, 4);
+		}
+
+		if (!g_output_stream_write_all (out, p, length, NULL, cancellable, error))
+			goto out;
+		r.pos += length;
+	}
+
+	ret = TRUE;
+ out:
+	reader_close (&r);
+	return ret;
+}
+
+static gboolean
+ogg_concat (GPtrArray     *parts,
+	    GOutputStream *out,
+	    GCancellable  *cancellable,
+	    GError       **error)
+{
+	GHashTable *serials;
+	gboolean    ret = TRUE;
+	guint       i;
+
+	serials = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	for (i = 0; ret && i < parts->len; i++)
+		ret = ogg_copy_part (out, g_ptr_array_index (parts, i), serials,
+				     cancellable, error);
+
+	g_hash_table_destroy (serials);
+
+	return ret;
+}
+
+typedef struct {
+	GPtrArray *parts;
+	GFile     *sink;
+	gchar     *media_type;
+} ConcatData;
+
+static void
+concat_data_free (ConcatData *data)
+{
+	g_ptr_array_unref (data->parts);
+	g_object_unref (data->sink);
+	g_free (data->media_type);
+	g_free (data);
+}
+
+static void
+concat_thread (GTask        *task,
+	       gpointer      source_object,
+	       gpointer      task_data,
+	       GCancellable *cancellable)
+{
+	ConcatData        *data = task_data;
+	GFileOutputStream *out;
+	GError            *error = NULL;
+	guint              i;
+
+	out = g_file_replace (data->sink, NULL, FALSE, G_FILE_CREATE_NONE,
+			      cancellable, &error);
+	if (out != NULL) {
+		gboolean ret;
+
+		if (g_strcmp0 (data->media_type, RB_GST_MEDIA_TYPE_FLAC) == 0)
+			ret = flac_concat (data->parts, G_OUTPUT_STREAM (out),
+					   cancellable, &error);
+		else
+			ret = ogg_concat (data->parts, G_OUTPUT_STREAM (out),
+					  cancellable, &error);
+
+		if (!g_output_stream_close (G_OUTPUT_STREAM (out), cancellable,
+					    ret ? &error : NULL))
+			ret = FALSE;
+		g_object_unref (out);
+
+		if (!ret)
+			g_file_delete (data->sink, NULL, NULL);
+	}
+
+	/* The parts are of no use either way */
+	for (i = 0; i < data->parts->len; i++)
+		g_file_delete (g_ptr_array_index (data->parts, i), NULL, NULL);
+
+	if (error != NULL)
+		g_task_return_error (task, error);
+	else
+		g_task_return_boolean (task, TRUE);
+}
+
+/*
+ * Public Methods
+ */
+
+/**
+ * Whether parts encoded to media_type can be joined at all.
+ */
+gboolean
+nsc_concat_supported (const gchar *media_type)
+{
+	return g_strcmp0 (media_type, RB_GST_MEDIA_TYPE_FLAC) == 0 ||
+		g_strcmp0 (media_type, RB_GST_MEDIA_TYPE_OGG_VORBIS) == 0;
+}
+
+/**
+ * Where part of n_parts of a file of duration nanoseconds at rate
+ * starts, in nanoseconds.  The boundaries fall on whole multiples of
+ * NSC_CONCAT_BLOCK samples, rounded up to the nanosecond so that the
+ * clipping of the decoded audio lands on that very sample.
+ */
+guint64
+nsc_concat_boundary (guint64 duration,
+		     guint   rate,
+		     guint   part,
+		     guint   n_parts)
+{
+	guint64 samples;
+
+	g_return_val_if_fail (rate > 0 && n_parts > 0, 0);
+
+	samples = gst_util_uint64_scale_int (duration, rate, GST_SECOND);
+	samples = gst_util_uint64_scale_int (samples, part, n_parts);
+	samples -= samples % NSC_CONCAT_BLOCK;
+
+	return gst_util_uint64_scale_int_ceil (samples, GST_SECOND, rate);
+}
+
+/**
+ * Join the parts, in order, into sink in a worker thread.  The
+ * parts are deleted afterwards, whether joining them worked or not.
+ */
+void
+nsc_concat_files_async (GPtrArray           *parts,
+			GFile               *sink,
+			const gchar         *media_type,
+			GCancellable        *cancellable,
+			GAsyncReadyCallback  callback,
+			gpointer             user_data)
+{
+	static GOnce  crc_once = G_ONCE_INIT;
+	ConcatData   *data;
+	GTask        *task;
+
+	g_return_if_fail (parts != NULL && parts->len > 0);
+	g_return_if_fail (G_IS_FILE (sink));
+	g_return_if_fail (nsc_concat_supported (media_type));
+
+	g_once (&crc_once, init_crc_tables, NULL);
+
+	data = g_new0 (ConcatData, 1);
+	data->parts = g_ptr_array_ref (parts);
+	data->sink = g_object_ref (sink);
+	data->media_type = g_strdup (media_type);
+
+	task = g_task_new (NULL, cancellable, callback, user_data);
+	g_task_set_task_data (task, data, (GDestroyNotify) concat_data_free);
+	g_task_run_in_thread (task, concat_thread);
+	g_object_unref (task);
+}
+
+gboolean
+nsc_concat_files_finish (GAsyncResult  *result,
+			 GError       **error)
+{
+	return g_task_propagate_boolean (G_TASK (result), error);
+}
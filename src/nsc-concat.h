@@ -0,0 +1,55 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-concat.h
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+#ifndef NSC_CONCAT_H
+#define NSC_CONCAT_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Parts to be joined are cut at multiples of this many samples.  It
+ * is a multiple of the block size flacenc uses at every quality, 1152
+ * or 4608, so only the last part ends on a short block.
+ */
+#define NSC_CONCAT_BLOCK 4608
+
+gboolean nsc_concat_supported    (const gchar         *media_type);
+guint64  nsc_concat_boundary     (guint64              duration,
+				  guint                rate,
+				  guint                part,
+				  guint                n_parts);
+void     nsc_concat_files_async  (GPtrArray           *parts,
+				  GFile               *sink,
+				  const gchar         *media_type,
+				  GCancellable        *cancellable,
+				  GAsyncReadyCallback  callback,
+				  gpointer             user_data);
+gboolean nsc_concat_files_finish (GAsyncResult        *result,
+				  GError             **error);
+
+G_END_DECLS
+
+#endif /* NSC_CONCAT_H */
@@ -26,67 +26,117 @@
 
 #include <config.h>
 
-#include <sys/time.h>
 #include <string.h>
 
 #include <glib/gi18n.h>
 #include <gio/gio.h>
 #include <gtk/gtk.h>
 #include <gst/gst.h>
-#include <libcaja-extension/caja-file-info.h>
+#include <gst/pbutils/pbutils.h>
 
+#include "nsc-concat.h"
 #include "nsc-converter.h"
+#include "nsc-cue.h"
+#include "nsc-file-list.h"
 #include "nsc-gstreamer.h"
+#include "nsc-job.h"
+#include "nsc-latency.h"
+#include "nsc-replaygain.h"
+#include "nsc-scheduler.h"
 #include "nsc-xml.h"
 #include "rb-gst-media-types.h"
 
 typedef struct _NscConverterPrivate NscConverterPrivate;
 
+/* A long file converted as several parts at once */
 typedef struct {
-	int            seconds;
-	struct timeval time;
-	int            ripped;
-	int            taken;
-} Progress;
+	NscConverter *converter;
+	GFile        *src;
+	GFile        *sink;
+	GPtrArray    *parts;
+	guint         left;
+	GError       *error;
+
+	/* ReplayGain of each part, as NscReplayGainTrack */
+	GArray       *replaygain;
+} Chunks;
+
+/* What the parts of a long file are worked out from */
+typedef struct {
+	GstClockTime  duration;
+	guint         rate;
+} Length;
 
 struct _NscConverterPrivate {
-	/* GStreamer Object */
-	NscGStreamer	*gst;
-
 	/* The current audio profile */
 	GstEncodingProfile *profile;
 
 	GtkWidget	*dialog;
 	GtkWidget	*path_chooser;
 	GtkWidget       *profile_chooser;
-	GtkWidget       *progress_dlg;
-	GtkWidget       *progressbar;
-	GtkWidget       *speedbar;
-
-	/* Status icon */
-	GtkStatusIcon   *status_icon;
-	
-	/* Files to be convertered */
-	GList		*files;
+
+	/* Files to be convertered, and the next one to queue */
+	NscFileList	*files;
+	guint            next_file;
+
+	/* Jobs finished, and those there are as far as known */
 	gint             files_converted;
 	gint		 total_files;
 
+	/* NscJobs of the files queued so far, left to hand to the scheduler */
+	GQueue          *jobs;
+
+	/* Disc images queued, by URI, so each is converted once */
+	GHashTable      *images;
+
+	/* The extension of the new files, and where their URIs are built */
+	const gchar     *extension;
+	GString         *uri_buffer;
+
+	/* The end of the batch has been dealt with */
+	gboolean         finished;
+
 	/* Use the source directory as the output directory? */
 	gboolean         src_dir;
 
-	/* Directory to save new file */
-	gchar           *save_path;
+	/* Convert at idle priority so the desktop stays responsive? */
+	gboolean         background;
 
-	/* Snapshots of the progress used to calculate the speed and the ETA */
-	Progress         before;
+	/* Which ReplayGain tags to write, and the tracks analysed so far */
+	NscReplayGainMode replaygain;
+	GArray          *tracks;
 
-        /* The duration of the file being converter. */
-	gint             current_duration;
+	/* Split files of twice this many minutes or more, 0 never to */
+	gint             chunk_minutes;
 
-	/* The total duration of the file being converter. */
-	gint             total_duration;
+	/* The encoder speed versus size preset */
+	gchar           *preset;
+
+	/* Sample rate conversion quality, 0 to 10 */
+	gint             resample_quality;
+
+	/* Lengths of the files long enough to split, by URI */
+	GstDiscoverer   *discoverer;
+	GHashTable      *durations;
+
+	/* The next file to stat, and how many are being discovered */
+	guint            probe_next;
+	guint            probing;
+
+	/* Files converted in parts, and how many are being joined */
+	GSList          *chunks;
+	gint             joins;
+
+	/* "file: reason" for each file that could not be converted */
+	GPtrArray       *failures;
+
+	/* Directory to save new file */
+	gchar           *save_path;
 };
 
+/* Files stat'ed per main loop iteration when looking for long ones */
+#define PROBE_CHUNK 256
+
 /* Default profile name */
 #define DEFAULT_MEDIA_TYPE "audio/x-vorbis"
 
@@ -105,6 +155,26 @@ enum {
 	PROP_FILES = 1,
 };
 
+static void
+chunks_free (Chunks *chunks)
+{
+	guint i;
+
+	/* Parts of a file that was never joined are of no use */
+	if (chunks->left > 0 || chunks->error != NULL)
+		for (i = 0; i < chunks->parts->len; i++)
+			g_file_delete (g_ptr_array_index (chunks->parts, i), NULL, NULL);
+
+	g_object_unref (chunks->src);
+	g_object_unref (chunks->sink);
+	g_ptr_array_unref (chunks->parts);
+	if (chunks->error)
+		g_error_free (chunks->error);
+	if (chunks->replaygain)
+		g_array_free (chunks->replaygain, TRUE);
+	g_free (chunks);
+}
+
 static void
 nsc_converter_finalize (GObject *object)
 {
@@ -115,14 +185,44 @@ nsc_converter_finalize (GObject *object)
 		if (priv->save_path)
 			g_free (priv->save_path);
 
-		if (priv->gst)
-			g_object_unref (priv->gst);
+		g_free (priv->preset);
 
 		if (priv->profile)
 			g_object_unref (priv->profile);
 
-		if (priv->files)
-			g_list_free (priv->files);
+		nsc_file_list_free (priv->files);
+
+		if (priv->images)
+			g_hash_table_destroy (priv->images);
+
+		if (priv->uri_buffer)
+			g_string_free (priv->uri_buffer, TRUE);
+
+		if (priv->jobs) {
+			g_queue_foreach (priv->jobs, (GFunc) nsc_job_free, NULL);
+			g_queue_free (priv->jobs);
+		}
+
+		if (priv->discoverer)
+			g_object_unref (priv->discoverer);
+
+		if (priv->durations)
+			g_hash_table_destroy (priv->durations);
+
+		g_slist_free_full (priv->chunks, (GDestroyNotify) chunks_free);
+
+		if (priv->failures)
+			g_ptr_array_unref (priv->failures);
+
+		if (priv->tracks) {
+			guint i;
+
+			for (i = 0; i < priv->tracks->len; i++)
+				g_object_unref (g_array_index (priv->tracks,
+							       NscReplayGainTrack,
+							       i).file);
+			g_array_free (priv->tracks, TRUE);
+		}
 
 		g_free (priv);
 
@@ -143,8 +243,9 @@ nsc_converter_set_property (GObject      *object,
 
 	switch (property_id) {
 	case PROP_FILES:
+		/* Every file counts as a job until it is queued */
 		priv->files = g_value_get_pointer (value);
-		priv->total_files = g_list_length (priv->files);
+		priv->total_files = priv->files ? nsc_file_list_length (priv->files) : 0;
 		break;
 	default:
 		/* We don't have any other property... */
@@ -197,382 +298,564 @@ nsc_converter_class_init (NscConverterClass *klass)
 }
 
 /**
- * Cancel converting the files.
+ * Create the new GFile, in the output directory and with the
+ * extension of the profile.  This will need to be unreferenced.
  */
-static void
-progress_cancel_cb (GtkWidget *widget, gpointer user_data)
+static GFile *
+create_new_file (NscConverter *converter, const gchar *uri)
 {
-	NscConverter        *conv;
 	NscConverterPrivate *priv;
+	const gchar         *basename, *extension;
+	gsize                length;
+	GFile               *file;
+	gint64               start;
+
+	priv = NSC_CONVERTER_GET_PRIVATE (converter);
+	start = nsc_latency_start ();
 
-	conv =  NSC_CONVERTER (user_data);
-	priv =  NSC_CONVERTER_GET_PRIVATE (conv);
+	/* Still escaped, which is just what the new URI needs */
+	basename = strrchr (uri, '/');
+	basename = basename ? basename + 1 : uri;
+	extension = strrchr (basename, '.');
+	length = extension ? (gsize) (extension - basename) : strlen (basename);
 
-	nsc_gstreamer_cancel_convert (priv->gst);
+	g_string_assign (priv->uri_buffer, priv->save_path);
+	g_string_append_c (priv->uri_buffer, '/');
+	g_string_append_len (priv->uri_buffer, basename, length);
+	g_string_append_c (priv->uri_buffer, '.');
+	g_string_append (priv->uri_buffer, priv->extension);
 
-	gtk_widget_destroy (priv->progress_dlg);
-	if (priv->status_icon)
-		g_object_unref (priv->status_icon);
+	file = g_file_new_for_uri (priv->uri_buffer->str);
+	nsc_latency_record ("create_new_file", start);
 
-	g_object_unref (priv->gst);
-	priv->gst = NULL;
+	return file;
 }
 
 /**
- * Create the progress dialog
+ * Create the GFile for a track of a disc image, named after its
+ * number and title.  This will need to be unreferenced.
  */
-static void
-create_progress_dialog (NscConverter *converter)
+static GFile *
+create_track_file (NscConverter *converter,
+		   GFile        *image,
+		   NscCueTrack  *track)
 {
 	NscConverterPrivate *priv;
-	GtkWidget           *button;
+	GFile               *dir, *new_file;
+	gchar               *title, *basename;
 
 	priv = NSC_CONVERTER_GET_PRIVATE (converter);
 
-	/* Create the gtkbuilder, and grab the widgets */
-	nsc_xml_get_file ("progress.ui",
-			  "progress_dialog", &priv->progress_dlg,
-			  "file_progressbar", &priv->progressbar,
-			  "speed_progressbar", &priv->speedbar,
-			  "cancel_button", &button,
-			  NULL);
-
-	/* Connect the signal for the cancel button */
-	g_signal_connect (G_OBJECT (button), "clicked",
-			  (GCallback) progress_cancel_cb,
-			  converter);
+	/* Untitled tracks are named after the image */
+	if (track->title != NULL) {
+		title = g_strdup (track->title);
+	} else {
+		gchar *extension;
+
+		title = g_file_get_basename (image);
+		extension = strrchr (title, '.');
+		if (extension != NULL)
+			*extension = '\0';
+	}
+	g_strdelimit (title, G_DIR_SEPARATOR_S, '-');
+
+	basename = g_strdup_printf ("%02d - %s.%s", track->number,
+				    title, priv->extension);
+	g_free (title);
 
-	gtk_widget_show_all (priv->progress_dlg);
+	dir = g_file_new_for_uri (priv->save_path);
+	new_file = g_file_get_child (dir, basename);
+	g_object_unref (dir);
+	g_free (basename);
+
+	return new_file;
 }
 
 /**
- * Create the new GFile.  This will need to be unreferenced.
+ * Create the hidden GFile one part of a split file is converted
+ * to.  This will need to be unreferenced.
  */
 static GFile *
-create_new_file (NscConverter *converter, GFile *file)
+create_part_file (GFile *sink, guint part)
 {
-	NscConverterPrivate *priv;
-	GFile               *new_file;
-	gchar               *media_type;
-	gchar               *old_basename, *new_basename;
-	gchar               *extension, *new_uri;
-	const gchar         *new_extension;
-
-	g_return_val_if_fail (G_IS_FILE (file), NULL);
+	GFile *parent, *part_file;
+	gchar *basename, *part_name;
 
-	priv = NSC_CONVERTER_GET_PRIVATE (converter);
-
-	/* Let's the get the basename from the original file */
-	old_basename = g_file_get_basename (file);
-
-	/* Now let's remove the extension from the basename. */
-	extension = g_strdup (strrchr (old_basename, '.'));
-	if (extension != NULL)
-		old_basename[strlen (old_basename) - strlen (extension)] = '\0';
-	g_free (extension);
-
-	/* Get the new extension from the audio profie */
-	media_type = rb_gst_encoding_profile_get_media_type (priv->profile);
-	new_extension = rb_gst_media_type_to_extension (media_type);
-	g_free (media_type);
-
-	/* Create the new basename */
-	new_basename = g_strdup_printf ("%s.%s", old_basename, new_extension);
-	g_free (old_basename);
+	parent = g_file_get_parent (sink);
+	basename = g_file_get_basename (sink);
+	part_name = g_strdup_printf (".%s.part%u", basename, part);
 
-	/* Now let's create the new files uri */
-	new_uri = g_strconcat (priv->save_path, G_DIR_SEPARATOR_S,
-			       new_basename, NULL);
-	g_free (new_basename);
+	part_file = g_file_get_child (parent, part_name);
 
-	/* And now finally let's create the new GFile */
-	new_file = g_file_new_for_uri (new_uri);
-	g_free (new_uri);
+	g_object_unref (parent);
+	g_free (basename);
+	g_free (part_name);
 
-	return new_file;
+	return part_file;
 }
 
 /**
- * Function to get orginal & new files, and pass
- * them to the gstreamer object.
+ * Queue a long file as parts of equal length, one per processor
+ * at most, and no shorter than chunk-minutes.  Returns FALSE if
+ * the file is better converted whole.
  */
-static void
-convert_file (NscConverter *convert)
+static gboolean
+queue_chunks (NscConverter *converter,
+	      GFile        *src,
+	      GFile        *sink)
 {
 	NscConverterPrivate *priv;
-	CajaFileInfo    *file_info;
-	GFile               *old_file, *new_file;
-	GError              *err = NULL;
-
-	priv = NSC_CONVERTER_GET_PRIVATE (convert);
+	Length              *length;
+	Chunks              *chunks;
+	gchar               *uri;
+	guint                n_parts, i;
 
-	g_return_if_fail (priv->files != NULL);
-
-	/* Get the files */
-	file_info = CAJA_FILE_INFO (priv->files->data);
-	old_file = caja_file_info_get_location (file_info);
-	new_file = create_new_file (convert, old_file);
+	priv = NSC_CONVERTER_GET_PRIVATE (converter);
 
-	/* Let's finally get to the fun stuff */
-	nsc_gstreamer_convert_file (priv->gst, old_file, new_file,
-				    &err);
+	if (priv->durations == NULL)
+		return FALSE;
+
+	uri = g_file_get_uri (src);
+	length = g_hash_table_lookup (priv->durations, uri);
+	g_free (uri);
+
+	if (length == NULL)
+		return FALSE;
+
+	n_parts = length->duration / (priv->chunk_minutes * 60 * GST_SECOND);
+	n_parts = MIN (n_parts, g_get_num_processors ());
+	if (n_parts < 2)
+		return FALSE;
+
+	chunks = g_new0 (Chunks, 1);
+	chunks->converter = converter;
+	chunks->src = g_object_ref (src);
+	chunks->sink = g_object_ref (sink);
+	chunks->parts = g_ptr_array_new_with_free_func (g_object_unref);
+	chunks->left = n_parts;
+	priv->chunks = g_slist_prepend (priv->chunks, chunks);
+
+	for (i = 0; i < n_parts; i++) {
+		NscJob *job;
+		GFile  *part;
+
+		part = create_part_file (sink, i);
+		g_ptr_array_add (chunks->parts, part);
+
+		/* Neighbouring parts share their boundary exactly */
+		job = nsc_job_new (src, part);
+		job->start = nsc_concat_boundary (length->duration, length->rate,
+						  i, n_parts);
+		if (i < n_parts - 1)
+			job->stop = nsc_concat_boundary (length->duration, length->rate,
+							 i + 1, n_parts);
+		job->chunks = chunks;
+		g_queue_push_tail (priv->jobs, job);
+	}
 
-	/* Free the files since we do not need them anymore */
-	g_object_unref (old_file);
-	g_object_unref (new_file);
+	return TRUE;
 }
 
-/**
- * Update progressbar text
+/** 
+ * Record an error converting one of the files, for the report at
+ * the end of the batch.  The error passed in does not need to be
+ * freed.
  */
 static void
-update_progressbar_text (NscConverter *convert)
+report_error (NscConverter *converter, GFile *file, GError *error)
 {
 	NscConverterPrivate *priv;
-	gchar               *text;
+	gchar               *name;
 
-	g_return_if_fail (NSC_IS_CONVERTER (convert));
+	priv = NSC_CONVERTER_GET_PRIVATE (converter);
 
-	priv = NSC_CONVERTER_GET_PRIVATE (convert);
+	if (priv->failures == NULL)
+		priv->failures = g_ptr_array_new_with_free_func (g_free);
 
-	text = g_strdup_printf (dgettext (GETTEXT_PACKAGE, "Converting: %d of %d"),
-				priv->files_converted + 1, priv->total_files);
-	gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progressbar),
-				   text);
-	if (priv->status_icon) {
-		gtk_status_icon_set_tooltip_text (priv->status_icon,
-						  text);
-	}
-	g_free (text);
+	name = g_file_get_parse_name (file);
+	g_message ("Could not convert %s: %s", name, error->message);
+	g_ptr_array_add (priv->failures,
+			 g_strdup_printf ("%s: %s", name, error->message));
+	g_free (name);
 }
 
-/** 
- * Callback to report errors.  The error passed in does not
- * need to be freed.
+/**
+ * List the files that could not be converted, without holding up
+ * anything else while the dialog is open.
  */
 static void
-on_error_cb (NscGStreamer *gstream, GError *error, gpointer data)
+show_failures (NscConverter *converter)
 {
-	NscConverter	    *converter;
 	NscConverterPrivate *priv;
-	GtkWidget           *dialog;
-	gchar               *text;
+	GtkWidget           *dialog, *scrolled, *view;
+	GtkTextBuffer       *buffer;
+	guint                i;
 
-	converter = NSC_CONVERTER (data);
 	priv = NSC_CONVERTER_GET_PRIVATE (converter);
 
-	text = g_strdup_printf (dgettext (GETTEXT_PACKAGE, "Caja Sound Converter could "
-					  "not convert this file.\nReason: %s"),
-				error->message);
+	if (priv->failures == NULL || priv->failures->len == 0)
+		return;
 
-	dialog = gtk_message_dialog_new (GTK_WINDOW (priv->dialog), 0,
+	dialog = gtk_message_dialog_new (NULL, 0,
 					 GTK_MESSAGE_ERROR,
 					 GTK_BUTTONS_CLOSE,
-					 text);
-	g_free (text);
+					 dngettext (GETTEXT_PACKAGE,
+						    "Caja Sound Converter could not convert %d of %d file",
+						    "Caja Sound Converter could not convert %d of %d files",
+						    priv->total_files),
+					 priv->failures->len,
+					 MAX (priv->total_files, (gint) priv->failures->len));
+
+	buffer = gtk_text_buffer_new (NULL);
+	for (i = 0; i < priv->failures->len; i++) {
+		GtkTextIter end;
+
+		gtk_text_buffer_get_end_iter (buffer, &end);
+		gtk_text_buffer_insert (buffer, &end,
+					g_ptr_array_index (priv->failures, i), -1);
+		gtk_text_buffer_insert (buffer, &end, "\n", -1);
+	}
 
-	gtk_dialog_run (GTK_DIALOG (dialog));
-	gtk_widget_destroy (dialog);
+	view = gtk_text_view_new_with_buffer (buffer);
+	g_object_unref (buffer);
+	gtk_text_view_set_editable (GTK_TEXT_VIEW (view), FALSE);
+	gtk_text_view_set_wrap_mode (GTK_TEXT_VIEW (view), GTK_WRAP_WORD_CHAR);
+
+	scrolled = gtk_scrolled_window_new (NULL, NULL);
+	gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled),
+					GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+	gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (scrolled),
+					     GTK_SHADOW_IN);
+	gtk_widget_set_size_request (scrolled, 480, 160);
+	gtk_container_add (GTK_CONTAINER (scrolled), view);
+	gtk_box_pack_start (GTK_BOX (gtk_dialog_get_content_area (GTK_DIALOG (dialog))),
+			    scrolled, TRUE, TRUE, 0);
+
+	g_signal_connect (dialog, "response",
+			  G_CALLBACK (gtk_widget_destroy), NULL);
+	gtk_widget_show_all (dialog);
+
+	g_ptr_array_set_size (priv->failures, 0);
 }
 
 /**
- * Callback to report completion.
+ * Tag a converted file with its ReplayGain, and the album's
+ * if there is one.
  */
 static void
-on_completion_cb (NscGStreamer *gstream, gpointer data)
+write_replaygain (NscConverter       *converter,
+		  NscReplayGainTrack *track,
+		  gboolean            album,
+		  gdouble             album_gain,
+		  gdouble             album_peak)
 {
-	NscConverter	    *converter;
 	NscConverterPrivate *priv;
-	gdouble              fraction;
+	GstTagList          *tags;
+	gchar               *media_type;
 
-	converter = NSC_CONVERTER (data);
 	priv = NSC_CONVERTER_GET_PRIVATE (converter);
-	
-	/* Increment converted total & point to next file */
-	priv->files_converted++;
-	priv->files = priv->files->next;
-
-	/* Reset the progress variables */
-	priv->current_duration =  0;
-	priv->total_duration   =  0;
-	priv->before.seconds   = -1;
-
-	/* Clear the speed label */
-	gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->speedbar),
-				   (dgettext (GETTEXT_PACKAGE, "Speed: Unknown")));
-
-	/* Update the progress dialog */
-	fraction = (double) priv->files_converted / priv->total_files;
-	gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (priv->progressbar),
-				       fraction);
-	update_progressbar_text (converter);
-
-	/* If there are more files let's go ahead and convert them */
-	if (priv->files != NULL) {
-		convert_file (converter);
-	} else {
-		/* No more files to convert time to do some cleanup */
-		gtk_widget_destroy (priv->progress_dlg);
-		if (priv->status_icon)
-			g_object_unref (priv->status_icon);
-		g_object_unref (priv->gst);
-		priv->gst = NULL;
+
+	tags = gst_tag_list_new (GST_TAG_TRACK_GAIN, track->gain,
+				 GST_TAG_TRACK_PEAK, track->peak,
+				 NULL);
+	if (album) {
+		gst_tag_list_add (tags, GST_TAG_MERGE_REPLACE,
+				  GST_TAG_ALBUM_GAIN, album_gain,
+				  GST_TAG_ALBUM_PEAK, album_peak,
+				  NULL);
 	}
+
+	media_type = rb_gst_encoding_profile_get_media_type (priv->profile);
+	nsc_replaygain_write_tags (track->file, media_type, tags);
+	g_free (media_type);
+
+	gst_tag_list_unref (tags);
 }
 
 /**
- * Callback to set file total duration.
+ * Once every file of the batch has been analysed, the
+ * album gain can be worked out and written to all of them.
  */
 static void
-on_duration_cb (NscGStreamer *gstream,
-		const int     seconds,
-		gpointer      data)
+write_album_replaygain (NscConverter *converter)
 {
-	NscConverter        *conv;
 	NscConverterPrivate *priv;
+	gdouble              gain, peak;
+	guint                i;
+
+	priv = NSC_CONVERTER_GET_PRIVATE (converter);
+
+	if (priv->tracks == NULL || priv->tracks->len == 0)
+		return;
 
-	conv = NSC_CONVERTER (data);
-	priv = NSC_CONVERTER_GET_PRIVATE (conv);
+	nsc_replaygain_album (priv->tracks, &gain, &peak);
 
-	priv->total_duration = seconds;
+	for (i = 0; i < priv->tracks->len; i++) {
+		write_replaygain (converter,
+				  &g_array_index (priv->tracks, NscReplayGainTrack, i),
+				  TRUE, gain, peak);
+	}
 }
 
 /**
- * Update the ETA and Speed labels
+ * Turn the next selected file into jobs.  A disc image with a cue
+ * sheet, or a cue sheet itself, becomes one job per track, each
+ * converting its own part of the image.  Files are only looked at
+ * once the batch gets to them, so a huge selection starts at once.
  */
 static void
-update_speed_progress (NscConverter *conv,
-		       float         speed,
-		       int           eta)
+queue_next_file (NscConverter *converter)
 {
 	NscConverterPrivate *priv;
-	gchar               *eta_str;
+	NscCueSheet         *sheet;
+	NscFileFlags         flags;
+	const gchar         *uri;
+	GFile               *src;
+	guint                queued;
+
+	priv = NSC_CONVERTER_GET_PRIVATE (converter);
+
+	uri = nsc_file_list_get_uri (priv->files, priv->next_file);
+	flags = nsc_file_list_get_flags (priv->files, priv->next_file);
+	priv->next_file++;
+
+	src = g_file_new_for_uri (uri);
+	queued = g_queue_get_length (priv->jobs);
 
-	priv = NSC_CONVERTER_GET_PRIVATE (conv);
+	if (flags & NSC_FILE_CUE) {
+		GError *error = NULL;
 
-	if (eta >= 0) {
-		eta_str =
-			g_strdup_printf (dgettext (GETTEXT_PACKAGE, 
-						   "Estimated time left: %d:%02d (at %0.1f\303\227)"),
-					 eta / 60,
-					 eta % 60,
-					 speed);
+		sheet = nsc_cue_sheet_load (src, &error);
+		if (sheet == NULL) {
+			report_error (converter, src, error);
+			g_error_free (error);
+		}
 	} else {
-		eta_str = g_strdup (dgettext (GETTEXT_PACKAGE, "Estimated time left: unknown"));
+		sheet = nsc_cue_sheet_find_for_image (src);
 	}
 
-	gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->speedbar),
-				   eta_str);
-	g_free (eta_str);
-}
+	if (sheet != NULL) {
+		gchar *image_uri;
 
-/**
- * Callback to report on file conversion progress.
- */
-static void
-on_progress_cb (NscGStreamer *gstream,
-		const int     seconds,
-		gpointer      data)
-{
-	NscConverter        *conv;
-	NscConverterPrivate *priv;
+		/* An image may be selected along with its cue sheet */
+		image_uri = g_file_get_uri (sheet->image);
+		if (!g_hash_table_lookup_extended (priv->images, image_uri, NULL, NULL)) {
+			guint i;
 
-	conv = NSC_CONVERTER (data);
-	priv = NSC_CONVERTER_GET_PRIVATE (conv);
+			g_hash_table_add (priv->images, image_uri);
 
-	if (priv->total_duration != 0) {
-		float percent;
+			for (i = 0; i < sheet->tracks->len; i++) {
+				NscCueTrack *track;
+				NscJob      *job;
+				GFile       *sink;
 
-		percent =
-			CLAMP ((float) (priv->current_duration + seconds)
-			       / (float) priv->total_duration, 0, 1);
-		gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (priv->speedbar), percent);
+				track = &g_array_index (sheet->tracks, NscCueTrack, i);
+				sink = create_track_file (converter, sheet->image, track);
 
-		if (priv->before.seconds == -1) {
-			priv->before.seconds = priv->current_duration + seconds;
-			gettimeofday (&priv->before.time, NULL);
-		} else {
-			struct timeval time;
-			gint           taken;
-			float          speed;
-
-			gettimeofday (&time, NULL);
-			taken = time.tv_sec + (time.tv_usec / 1000000.0)
-				- (priv->before.time.tv_sec + (priv->before.time.tv_usec / 1000000.0));
-
-			if (taken >= 2) {
-				priv->before.taken += taken;
-				priv->before.ripped += priv->current_duration + seconds - priv->before.seconds;
-				speed = (float) priv->before.ripped / (float) priv->before.taken;
-				update_speed_progress (conv, speed,
-						       (int) ((priv->total_duration - priv->current_duration - seconds)
-							      / speed));
-				priv->before.seconds = priv->current_duration + seconds;
-				gettimeofday (&priv->before.time, NULL);
+				job = nsc_job_new (sheet->image, sink);
+				job->start = track->start;
+				job->stop = track->stop;
+				job->tags = nsc_cue_sheet_get_track_tags (sheet, i);
+				g_queue_push_tail (priv->jobs, job);
+
+				g_object_unref (sink);
 			}
+		} else {
+			g_free (image_uri);
 		}
+		nsc_cue_sheet_free (sheet);
+	} else if (!(flags & NSC_FILE_CUE)) {
+		GFile *sink;
+
+		sink = create_new_file (converter, uri);
+		if (!queue_chunks (converter, src, sink))
+			g_queue_push_tail (priv->jobs, nsc_job_new (src, sink));
+		g_object_unref (sink);
 	}
+
+	/* The file was counted as one job when the batch was created */
+	priv->total_files += (gint) g_queue_get_length (priv->jobs) - (gint) queued - 1;
+
+	g_object_unref (src);
 }
 
 static void
-converter_status_icon_activate_cb (GtkStatusIcon *status_icon,
-				   NscConverter  *converter)
+start_batch (NscConverter *converter)
 {
 	NscConverterPrivate *priv;
-	gboolean             visible;
+	gchar               *media_type;
 
 	priv = NSC_CONVERTER_GET_PRIVATE (converter);
 
-	g_object_get (priv->progress_dlg,
-		      "visible", &visible,
-		      NULL);
+	media_type = rb_gst_encoding_profile_get_media_type (priv->profile);
+	priv->extension = rb_gst_media_type_to_extension (media_type);
+	g_free (media_type);
+
+	priv->jobs = g_queue_new ();
+	priv->images = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	priv->uri_buffer = g_string_new (NULL);
 
-	if (visible && gtk_status_icon_is_embedded (status_icon)) {
-		gtk_widget_hide (priv->progress_dlg);
-	} else {
-		gtk_widget_show_all (priv->progress_dlg);
-	}
+	nsc_scheduler_add_batch (nsc_scheduler_get_default (), converter);
 }
 
 static void
-create_gst (NscConverter *conv)
+discovered_cb (GstDiscoverer     *discoverer,
+	       GstDiscovererInfo *info,
+	       GError            *error,
+	       gpointer           user_data)
 {
 	NscConverterPrivate *priv;
+	GList               *streams;
+	Length              *length;
+	GstClockTime         duration;
+	guint                rate = 0;
+
+	priv = NSC_CONVERTER_GET_PRIVATE (user_data);
+
+	if (gst_discoverer_info_get_result (info) != GST_DISCOVERER_OK)
+		return;
+
+	streams = gst_discoverer_info_get_audio_streams (info);
+	if (streams != NULL)
+		rate = gst_discoverer_audio_info_get_sample_rate (streams->data);
+	gst_discoverer_stream_info_list_free (streams);
 
-	priv = NSC_CONVERTER_GET_PRIVATE (conv);
-
-	priv->gst = nsc_gstreamer_new (priv->profile);
-	
-	/* Connect to the gstreamer object signals */
-	g_signal_connect (G_OBJECT (priv->gst), "completion",
-			  (GCallback) on_completion_cb,
-			  conv);
-	g_signal_connect (G_OBJECT (priv->gst), "error",
-			  (GCallback) on_error_cb,
-			  conv);
-	g_signal_connect (G_OBJECT (priv->gst), "progress",
-			  (GCallback) on_progress_cb,
-			  conv);
-	g_signal_connect (G_OBJECT (priv->gst), "duration",
-			  (GCallback) on_duration_cb,
-			  conv);
+	/* Without both, the file is converted whole */
+	duration = gst_discoverer_info_get_duration (info);
+	if (!GST_CLOCK_TIME_IS_VALID (duration) || rate == 0)
+		return;
+
+	length = g_new (Length, 1);
+	length->duration = duration;
+	length->rate = rate;
+	g_hash_table_insert (priv->durations,
+			     g_strdup (gst_discoverer_info_get_uri (info)),
+			     length);
 }
 
 static void
-create_status_icon (NscConverter *conv)
+discovery_finished_cb (GstDiscoverer *discoverer,
+		       gpointer       user_data)
 {
+	NscConverter *converter = NSC_CONVERTER (user_data);
+
+	gst_discoverer_stop (discoverer);
+	start_batch (converter);
+
+	/* Taken by probe_durations() */
+	g_object_unref (converter);
+}
+
+/**
+ * Stat the files a chunk at a time, so that Caja stays responsive
+ * with a huge selection, queueing the ones large enough to be worth
+ * splitting for discovery.  Once done, discovery starts, or the
+ * batch does if there was nothing to discover.
+ */
+static gboolean
+probe_files_cb (gpointer user_data)
+{
+	NscConverter        *converter = NSC_CONVERTER (user_data);
 	NscConverterPrivate *priv;
+	goffset              min_size;
+	guint                length, n;
+
+	priv = NSC_CONVERTER_GET_PRIVATE (converter);
+	length = nsc_file_list_length (priv->files);
+
+	/* Nothing under two parts at 64 kbps is long enough to split */
+	min_size = (goffset) priv->chunk_minutes * 60 * 2 * 8000;
+
+	for (n = 0; priv->probe_next < length && n < PROBE_CHUNK; n++) {
+		const gchar *uri;
+		GFileInfo   *info;
+		GFile       *location;
+		guint        i = priv->probe_next++;
+
+		if (nsc_file_list_get_flags (priv->files, i) & NSC_FILE_CUE)
+			continue;
+
+		uri = nsc_file_list_get_uri (priv->files, i);
+		location = g_file_new_for_uri (uri);
+		info = g_file_query_info (location, G_FILE_ATTRIBUTE_STANDARD_SIZE,
+					  G_FILE_QUERY_INFO_NONE, NULL, NULL);
+
+		if (info != NULL && g_file_info_get_size (info) >= min_size &&
+		    gst_discoverer_discover_uri_async (priv->discoverer, uri))
+			priv->probing++;
+
+		if (info != NULL)
+			g_object_unref (info);
+		g_object_unref (location);
+	}
 
-	priv = NSC_CONVERTER_GET_PRIVATE (conv);
+	if (priv->probe_next < length)
+		return TRUE;
 
-	priv->status_icon = gtk_status_icon_new_from_icon_name ("gtk-convert");
-	g_signal_connect (priv->status_icon,
-			  "activate",
-			  G_CALLBACK (converter_status_icon_activate_cb),
-			  conv);
-	gtk_status_icon_set_visible (priv->status_icon, TRUE);
+	if (priv->probing > 0) {
+		/* discovery_finished_cb() takes it from here */
+		gst_discoverer_start (priv->discoverer);
+	} else {
+		start_batch (converter);
+		/* Taken by probe_durations() */
+		g_object_unref (converter);
+	}
+
+	return FALSE;
 }
-	
+
+/**
+ * Find out, in the background, how long the files that may be
+ * worth splitting are, and start the batch once that is known.
+ * Returns FALSE if splitting is off, and the batch can start right
+ * away.
+ */
+static gboolean
+probe_durations (NscConverter *converter)
+{
+	NscConverterPrivate *priv;
+	gchar               *media_type;
+	gboolean             can_join;
+
+	priv = NSC_CONVERTER_GET_PRIVATE (converter);
+
+	if (priv->chunk_minutes <= 0)
+		return FALSE;
+
+	/*
+	 * Chained Ogg files cannot be retagged, so they are only
+	 * split when there is no ReplayGain to write.
+	 */
+	media_type = rb_gst_encoding_profile_get_media_type (priv->profile);
+	can_join = nsc_concat_supported (media_type) &&
+		(priv->replaygain == NSC_REPLAYGAIN_NONE ||
+		 g_strcmp0 (media_type, RB_GST_MEDIA_TYPE_FLAC) == 0);
+	g_free (media_type);
+
+	if (!can_join)
+		return FALSE;
+
+	priv->discoverer = gst_discoverer_new (10 * GST_SECOND, NULL);
+	if (priv->discoverer == NULL)
+		return FALSE;
+
+	priv->durations = g_hash_table_new_full (g_str_hash, g_str_equal,
+						 g_free, g_free);
+	g_signal_connect (priv->discoverer, "discovered",
+			  G_CALLBACK (discovered_cb), converter);
+	g_signal_connect (priv->discoverer, "finished",
+			  G_CALLBACK (discovery_finished_cb), converter);
+
+	/* Released once the batch is started */
+	g_object_ref (converter);
+
+	priv->probe_next = 0;
+	priv->probing = 0;
+	g_idle_add (probe_files_cb, converter);
+
+	return TRUE;
+}
+
 /**
  * The OK or Cancel button was pressed on the main dialog.
  */
@@ -592,9 +875,9 @@ converter_response_cb (GtkWidget *dialog,
 		priv = NSC_CONVERTER_GET_PRIVATE (converter);
 
 		/* Grab the save path */
+		g_free (priv->save_path);
 		priv->save_path =
-			g_strdup (gtk_file_chooser_get_uri
-				  (GTK_FILE_CHOOSER (priv->path_chooser)));
+			gtk_file_chooser_get_uri (GTK_FILE_CHOOSER (priv->path_chooser));
 	       
 		/* Grab the encoding profile choosen */
 		model = gtk_combo_box_get_model (GTK_COMBO_BOX (priv->profile_chooser));
@@ -604,6 +887,8 @@ converter_response_cb (GtkWidget *dialog,
 
 			gtk_tree_model_get (GTK_TREE_MODEL (model), &iter,
 					    0, &media_type, -1);
+			if (priv->profile)
+				gst_encoding_profile_unref (priv->profile);
 			priv->profile = rb_gst_get_encoding_profile (media_type);
 			g_free (media_type);
 		}
@@ -617,38 +902,38 @@ converter_response_cb (GtkWidget *dialog,
 			return;
 		}
 
-		/* Create the gstreamer converter object */
-		create_gst (converter);
-
-		/* Create the progress window & status icon */
-		create_progress_dialog (converter);
-		create_status_icon (converter);
-
-		/* Let's put some text in the progressbar */
-		update_progressbar_text (converter);
-		gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->speedbar), 
-					   (dgettext (GETTEXT_PACKAGE, "Speed: Unknown")));
-
-		/* Alright we're finally ready to start converting */
-		convert_file (converter);
+		/* Alright we're finally ready to queue the files */
+		if (!probe_durations (converter))
+			start_batch (converter);
 	}
 	gtk_widget_destroy (dialog);
+
+	/* The scheduler holds its own reference while converting */
+	g_object_unref (user_data);
 }
 
-static GtkWidget
-*nsc_audio_profile_chooser_new (void)
+GtkWidget *
+nsc_audio_profile_chooser_new (void)
 {
 	GstEncodingTarget *target;
 	const GList       *p;
 	GtkWidget         *combo_box;
 	GtkCellRenderer   *renderer;
 	GtkTreeModel      *model;
+	gint64             start;
 
+	start = nsc_latency_start ();
 	model = GTK_TREE_MODEL (gtk_tree_store_new
 				(3, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_POINTER));
 	target = rb_gst_get_default_encoding_target ();
 
-	for (p = gst_encoding_target_get_profiles (target); p != NULL; p = p->next) {
+	/* The model points into the target, so keeps it alive */
+	if (target != NULL)
+		g_object_set_data_full (G_OBJECT (model), "target", target,
+					g_object_unref);
+
+	for (p = target ? gst_encoding_target_get_profiles (target) : NULL;
+	     p != NULL; p = p->next) {
 		GstEncodingProfile *profile;
 		gchar *media_type;
 
@@ -671,6 +956,8 @@ static GtkWidget
 	gtk_cell_layout_set_attributes (GTK_CELL_LAYOUT (combo_box),
 					renderer, "text", 1, NULL);
 
+	nsc_latency_record ("profile_chooser_new", start);
+
 	return GTK_WIDGET (combo_box);
 }
 
@@ -707,8 +994,10 @@ create_main_dialog (NscConverter *converter)
 	NscConverterPrivate *priv;
 	GtkWidget           *hbox;
 	gboolean             result;
+	gint64               start;
 
 	priv = NSC_CONVERTER_GET_PRIVATE (converter);
+	start = nsc_latency_start ();
 
 	/* Create the gtkbuilder and grab some widgets */
 	result = nsc_xml_get_file ("main.ui",
@@ -726,15 +1015,8 @@ create_main_dialog (NscConverter *converter)
 	 * to use that as the output destination.
 	 */
 	if (priv->src_dir) {
-		CajaFileInfo *file_info;
-		gchar            *uri;
-
-		file_info = CAJA_FILE_INFO (priv->files->data);
-		uri = caja_file_info_get_uri (file_info);
-
 		gtk_file_chooser_set_uri (GTK_FILE_CHOOSER (priv->path_chooser),
-					  uri);
-		g_free (uri);
+					  nsc_file_list_get_uri (priv->files, 0));
 	}
 
 	/* Create the gstreamer audio profile chooser */
@@ -758,6 +1040,8 @@ create_main_dialog (NscConverter *converter)
 			  converter);
 
 	gtk_widget_show_all (priv->dialog);
+
+	nsc_latency_record ("create_main_dialog", start);
 }
 
 static void
@@ -771,13 +1055,10 @@ nsc_converter_init (NscConverter *self)
 	if ((NSC_CONVERTER (self))->priv != NULL) {
 		NscConverterPrivate *priv = NSC_CONVERTER_GET_PRIVATE (self);
 		GSettings           *gsettings;
+		gchar               *replaygain;
 
 		/* Set init values */
-		priv->gst = NULL;
 		priv->files_converted = 0;
-		priv->current_duration = 0;
-		priv->total_duration = 0;
-		priv->before.seconds = -1;
 
 		/* Get GSettings client */
 		gsettings = g_settings_new (SOURCE_DIRECTORY);
@@ -787,6 +1068,13 @@ nsc_converter_init (NscConverter *self)
 		}
 
 		priv->src_dir = g_settings_get_boolean (gsettings, "source-dir");
+		priv->background = g_settings_get_boolean (gsettings, "background-mode");
+		priv->chunk_minutes = g_settings_get_int (gsettings, "chunk-minutes");
+		priv->preset = g_settings_get_string (gsettings, "encoder-preset");
+		priv->resample_quality = g_settings_get_int (gsettings, "resample-quality");
+		replaygain = g_settings_get_string (gsettings, "replaygain");
+		priv->replaygain = nsc_replaygain_mode_from_string (replaygain);
+		g_free (replaygain);
 
 		/* Unreference the gsettings client */
 		g_object_unref (gsettings);
@@ -796,11 +1084,142 @@ nsc_converter_init (NscConverter *self)
 	}
 }
 
+/**
+ * Record the ReplayGain of a converted file, and tag it unless
+ * the album gain needs to be worked out first.
+ */
+static void
+add_replaygain (NscConverter *converter,
+		GFile        *sink,
+		gdouble       gain,
+		gdouble       peak,
+		gint          duration)
+{
+	NscConverterPrivate *priv;
+	NscReplayGainTrack   track;
+
+	priv = NSC_CONVERTER_GET_PRIVATE (converter);
+
+	track.file = g_object_ref (sink);
+	track.gain = gain;
+	track.peak = peak;
+	track.duration = duration;
+
+	if (priv->replaygain == NSC_REPLAYGAIN_TRACK) {
+		write_replaygain (converter, &track, FALSE, 0, 0);
+		g_object_unref (track.file);
+		return;
+	}
+
+	/* Album mode needs every track first */
+	if (priv->tracks == NULL)
+		priv->tracks = g_array_new (FALSE, FALSE, sizeof (NscReplayGainTrack));
+	g_array_append_val (priv->tracks, track);
+}
+
+/**
+ * Once every job has finished and every split file has been joined,
+ * write the album gain and report what failed.
+ */
+static void
+check_batch_done (NscConverter *converter)
+{
+	NscConverterPrivate *priv;
+
+	priv = NSC_CONVERTER_GET_PRIVATE (converter);
+
+	if (priv->finished || priv->joins > 0 ||
+	    priv->files_converted < priv->total_files ||
+	    priv->next_file < nsc_file_list_length (priv->files))
+		return;
+	priv->finished = TRUE;
+
+	if (priv->replaygain == NSC_REPLAYGAIN_ALBUM)
+		write_album_replaygain (converter);
+
+	show_failures (converter);
+}
+
+static void
+join_ready_cb (GObject      *source_object,
+	       GAsyncResult *result,
+	       gpointer      user_data)
+{
+	Chunks              *chunks = user_data;
+	NscConverter        *converter = chunks->converter;
+	NscConverterPrivate *priv;
+	GError              *error = NULL;
+
+	priv = NSC_CONVERTER_GET_PRIVATE (converter);
+	priv->joins--;
+
+	if (!nsc_concat_files_finish (result, &error)) {
+		report_error (converter, chunks->src, error);
+		g_error_free (error);
+	} else if (chunks->replaygain != NULL &&
+		   chunks->replaygain->len == chunks->parts->len) {
+		gdouble gain, peak;
+		gint    duration = 0;
+		guint   i;
+
+		/* The parts combine the way the tracks of an album do */
+		nsc_replaygain_album (chunks->replaygain, &gain, &peak);
+		for (i = 0; i < chunks->replaygain->len; i++)
+			duration += g_array_index (chunks->replaygain,
+						   NscReplayGainTrack, i).duration;
+
+		add_replaygain (converter, chunks->sink, gain, peak, duration);
+	}
+
+	check_batch_done (converter);
+
+	/* Taken in chunk_finished() */
+	g_object_unref (converter);
+}
+
+/**
+ * Join the parts of a split file once they have all been
+ * converted.
+ */
+static void
+chunk_finished (NscConverter *converter,
+		Chunks       *chunks,
+		GError       *error)
+{
+	NscConverterPrivate *priv;
+	gchar               *media_type;
+
+	priv = NSC_CONVERTER_GET_PRIVATE (converter);
+
+	if (error != NULL && chunks->error == NULL)
+		chunks->error = g_error_copy (error);
+
+	if (--chunks->left > 0)
+		return;
+
+	/* Only report a failed file once; its parts go with the batch */
+	if (chunks->error != NULL) {
+		report_error (converter, chunks->src, chunks->error);
+		return;
+	}
+
+	priv->joins++;
+	g_object_ref (converter);
+
+	media_type = rb_gst_encoding_profile_get_media_type (priv->profile);
+	nsc_concat_files_async (chunks->parts, chunks->sink, media_type,
+				NULL, join_ready_cb, chunks);
+	g_free (media_type);
+}
+
 /*
  * Public Methods
  */
+/**
+ * Create a batch converting files, which it takes over.
+ */
 NscConverter *
-nsc_converter_new (GList *files)
+nsc_converter_new (NscFileList *files)
 {
 	return g_object_new (NSC_TYPE_CONVERTER, "files", files, NULL);
 }
@@ -812,3 +1231,196 @@ nsc_converter_show_dialog (NscConverter *converter)
 
 	create_main_dialog (converter);
 }
+
+/**
+ * Queue the batch straight away, without asking, converting to the
+ * profile for media_type into destination.  Returns FALSE if there
+ * is no usable profile for it.
+ */
+gboolean
+nsc_converter_start (NscConverter *converter,
+		     const gchar  *media_type,
+		     GFile        *destination)
+{
+	NscConverterPrivate *priv;
+	GstEncodingProfile  *profile;
+
+	g_return_val_if_fail (NSC_IS_CONVERTER (converter), FALSE);
+	g_return_val_if_fail (G_IS_FILE (destination), FALSE);
+
+	priv = NSC_CONVERTER_GET_PRIVATE (converter);
+
+	profile = rb_gst_get_encoding_profile (media_type);
+	if (profile == NULL || !nsc_gstreamer_supports_profile (profile)) {
+		if (profile != NULL)
+			gst_encoding_profile_unref (profile);
+		return FALSE;
+	}
+
+	if (priv->profile)
+		gst_encoding_profile_unref (priv->profile);
+	priv->profile = profile;
+
+	g_free (priv->save_path);
+	priv->save_path = g_file_get_uri (destination);
+
+	if (!probe_durations (converter))
+		start_batch (converter);
+
+	return TRUE;
+}
+
+/**
+ * Hand out the next job of the batch, or NULL once they have all
+ * been started.  The job needs to be freed with nsc_job_free().
+ */
+NscJob *
+nsc_converter_next_job (NscConverter *converter)
+{
+	NscConverterPrivate *priv;
+	NscJob              *job;
+
+	g_return_val_if_fail (NSC_IS_CONVERTER (converter), NULL);
+
+	priv = NSC_CONVERTER_GET_PRIVATE (converter);
+
+	if (priv->jobs == NULL)
+		return NULL;
+
+	while (g_queue_is_empty (priv->jobs) &&
+	       priv->next_file < nsc_file_list_length (priv->files))
+		queue_next_file (converter);
+
+	job = g_queue_pop_head (priv->jobs);
+
+	/* The last files may all have come to nothing */
+	if (job == NULL)
+		check_batch_done (converter);
+
+	return job;
+}
+
+/**
+ * Called by the scheduler once a job of the batch has been
+ * converted, or failed to.
+ */
+void
+nsc_converter_job_finished (NscConverter *converter,
+			    NscJob       *job,
+			    GError       *error)
+{
+	NscConverterPrivate *priv;
+
+	g_return_if_fail (NSC_IS_CONVERTER (converter));
+
+	priv = NSC_CONVERTER_GET_PRIVATE (converter);
+
+	priv->files_converted++;
+
+	if (job->chunks != NULL)
+		chunk_finished (converter, job->chunks, error);
+	else if (error != NULL)
+		report_error (converter, job->src, error);
+
+	check_batch_done (converter);
+}
+
+/**
+ * Put back a job that failed with a transient error, to be
+ * handed out again before the others.  The batch takes the job
+ * back.
+ */
+void
+nsc_converter_retry_job (NscConverter *converter,
+			 NscJob       *job)
+{
+	NscConverterPrivate *priv;
+
+	g_return_if_fail (NSC_IS_CONVERTER (converter));
+
+	priv = NSC_CONVERTER_GET_PRIVATE (converter);
+
+	g_queue_push_head (priv->jobs, job);
+}
+
+/**
+ * Called by the scheduler with the ReplayGain of a job that
+ * has just been converted successfully.
+ */
+void
+nsc_converter_job_replaygain (NscConverter *converter,
+			      NscJob       *job,
+			      gdouble       gain,
+			      gdouble       peak,
+			      gint          duration)
+{
+	Chunks             *chunks;
+	NscReplayGainTrack  track;
+
+	g_return_if_fail (NSC_IS_CONVERTER (converter));
+
+	if (job->chunks == NULL) {
+		add_replaygain (converter, job->sink, gain, peak, duration);
+		return;
+	}
+
+	/* A part only counts towards the gain of the whole file */
+	chunks = job->chunks;
+	if (chunks->replaygain == NULL)
+		chunks->replaygain = g_array_new (FALSE, FALSE,
+						  sizeof (NscReplayGainTrack));
+
+	track.file = NULL;
+	track.gain = gain;
+	track.peak = peak;
+	track.duration = duration;
+	g_array_append_val (chunks->replaygain, track);
+}
+
+GstEncodingProfile *
+nsc_converter_get_profile (NscConverter *converter)
+{
+	g_return_val_if_fail (NSC_IS_CONVERTER (converter), NULL);
+
+	return NSC_CONVERTER_GET_PRIVATE (converter)->profile;
+}
+
+gboolean
+nsc_converter_get_background (NscConverter *converter)
+{
+	g_return_val_if_fail (NSC_IS_CONVERTER (converter), FALSE);
+
+	return NSC_CONVERTER_GET_PRIVATE (converter)->background;
+}
+
+gboolean
+nsc_converter_get_replaygain (NscConverter *converter)
+{
+	g_return_val_if_fail (NSC_IS_CONVERTER (converter), FALSE);
+
+	return NSC_CONVERTER_GET_PRIVATE (converter)->replaygain != NSC_REPLAYGAIN_NONE;
+}
+
+const gchar *
+nsc_converter_get_preset (NscConverter *converter)
+{
+	g_return_val_if_fail (NSC_IS_CONVERTER (converter), NULL);
+
+	return NSC_CONVERTER_GET_PRIVATE (converter)->preset;
+}
+
+gint
+nsc_converter_get_resample_quality (NscConverter *converter)
+{
+	g_return_val_if_fail (NSC_IS_CONVERTER (converter), 0);
+
+	return NSC_CONVERTER_GET_PRIVATE (converter)->resample_quality;
+}
+
+gint
+nsc_converter_get_total_files (NscConverter *converter)
+{
+	g_return_val_if_fail (NSC_IS_CONVERTER (converter), 0);
+
+	return NSC_CONVERTER_GET_PRIVATE (converter)->total_files;
+}
@@ -25,6 +25,12 @@
 #define NSC_CONVERTER_H
 
 #include <glib-object.h>
+#include <gio/gio.h>
+#include <gtk/gtk.h>
+#include <gst/pbutils/encoding-profile.h>
+
+#include "nsc-file-list.h"
+#include "nsc-job.h"
 
 G_BEGIN_DECLS
 
@@ -50,8 +56,33 @@ struct _NscConverterClass {
 };
 
 GType		 nsc_converter_get_type    (void);
-NscConverter	*nsc_converter_new 	   (GList *files);
+NscConverter	*nsc_converter_new 	   (NscFileList *files);
 void		 nsc_converter_show_dialog (NscConverter *dialog);
+gboolean	 nsc_converter_start       (NscConverter *converter,
+					    const gchar  *media_type,
+					    GFile        *destination);
+
+/* Used by NscScheduler, which runs the batch */
+NscJob		*nsc_converter_next_job    (NscConverter  *converter);
+void		 nsc_converter_job_finished (NscConverter *converter,
+					     NscJob       *job,
+					     GError       *error);
+void		 nsc_converter_retry_job   (NscConverter *converter,
+					    NscJob       *job);
+void		 nsc_converter_job_replaygain (NscConverter *converter,
+					       NscJob       *job,
+					       gdouble       gain,
+					       gdouble       peak,
+					       gint          duration);
+GstEncodingProfile *nsc_converter_get_profile     (NscConverter *converter);
+gboolean	 nsc_converter_get_background  (NscConverter *converter);
+gboolean	 nsc_converter_get_replaygain  (NscConverter *converter);
+const gchar	*nsc_converter_get_preset      (NscConverter *converter);
+gint		 nsc_converter_get_resample_quality (NscConverter *converter);
+gint		 nsc_converter_get_total_files (NscConverter *converter);
+
+/* The profile combo box of the dialog */
+GtkWidget	*nsc_audio_profile_chooser_new (void);
 
 G_END_DECLS
 
@@ -0,0 +1,339 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-cue.c
+ * 
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ * 
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <gio/gio.h>
+#include <gst/gst.h>
+
+#include "nsc-cue.h"
+#include "nsc-error.h"
+
+/* Cue sheet times are in CD frames */
+#define FRAMES_PER_SECOND 75
+
+/**
+ * Return the next argument of a cue sheet command, which is
+ * either a quoted string or a single word, and move past it.
+ */
+static gchar *
+next_argument (gchar **line)
+{
+	gchar *start, *end;
+
+	start = *line;
+	while (g_ascii_isspace (*start))
+		start++;
+
+	if (*start == '\0')
+		return NULL;
+
+	if (*start == '"') {
+		start++;
+		end = strchr (start, '"');
+		if (end == NULL)
+			end = start + strlen (start);
+	} else {
+		end = start;
+		while (*end != '\0' && !g_ascii_isspace (*end))
+			end++;
+	}
+
+	*line = (*end != '\0') ? end + 1 : end;
+
+	return g_strndup (start, end - start);
+}
+
+static gboolean
+parse_index_time (const gchar *msf, GstClockTime *time)
+{
+	guint minutes, seconds, frames;
+	guint64 total;
+
+	if (sscanf (msf, "%u:%u:%u", &minutes, &seconds, &frames) != 3)
+		return FALSE;
+
+	total = ((guint64) minutes * 60 + seconds) * FRAMES_PER_SECOND + frames;
+	*time = gst_util_uint64_scale (total, GST_SECOND, FRAMES_PER_SECOND);
+
+	return TRUE;
+}
+
+/**
+ * Cue sheets are often in the encoding of whatever ripped the
+ * disc, so fall back to Latin-1 if it isn't UTF-8.
+ */
+static gchar *
+contents_to_utf8 (gchar *contents, gsize length)
+{
+	gchar *utf8;
+
+	if (g_utf8_validate (contents, length, NULL))
+		return contents;
+
+	utf8 = g_convert (contents, length, "UTF-8", "ISO-8859-1",
+			  NULL, NULL, NULL);
+	g_free (contents);
+
+	return utf8;
+}
+
+/*
+ * Public Methods
+ */
+
+/**
+ * Parse a cue sheet.  Only sheets describing one audio file are
+ * accepted, since those are the ones that need splitting.
+ */
+NscCueSheet *
+nsc_cue_sheet_load (GFile *cue, GError **error)
+{
+	NscCueSheet  *sheet;
+	NscCueTrack  *track = NULL;
+	GFile        *parent;
+	gchar        *contents, **lines;
+	gchar        *file_name = NULL;
+	gsize         length;
+	gint          files = 0;
+	guint         i;
+
+	g_return_val_if_fail (G_IS_FILE (cue), NULL);
+
+	if (!g_file_load_contents (cue, NULL, &contents, &length, NULL, error))
+		return NULL;
+
+	contents = contents_to_utf8 (contents, length);
+	if (contents == NULL) {
+		g_set_error (error, NSC_ERROR, NSC_ERROR_INTERNAL_ERROR,
+			     _("Could not read the cue sheet"));
+		return NULL;
+	}
+
+	sheet = g_new0 (NscCueSheet, 1);
+	sheet->tracks = g_array_new (FALSE, TRUE, sizeof (NscCueTrack));
+
+	lines = g_strsplit_set (contents, "\r\n", -1);
+	g_free (contents);
+
+	for (i = 0; lines[i] != NULL; i++) {
+		gchar *line = lines[i];
+		gchar *command;
+
+		command = next_argument (&line);
+		if (command == NULL)
+			continue;
+
+		if (g_ascii_strcasecmp (command, "FILE") == 0) {
+			g_free (file_name);
+			file_name = next_argument (&line);
+			files++;
+		} else if (g_ascii_strcasecmp (command, "TRACK") == 0) {
+			gchar       *number = next_argument (&line);
+			gchar       *type = next_argument (&line);
+			NscCueTrack  new_track = { 0, };
+
+			if (g_ascii_strcasecmp (type ? type : "", "AUDIO") == 0) {
+				new_track.number = number ? atoi (number) : 0;
+				new_track.start = GST_CLOCK_TIME_NONE;
+				new_track.stop = GST_CLOCK_TIME_NONE;
+				g_array_append_val (sheet->tracks, new_track);
+				track = &g_array_index (sheet->tracks, NscCueTrack,
+							sheet->tracks->len - 1);
+			} else {
+				/* Skip data tracks */
+				track = NULL;
+			}
+			g_free (number);
+			g_free (type);
+		} else if (g_ascii_strcasecmp (command, "INDEX") == 0 && track) {
+			gchar *number = next_argument (&line);
+			gchar *msf = next_argument (&line);
+
+			/* Pregaps (INDEX 00) stay with the previous track */
+			if (number && atoi (number) == 1 && msf)
+				parse_index_time (msf, &track->start);
+			g_free (number);
+			g_free (msf);
+		} else if (g_ascii_strcasecmp (command, "TITLE") == 0) {
+			gchar **title = track ? &track->title : &sheet->title;
+
+			g_free (*title);
+			*title = next_argument (&line);
+		} else if (g_ascii_strcasecmp (command, "PERFORMER") == 0) {
+			gchar **performer = track ? &track->performer : &sheet->performer;
+
+			g_free (*performer);
+			*performer = next_argument (&line);
+		}
+
+		g_free (command);
+	}
+	g_strfreev (lines);
+
+	if (files != 1 || file_name == NULL || sheet->tracks->len == 0) {
+		g_set_error (error, NSC_ERROR, NSC_ERROR_INTERNAL_ERROR,
+			     _("The cue sheet does not describe a single-file disc image"));
+		g_free (file_name);
+		nsc_cue_sheet_free (sheet);
+		return NULL;
+	}
+
+	/* Each track ends where the next one starts */
+	for (i = 0; i < sheet->tracks->len; i++) {
+		NscCueTrack *t = &g_array_index (sheet->tracks, NscCueTrack, i);
+
+		if (!GST_CLOCK_TIME_IS_VALID (t->start)) {
+			g_set_error (error, NSC_ERROR, NSC_ERROR_INTERNAL_ERROR,
+				     _("Track %d of the cue sheet has no start"),
+				     t->number);
+			g_free (file_name);
+			nsc_cue_sheet_free (sheet);
+			return NULL;
+		}
+
+		if (i + 1 < sheet->tracks->len)
+			t->stop = g_array_index (sheet->tracks, NscCueTrack, i + 1).start;
+	}
+
+	parent = g_file_get_parent (cue);
+	sheet->image = g_file_resolve_relative_path (parent, file_name);
+	g_object_unref (parent);
+	g_free (file_name);
+
+	return sheet;
+}
+
+/**
+ * Look for "image.cue" or "image.ext.cue" next to the image,
+ * and check that it really describes that file.
+ */
+NscCueSheet *
+nsc_cue_sheet_find_for_image (GFile *image)
+{
+	GFile  *parent;
+	gchar  *basename, *dot, *names[2];
+	guint   i;
+	NscCueSheet *sheet = NULL;
+
+	g_return_val_if_fail (G_IS_FILE (image), NULL);
+
+	parent = g_file_get_parent (image);
+	if (parent == NULL)
+		return NULL;
+
+	basename = g_file_get_basename (image);
+	names[0] = g_strconcat (basename, ".cue", NULL);
+	dot = strrchr (basename, '.');
+	if (dot != NULL)
+		*dot = '\0';
+	names[1] = g_strconcat (basename, ".cue", NULL);
+	g_free (basename);
+
+	for (i = 0; i < G_N_ELEMENTS (names) && sheet == NULL; i++) {
+		GFile *cue = g_file_get_child (parent, names[i]);
+
+		if (g_file_query_exists (cue, NULL)) {
+			sheet = nsc_cue_sheet_load (cue, NULL);
+			if (sheet != NULL && !g_file_equal (sheet->image, image)) {
+				nsc_cue_sheet_free (sheet);
+				sheet = NULL;
+			}
+		}
+		g_object_unref (cue);
+	}
+
+	g_free (names[0]);
+	g_free (names[1]);
+	g_object_unref (parent);
+
+	return sheet;
+}
+
+/**
+ * The tags for the file made from a track.  This needs to be
+ * unreferenced.
+ */
+GstTagList *
+nsc_cue_sheet_get_track_tags (NscCueSheet *sheet, guint index)
+{
+	NscCueTrack *track;
+	GstTagList  *tags;
+	const gchar *artist;
+
+	g_return_val_if_fail (sheet != NULL, NULL);
+	g_return_val_if_fail (index < sheet->tracks->len, NULL);
+
+	track = &g_array_index (sheet->tracks, NscCueTrack, index);
+
+	tags = gst_tag_list_new (GST_TAG_TRACK_NUMBER, (guint) track->number,
+				 GST_TAG_TRACK_COUNT, sheet->tracks->len,
+				 NULL);
+
+	if (track->title)
+		gst_tag_list_add (tags, GST_TAG_MERGE_REPLACE,
+				  GST_TAG_TITLE, track->title, NULL);
+	if (sheet->title)
+		gst_tag_list_add (tags, GST_TAG_MERGE_REPLACE,
+				  GST_TAG_ALBUM, sheet->title, NULL);
+
+	artist = track->performer ? track->performer : sheet->performer;
+	if (artist)
+		gst_tag_list_add (tags, GST_TAG_MERGE_REPLACE,
+				  GST_TAG_ARTIST, artist, NULL);
+	if (sheet->performer)
+		gst_tag_list_add (tags, GST_TAG_MERGE_REPLACE,
+				  GST_TAG_ALBUM_ARTIST, sheet->performer, NULL);
+
+	return tags;
+}
+
+void
+nsc_cue_sheet_free (NscCueSheet *sheet)
+{
+	guint i;
+
+	if (sheet == NULL)
+		return;
+
+	for (i = 0; i < sheet->tracks->len; i++) {
+		NscCueTrack *track = &g_array_index (sheet->tracks, NscCueTrack, i);
+
+		g_free (track->title);
+		g_free (track->performer);
+	}
+	g_array_free (sheet->tracks, TRUE);
+
+	if (sheet->image)
+		g_object_unref (sheet->image);
+	g_free (sheet->title);
+	g_free (sheet->performer);
+	g_free (sheet);
+}
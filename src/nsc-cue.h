@@ -0,0 +1,59 @@
+/*
+ *  nsc-cue.h
+ * 
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ * 
+ */
+
+#ifndef NSC_CUE_H
+#define NSC_CUE_H
+
+#include <gio/gio.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct {
+	gint          number;
+	gchar        *title;
+	gchar        *performer;
+
+	/* INDEX 01 of the track; it runs until the next track's */
+	GstClockTime  start;
+	GstClockTime  stop;
+} NscCueTrack;
+
+/* A cue sheet describing a single-file disc image */
+typedef struct {
+	GFile        *image;
+	gchar        *title;
+	gchar        *performer;
+	GArray       *tracks;
+} NscCueSheet;
+
+NscCueSheet *nsc_cue_sheet_load           (GFile        *cue,
+					   GError      **error);
+NscCueSheet *nsc_cue_sheet_find_for_image (GFile        *image);
+GstTagList  *nsc_cue_sheet_get_track_tags (NscCueSheet  *sheet,
+					   guint         index);
+void         nsc_cue_sheet_free           (NscCueSheet  *sheet);
+
+G_END_DECLS
+
+#endif /* NSC_CUE_H */
@@ -0,0 +1,575 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-daemon.c
+ * 
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ * 
+ */
+
+/*
+ * caja-sound-converter-daemon is started by the session bus the first
+ * time the extension asks for a conversion.  It keeps GStreamer, the
+ * plugin registry and the encoding profiles loaded, and keeps the
+ * NscGStreamer objects of finished jobs around for the next request,
+ * exiting once it has been idle for a while.  With --background it
+ * is the instance for background jobs, see nsc-dbus.h.
+ */
+
+#include <config.h>
+
+#include <locale.h>
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <gio/gio.h>
+#include <gst/gst.h>
+
+#include "nsc-dbus.h"
+#include "nsc-error.h"
+#include "nsc-gstreamer.h"
+#include "nsc-priority.h"
+#include "rb-gst-media-types.h"
+
+/* Seconds without any job before the daemon exits */
+#define IDLE_TIMEOUT 120
+
+typedef struct {
+	guint               id;
+	gchar              *sender;
+	GFile              *src;
+	GFile              *sink;
+	gboolean            background;
+	gboolean            replaygain;
+	guint64             start;
+	guint64             stop;
+	GstTagList         *tags;
+	gchar              *preset;
+	gint                resample_quality;
+	gboolean            checksum;
+	gboolean            verify;
+	gboolean            paused;
+	GstEncodingProfile *profile;
+	NscGStreamer       *gst;
+} Job;
+
+static GMainLoop       *loop = NULL;
+static GDBusConnection *connection = NULL;
+static GDBusNodeInfo   *introspection_data = NULL;
+
+/* Job id to Job */
+static GHashTable      *jobs = NULL;
+
+/* Profile name to a GQueue of idle NscGStreamer objects */
+static GHashTable      *idle_pool = NULL;
+
+static guint            next_job_id = 1;
+static guint            idle_id = 0;
+static gboolean         background = FALSE;
+
+static const GOptionEntry entries[] = {
+	{ "background", 0, 0, G_OPTION_ARG_NONE, &background,
+	  N_("Only run background jobs, with low cgroup weights"), NULL },
+	{ NULL }
+};
+
+static gboolean
+idle_timeout_cb (gpointer user_data)
+{
+	g_debug ("Idle for %d seconds, exiting", IDLE_TIMEOUT);
+
+	idle_id = 0;
+	g_main_loop_quit (loop);
+
+	return FALSE;
+}
+
+static void
+update_idle_timeout (void)
+{
+	if (g_hash_table_size (jobs) > 0) {
+		if (idle_id) {
+			g_source_remove (idle_id);
+			idle_id = 0;
+		}
+	} else if (idle_id == 0) {
+		idle_id = g_timeout_add_seconds (IDLE_TIMEOUT,
+						 idle_timeout_cb, NULL);
+	}
+}
+
+static void
+job_free (Job *job)
+{
+	g_free (job->sender);
+	g_object_unref (job->src);
+	g_object_unref (job->sink);
+	gst_encoding_profile_unref (job->profile);
+	if (job->tags)
+		gst_tag_list_unref (job->tags);
+	g_free (job->preset);
+	g_free (job);
+}
+
+/**
+ * Take a converter for the profile out of the pool, or
+ * create one if there isn't an idle one.
+ */
+static NscGStreamer *
+pool_take (GstEncodingProfile *profile)
+{
+	GQueue *queue;
+
+	queue = g_hash_table_lookup (idle_pool,
+				     gst_encoding_profile_get_name (profile));
+	if (queue != NULL && !g_queue_is_empty (queue))
+		return g_queue_pop_head (queue);
+
+	return nsc_gstreamer_new (profile);
+}
+
+static void
+pool_return (GstEncodingProfile *profile, NscGStreamer *gst)
+{
+	const gchar *name;
+	GQueue      *queue;
+
+	name = gst_encoding_profile_get_name (profile);
+	queue = g_hash_table_lookup (idle_pool, name);
+	if (queue == NULL) {
+		queue = g_queue_new ();
+		g_hash_table_insert (idle_pool, g_strdup (name), queue);
+	}
+
+	g_queue_push_head (queue, gst);
+}
+
+static void
+pool_queue_free (GQueue *queue)
+{
+	g_queue_foreach (queue, (GFunc) g_object_unref, NULL);
+	g_queue_free (queue);
+}
+
+static void
+emit_job_signal (Job         *job,
+		 const gchar *signal_name,
+		 GVariant    *parameters)
+{
+	GError *error = NULL;
+
+	if (!g_dbus_connection_emit_signal (connection,
+					    job->sender,
+					    NSC_DBUS_PATH,
+					    NSC_DBUS_INTERFACE,
+					    signal_name,
+					    parameters,
+					    &error)) {
+		g_warning ("Unable to emit %s: %s", signal_name, error->message);
+		g_error_free (error);
+	}
+}
+
+/**
+ * Forget about a job, handing its converter back to the pool.
+ */
+static void
+release_job (Job *job)
+{
+	if (job->gst != NULL) {
+		g_signal_handlers_disconnect_matched (job->gst,
+						      G_SIGNAL_MATCH_DATA,
+						      0, 0, NULL, NULL, job);
+		pool_return (job->profile, job->gst);
+		job->gst = NULL;
+	}
+
+	/* This frees the job */
+	g_hash_table_remove (jobs, GUINT_TO_POINTER (job->id));
+	update_idle_timeout ();
+}
+
+static void
+emit_usage (Job *job)
+{
+	guint64 cpu_time, peak_rss;
+
+	if (job->gst == NULL)
+		return;
+
+	g_object_get (G_OBJECT (job->gst),
+		      "cpu-time", &cpu_time,
+		      "peak-rss", &peak_rss,
+		      NULL);
+	emit_job_signal (job, "Usage",
+			 g_variant_new ("(utt)", job->id, cpu_time, peak_rss));
+}
+
+static void
+emit_checksum (Job *job)
+{
+	gchar *md5 = NULL;
+
+	g_object_get (G_OBJECT (job->gst), "pcm-md5", &md5, NULL);
+	if (md5 != NULL)
+		emit_job_signal (job, "Checksum",
+				 g_variant_new ("(us)", job->id, md5));
+	g_free (md5);
+}
+
+static void
+job_error (Job *job, GError *error)
+{
+	emit_usage (job);
+	emit_job_signal (job, "Error",
+			 g_variant_new ("(usis)", job->id,
+					g_quark_to_string (error->domain),
+					error->code, error->message));
+	release_job (job);
+}
+
+static void
+on_error_cb (NscGStreamer *gst, GError *error, gpointer data)
+{
+	job_error ((Job *) data, error);
+}
+
+static void
+on_completion_cb (NscGStreamer *gst, gpointer data)
+{
+	Job *job = data;
+
+	emit_usage (job);
+	emit_checksum (job);
+	emit_job_signal (job, "Completion", g_variant_new ("(u)", job->id));
+	release_job (job);
+}
+
+static void
+on_duration_cb (NscGStreamer *gst, const int seconds, gpointer data)
+{
+	Job *job = data;
+
+	emit_job_signal (job, "Duration",
+			 g_variant_new ("(ui)", job->id, seconds));
+}
+
+static void
+on_progress_cb (NscGStreamer *gst, const int seconds, gpointer data)
+{
+	Job *job = data;
+
+	emit_job_signal (job, "Progress",
+			 g_variant_new ("(ui)", job->id, seconds));
+}
+
+static void
+on_replaygain_cb (NscGStreamer *gst,
+		  gdouble       gain,
+		  gdouble       peak,
+		  gpointer      data)
+{
+	Job *job = data;
+
+	emit_job_signal (job, "ReplayGain",
+			 g_variant_new ("(udd)", job->id, gain, peak));
+}
+
+static gboolean
+start_job_cb (gpointer user_data)
+{
+	Job    *job;
+	GError *error = NULL;
+
+	/* The job may have been cancelled in the meantime */
+	job = g_hash_table_lookup (jobs, user_data);
+	if (job == NULL)
+		return FALSE;
+
+	job->gst = pool_take (job->profile);
+	g_object_set (G_OBJECT (job->gst),
+		      "background", job->background,
+		      "replaygain", job->replaygain,
+		      "start", job->start,
+		      "stop", job->stop,
+		      "tags", job->tags,
+		      "preset", job->preset,
+		      "resample-quality", job->resample_quality,
+		      "checksum", job->checksum,
+		      "verify", job->verify,
+		      NULL);
+
+	g_signal_connect (G_OBJECT (job->gst), "completion",
+			  (GCallback) on_completion_cb, job);
+	g_signal_connect (G_OBJECT (job->gst), "error",
+			  (GCallback) on_error_cb, job);
+	g_signal_connect (G_OBJECT (job->gst), "progress",
+			  (GCallback) on_progress_cb, job);
+	g_signal_connect (G_OBJECT (job->gst), "duration",
+			  (GCallback) on_duration_cb, job);
+	g_signal_connect (G_OBJECT (job->gst), "replaygain",
+			  (GCallback) on_replaygain_cb, job);
+
+	if (job->paused) {
+		nsc_gstreamer_preroll_file (job->gst, job->src, job->sink);
+		return FALSE;
+	}
+
+	nsc_gstreamer_convert_file (job->gst, job->src, job->sink, &error);
+	if (error != NULL) {
+		job_error (job, error);
+		g_error_free (error);
+	}
+
+	return FALSE;
+}
+
+static void
+handle_convert (GVariant              *parameters,
+		GDBusMethodInvocation *invocation)
+{
+	GstEncodingProfile *profile;
+	const gchar        *src_uri, *sink_uri, *profile_name;
+	const gchar        *tags_str;
+	GVariant           *options;
+	Job                *job;
+
+	g_variant_get (parameters, "(&s&s&s@a{sv})",
+		       &src_uri, &sink_uri, &profile_name, &options);
+
+	profile = rb_gst_get_encoding_profile_by_name (profile_name);
+	if (profile == NULL) {
+		g_dbus_method_invocation_return_error (invocation,
+						       NSC_ERROR,
+						       NSC_ERROR_INTERNAL_ERROR,
+						       _("Unknown encoding profile %s"),
+						       profile_name);
+		g_variant_unref (options);
+		return;
+	}
+
+	job = g_new0 (Job, 1);
+	job->id = next_job_id++;
+	job->sender = g_strdup (g_dbus_method_invocation_get_sender (invocation));
+	job->src = g_file_new_for_uri (src_uri);
+	job->sink = g_file_new_for_uri (sink_uri);
+	job->profile = profile;
+
+	/* Missing options keep their default of FALSE */
+	g_variant_lookup (options, "background", "b", &job->background);
+	job->background |= background;
+	g_variant_lookup (options, "replaygain", "b", &job->replaygain);
+	g_variant_lookup (options, "checksum", "b", &job->checksum);
+	g_variant_lookup (options, "verify", "b", &job->verify);
+	g_variant_lookup (options, "paused", "b", &job->paused);
+
+	/* The whole file unless told otherwise */
+	job->stop = GST_CLOCK_TIME_NONE;
+	g_variant_lookup (options, "start", "t", &job->start);
+	g_variant_lookup (options, "stop", "t", &job->stop);
+
+	/* audioresample's default */
+	job->resample_quality = 4;
+	g_variant_lookup (options, "resample-quality", "i", &job->resample_quality);
+	job->resample_quality = CLAMP (job->resample_quality, 0, 10);
+
+	if (g_variant_lookup (options, "tags", "&s", &tags_str))
+		job->tags = gst_tag_list_new_from_string (tags_str);
+	g_variant_lookup (options, "preset", "s", &job->preset);
+	g_variant_unref (options);
+
+	g_hash_table_insert (jobs, GUINT_TO_POINTER (job->id), job);
+	update_idle_timeout ();
+
+	/* Reply first, so the client knows the id before any signal */
+	g_dbus_method_invocation_return_value (invocation,
+					       g_variant_new ("(u)", job->id));
+
+	g_idle_add (start_job_cb, GUINT_TO_POINTER (job->id));
+}
+
+static void
+handle_start (GVariant              *parameters,
+	      GDBusMethodInvocation *invocation)
+{
+	Job    *job;
+	GError *error = NULL;
+	guint   id;
+
+	g_variant_get (parameters, "(u)", &id);
+
+	job = g_hash_table_lookup (jobs, GUINT_TO_POINTER (id));
+	if (job != NULL && job->paused) {
+		job->paused = FALSE;
+
+		/* Otherwise start_job_cb() has yet to run, and converts it */
+		if (job->gst != NULL) {
+			nsc_gstreamer_convert_file (job->gst, job->src,
+						    job->sink, &error);
+			if (error != NULL) {
+				job_error (job, error);
+				g_error_free (error);
+			}
+		}
+	}
+
+	g_dbus_method_invocation_return_value (invocation, NULL);
+}
+
+static void
+handle_cancel (GVariant              *parameters,
+	       GDBusMethodInvocation *invocation)
+{
+	Job   *job;
+	guint  id;
+
+	g_variant_get (parameters, "(u)", &id);
+
+	job = g_hash_table_lookup (jobs, GUINT_TO_POINTER (id));
+	if (job != NULL) {
+		if (job->gst != NULL)
+			nsc_gstreamer_cancel_convert (job->gst);
+		release_job (job);
+	}
+
+	g_dbus_method_invocation_return_value (invocation, NULL);
+}
+
+static void
+handle_method_call (GDBusConnection       *conn,
+		    const gchar           *sender,
+		    const gchar           *object_path,
+		    const gchar           *interface_name,
+		    const gchar           *method_name,
+		    GVariant              *parameters,
+		    GDBusMethodInvocation *invocation,
+		    gpointer               user_data)
+{
+	if (g_strcmp0 (method_name, "Convert") == 0)
+		handle_convert (parameters, invocation);
+	else if (g_strcmp0 (method_name, "Start") == 0)
+		handle_start (parameters, invocation);
+	else if (g_strcmp0 (method_name, "Cancel") == 0)
+		handle_cancel (parameters, invocation);
+}
+
+static const GDBusInterfaceVTable interface_vtable = {
+	handle_method_call,
+	NULL,
+	NULL,
+};
+
+static void
+bus_acquired_cb (GDBusConnection *conn,
+		 const gchar     *name,
+		 gpointer         user_data)
+{
+	GError *error = NULL;
+
+	connection = conn;
+
+	/*
+	 * The threads of a background job run at idle priority anyway,
+	 * but an instance that runs nothing else can also be given low
+	 * cgroup weights.
+	 */
+	if (background)
+		nsc_priority_enter_scope (conn);
+
+	g_dbus_connection_register_object (conn,
+					   NSC_DBUS_PATH,
+					   introspection_data->interfaces[0],
+					   &interface_vtable,
+					   NULL, NULL,
+					   &error);
+	if (error != NULL) {
+		g_warning ("Unable to register object: %s", error->message);
+		g_error_free (error);
+		g_main_loop_quit (loop);
+	}
+}
+
+static void
+name_lost_cb (GDBusConnection *conn,
+	      const gchar     *name,
+	      gpointer         user_data)
+{
+	/* Either another daemon is already running, or the bus went away */
+	g_main_loop_quit (loop);
+}
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext    *context;
+	GstEncodingTarget *target;
+	GError            *error = NULL;
+	guint              owner_id;
+
+	setlocale (LC_ALL, "");
+	bindtextdomain (GETTEXT_PACKAGE, MATELOCALEDIR);
+	bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
+	textdomain (GETTEXT_PACKAGE);
+
+	context = g_option_context_new (NULL);
+	g_option_context_add_main_entries (context, entries, GETTEXT_PACKAGE);
+	g_option_context_add_group (context, gst_init_get_option_group ());
+
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return 1;
+	}
+	g_option_context_free (context);
+
+	/* Load the profiles now rather than on the first request */
+	target = rb_gst_get_default_encoding_target ();
+	if (target != NULL)
+		gst_encoding_target_unref (target);
+
+	introspection_data = g_dbus_node_info_new_for_xml (NSC_DBUS_INTROSPECTION_XML,
+							   NULL);
+	g_assert (introspection_data != NULL);
+
+	jobs = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+				      NULL, (GDestroyNotify) job_free);
+	idle_pool = g_hash_table_new_full (g_str_hash, g_str_equal,
+					   g_free, (GDestroyNotify) pool_queue_free);
+
+	loop = g_main_loop_new (NULL, FALSE);
+
+	owner_id = g_bus_own_name (G_BUS_TYPE_SESSION,
+				   background ? NSC_DBUS_BACKGROUND_NAME : NSC_DBUS_NAME,
+				   G_BUS_NAME_OWNER_FLAGS_NONE,
+				   bus_acquired_cb,
+				   NULL,
+				   name_lost_cb,
+				   NULL, NULL);
+
+	update_idle_timeout ();
+	g_main_loop_run (loop);
+
+	g_bus_unown_name (owner_id);
+
+	g_hash_table_destroy (jobs);
+	g_hash_table_destroy (idle_pool);
+	g_dbus_node_info_unref (introspection_data);
+	g_main_loop_unref (loop);
+
+	return 0;
+}
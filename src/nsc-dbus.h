@@ -0,0 +1,111 @@
+/*
+ *  nsc-dbus.h
+ * 
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ * 
+ */
+
+#ifndef NSC_DBUS_H
+#define NSC_DBUS_H
+
+/*
+ * The interface exported by caja-sound-converter-daemon, and used
+ * by NscRemote to convert files outside of the Caja process.
+ *
+ * Convert() only queues the job and returns its id; everything
+ * else, including errors starting the pipeline, is reported through
+ * the signals so that the client never misses one for a job id it
+ * does not know yet.
+ *
+ * The options of Convert() are the NscGStreamer properties to set
+ * for the job: the booleans "background" and "replaygain", the
+ * "start" and "stop" times of the part to convert as uint64
+ * nanoseconds, the "tags" as a serialized GstTagList string, the
+ * encoder "preset" name, the int32 "resample-quality", and the
+ * booleans "checksum" and "verify".  With "paused" set, the job is
+ * only prerolled until Start() is called, so it can begin the
+ * moment the client's previous job ends.
+ *
+ * Usage is sent just before Completion or Error, with the CPU time
+ * the job's streaming threads used in microseconds and the daemon's
+ * peak RSS in KiB.  Checksum, sent just before Completion when the
+ * job was asked for one, has the MD5 of the audio given to the
+ * encoder as a hex string.
+ *
+ * Background jobs go to a second instance of the daemon, started
+ * with --background under NSC_DBUS_BACKGROUND_NAME, which moves
+ * itself into a cgroup scope with low weights.  The scope throttles
+ * the whole process, so foreground jobs never run in that instance.
+ */
+#define NSC_DBUS_NAME      "org.mate.CajaSoundConverter"
+#define NSC_DBUS_BACKGROUND_NAME "org.mate.CajaSoundConverter.Background"
+#define NSC_DBUS_PATH      "/org/mate/CajaSoundConverter"
+#define NSC_DBUS_INTERFACE "org.mate.CajaSoundConverter"
+
+#define NSC_DBUS_INTROSPECTION_XML					\
+	"<node>"							\
+	"  <interface name='" NSC_DBUS_INTERFACE "'>"			\
+	"    <method name='Convert'>"					\
+	"      <arg type='s' name='source' direction='in'/>"		\
+	"      <arg type='s' name='sink' direction='in'/>"		\
+	"      <arg type='s' name='profile' direction='in'/>"		\
+	"      <arg type='a{sv}' name='options' direction='in'/>"	\
+	"      <arg type='u' name='job' direction='out'/>"		\
+	"    </method>"							\
+	"    <method name='Start'>"					\
+	"      <arg type='u' name='job' direction='in'/>"		\
+	"    </method>"							\
+	"    <method name='Cancel'>"					\
+	"      <arg type='u' name='job' direction='in'/>"		\
+	"    </method>"							\
+	"    <signal name='Duration'>"					\
+	"      <arg type='u' name='job'/>"				\
+	"      <arg type='i' name='seconds'/>"				\
+	"    </signal>"							\
+	"    <signal name='Progress'>"					\
+	"      <arg type='u' name='job'/>"				\
+	"      <arg type='i' name='seconds'/>"				\
+	"    </signal>"							\
+	"    <signal name='Checksum'>"					\
+	"      <arg type='u' name='job'/>"				\
+	"      <arg type='s' name='md5'/>"				\
+	"    </signal>"							\
+	"    <signal name='Completion'>"				\
+	"      <arg type='u' name='job'/>"				\
+	"    </signal>"							\
+	"    <signal name='ReplayGain'>"				\
+	"      <arg type='u' name='job'/>"				\
+	"      <arg type='d' name='gain'/>"				\
+	"      <arg type='d' name='peak'/>"				\
+	"    </signal>"							\
+	"    <signal name='Usage'>"					\
+	"      <arg type='u' name='job'/>"				\
+	"      <arg type='t' name='cpu_time'/>"				\
+	"      <arg type='t' name='peak_rss'/>"				\
+	"    </signal>"							\
+	"    <signal name='Error'>"					\
+	"      <arg type='u' name='job'/>"				\
+	"      <arg type='s' name='domain'/>"				\
+	"      <arg type='i' name='code'/>"				\
+	"      <arg type='s' name='message'/>"				\
+	"    </signal>"							\
+	"  </interface>"						\
+	"</node>"
+
+#endif /* NSC_DBUS_H */
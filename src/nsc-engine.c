@@ -0,0 +1,586 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-engine.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+/*
+ * All NscEngines share one thread, which runs a main loop on a
+ * context of its own.  Each NscEngine drives an NscGStreamer on it:
+ * the pipelines are built, prerolled, started, finished and verified
+ * there, and their bus messages handled there, whatever Caja's main
+ * loop is busy with.  Calls go over to the thread in the order they
+ * were made, and signals come back the same way.
+ *
+ * Nothing but the thread touches the NscGStreamer once it has been
+ * set up, and nothing but the main context touches the NscEngine.
+ * What both need is in a Shared, which whichever side is last frees.
+ */
+
+#include <config.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <gst/gst.h>
+
+#include "nsc-engine.h"
+
+/* Kept apart from the NscEngine so the thread never touches it */
+typedef struct {
+	gint          ref_count;
+	GMainContext *context;
+
+	/* The thread's */
+	NscGStreamer *gstreamer;
+	guint         running;
+
+	/* The main context's; engine is NULL once disposed */
+	NscEngine    *engine;
+	guint         generation;
+
+	/* The latest position, and whether it is on its way */
+	gint          progress;
+	gint          progress_pending;
+} Shared;
+
+struct NscEnginePrivate {
+	Shared *shared;
+};
+
+/* A call over to the thread, with the properties it was made with */
+typedef struct {
+	Shared             *shared;
+	guint               generation;
+	GFile              *src;
+	GFile              *sink;
+	gboolean            background;
+	gboolean            replaygain;
+	gboolean            checksum;
+	gboolean            verify;
+	guint64             start;
+	guint64             stop;
+	GstTagList         *tags;
+	gchar              *preset;
+	gint                resample_quality;
+} Call;
+
+typedef enum {
+	RELAY_PROGRESS,
+	RELAY_DURATION,
+	RELAY_REPLAYGAIN,
+	RELAY_COMPLETION,
+	RELAY_ERROR
+} RelayType;
+
+/* A signal on its way back to the main context */
+typedef struct {
+	Shared    *shared;
+	guint      generation;
+	RelayType  type;
+	gint       seconds;
+	gdouble    gain;
+	gdouble    peak;
+	guint64    cpu_time;
+	guint64    peak_rss;
+	gchar     *pcm_md5;
+	GError    *error;
+} Relay;
+
+G_DEFINE_TYPE (NscEngine, nsc_engine, NSC_TYPE_GSTREAMER);
+
+#define NSC_ENGINE_GET_PRIVATE(o)                           \
+	((NscEnginePrivate *)((NSC_ENGINE(o))->priv))
+
+/*
+ * Private Methods
+ */
+static gpointer
+engine_thread (gpointer data)
+{
+	GMainContext *context = data;
+	GMainLoop    *loop;
+
+	/* Where the bus watches, ticks and verifications go */
+	g_main_context_push_thread_default (context);
+
+	loop = g_main_loop_new (context, FALSE);
+	g_main_loop_run (loop);
+
+	return NULL;
+}
+
+static GMainContext *
+engine_context (void)
+{
+	static gsize context = 0;
+
+	if (g_once_init_enter (&context)) {
+		GMainContext *new_context = g_main_context_new ();
+
+		g_thread_unref (g_thread_new ("nsc-engine", engine_thread,
+					      g_main_context_ref (new_context)));
+		g_once_init_leave (&context, (gsize) new_context);
+	}
+
+	return (GMainContext *) context;
+}
+
+/*
+ * Always by way of an idle, never right away, so calls and signals
+ * keep their order even when the context happens to be free.
+ */
+static void
+run_on (GMainContext   *context,
+	GSourceFunc     func,
+	gpointer        data,
+	GDestroyNotify  notify)
+{
+	GSource *source;
+
+	source = g_idle_source_new ();
+	g_source_set_priority (source, G_PRIORITY_DEFAULT);
+	g_source_set_callback (source, func, data, notify);
+	g_source_attach (source, context);
+	g_source_unref (source);
+}
+
+static Shared *
+shared_ref (Shared *shared)
+{
+	g_atomic_int_inc (&shared->ref_count);
+
+	return shared;
+}
+
+static void
+shared_unref (Shared *shared)
+{
+	if (!g_atomic_int_dec_and_test (&shared->ref_count))
+		return;
+
+	g_main_context_unref (shared->context);
+	g_free (shared);
+}
+
+/*
+ * The main context's side
+ */
+static void
+relay_free (Relay *relay)
+{
+	shared_unref (relay->shared);
+	g_free (relay->pcm_md5);
+	if (relay->error != NULL)
+		g_error_free (relay->error);
+	g_free (relay);
+}
+
+static gboolean
+relay_cb (gpointer user_data)
+{
+	Relay     *relay = user_data;
+	Shared    *shared = relay->shared;
+	NscEngine *engine = shared->engine;
+
+	if (relay->type == RELAY_PROGRESS)
+		g_atomic_int_set (&shared->progress_pending, FALSE);
+
+	/* Disposed, or the job was cancelled or has ended meanwhile */
+	if (engine == NULL || relay->generation != shared->generation)
+		return FALSE;
+
+	/* Handlers may well drop the last reference */
+	g_object_ref (engine);
+
+	switch (relay->type) {
+	case RELAY_PROGRESS:
+		g_signal_emit_by_name (engine, "progress",
+				       g_atomic_int_get (&shared->progress));
+		break;
+	case RELAY_DURATION:
+		g_signal_emit_by_name (engine, "duration", relay->seconds);
+		break;
+	case RELAY_REPLAYGAIN:
+		g_signal_emit_by_name (engine, "replaygain",
+				       relay->gain, relay->peak);
+		break;
+	case RELAY_COMPLETION:
+	case RELAY_ERROR:
+		shared->generation++;
+		g_object_set (G_OBJECT (engine),
+			      "cpu-time", relay->cpu_time,
+			      "peak-rss", relay->peak_rss,
+			      "pcm-md5", relay->pcm_md5,
+			      NULL);
+		if (relay->type == RELAY_COMPLETION)
+			g_signal_emit_by_name (engine, "completion");
+		else
+			g_signal_emit_by_name (engine, "error", relay->error);
+		break;
+	}
+
+	g_object_unref (engine);
+
+	return FALSE;
+}
+
+/*
+ * The thread's side
+ */
+static Relay *
+relay_new (Shared *shared, RelayType type)
+{
+	Relay *relay;
+
+	relay = g_new0 (Relay, 1);
+	relay->shared = shared_ref (shared);
+	relay->generation = shared->running;
+	relay->type = type;
+
+	return relay;
+}
+
+static void
+send_relay (Relay *relay)
+{
+	run_on (relay->shared->context, relay_cb, relay,
+		(GDestroyNotify) relay_free);
+}
+
+/* Sends what the scheduler reads once the file is done */
+static void
+send_end (Shared *shared, RelayType type, const GError *error)
+{
+	Relay *relay;
+
+	relay = relay_new (shared, type);
+	g_object_get (G_OBJECT (shared->gstreamer),
+		      "cpu-time", &relay->cpu_time,
+		      "peak-rss", &relay->peak_rss,
+		      "pcm-md5", &relay->pcm_md5,
+		      NULL);
+	if (error != NULL)
+		relay->error = g_error_copy (error);
+	send_relay (relay);
+}
+
+/* Only the latest position is sent, and only once it has arrived */
+static void
+progress_cb (NscGStreamer *gstreamer, gint seconds, gpointer user_data)
+{
+	Shared *shared = user_data;
+
+	g_atomic_int_set (&shared->progress, seconds);
+	if (g_atomic_int_get (&shared->progress_pending))
+		return;
+
+	g_atomic_int_set (&shared->progress_pending, TRUE);
+	send_relay (relay_new (shared, RELAY_PROGRESS));
+}
+
+static void
+duration_cb (NscGStreamer *gstreamer, gint seconds, gpointer user_data)
+{
+	Relay *relay;
+
+	relay = relay_new (user_data, RELAY_DURATION);
+	relay->seconds = seconds;
+	send_relay (relay);
+}
+
+static void
+replaygain_cb (NscGStreamer *gstreamer,
+	       gdouble       gain,
+	       gdouble       peak,
+	       gpointer      user_data)
+{
+	Relay *relay;
+
+	relay = relay_new (user_data, RELAY_REPLAYGAIN);
+	relay->gain = gain;
+	relay->peak = peak;
+	send_relay (relay);
+}
+
+static void
+completion_cb (NscGStreamer *gstreamer, gpointer user_data)
+{
+	send_end (user_data, RELAY_COMPLETION, NULL);
+}
+
+static void
+error_cb (NscGStreamer *gstreamer, GError *error, gpointer user_data)
+{
+	send_end (user_data, RELAY_ERROR, error);
+}
+
+static void
+call_free (Call *call)
+{
+	shared_unref (call->shared);
+	g_clear_object (&call->src);
+	g_clear_object (&call->sink);
+	if (call->tags != NULL)
+		gst_tag_list_unref (call->tags);
+	g_free (call->preset);
+	g_free (call);
+}
+
+static void
+apply_call (Call *call)
+{
+	g_object_set (G_OBJECT (call->shared->gstreamer),
+		      "background", call->background,
+		      "replaygain", call->replaygain,
+		      "start", call->start,
+		      "stop", call->stop,
+		      "tags", call->tags,
+		      "preset", call->preset,
+		      "resample-quality", call->resample_quality,
+		      "checksum", call->checksum,
+		      "verify", call->verify,
+		      NULL);
+}
+
+static gboolean
+convert_cb (gpointer user_data)
+{
+	Call   *call = user_data;
+	Shared *shared = call->shared;
+	GError *error = NULL;
+
+	apply_call (call);
+	shared->running = call->generation;
+
+	nsc_gstreamer_convert_file (shared->gstreamer, call->src,
+				    call->sink, &error);
+	if (error != NULL) {
+		send_end (shared, RELAY_ERROR, error);
+		g_error_free (error);
+	}
+
+	return FALSE;
+}
+
+static gboolean
+preroll_cb (gpointer user_data)
+{
+	Call *call = user_data;
+
+	apply_call (call);
+	nsc_gstreamer_preroll_file (call->shared->gstreamer,
+				    call->src, call->sink);
+
+	return FALSE;
+}
+
+static gboolean
+cancel_cb (gpointer user_data)
+{
+	Shared *shared = user_data;
+
+	nsc_gstreamer_cancel_convert (shared->gstreamer);
+
+	return FALSE;
+}
+
+static gboolean
+shutdown_cb (gpointer user_data)
+{
+	Shared *shared = user_data;
+
+	g_signal_handlers_disconnect_matched (shared->gstreamer,
+					      G_SIGNAL_MATCH_DATA,
+					      0, 0, NULL, NULL, shared);
+	nsc_gstreamer_cancel_convert (shared->gstreamer);
+	g_object_unref (shared->gstreamer);
+	shared->gstreamer = NULL;
+
+	return FALSE;
+}
+
+/*
+ * Back on the main context
+ */
+static Call *
+call_new (NscEngine *engine, GFile *src, GFile *sink)
+{
+	NscEnginePrivate *priv = NSC_ENGINE_GET_PRIVATE (engine);
+	Call             *call;
+
+	call = g_new0 (Call, 1);
+	call->shared = shared_ref (priv->shared);
+	call->src = g_object_ref (src);
+	call->sink = g_object_ref (sink);
+
+	g_object_get (G_OBJECT (engine),
+		      "background", &call->background,
+		      "replaygain", &call->replaygain,
+		      "start", &call->start,
+		      "stop", &call->stop,
+		      "tags", &call->tags,
+		      "preset", &call->preset,
+		      "resample-quality", &call->resample_quality,
+		      "checksum", &call->checksum,
+		      "verify", &call->verify,
+		      NULL);
+
+	return call;
+}
+
+/* Errors come back as the "error" signal, as they would from a bus */
+static void
+nsc_engine_convert_file (NscGStreamer *gstreamer,
+			 GFile        *src,
+			 GFile        *sink,
+			 GError      **error)
+{
+	NscEngine *engine = NSC_ENGINE (gstreamer);
+	Call      *call;
+
+	g_return_if_fail (src != NULL);
+	g_return_if_fail (sink != NULL);
+
+	call = call_new (engine, src, sink);
+	call->generation = ++call->shared->generation;
+
+	/* Until the file's own arrive with its completion */
+	g_object_set (G_OBJECT (engine),
+		      "cpu-time", (guint64) 0,
+		      "peak-rss", (guint64) 0,
+		      "pcm-md5", NULL,
+		      NULL);
+
+	run_on (engine_context (), convert_cb, call,
+		(GDestroyNotify) call_free);
+}
+
+static void
+nsc_engine_cancel_convert (NscGStreamer *gstreamer)
+{
+	NscEnginePrivate *priv = NSC_ENGINE_GET_PRIVATE (gstreamer);
+
+	priv->shared->generation++;
+	run_on (engine_context (), cancel_cb, shared_ref (priv->shared),
+		(GDestroyNotify) shared_unref);
+}
+
+static void
+nsc_engine_preroll_file (NscGStreamer *gstreamer,
+			 GFile        *src,
+			 GFile        *sink)
+{
+	run_on (engine_context (), preroll_cb,
+		call_new (NSC_ENGINE (gstreamer), src, sink),
+		(GDestroyNotify) call_free);
+}
+
+/*
+ * GObject methods
+ */
+static void
+nsc_engine_dispose (GObject *object)
+{
+	NscEngine        *self = NSC_ENGINE (object);
+	NscEnginePrivate *priv = NSC_ENGINE_GET_PRIVATE (self);
+
+	if (priv != NULL && priv->shared != NULL) {
+		priv->shared->engine = NULL;
+
+		/* The thread drops the converter, and with it our
+		 * reference to the Shared */
+		if (priv->shared->gstreamer != NULL)
+			run_on (engine_context (), shutdown_cb, priv->shared,
+				(GDestroyNotify) shared_unref);
+		else
+			shared_unref (priv->shared);
+		priv->shared = NULL;
+	}
+
+	G_OBJECT_CLASS (nsc_engine_parent_class)->dispose (object);
+}
+
+static void
+nsc_engine_finalize (GObject *object)
+{
+	NscEngine *self = NSC_ENGINE (object);
+
+	g_free (self->priv);
+	self->priv = NULL;
+
+	G_OBJECT_CLASS (nsc_engine_parent_class)->finalize (object);
+}
+
+static void
+nsc_engine_class_init (NscEngineClass *klass)
+{
+	GObjectClass      *object_class = G_OBJECT_CLASS (klass);
+	NscGStreamerClass *gstreamer_class = NSC_GSTREAMER_CLASS (klass);
+
+	object_class->dispose  = nsc_engine_dispose;
+	object_class->finalize = nsc_engine_finalize;
+
+	gstreamer_class->convert_file   = nsc_engine_convert_file;
+	gstreamer_class->cancel_convert = nsc_engine_cancel_convert;
+	gstreamer_class->preroll_file   = nsc_engine_preroll_file;
+}
+
+static void
+nsc_engine_init (NscEngine *self)
+{
+	NscEnginePrivate *priv;
+
+	self->priv = g_malloc0 (sizeof (NscEnginePrivate));
+	priv = NSC_ENGINE_GET_PRIVATE (self);
+
+	priv->shared = g_new0 (Shared, 1);
+	priv->shared->ref_count = 1;
+	priv->shared->context = g_main_context_ref_thread_default ();
+	priv->shared->engine = self;
+}
+
+/*
+ * Public Methods
+ */
+NscGStreamer *
+nsc_engine_new (GstEncodingProfile *profile)
+{
+	NscGStreamer *engine;
+	Shared       *shared;
+
+	engine = g_object_new (NSC_TYPE_ENGINE, "profile", profile, NULL);
+	shared = NSC_ENGINE_GET_PRIVATE (engine)->shared;
+
+	/* Set up before the thread ever sees it */
+	shared->gstreamer = nsc_gstreamer_new (profile);
+	g_signal_connect (G_OBJECT (shared->gstreamer), "progress",
+			  G_CALLBACK (progress_cb), shared);
+	g_signal_connect (G_OBJECT (shared->gstreamer), "duration",
+			  G_CALLBACK (duration_cb), shared);
+	g_signal_connect (G_OBJECT (shared->gstreamer), "replaygain",
+			  G_CALLBACK (replaygain_cb), shared);
+	g_signal_connect (G_OBJECT (shared->gstreamer), "completion",
+			  G_CALLBACK (completion_cb), shared);
+	g_signal_connect (G_OBJECT (shared->gstreamer), "error",
+			  G_CALLBACK (error_cb), shared);
+
+	return engine;
+}
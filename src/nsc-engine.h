@@ -0,0 +1,63 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-engine.h
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+#ifndef NSC_ENGINE_H
+#define NSC_ENGINE_H
+
+#include "nsc-gstreamer.h"
+
+G_BEGIN_DECLS
+
+#define NSC_TYPE_ENGINE            (nsc_engine_get_type ())
+#define NSC_ENGINE(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), NSC_TYPE_ENGINE, NscEngine))
+#define NSC_ENGINE_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), NSC_TYPE_ENGINE, NscEngineClass))
+#define NSC_IS_ENGINE(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), NSC_TYPE_ENGINE))
+#define NSC_IS_ENGINE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), NSC_TYPE_ENGINE))
+#define NSC_ENGINE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), NSC_TYPE_ENGINE, NscEngineClass))
+
+typedef struct NscEnginePrivate NscEnginePrivate;
+
+/*
+ * An NscGStreamer that converts in the Caja process, but on a thread
+ * of its own, so a busy Caja window doesn't hold up the pipelines.
+ * Its signals are emitted on the main context of the thread that
+ * created it, with progress coalesced to the latest position.
+ */
+typedef struct {
+	/* Parent object */
+	NscGStreamer parent;
+	/* Private data pointer */
+	gpointer     priv;
+} NscEngine;
+
+typedef struct {
+	NscGStreamerClass parent_class;
+} NscEngineClass;
+
+GType         nsc_engine_get_type (void);
+NscGStreamer *nsc_engine_new      (GstEncodingProfile *profile);
+
+G_END_DECLS
+
+#endif /* NSC_ENGINE_H */
@@ -24,6 +24,9 @@
 
 #include <config.h>
 
+#include <gio/gio.h>
+#include <gst/gst.h>
+
 #include "nsc-error.h"
 
 GQuark
@@ -37,3 +40,54 @@ nsc_error_quark (void)
 
 	return q;
 }
+
+/**
+ * Whether the error may well go away if the conversion is tried
+ * again a little later: a busy or unreachable network share, a
+ * read or write that failed half way, or the conversion service
+ * going away.
+ */
+gboolean
+nsc_error_is_transient (const GError *error)
+{
+	if (error == NULL)
+		return FALSE;
+
+	if (error->domain == G_IO_ERROR) {
+		switch (error->code) {
+		case G_IO_ERROR_BUSY:
+		case G_IO_ERROR_TIMED_OUT:
+		case G_IO_ERROR_WOULD_BLOCK:
+		case G_IO_ERROR_HOST_NOT_FOUND:
+		case G_IO_ERROR_HOST_UNREACHABLE:
+		case G_IO_ERROR_NETWORK_UNREACHABLE:
+		case G_IO_ERROR_CONNECTION_REFUSED:
+		case G_IO_ERROR_NOT_CONNECTED:
+			return TRUE;
+		default:
+			return FALSE;
+		}
+	}
+
+	if (error->domain == GST_RESOURCE_ERROR) {
+		switch (error->code) {
+		case GST_RESOURCE_ERROR_BUSY:
+		case GST_RESOURCE_ERROR_READ:
+		case GST_RESOURCE_ERROR_WRITE:
+		case GST_RESOURCE_ERROR_SEEK:
+		case GST_RESOURCE_ERROR_SYNC:
+			return TRUE;
+		default:
+			return FALSE;
+		}
+	}
+
+	if (error->domain == G_DBUS_ERROR) {
+		return error->code == G_DBUS_ERROR_NO_REPLY ||
+			error->code == G_DBUS_ERROR_TIMEOUT ||
+			error->code == G_DBUS_ERROR_TIMED_OUT;
+	}
+
+	return error->domain == NSC_ERROR &&
+		error->code == NSC_ERROR_SERVICE_EXITED;
+}
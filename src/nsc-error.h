@@ -29,9 +29,12 @@
 #define NSC_ERROR nsc_error_quark ()
 
 typedef enum {
-	NSC_ERROR_INTERNAL_ERROR
+	NSC_ERROR_INTERNAL_ERROR,
+	NSC_ERROR_SERVICE_EXITED,
+	NSC_ERROR_VERIFY_FAILED
 } NscError;
 
-GQuark nsc_error_quark (void) G_GNUC_CONST;
+GQuark   nsc_error_quark        (void) G_GNUC_CONST;
+gboolean nsc_error_is_transient (const GError *error);
 
 #endif
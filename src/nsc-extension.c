@@ -26,7 +26,10 @@
 
 #include "nsc-converter.h"
 #include "nsc-extension.h"
-#include "nsc-gstreamer.h"
+#include "nsc-file-list.h"
+#include "nsc-latency.h"
+#include "nsc-selection.h"
+#include "nsc-watch.h"
 
 #include <libcaja-extension/caja-menu-provider.h>
 
@@ -34,8 +37,6 @@
 #include <gtk/gtk.h>
 #include <gst/gst.h>
 
-#include <string.h> /* For strcmp */
-
 static void   nsc_extension_instance_init  (NscExtension         *sound);
 static void   nsc_extension_class_init     (NscExtensionClass    *class);
 static GList *nsc_extension_get_file_items (CajaMenuProvider *provider,
@@ -44,100 +45,52 @@ static GList *nsc_extension_get_file_items (CajaMenuProvider *provider,
 
 static GType sound_converter_type = 0;
 
-/*
- * These are the formats we require, so
- * no check of plugin support is needed
- */
-static gchar *mime_types[] = {
-	"audio/x-flac",
-	"audio/x-vorbis+ogg",
-	"audio/ogg",
-	"audio/x-wav",
-	NULL
-};
+typedef struct {
+	NscSelectionFilter *filter;
+	gint64              started;
+} FilterState;
 
+/**
+ * Filter the selection an idle callback at a time, and open the
+ * dialog once done.
+ */
 static gboolean
-file_is_sound (CajaFileInfo *file_info)
+filter_files_cb (gpointer user_data)
 {
-	gchar          *scheme;
-	gint            i;
-	GError         *error = NULL;
-
-	/* Is this a file? */
-	scheme = caja_file_info_get_uri_scheme (file_info);
-
-	if (strcmp (scheme, "file") != 0) {
-		g_free (scheme);
-		return FALSE;
-	}
-	g_free (scheme);
+	FilterState  *state = user_data;
+	NscConverter *converter;
+	NscFileList  *sounds;
 
-	for (i = 0; mime_types[i] != NULL; i++)
-		if (caja_file_info_is_mime_type (file_info, mime_types[i]))
-			return TRUE;
+	if (nsc_selection_filter_step (state->filter))
+		return TRUE;
 
-	/* Check for mp3 support */
-	if (nsc_gstreamer_supports_mp3 (&error)) {
-		if (caja_file_info_is_mime_type (file_info, "audio/mpeg"))
-			return TRUE;
-	} else {
-		g_error_free (error);
-		error = NULL;
-	}
+	nsc_latency_record ("filter_files", state->started);
 
-	/* Check for aac suppport */
-	if (nsc_gstreamer_supports_aac (&error)) {
-		if (caja_file_info_is_mime_type (file_info, "audio/mp4"))
-			return TRUE;
-	} else {
-		g_error_free (error);
-		error = NULL;
-	}
+	sounds = nsc_selection_filter_finish (state->filter);
 
-	/* Check for Musepack support */
-	if (nsc_gstreamer_supports_musepack (&error)) {
-		if (caja_file_info_is_mime_type (file_info, "audio/x-musepack"))
-			return TRUE;
+	if (nsc_file_list_length (sounds) > 0) {
+		converter = nsc_converter_new (sounds);
+		nsc_converter_show_dialog (converter);
 	} else {
-		g_error_free (error);
-		error = NULL;
+		nsc_file_list_free (sounds);
 	}
 
-	/* Check for wma support */
-	if (nsc_gstreamer_supports_wma (&error)) {
-		if (caja_file_info_is_mime_type (file_info, "audio/x-ms-wma"))
-			return TRUE;
-	} else {
-		g_error_free (error);
-		error = NULL;
-	}
+	g_free (state);
 
 	return FALSE;
 }
 
-static GList *
-converter_filter_files (GList *files)
-{
-	GList *sounds = NULL;
-	GList *file = NULL;
-
-	for (file = files; file != NULL; file = file->next) {
-		if (file_is_sound (file->data))
-			sounds = g_list_prepend (sounds, file->data);
-	}
-
-	return sounds;
-}
-
 static void
 sound_convert_callback (CajaMenuItem *item,
 		        GList            *files)
 {
-	NscConverter *converter;
+	FilterState *state;
 
-	converter = nsc_converter_new (converter_filter_files (files));
+	state = g_new0 (FilterState, 1);
+	state->filter = nsc_selection_filter_new (files);
+	state->started = nsc_latency_start ();
 
-	nsc_converter_show_dialog (converter);
+	g_idle_add (filter_files_cb, state);
 }
 
 static GList *
@@ -154,32 +107,32 @@ nsc_extension_get_file_items (CajaMenuProvider *provider,
 			      GList                *files)
 {
 	CajaMenuItem *item;
-	GList            *scan = NULL;
 	GList            *items = NULL;
+	gint64            start;
 
 	if (files == NULL)
 		return NULL;
 
-	for (scan = files; scan; scan = scan->next) {
-		if (file_is_sound (scan->data)) {
-			item = caja_menu_item_new ("CajaSoundConverter::convert",
-                                                       dgettext (GETTEXT_PACKAGE, "_Convert..."),
-                                                       dgettext (GETTEXT_PACKAGE,
-								 "Convert each selected audio file"),
-                                                       "audio-x-generic");
+	start = nsc_latency_start ();
 
-			g_signal_connect (item, "activate",
-					  G_CALLBACK (sound_convert_callback),
-					  caja_file_info_list_copy (files));
+	if (nsc_selection_has_sound (files)) {
+		item = caja_menu_item_new ("CajaSoundConverter::convert",
+                                           dgettext (GETTEXT_PACKAGE, "_Convert..."),
+                                           dgettext (GETTEXT_PACKAGE,
+						     "Convert each selected audio file"),
+                                           "audio-x-generic");
 
-			items = g_list_prepend (items, item);
-			items = g_list_reverse (items);
+		g_signal_connect_data (item, "activate",
+				       G_CALLBACK (sound_convert_callback),
+				       caja_file_info_list_copy (files),
+				       (GClosureNotify) caja_file_info_list_free,
+				       0);
 
-			return items;
-		}
+		items = g_list_prepend (items, item);
 	}
 
-	return NULL;
+	nsc_latency_record ("get_file_items", start);
+	return items;
 }
 
 static void
@@ -197,6 +150,8 @@ nsc_extension_instance_init (NscExtension *sound)
 	 * profile chooser won't show any values.
 	 */
 	gst_init (NULL, NULL);
+
+	nsc_watch_start ();
 }
 
 static void
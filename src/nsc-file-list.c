@@ -0,0 +1,69 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-file-list.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+#include <config.h>
+
+#include "nsc-file-list.h"
+
+/* Room for a few hundred typical URIs per arena block */
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+NscFileList *
+nsc_file_list_new (void)
+{
+	NscFileList *list;
+
+	list = g_new (NscFileList, 1);
+	list->arena = g_string_chunk_new (ARENA_BLOCK_SIZE);
+	list->uris = g_ptr_array_new ();
+	list->flags = g_byte_array_new ();
+
+	return list;
+}
+
+void
+nsc_file_list_add (NscFileList  *list,
+		   const gchar  *uri,
+		   NscFileFlags  flags)
+{
+	guint8 byte = flags;
+
+	g_return_if_fail (list != NULL);
+	g_return_if_fail (uri != NULL);
+
+	g_ptr_array_add (list->uris, g_string_chunk_insert (list->arena, uri));
+	g_byte_array_append (list->flags, &byte, 1);
+}
+
+void
+nsc_file_list_free (NscFileList *list)
+{
+	if (list == NULL)
+		return;
+
+	g_string_chunk_free (list->arena);
+	g_ptr_array_free (list->uris, TRUE);
+	g_byte_array_free (list->flags, TRUE);
+	g_free (list);
+}
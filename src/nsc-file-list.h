@@ -0,0 +1,60 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-file-list.h
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+#ifndef NSC_FILE_LIST_H
+#define NSC_FILE_LIST_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+	NSC_FILE_AUDIO = 0,
+	/* A cue sheet, standing for the disc image it describes */
+	NSC_FILE_CUE   = 1 << 0
+} NscFileFlags;
+
+/*
+ * The files of a batch: one pointer and one byte per file, with
+ * the URIs themselves packed into a string arena.
+ */
+typedef struct {
+	GStringChunk *arena;
+	GPtrArray    *uris;
+	GByteArray   *flags;
+} NscFileList;
+
+NscFileList  *nsc_file_list_new       (void);
+void          nsc_file_list_add       (NscFileList  *list,
+				       const gchar  *uri,
+				       NscFileFlags  flags);
+void          nsc_file_list_free      (NscFileList  *list);
+
+#define nsc_file_list_length(list)     ((list)->uris->len)
+#define nsc_file_list_get_uri(list, i) ((const gchar *) g_ptr_array_index ((list)->uris, (i)))
+#define nsc_file_list_get_flags(list, i) ((NscFileFlags) (list)->flags->data[(i)])
+
+G_END_DECLS
+
+#endif /* NSC_FILE_LIST_H */
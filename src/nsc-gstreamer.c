@@ -27,19 +27,37 @@
 #include <config.h>
 
 #include <string.h>
+#include <time.h>
+#include <sys/resource.h>
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <glib-object.h>
 #include <gst/gst.h>
 
+#include "nsc-audio-convert.h"
+#include "nsc-checksum.h"
 #include "nsc-error.h"
 #include "nsc-gstreamer.h"
+#include "nsc-priority.h"
+#include "nsc-trace.h"
 #include "rb-gst-media-types.h"
 
 /* Properties */
 enum {
 	PROP_0,
 	PROP_PROFILE,
+	PROP_BACKGROUND,
+	PROP_REPLAYGAIN,
+	PROP_START,
+	PROP_STOP,
+	PROP_TAGS,
+	PROP_PRESET,
+	PROP_RESAMPLE_QUALITY,
+	PROP_CPU_TIME,
+	PROP_PEAK_RSS,
+	PROP_CHECKSUM,
+	PROP_VERIFY,
+	PROP_PCM_MD5,
 };
 
 /* Signals */
@@ -48,6 +66,7 @@ enum {
 	DURATION,
 	COMPLETION,
 	ERROR,
+	REPLAYGAIN,
 	LAST_SIGNAL,
 };
 
@@ -56,6 +75,18 @@ static guint signals[LAST_SIGNAL] = { 0 };
 /* Element names */
 #define FILE_SOURCE "giosrc"
 #define FILE_SINK   "giosink"
+#define STREAM_SOURCE "giostreamsrc"
+#define STREAM_SINK   "giostreamsink"
+
+/* audioresample's own default */
+#define DEFAULT_RESAMPLE_QUALITY 4
+
+/* From decodebin, which does not install a header for it */
+typedef enum {
+	AUTOPLUG_SELECT_TRY,
+	AUTOPLUG_SELECT_EXPOSE,
+	AUTOPLUG_SELECT_SKIP
+} AutoplugSelectResult;
 
 struct NscGStreamerPrivate {
 	/* The current audio profile */
@@ -64,26 +95,110 @@ struct NscGStreamerPrivate {
 	/* If the pipeline needs to be re-created */
 	gboolean        rebuild_pipeline;
 
+	/* The pipeline reads and writes GIO streams rather than files */
+	gboolean        streams;
+
+	/* Run the streaming threads at idle priority */
+	gboolean        background;
+
+	/* Analyse the decoded audio for ReplayGain */
+	gboolean        replaygain;
+
+	/* Only convert this part of the source, e.g. a track of a disc image */
+	GstClockTime    start;
+	GstClockTime    stop;
+
+	/* Tags replacing the ones of the source */
+	GstTagList     *tags;
+
+	/* The speed versus size encoder preset, e.g. "fast", and the
+	 * settings it asks of each encoder factory, looked up when it is
+	 * set so the streaming thread doesn't touch the registry */
+	gchar          *preset;
+	GHashTable     *preset_settings;
+
+	/* audioresample quality, from 0 (fastest) to 10 */
+	gint            resample_quality;
+
+	/* What the last conversion cost: the CPU time of its streaming
+	 * threads in microseconds, and the process' peak RSS in KiB */
+	guint64         cpu_time;
+	guint64         peak_rss;
+
+	/* Work out the MD5 of the audio given to the encoder, and check
+	 * that a lossless output decodes to it again */
+	gboolean        checksum;
+	gboolean        verify;
+	GChecksum      *pcm_checksum;
+	GstCaps        *pcm_caps;
+	gchar          *pcm_md5;
+	GCancellable   *verifying;
+
+	/* Waiting for preroll before seeking, or for the seek to finish */
+	gboolean        seek_pending;
+	gboolean        seeking;
+
+	/* Prerolled to PAUSED on these files, waiting for convert_file() */
+	gboolean        standby;
+	GFile          *standby_src;
+	GFile          *standby_sink;
+
 	/* The gstreamer pipline elements */
 	GstElement     *pipeline;
 	GstElement     *filesrc;
 	GstElement     *decode;
 	GstElement     *audioconvert;
 	GstElement     *audioresample;
+	GstElement     *rganalysis;
 	GstElement     *encode;
 	GstElement     *filesink;
 
+	/* The decoder's audio output has been linked to the encoder */
+	gboolean        audio_linked;
+
+	/* The encoder input, kept for the next file on the pipeline */
+	GstPad         *encode_pad;
+
+	/* The one stream decodebin may plug an audio decoder for */
+	GstPad         *audio_stream;
+
+	/* When the current phase of the file started, for the trace,
+	 * and when the prerolled file and the verification did */
+	gint64          phase_start;
+	gint64          preroll_start;
+	gint64          verify_start;
+
 	/* Misc */
 	int             seconds;
 	GError         *construct_error;
-	guint           tick_id;
+	GSource        *tick;
 };
 
+static void destroy_pipeline                  (NscGStreamer *gstreamer);
+static void stop_tick                         (NscGStreamer *gstreamer);
+static void nsc_gstreamer_real_convert_file   (NscGStreamer *gstreamer,
+					       GFile        *src,
+					       GFile        *sink,
+					       GError      **error);
+static void nsc_gstreamer_real_cancel_convert (NscGStreamer *gstreamer);
+static void nsc_gstreamer_real_preroll_file   (NscGStreamer *gstreamer,
+					       GFile        *src,
+					       GFile        *sink);
+
 /*
  * GObject methods
  */
 G_DEFINE_TYPE (NscGStreamer, nsc_gstreamer, G_TYPE_OBJECT);
 
+/* Guards cpu_time, added to by the streaming threads */
+G_LOCK_DEFINE_STATIC (usage);
+
+/* A streaming thread's CPU time when it entered its task */
+static GPrivate thread_start = G_PRIVATE_INIT (g_free);
+
+/* And the time, for the trace */
+static GPrivate thread_trace_start = G_PRIVATE_INIT (g_free);
+
 #define NSC_GSTREAMER_GET_PRIVATE(o)                           \
 	((NscGStreamerPrivate *)((NSC_GSTREAMER(o))->priv))
 
@@ -108,6 +223,57 @@ nsc_gstreamer_set_property (GObject      *object,
 
 		g_object_notify (object, "profile");
 		break;
+	case PROP_BACKGROUND:
+		priv->background = g_value_get_boolean (value);
+		break;
+	case PROP_REPLAYGAIN:
+		if (priv->replaygain != g_value_get_boolean (value)) {
+			priv->replaygain = g_value_get_boolean (value);
+			priv->rebuild_pipeline = TRUE;
+		}
+		break;
+	case PROP_START:
+		priv->start = g_value_get_uint64 (value);
+		break;
+	case PROP_STOP:
+		priv->stop = g_value_get_uint64 (value);
+		break;
+	case PROP_TAGS:
+		if (priv->tags)
+			gst_tag_list_unref (priv->tags);
+		priv->tags = g_value_dup_boxed (value);
+		break;
+	case PROP_PRESET:
+		if (g_strcmp0 (priv->preset, g_value_get_string (value)) != 0) {
+			g_free (priv->preset);
+			priv->preset = g_value_dup_string (value);
+			if (priv->preset_settings)
+				g_hash_table_unref (priv->preset_settings);
+			priv->preset_settings = rb_gst_get_encoder_presets (priv->preset);
+			priv->rebuild_pipeline = TRUE;
+		}
+		break;
+	case PROP_RESAMPLE_QUALITY:
+		priv->resample_quality = g_value_get_int (value);
+		break;
+	case PROP_CPU_TIME:
+		G_LOCK (usage);
+		priv->cpu_time = g_value_get_uint64 (value);
+		G_UNLOCK (usage);
+		break;
+	case PROP_PEAK_RSS:
+		priv->peak_rss = g_value_get_uint64 (value);
+		break;
+	case PROP_CHECKSUM:
+		priv->checksum = g_value_get_boolean (value);
+		break;
+	case PROP_VERIFY:
+		priv->verify = g_value_get_boolean (value);
+		break;
+	case PROP_PCM_MD5:
+		g_free (priv->pcm_md5);
+		priv->pcm_md5 = g_value_dup_string (value);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
 	}
@@ -126,6 +292,44 @@ nsc_gstreamer_get_property (GObject    *object,
 	case PROP_PROFILE:
 		g_value_set_pointer (value, gst_encoding_profile_ref (priv->profile));
 		break;
+	case PROP_BACKGROUND:
+		g_value_set_boolean (value, priv->background);
+		break;
+	case PROP_REPLAYGAIN:
+		g_value_set_boolean (value, priv->replaygain);
+		break;
+	case PROP_START:
+		g_value_set_uint64 (value, priv->start);
+		break;
+	case PROP_STOP:
+		g_value_set_uint64 (value, priv->stop);
+		break;
+	case PROP_TAGS:
+		g_value_set_boxed (value, priv->tags);
+		break;
+	case PROP_PRESET:
+		g_value_set_string (value, priv->preset);
+		break;
+	case PROP_RESAMPLE_QUALITY:
+		g_value_set_int (value, priv->resample_quality);
+		break;
+	case PROP_CPU_TIME:
+		G_LOCK (usage);
+		g_value_set_uint64 (value, priv->cpu_time);
+		G_UNLOCK (usage);
+		break;
+	case PROP_PEAK_RSS:
+		g_value_set_uint64 (value, priv->peak_rss);
+		break;
+	case PROP_CHECKSUM:
+		g_value_set_boolean (value, priv->checksum);
+		break;
+	case PROP_VERIFY:
+		g_value_set_boolean (value, priv->verify);
+		break;
+	case PROP_PCM_MD5:
+		g_value_set_string (value, priv->pcm_md5);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
 	}
@@ -144,11 +348,7 @@ nsc_gstreamer_dispose (GObject *object)
 			priv->profile = NULL;
 		}
 
-		if (priv->pipeline) {
-			gst_element_set_state (priv->pipeline, GST_STATE_NULL);
-			g_object_unref (priv->pipeline);
-			priv->pipeline = NULL;
-		}
+		destroy_pipeline (self);
 	}
 
 	G_OBJECT_CLASS (nsc_gstreamer_parent_class)->dispose (object);
@@ -161,12 +361,26 @@ nsc_gstreamer_finalize (GObject *object)
 	NscGStreamerPrivate *priv = NSC_GSTREAMER_GET_PRIVATE (self);
 
 	if (priv != NULL) {
-		if (priv->tick_id)
-			g_source_remove (priv->tick_id);
+		stop_tick (self);
 
 		if (priv->construct_error)
 			g_error_free (priv->construct_error);
 
+		if (priv->tags)
+			gst_tag_list_unref (priv->tags);
+
+		g_free (priv->preset);
+		if (priv->preset_settings)
+			g_hash_table_unref (priv->preset_settings);
+
+		if (priv->pcm_checksum)
+			g_checksum_free (priv->pcm_checksum);
+		if (priv->pcm_caps)
+			gst_caps_unref (priv->pcm_caps);
+		g_free (priv->pcm_md5);
+
+		g_clear_object (&priv->standby_src);
+		g_clear_object (&priv->standby_sink);
 
 		g_free (priv);
 
@@ -190,12 +404,90 @@ nsc_gstreamer_class_init (NscGStreamerClass *klass)
 	object_class->dispose      = nsc_gstreamer_dispose;
 	object_class->finalize     = nsc_gstreamer_finalize;
 
+	klass->convert_file   = nsc_gstreamer_real_convert_file;
+	klass->cancel_convert = nsc_gstreamer_real_cancel_convert;
+	klass->preroll_file   = nsc_gstreamer_real_preroll_file;
+
+	nsc_audio_convert_register ();
+
 	/* Properties */
 	g_object_class_install_property (object_class, PROP_PROFILE,
 					 g_param_spec_pointer ("profile",
 							       _("Audio Profile"),
 							       _("The GStreamer Encoding Profile used for encoding audio"),
 							       G_PARAM_READWRITE));
+	g_object_class_install_property (object_class, PROP_BACKGROUND,
+					 g_param_spec_boolean ("background",
+							       _("Background"),
+							       _("Whether to convert at idle CPU and I/O priority"),
+							       FALSE,
+							       G_PARAM_READWRITE));
+	g_object_class_install_property (object_class, PROP_REPLAYGAIN,
+					 g_param_spec_boolean ("replaygain",
+							       _("ReplayGain"),
+							       _("Whether to compute the ReplayGain of the decoded audio"),
+							       FALSE,
+							       G_PARAM_READWRITE));
+	g_object_class_install_property (object_class, PROP_START,
+					 g_param_spec_uint64 ("start",
+							      _("Start"),
+							      _("Where in the source to start converting"),
+							      0, G_MAXUINT64, 0,
+							      G_PARAM_READWRITE));
+	g_object_class_install_property (object_class, PROP_STOP,
+					 g_param_spec_uint64 ("stop",
+							      _("Stop"),
+							      _("Where in the source to stop converting"),
+							      0, G_MAXUINT64, GST_CLOCK_TIME_NONE,
+							      G_PARAM_READWRITE));
+	g_object_class_install_property (object_class, PROP_TAGS,
+					 g_param_spec_boxed ("tags",
+							     _("Tags"),
+							     _("Tags to write in place of the ones of the source"),
+							     GST_TYPE_TAG_LIST,
+							     G_PARAM_READWRITE));
+	g_object_class_install_property (object_class, PROP_PRESET,
+					 g_param_spec_string ("preset",
+							      _("Preset"),
+							      _("The speed versus size preset of the encoder"),
+							      NULL,
+							      G_PARAM_READWRITE));
+	g_object_class_install_property (object_class, PROP_RESAMPLE_QUALITY,
+					 g_param_spec_int ("resample-quality",
+							   _("Resample quality"),
+							   _("The quality of sample rate conversion, from 0 (fastest) to 10"),
+							   0, 10, DEFAULT_RESAMPLE_QUALITY,
+							   G_PARAM_READWRITE));
+	g_object_class_install_property (object_class, PROP_CPU_TIME,
+					 g_param_spec_uint64 ("cpu-time",
+							      _("CPU time"),
+							      _("Microseconds of CPU time the streaming threads of the last conversion used"),
+							      0, G_MAXUINT64, 0,
+							      G_PARAM_READWRITE));
+	g_object_class_install_property (object_class, PROP_PEAK_RSS,
+					 g_param_spec_uint64 ("peak-rss",
+							      _("Peak RSS"),
+							      _("The converting process' peak resident set size in KiB, as of the end of the last conversion"),
+							      0, G_MAXUINT64, 0,
+							      G_PARAM_READWRITE));
+	g_object_class_install_property (object_class, PROP_CHECKSUM,
+					 g_param_spec_boolean ("checksum",
+							       _("Checksum"),
+							       _("Whether to work out the MD5 of the audio given to the encoder"),
+							       FALSE,
+							       G_PARAM_READWRITE));
+	g_object_class_install_property (object_class, PROP_VERIFY,
+					 g_param_spec_boolean ("verify",
+							       _("Verify"),
+							       _("Whether to check that a lossless output decodes to the audio given to the encoder"),
+							       FALSE,
+							       G_PARAM_READWRITE));
+	g_object_class_install_property (object_class, PROP_PCM_MD5,
+					 g_param_spec_string ("pcm-md5",
+							      _("PCM MD5"),
+							      _("The MD5 of the audio given to the encoder in the last conversion"),
+							      NULL,
+							      G_PARAM_READWRITE));
 
 	/* Signals */
 	signals[PROGRESS] = 
@@ -230,6 +522,14 @@ nsc_gstreamer_class_init (NscGStreamerClass *klass)
 			      NULL, NULL,
 			      g_cclosure_marshal_VOID__POINTER,
 			      G_TYPE_NONE, 1, G_TYPE_POINTER);
+	signals[REPLAYGAIN] =
+		g_signal_new ("replaygain",
+			      G_TYPE_FROM_CLASS (object_class),
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (NscGStreamerClass, replaygain),
+			      NULL, NULL,
+			      NULL,
+			      G_TYPE_NONE, 2, G_TYPE_DOUBLE, G_TYPE_DOUBLE);
 }
 
 static void
@@ -244,12 +544,227 @@ nsc_gstreamer_init (NscGStreamer *self)
 		NscGStreamerPrivate *priv = NSC_GSTREAMER_GET_PRIVATE (self);
 		/* Initialize private data */
 		priv->rebuild_pipeline = TRUE;
+		priv->stop = GST_CLOCK_TIME_NONE;
+		priv->resample_quality = DEFAULT_RESAMPLE_QUALITY;
 	}
 }
 
 /* 
  * Private Methods
  */
+static gint64
+thread_cpu_time (void)
+{
+	struct timespec ts;
+
+	if (clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+		return 0;
+
+	return (gint64) ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+static void
+reset_usage (NscGStreamer *gstreamer)
+{
+	NscGStreamerPrivate *priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+
+	G_LOCK (usage);
+	priv->cpu_time = 0;
+	G_UNLOCK (usage);
+	priv->peak_rss = 0;
+}
+
+static void
+reset_checksum (NscGStreamer *gstreamer)
+{
+	NscGStreamerPrivate *priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+
+	if (priv->pcm_checksum) {
+		g_checksum_free (priv->pcm_checksum);
+		priv->pcm_checksum = NULL;
+	}
+	if (priv->pcm_caps) {
+		gst_caps_unref (priv->pcm_caps);
+		priv->pcm_caps = NULL;
+	}
+	g_free (priv->pcm_md5);
+	priv->pcm_md5 = NULL;
+
+	if (priv->checksum || priv->verify)
+		priv->pcm_checksum = g_checksum_new (G_CHECKSUM_MD5);
+}
+
+/*
+ * Runs in the streaming thread, which is the only one to touch
+ * pcm_checksum and pcm_caps until the pipeline stops.
+ */
+static GstPadProbeReturn
+checksum_probe_cb (GstPad          *pad,
+		   GstPadProbeInfo *info,
+		   gpointer         user_data)
+{
+	NscGStreamerPrivate *priv = NSC_GSTREAMER_GET_PRIVATE (user_data);
+
+	if (priv->pcm_checksum == NULL)
+		return GST_PAD_PROBE_OK;
+
+	if (priv->pcm_caps == NULL)
+		priv->pcm_caps = gst_pad_get_current_caps (pad);
+	nsc_checksum_add_buffer (priv->pcm_checksum,
+				 GST_PAD_PROBE_INFO_BUFFER (info));
+
+	return GST_PAD_PROBE_OK;
+}
+
+/* Called once the pipeline has stopped and its threads left */
+static void
+finish_checksum (NscGStreamer *gstreamer)
+{
+	NscGStreamerPrivate *priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+
+	if (priv->pcm_checksum == NULL)
+		return;
+
+	priv->pcm_md5 = g_strdup (g_checksum_get_string (priv->pcm_checksum));
+	g_checksum_free (priv->pcm_checksum);
+	priv->pcm_checksum = NULL;
+}
+
+/* Called once the pipeline has stopped and its threads left */
+static void
+finish_usage (NscGStreamer *gstreamer)
+{
+	NscGStreamerPrivate *priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+	struct rusage        usage;
+
+	if (getrusage (RUSAGE_SELF, &usage) == 0)
+		priv->peak_rss = usage.ru_maxrss;
+}
+
+/*
+ * Get a finished pipeline ready for the next file without building
+ * it again.  With thousands of tiny files, creating the encoder and
+ * muxer and bringing them up costs more than encoding the audio, so
+ * the pipeline goes back to READY, where the sink has closed its
+ * file and decodebin has dropped the decoder it plugged, but the
+ * encoder stays.  What pad_added_cb() put between the two goes, as
+ * the next file may well need a different conversion.
+ */
+static void
+recycle_pipeline (NscGStreamer *gstreamer)
+{
+	NscGStreamerPrivate *priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+	GstIterator         *iter;
+	GValue               item = G_VALUE_INIT;
+	GList               *dropped = NULL, *l;
+
+	gst_element_set_state (priv->pipeline, GST_STATE_READY);
+
+	iter = gst_bin_iterate_elements (GST_BIN (priv->pipeline));
+	while (gst_iterator_next (iter, &item) == GST_ITERATOR_OK) {
+		GstElement *element = g_value_get_object (&item);
+
+		if (element != priv->filesrc && element != priv->decode &&
+		    element != priv->encode && element != priv->filesink)
+			dropped = g_list_prepend (dropped, gst_object_ref (element));
+		g_value_reset (&item);
+	}
+	g_value_unset (&item);
+	gst_iterator_free (iter);
+
+	for (l = dropped; l != NULL; l = l->next) {
+		gst_element_set_state (l->data, GST_STATE_NULL);
+		gst_bin_remove (GST_BIN (priv->pipeline), l->data);
+	}
+	g_list_free_full (dropped, gst_object_unref);
+
+	/* The tags of this file must not end up in the next one */
+	iter = gst_bin_iterate_all_by_interface (GST_BIN (priv->encode),
+						 GST_TYPE_TAG_SETTER);
+	while (gst_iterator_next (iter, &item) == GST_ITERATOR_OK) {
+		gst_tag_setter_reset_tags (GST_TAG_SETTER (g_value_get_object (&item)));
+		g_value_reset (&item);
+	}
+	g_value_unset (&item);
+	gst_iterator_free (iter);
+
+	priv->audioconvert = NULL;
+	priv->audioresample = NULL;
+	priv->rganalysis = NULL;
+	priv->audio_linked = FALSE;
+	priv->audio_stream = NULL;
+}
+
+static void
+verify_done_cb (GObject      *source,
+		GAsyncResult *result,
+		gpointer      user_data)
+{
+	NscGStreamer        *gstreamer = NSC_GSTREAMER (user_data);
+	NscGStreamerPrivate *priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+	GError              *error = NULL;
+	gchar               *md5;
+
+	md5 = nsc_checksum_file_finish (result, &error);
+
+	/* Cancelled, and the output removed already */
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		g_error_free (error);
+		g_object_unref (gstreamer);
+		return;
+	}
+
+	g_clear_object (&priv->verifying);
+	nsc_trace_span (gstreamer, "verify", priv->verify_start, NULL);
+
+	if (error == NULL && g_strcmp0 (md5, priv->pcm_md5) != 0)
+		error = g_error_new (NSC_ERROR, NSC_ERROR_VERIFY_FAILED,
+				     _("The converted file does not decode to the audio it was made from"));
+
+	if (error != NULL) {
+		g_signal_emit (gstreamer, signals[ERROR], 0, error);
+		g_error_free (error);
+	} else {
+		g_signal_emit (gstreamer, signals[COMPLETION], 0);
+	}
+
+	g_free (md5);
+	g_object_unref (gstreamer);
+}
+
+/*
+ * Decode what was written and compare.  Only lossless outputs can
+ * decode to the same samples, and FLAC's own MD5 only speaks for
+ * what its encoder was given, not for what reached the disk.
+ */
+static gboolean
+start_verify (NscGStreamer *gstreamer)
+{
+	NscGStreamerPrivate *priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+	GFile               *sink;
+	gchar               *media_type;
+	gboolean             lossless;
+
+	if (!priv->verify || priv->pcm_md5 == NULL || priv->pcm_caps == NULL)
+		return FALSE;
+
+	media_type = rb_gst_encoding_profile_get_media_type (priv->profile);
+	lossless = media_type != NULL && rb_gst_media_type_is_lossless (media_type);
+	g_free (media_type);
+	if (!lossless)
+		return FALSE;
+
+	g_object_get (G_OBJECT (priv->filesink), "file", &sink, NULL);
+
+	priv->verifying = g_cancellable_new ();
+	priv->verify_start = nsc_trace_start ();
+	nsc_checksum_file_async (sink, priv->pcm_caps, priv->verifying,
+				 verify_done_cb, g_object_ref (gstreamer));
+	g_object_unref (sink);
+
+	return TRUE;
+}
+
 static void
 eos_cb (GstBus     *bus,
 	GstMessage *message,
@@ -261,14 +776,26 @@ eos_cb (GstBus     *bus,
 	gstreamer = NSC_GSTREAMER (user_data);
 	priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
 
-	gst_element_set_state (priv->pipeline, GST_STATE_NULL);
+	nsc_trace_span (gstreamer, "convert", priv->phase_start, NULL);
+	priv->phase_start = nsc_trace_start ();
 
-	if (priv->tick_id) {
-		g_source_remove (priv->tick_id);
-		priv->tick_id = 0;
+	/* A caller's stream is only converted once */
+	if (priv->streams) {
+		gst_element_set_state (priv->pipeline, GST_STATE_NULL);
+		priv->rebuild_pipeline = TRUE;
+	} else {
+		recycle_pipeline (gstreamer);
 	}
+	finish_usage (gstreamer);
+	finish_checksum (gstreamer);
 
-	priv->rebuild_pipeline = TRUE;
+	stop_tick (gstreamer);
+
+	nsc_trace_span (gstreamer, "finalise", priv->phase_start, NULL);
+
+	/* The completion waits for the verification */
+	if (!priv->streams && start_verify (gstreamer))
+		return;
 
 	g_signal_emit (gstreamer, signals[COMPLETION], 0);
 }
@@ -291,6 +818,9 @@ build_encoder (NscGStreamer *gstreamer)
 	g_object_set (encodebin, "profile", priv->profile, NULL);
 	g_object_set (encodebin, "queue-time-max", 120 * GST_SECOND, NULL);
 
+	/* pad_added_cb only converts the audio if the encoder needs it */
+	gst_util_set_object_arg (G_OBJECT (encodebin), "flags", "no-audio-conversion");
+
 	return encodebin;
 }
 
@@ -308,127 +838,442 @@ error_cb (GstBus     *bus,
 
 	/* Make sure the pipeline is not running any more */
 	gst_element_set_state (priv->pipeline, GST_STATE_NULL);
+	finish_usage (gstreamer);
 	priv->rebuild_pipeline = TRUE;
 
-	if (priv->tick_id) {
-		g_source_remove (priv->tick_id);
-		priv->tick_id = 0;
+	/*
+	 * Nobody is waiting for a file that is only prerolled yet;
+	 * convert_file() will start it afresh and report the error.
+	 */
+	if (priv->standby) {
+		priv->standby = FALSE;
+		g_clear_object (&priv->standby_src);
+		g_clear_object (&priv->standby_sink);
+		return;
 	}
 
+	stop_tick (gstreamer);
+
 	gst_message_parse_error (message, &error, NULL);
+	nsc_trace_instant (gstreamer, "error", error->message);
 	g_signal_emit (gstreamer, signals[ERROR], 0, error);
 	g_error_free (error);
 }
 
-static void
-build_pipeline (NscGStreamer *gstreamer)
+/*
+ * Called synchronously from whichever thread posted the message.
+ * The stream status CREATE message comes before a streaming task
+ * starts, so this is where a background conversion hands it the
+ * idle priority pool.  ENTER is posted by each streaming thread
+ * before it starts pushing data, and LEAVE just before it stops,
+ * which is where its CPU time is added up.
+ */
+static GstBusSyncReply
+sync_message_cb (GstBus     *bus,
+		 GstMessage *message,
+		 gpointer    user_data)
 {
 	NscGStreamerPrivate *priv;
-	GstBus              *bus;
-
-	g_return_if_fail (NSC_IS_GSTREAMER (gstreamer));
-
-	priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
-
-	if (priv->pipeline != NULL) {
-		gst_object_unref (GST_OBJECT (priv->pipeline));
+	GstStreamStatusType  type;
+	GstElement          *owner;
+
+	if (GST_MESSAGE_TYPE (message) != GST_MESSAGE_STREAM_STATUS)
+		return GST_BUS_PASS;
+
+	priv = NSC_GSTREAMER_GET_PRIVATE (user_data);
+
+	gst_message_parse_stream_status (message, &type, &owner);
+	if (type == GST_STREAM_STATUS_TYPE_CREATE) {
+		const GValue *value;
+
+		value = gst_message_get_stream_status_object (message);
+		if (priv->background && value != NULL &&
+		    G_VALUE_TYPE (value) == GST_TYPE_TASK)
+			gst_task_set_pool (g_value_get_object (value),
+					   nsc_priority_get_background_pool ());
+	} else if (type == GST_STREAM_STATUS_TYPE_ENTER) {
+		gint64 *start = g_private_get (&thread_start);
+		gint64 *trace_start = g_private_get (&thread_trace_start);
+
+		if (start == NULL) {
+			start = g_new (gint64, 1);
+			g_private_set (&thread_start, start);
+			trace_start = g_new (gint64, 1);
+			g_private_set (&thread_trace_start, trace_start);
+		}
+		*start = thread_cpu_time ();
+
+		/* Each streaming thread gets a track of its own */
+		*trace_start = nsc_trace_start ();
+		if (*trace_start != 0)
+			nsc_trace_name_track (g_thread_self (),
+					      GST_ELEMENT_NAME (owner));
+	} else if (type == GST_STREAM_STATUS_TYPE_LEAVE) {
+		gint64 *start = g_private_get (&thread_start);
+		gint64 *trace_start = g_private_get (&thread_trace_start);
+
+		if (start != NULL) {
+			gint64 cpu_time = thread_cpu_time () - *start;
+
+			G_LOCK (usage);
+			priv->cpu_time += cpu_time;
+			G_UNLOCK (usage);
+
+			if (*trace_start != 0) {
+				gchar *detail;
+
+				detail = g_strdup_printf ("%" G_GINT64_FORMAT " us CPU",
+							  cpu_time);
+				nsc_trace_span (g_thread_self (), "streaming",
+						*trace_start, detail);
+				g_free (detail);
+			}
+		}
 	}
 
-	priv->pipeline = gst_pipeline_new ("pipeline");
-	bus = gst_element_get_bus (priv->pipeline);
-	gst_bus_add_signal_watch (bus);
+	return GST_BUS_PASS;
+}
 
-	/* Connect the signals we want to listen to on the bus */
-	g_signal_connect (G_OBJECT (bus), "message::error",
-			  G_CALLBACK (error_cb),
-			  gstreamer);
-	g_signal_connect (G_OBJECT (bus), "message::eos",
-			  G_CALLBACK (eos_cb),
-			  gstreamer);
+/*
+ * rganalysis posts the track gain and peak just before it
+ * lets the EOS through, so this comes before the completion.
+ */
+static void
+tag_cb (GstBus     *bus,
+	GstMessage *message,
+	gpointer    user_data)
+{
+	NscGStreamer        *gstreamer;
+	NscGStreamerPrivate *priv;
+	GstTagList          *tags = NULL;
+	gdouble              gain, peak;
 
-	/* Read from disk */
-	priv->filesrc = gst_element_factory_make (FILE_SOURCE, "file_src");
-	if (priv->filesrc == NULL) {
-		g_set_error (&priv->construct_error,
-			     NSC_ERROR, NSC_ERROR_INTERNAL_ERROR,
-			     _("Could not create GStreamer file input"));
-		return;
-	}
+	gstreamer = NSC_GSTREAMER (user_data);
+	priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
 
-	/* Decode */
-	priv->decode = gst_element_factory_make ("decodebin", NULL);
-	if (priv->decode == NULL) {
-		g_set_error (&priv->construct_error,
-			     NSC_ERROR, NSC_ERROR_INTERNAL_ERROR,
-			     _("Could not create GStreamer file input"));
+	if (priv->rganalysis == NULL ||
+	    GST_MESSAGE_SRC (message) != GST_OBJECT (priv->rganalysis))
 		return;
-	}
 
-	/* Encode */
-	priv->encode = build_encoder (gstreamer);
-	if (priv->encode == NULL) {
-		g_set_error (&priv->construct_error,
-			     NSC_ERROR, NSC_ERROR_INTERNAL_ERROR,
-			     _("Could not create GStreamer encoders for %s"),
-			     gst_encoding_profile_get_name (priv->profile));
-		return;
+	gst_message_parse_tag (message, &tags);
+	if (gst_tag_list_get_double (tags, GST_TAG_TRACK_GAIN, &gain) &&
+	    gst_tag_list_get_double (tags, GST_TAG_TRACK_PEAK, &peak)) {
+		g_signal_emit (gstreamer, signals[REPLAYGAIN], 0, gain, peak);
 	}
+	gst_tag_list_unref (tags);
+}
 
-	/* Write to disk */
-	priv->filesink = gst_element_factory_make (FILE_SINK, "file_sink");
-	if (priv->filesink == NULL) {
-		g_set_error (&priv->construct_error,
-			     NSC_ERROR, NSC_ERROR_INTERNAL_ERROR,
-			     _("Could not create GStreamer file output"));
-		return;
-	}
+/*
+ * Insert the ReplayGain analysis between the decoder and the
+ * encoder, so the audio is only decoded once.
+ */
+static GstPad *
+build_analysis (NscGStreamer *gstreamer)
+{
+	NscGStreamerPrivate *priv;
 
-	/* Add the elements to the pipeline */
-	gst_bin_add_many (GST_BIN (priv->pipeline),
-			  priv->filesrc, priv->decode,
-			  priv->encode, priv->filesink,
-			  NULL);
+	priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
 
-	/* Link filessrc and decoder */
-	if (!gst_element_link_many (priv->filesrc, priv->decode, NULL)) {
-		g_set_error (&priv->construct_error,
-			     NSC_ERROR, NSC_ERROR_INTERNAL_ERROR,
-			     _("Could not link pipeline"));
-		return;
+	priv->audioconvert = gst_element_factory_make ("audioconvert", NULL);
+	priv->rganalysis = gst_element_factory_make ("rganalysis", NULL);
+	if (priv->audioconvert == NULL || priv->rganalysis == NULL) {
+		g_warning (_("Could not create the ReplayGain analysis"));
+		if (priv->audioconvert)
+			gst_object_unref (priv->audioconvert);
+		if (priv->rganalysis)
+			gst_object_unref (priv->rganalysis);
+		priv->audioconvert = NULL;
+		priv->rganalysis = NULL;
+		return NULL;
 	}
 
-	/* Link the rest */
-	if (!gst_element_link (priv->encode, priv->filesink)) {
-		g_set_error (&priv->construct_error,
-			     NSC_ERROR, NSC_ERROR_INTERNAL_ERROR,
-			     _("Could not link pipeline"));
-		return;
-	}
+	/* Analyse even if the source file has ReplayGain tags already */
+	g_object_set (priv->rganalysis, "forced", TRUE, NULL);
 
-	priv->rebuild_pipeline = FALSE;
+	gst_bin_add_many (GST_BIN (priv->pipeline),
+			  priv->audioconvert, priv->rganalysis, NULL);
+	gst_element_link (priv->audioconvert, priv->rganalysis);
+	gst_element_sync_state_with_parent (priv->audioconvert);
+	gst_element_sync_state_with_parent (priv->rganalysis);
+
+	return gst_element_get_static_pad (priv->audioconvert, "sink");
 }
 
-static gboolean
-tick_timeout_cb (NscGStreamer *gstreamer)
+/*
+ * Give the tags to every element in the encoder that writes
+ * them, so that they win over the tags coming from the source.
+ */
+static void
+apply_tags (NscGStreamer *gstreamer)
 {
 	NscGStreamerPrivate *priv;
-	gint64               nanos;
-	gint                 secs;
-	GstState             state;
-	GstState             pending_state;
-
-	g_return_val_if_fail (NSC_IS_GSTREAMER (gstreamer), FALSE);
+	GstIterator         *iter;
+	GValue               item = G_VALUE_INIT;
 
 	priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
 
-	gst_element_get_state (priv->pipeline,
-						   &state,
-						   &pending_state,
-						   0);
+	iter = gst_bin_iterate_all_by_interface (GST_BIN (priv->encode),
+						 GST_TYPE_TAG_SETTER);
+	while (gst_iterator_next (iter, &item) == GST_ITERATOR_OK) {
+		GstTagSetter *setter = GST_TAG_SETTER (g_value_get_object (&item));
 
-	if (state != GST_STATE_PLAYING &&
+		gst_tag_setter_merge_tags (setter, priv->tags,
+					   GST_TAG_MERGE_REPLACE);
+		g_value_reset (&item);
+	}
+	g_value_unset (&item);
+	gst_iterator_free (iter);
+}
+
+/*
+ * Convert the decoded audio to something the encoder takes, and link
+ * it to encode_pad.  nscaudioconvert does mono and stereo in a single
+ * pass; audioconvert is only needed to downmix surround sound.
+ * audioresample passes the buffers through if the rates agree.
+ */
+static GstPad *
+build_conversion (NscGStreamer *gstreamer,
+		  gint          channels,
+		  GstPad       *encode_pad)
+{
+	NscGStreamerPrivate *priv;
+	GstElement          *convert, *resample;
+	GstPad              *src_pad;
+
+	priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+
+	convert = gst_element_factory_make (channels <= 2 ? NSC_AUDIO_CONVERT_NAME
+						     : "audioconvert", NULL);
+	resample = gst_element_factory_make ("audioresample", NULL);
+	if (convert == NULL || resample == NULL) {
+		g_warning (_("Could not create the audio conversion"));
+		if (convert)
+			gst_object_unref (convert);
+		if (resample)
+			gst_object_unref (resample);
+		return NULL;
+	}
+
+	gst_bin_add_many (GST_BIN (priv->pipeline), convert, resample, NULL);
+	gst_element_link (convert, resample);
+
+	src_pad = gst_element_get_static_pad (resample, "src");
+	gst_pad_link (src_pad, encode_pad);
+	gst_object_unref (src_pad);
+
+	g_object_set (resample, "quality", priv->resample_quality, NULL);
+
+	gst_element_sync_state_with_parent (convert);
+	gst_element_sync_state_with_parent (resample);
+	priv->audioresample = resample;
+
+	return gst_element_get_static_pad (convert, "sink");
+}
+
+/*
+ * Set the properties the preset asks of each element encodebin
+ * made, e.g. "quality=0" on flacenc for the fast preset.
+ */
+static void
+apply_preset (NscGStreamer *gstreamer)
+{
+	NscGStreamerPrivate *priv;
+	GstIterator         *iter;
+	GValue               item = G_VALUE_INIT;
+
+	priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+
+	iter = gst_bin_iterate_recurse (GST_BIN (priv->encode));
+	while (gst_iterator_next (iter, &item) == GST_ITERATOR_OK) {
+		GstElement        *element = g_value_get_object (&item);
+		GstElementFactory *factory;
+		const gchar       *settings;
+		gchar            **pairs;
+		int                i;
+
+		factory = gst_element_get_factory (element);
+		settings = factory ? g_hash_table_lookup (priv->preset_settings,
+							  GST_OBJECT_NAME (factory))
+				   : NULL;
+		if (settings == NULL) {
+			g_value_reset (&item);
+			continue;
+		}
+
+		pairs = g_strsplit (settings, " ", -1);
+		for (i = 0; pairs[i] != NULL; i++) {
+			gchar *value = strchr (pairs[i], '=');
+
+			if (value == NULL)
+				continue;
+			*value++ = '\0';
+			gst_util_set_object_arg (G_OBJECT (element), pairs[i], value);
+		}
+		g_strfreev (pairs);
+		g_value_reset (&item);
+	}
+	g_value_unset (&item);
+	gst_iterator_free (iter);
+}
+
+/*
+ * Keep decodebin from decoding anything but the first audio stream:
+ * cover art, video tracks and the other audio tracks are dropped
+ * before they cost a decoder.
+ */
+static AutoplugSelectResult
+autoplug_select_cb (GstElement        *decodebin,
+		    GstPad            *pad,
+		    GstCaps           *caps,
+		    GstElementFactory *factory,
+		    gpointer           user_data)
+{
+	NscGStreamerPrivate *priv = NSC_GSTREAMER_GET_PRIVATE (user_data);
+
+	if (!gst_element_factory_list_is_type (factory, GST_ELEMENT_FACTORY_TYPE_DECODER))
+		return AUTOPLUG_SELECT_TRY;
+
+	if (!gst_element_factory_list_is_type (factory, GST_ELEMENT_FACTORY_TYPE_MEDIA_AUDIO))
+		return AUTOPLUG_SELECT_SKIP;
+
+	/* A second decoder for the same stream is fine, if the first failed */
+	if (priv->audio_stream == NULL)
+		priv->audio_stream = pad;
+
+	return priv->audio_stream == pad ? AUTOPLUG_SELECT_TRY : AUTOPLUG_SELECT_SKIP;
+}
+
+/*
+ * decodebin only creates its source pads once it knows what the
+ * file contains, so link them to the encoder as they show up.
+ */
+static void
+pad_added_cb (GstElement *decodebin,
+	      GstPad     *pad,
+	      gpointer    user_data)
+{
+	NscGStreamer        *gstreamer;
+	NscGStreamerPrivate *priv;
+	GstCaps             *caps;
+	GstStructure        *structure;
+	GstPad              *encode_pad, *sink_pad;
+	gboolean             is_audio;
+	gint                 channels = 0;
+
+	gstreamer = NSC_GSTREAMER (user_data);
+	priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+
+	/* What the decoder produces now, if it has settled on that yet */
+	caps = gst_pad_get_current_caps (pad);
+	if (caps == NULL)
+		caps = gst_pad_query_caps (pad, NULL);
+	structure = gst_caps_get_structure (caps, 0);
+	is_audio = g_str_has_prefix (gst_structure_get_name (structure), "audio/");
+	gst_structure_get_int (structure, "channels", &channels);
+
+	if (!is_audio || priv->audio_linked) {
+		gst_caps_unref (caps);
+		return;
+	}
+
+	/* A recycled pipeline links the new decoder to the same input */
+	if (priv->encode_pad == NULL) {
+		priv->encode_pad = gst_element_get_request_pad (priv->encode, "audio_%u");
+		if (priv->encode_pad != NULL)
+			gst_pad_add_probe (priv->encode_pad, GST_PAD_PROBE_TYPE_BUFFER,
+					   checksum_probe_cb, gstreamer, NULL);
+	}
+	if (priv->encode_pad == NULL) {
+		g_warning (_("Could not get an audio input from the encoder"));
+		gst_caps_unref (caps);
+		return;
+	}
+	encode_pad = gst_object_ref (priv->encode_pad);
+
+	sink_pad = NULL;
+	if (priv->replaygain) {
+		sink_pad = build_analysis (gstreamer);
+		if (sink_pad != NULL) {
+			GstPad *analysis_pad, *conversion_pad;
+
+			/* rganalysis only takes mono or stereo */
+			analysis_pad = gst_element_get_static_pad (priv->rganalysis, "src");
+			conversion_pad = build_conversion (gstreamer, 2, encode_pad);
+			if (conversion_pad != NULL) {
+				gst_pad_link (analysis_pad, conversion_pad);
+				gst_object_unref (conversion_pad);
+			} else {
+				gst_pad_link (analysis_pad, encode_pad);
+			}
+			gst_object_unref (analysis_pad);
+		}
+	}
+
+	/* Only convert if the encoder can't take the decoded audio as is */
+	if (sink_pad == NULL) {
+		GstCaps *encode_caps;
+
+		encode_caps = gst_pad_query_caps (encode_pad, NULL);
+		if (!gst_caps_can_intersect (caps, encode_caps))
+			sink_pad = build_conversion (gstreamer, channels, encode_pad);
+		gst_caps_unref (encode_caps);
+	}
+	gst_caps_unref (caps);
+
+	if (sink_pad == NULL)
+		sink_pad = gst_object_ref (encode_pad);
+
+	if (gst_pad_link (pad, sink_pad) == GST_PAD_LINK_OK)
+		priv->audio_linked = TRUE;
+	else
+		g_warning (_("Could not link the decoder to the encoder"));
+
+	/* encodebin has created its encoder and muxer by now */
+	if (priv->tags != NULL)
+		apply_tags (gstreamer);
+	if (priv->preset_settings != NULL)
+		apply_preset (gstreamer);
+
+	gst_object_unref (sink_pad);
+	gst_object_unref (encode_pad);
+}
+
+/* The tick may be on another thread's context, see convert_file() */
+static void
+stop_tick (NscGStreamer *gstreamer)
+{
+	NscGStreamerPrivate *priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+
+	if (priv->tick == NULL)
+		return;
+
+	g_source_destroy (priv->tick);
+	g_source_unref (priv->tick);
+	priv->tick = NULL;
+}
+
+static gboolean
+tick_timeout_cb (NscGStreamer *gstreamer)
+{
+	NscGStreamerPrivate *priv;
+	gint64               nanos;
+	gint                 secs;
+	GstState             state;
+	GstState             pending_state;
+
+	g_return_val_if_fail (NSC_IS_GSTREAMER (gstreamer), FALSE);
+
+	priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+
+	gst_element_get_state (priv->pipeline,
+						   &state,
+						   &pending_state,
+						   0);
+
+	if (state != GST_STATE_PLAYING &&
 	    pending_state != GST_STATE_PLAYING) {
-		priv->tick_id = 0;
+		g_source_unref (priv->tick);
+		priv->tick = NULL;
 		return FALSE;
 	}
 
@@ -439,6 +1284,11 @@ tick_timeout_cb (NscGStreamer *gstreamer)
 		return TRUE;
 	}
 
+	if (nanos > (gint64) priv->start)
+		nanos -= priv->start;
+	else
+		nanos = 0;
+
 	secs = nanos / GST_SECOND;
 	if (secs != priv->seconds) {
 		g_signal_emit (gstreamer, signals[PROGRESS], 0, secs);
@@ -448,57 +1298,305 @@ tick_timeout_cb (NscGStreamer *gstreamer)
 }
 
 /*
- * Public Methods
+ * Report the duration of what is being converted, and start
+ * polling the position for the progress.
  */
-NscGStreamer *
-nsc_gstreamer_new (GstEncodingProfile *profile)
+static void
+start_progress (NscGStreamer *gstreamer)
 {
-	return g_object_new (NSC_TYPE_GSTREAMER, "profile", profile, NULL);
+	NscGStreamerPrivate *priv;
+	gint64               nanos;
+
+	priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+
+	nsc_trace_span (gstreamer, "start", priv->phase_start, NULL);
+	priv->phase_start = nsc_trace_start ();
+
+	/* Get file duration */
+	if (GST_CLOCK_TIME_IS_VALID (priv->stop)) {
+		nanos = priv->stop - priv->start;
+	} else if (!gst_element_query_duration (priv->pipeline, GST_FORMAT_TIME, &nanos)) {
+		g_warning (_("Could not get current file duration"));
+		nanos = -1;
+	} else {
+		nanos = MAX (nanos - (gint64) priv->start, 0);
+	}
+
+	if (nanos >= 0) {
+		gint secs;
+
+		secs = nanos / GST_SECOND;
+		g_signal_emit (gstreamer, signals[DURATION], 0, secs);
+	}
+
+	/* Next to the bus watch */
+	stop_tick (gstreamer);
+	priv->tick = g_timeout_source_new (250);
+	g_source_set_callback (priv->tick, (GSourceFunc)tick_timeout_cb,
+			       gstreamer, NULL);
+	g_source_attach (priv->tick, g_main_context_get_thread_default ());
 }
 
-void
-nsc_gstreamer_convert_file (NscGStreamer *gstreamer,
-			    GFile        *src,
-			    GFile        *sink,
-			    GError      **error)
+/*
+ * When converting a part of the file, the first ASYNC_DONE is the
+ * preroll, after which the pipeline is seeked to the part.  The
+ * seek is accurate, and the encoders clip the decoded buffers to
+ * the segment, so consecutive parts share their boundary sample
+ * exactly and nothing is lost or doubled between them.  The second
+ * ASYNC_DONE is the seek completing.
+ */
+static void
+async_done_cb (GstBus     *bus,
+	       GstMessage *message,
+	       gpointer    user_data)
 {
-	GstStateChangeReturn  state_ret;
-	NscGStreamerPrivate  *priv;
-	gint64                nanos;
+	NscGStreamer        *gstreamer;
+	NscGStreamerPrivate *priv;
+
+	gstreamer = NSC_GSTREAMER (user_data);
+	priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+
+	if (priv->seek_pending) {
+		priv->seek_pending = FALSE;
+		priv->seeking = TRUE;
+
+		if (!gst_element_seek (priv->pipeline, 1.0, GST_FORMAT_TIME,
+				       GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE,
+				       GST_SEEK_TYPE_SET, priv->start,
+				       GST_CLOCK_TIME_IS_VALID (priv->stop) ?
+				       GST_SEEK_TYPE_SET : GST_SEEK_TYPE_NONE,
+				       priv->stop)) {
+			GError *error;
+
+			priv->seeking = FALSE;
+			gst_element_set_state (priv->pipeline, GST_STATE_NULL);
+			finish_usage (gstreamer);
+			priv->rebuild_pipeline = TRUE;
+
+			error = g_error_new (NSC_ERROR, NSC_ERROR_INTERNAL_ERROR,
+					     _("Could not seek to the part of the file to convert"));
+			g_signal_emit (gstreamer, signals[ERROR], 0, error);
+			g_error_free (error);
+		}
+	} else if (priv->seeking) {
+		priv->seeking = FALSE;
+		gst_element_set_state (priv->pipeline, GST_STATE_PLAYING);
+		start_progress (gstreamer);
+	}
+}
+
+/*
+ * The bus watch holds on to the bus, and its handlers to us, so
+ * they have to go along with the pipeline.
+ */
+static void
+destroy_pipeline (NscGStreamer *gstreamer)
+{
+	NscGStreamerPrivate *priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+	GstBus              *bus;
+
+	if (priv->encode_pad != NULL) {
+		gst_object_unref (priv->encode_pad);
+		priv->encode_pad = NULL;
+	}
+
+	if (priv->pipeline == NULL)
+		return;
+
+	/* A recycled pipeline is still in READY */
+	gst_element_set_state (priv->pipeline, GST_STATE_NULL);
+
+	bus = gst_element_get_bus (priv->pipeline);
+	gst_bus_remove_signal_watch (bus);
+	gst_bus_set_sync_handler (bus, NULL, NULL, NULL);
+	g_signal_handlers_disconnect_matched (bus, G_SIGNAL_MATCH_DATA,
+					      0, 0, NULL, NULL, gstreamer);
+	gst_object_unref (bus);
+
+	gst_object_unref (priv->pipeline);
+	priv->pipeline = NULL;
+}
+
+static void
+build_pipeline (NscGStreamer *gstreamer)
+{
+	NscGStreamerPrivate *priv;
+	GstBus              *bus;
+	GstCaps             *caps;
 
 	g_return_if_fail (NSC_IS_GSTREAMER (gstreamer));
 
-	g_return_if_fail (src != NULL);
-	g_return_if_fail (sink != NULL);
-       
 	priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
-	
+
+	destroy_pipeline (gstreamer);
+
+	priv->pipeline = gst_pipeline_new ("pipeline");
+	bus = gst_element_get_bus (priv->pipeline);
+	/* The watch goes on the calling thread's default main context,
+	 * so an NscEngine handles its messages on the engine thread */
+	gst_bus_add_signal_watch (bus);
+	gst_bus_set_sync_handler (bus, sync_message_cb, gstreamer, NULL);
+
+	/* Connect the signals we want to listen to on the bus */
+	g_signal_connect (G_OBJECT (bus), "message::error",
+			  G_CALLBACK (error_cb),
+			  gstreamer);
+	g_signal_connect (G_OBJECT (bus), "message::eos",
+			  G_CALLBACK (eos_cb),
+			  gstreamer);
+	g_signal_connect (G_OBJECT (bus), "message::tag",
+			  G_CALLBACK (tag_cb),
+			  gstreamer);
+	g_signal_connect (G_OBJECT (bus), "message::async-done",
+			  G_CALLBACK (async_done_cb),
+			  gstreamer);
+	gst_object_unref (bus);
+
+	/*
+	 * Each element goes into the pipeline as soon as it is made,
+	 * so that if a later one can't be, it goes with the pipeline.
+	 */
+
+	/* Read from disk, or from the caller's stream */
+	priv->filesrc = gst_element_factory_make (priv->streams ? STREAM_SOURCE : FILE_SOURCE,
+						  "file_src");
+	if (priv->filesrc == NULL) {
+		g_set_error (&priv->construct_error,
+			     NSC_ERROR, NSC_ERROR_INTERNAL_ERROR,
+			     _("Could not create GStreamer file input"));
+		return;
+	}
+	gst_bin_add (GST_BIN (priv->pipeline), priv->filesrc);
+
+	/* Decode */
+	priv->decode = gst_element_factory_make ("decodebin", NULL);
+	if (priv->decode == NULL) {
+		g_set_error (&priv->construct_error,
+			     NSC_ERROR, NSC_ERROR_INTERNAL_ERROR,
+			     _("Could not create GStreamer file input"));
+		return;
+	}
+	gst_bin_add (GST_BIN (priv->pipeline), priv->decode);
+
+	/* Only raw audio, and no pads for the streams that aren't */
+	caps = gst_caps_new_empty_simple ("audio/x-raw");
+	g_object_set (priv->decode,
+		      "caps", caps,
+		      "expose-all-streams", FALSE,
+		      NULL);
+	gst_caps_unref (caps);
+
+	/* Encode */
+	priv->encode = build_encoder (gstreamer);
+	if (priv->encode == NULL) {
+		g_set_error (&priv->construct_error,
+			     NSC_ERROR, NSC_ERROR_INTERNAL_ERROR,
+			     _("Could not create GStreamer encoders for %s"),
+			     gst_encoding_profile_get_name (priv->profile));
+		return;
+	}
+	gst_bin_add (GST_BIN (priv->pipeline), priv->encode);
+
+	/* Write to disk, or to the caller's stream */
+	priv->filesink = gst_element_factory_make (priv->streams ? STREAM_SINK : FILE_SINK,
+						   "file_sink");
+	if (priv->filesink == NULL) {
+		g_set_error (&priv->construct_error,
+			     NSC_ERROR, NSC_ERROR_INTERNAL_ERROR,
+			     _("Could not create GStreamer file output"));
+		return;
+	}
+	gst_bin_add (GST_BIN (priv->pipeline), priv->filesink);
+
+	priv->audioconvert = NULL;
+	priv->audioresample = NULL;
+	priv->rganalysis = NULL;
+	priv->audio_linked = FALSE;
+	priv->audio_stream = NULL;
+	g_signal_connect (G_OBJECT (priv->decode), "pad-added",
+			  G_CALLBACK (pad_added_cb),
+			  gstreamer);
+	g_signal_connect (G_OBJECT (priv->decode), "autoplug-select",
+			  G_CALLBACK (autoplug_select_cb),
+			  gstreamer);
+
+	/* Link filessrc and decoder */
+	if (!gst_element_link_many (priv->filesrc, priv->decode, NULL)) {
+		g_set_error (&priv->construct_error,
+			     NSC_ERROR, NSC_ERROR_INTERNAL_ERROR,
+			     _("Could not link pipeline"));
+		return;
+	}
+
+	/* Link the rest */
+	if (!gst_element_link (priv->encode, priv->filesink)) {
+		g_set_error (&priv->construct_error,
+			     NSC_ERROR, NSC_ERROR_INTERNAL_ERROR,
+			     _("Could not link pipeline"));
+		return;
+	}
+
+	priv->rebuild_pipeline = FALSE;
+}
+
+/*
+ * Make sure there is a pipeline for either files or streams.
+ */
+static gboolean
+prepare_pipeline (NscGStreamer *gstreamer,
+		  gboolean      streams,
+		  GError      **error)
+{
+	NscGStreamerPrivate *priv;
+
+	priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+
+	if (priv->streams != streams) {
+		priv->streams = streams;
+		priv->rebuild_pipeline = TRUE;
+	}
+
 	/* See if we need to rebuild the pipeline */
 	if (priv->rebuild_pipeline != FALSE) {
+		gint64 start = nsc_trace_start ();
+
 		build_pipeline (gstreamer);
+		nsc_trace_span (gstreamer, "build", start, NULL);
 
 		if (priv->construct_error != NULL) {
 			g_propagate_error (error, priv->construct_error);
 			priv->construct_error = NULL;
-			return;
+			return FALSE;
 		}
 	}
 
-	/* Set the input file */
-	gst_element_set_state (priv->filesrc, GST_STATE_NULL);
-	g_object_set (G_OBJECT (priv->filesrc),
-		      "file", src,
-		      NULL);
+	return TRUE;
+}
 
-	/* Set the output filename */
-	gst_element_set_state (priv->filesink, GST_STATE_NULL);
-	g_object_set (G_OBJECT (priv->filesink),
-		      "file", sink,
-		      NULL);
+/*
+ * Set the pipeline going once its input and output are set.
+ */
+static void
+start_pipeline (NscGStreamer *gstreamer,
+		GError      **error)
+{
+	GstStateChangeReturn  state_ret;
+	NscGStreamerPrivate  *priv;
+	gboolean              ranged;
+
+	priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+
+	/*
+	 * To convert only a part of the file, preroll first so the
+	 * pipeline can be seeked to it.  Otherwise let's get ready
+	 * to rumble!
+	 */
+	ranged = priv->start != 0 || GST_CLOCK_TIME_IS_VALID (priv->stop);
 
-	/* Let's get ready to rumble! */
+	priv->seek_pending = FALSE;
+	priv->seeking = FALSE;
 	state_ret = gst_element_set_state (priv->pipeline,
-					   GST_STATE_PLAYING);
+					   ranged ? GST_STATE_PAUSED : GST_STATE_PLAYING);
 
 	if (state_ret == GST_STATE_CHANGE_ASYNC) {
 		/* 
@@ -533,22 +1631,148 @@ nsc_gstreamer_convert_file (NscGStreamer *gstreamer,
 		return;
 	}
 
-	/* Get file duration */
-	if (!gst_element_query_duration (priv->pipeline, GST_FORMAT_TIME, &nanos)) {
-		g_warning (_("Could not get current file duration"));
-	} else {
-		gint secs;
+	/* A part of the file starts once the seek is done */
+	if (ranged) {
+		priv->seek_pending = TRUE;
+		return;
+	}
 
-		secs = nanos / GST_SECOND;
-		g_signal_emit (gstreamer, signals[DURATION], 0, secs);
+	start_progress (gstreamer);
+}
+
+static void
+set_files (NscGStreamer *gstreamer,
+	   GFile        *src,
+	   GFile        *sink)
+{
+	NscGStreamerPrivate *priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+
+	/* Set the input file */
+	gst_element_set_state (priv->filesrc, GST_STATE_NULL);
+	g_object_set (G_OBJECT (priv->filesrc),
+		      "file", src,
+		      NULL);
+
+	/* Set the output filename */
+	gst_element_set_state (priv->filesink, GST_STATE_NULL);
+	g_object_set (G_OBJECT (priv->filesink),
+		      "file", sink,
+		      NULL);
+}
+
+/*
+ * Throw away a prerolled pipeline, along with the file its sink
+ * has already created.
+ */
+static void
+drop_standby (NscGStreamer *gstreamer)
+{
+	NscGStreamerPrivate *priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+
+	gst_element_set_state (priv->pipeline, GST_STATE_NULL);
+	priv->rebuild_pipeline = TRUE;
+	priv->standby = FALSE;
+	nsc_trace_span (gstreamer, "preroll", priv->preroll_start, "dropped");
+
+	g_file_delete (priv->standby_sink, NULL, NULL);
+	g_clear_object (&priv->standby_src);
+	g_clear_object (&priv->standby_sink);
+}
+
+static void
+nsc_gstreamer_real_convert_file (NscGStreamer *gstreamer,
+				 GFile        *src,
+				 GFile        *sink,
+				 GError      **error)
+{
+	NscGStreamerPrivate  *priv;
+
+	g_return_if_fail (NSC_IS_GSTREAMER (gstreamer));
+
+	g_return_if_fail (src != NULL);
+	g_return_if_fail (sink != NULL);
+       
+	priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+	priv->phase_start = nsc_trace_start ();
+
+	/* Prerolled on just these files?  Then it only has to play */
+	if (priv->standby) {
+		if (!priv->rebuild_pipeline &&
+		    g_file_equal (src, priv->standby_src) &&
+		    g_file_equal (sink, priv->standby_sink)) {
+			priv->standby = FALSE;
+			g_clear_object (&priv->standby_src);
+			g_clear_object (&priv->standby_sink);
+			nsc_trace_span (gstreamer, "preroll",
+					priv->preroll_start, "used");
+
+			start_pipeline (gstreamer, error);
+			return;
+		}
+
+		drop_standby (gstreamer);
 	}
+	
+	if (!prepare_pipeline (gstreamer, FALSE, error))
+		return;
 
-	priv->tick_id = g_timeout_add (250, (GSourceFunc)tick_timeout_cb,
-				       gstreamer);
+	set_files (gstreamer, src, sink);
+	reset_usage (gstreamer);
+	reset_checksum (gstreamer);
+
+	start_pipeline (gstreamer, error);
 }
 
-void
-nsc_gstreamer_cancel_convert (NscGStreamer *gstreamer)
+/*
+ * Get the pipeline for the next file ready while the previous one
+ * is still being converted, up to PAUSED, so that by the time it is
+ * needed the file is open, typefound and its decoder plugged.  Only
+ * whole files are prerolled, as a part still needs its seek.
+ */
+static void
+nsc_gstreamer_real_preroll_file (NscGStreamer *gstreamer,
+				 GFile        *src,
+				 GFile        *sink)
+{
+	NscGStreamerPrivate  *priv;
+	GstStateChangeReturn  state_ret;
+
+	priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+
+	if (priv->start != 0 || GST_CLOCK_TIME_IS_VALID (priv->stop))
+		return;
+
+	if (priv->standby)
+		drop_standby (gstreamer);
+
+	if (!prepare_pipeline (gstreamer, FALSE, NULL))
+		return;
+
+	set_files (gstreamer, src, sink);
+	reset_usage (gstreamer);
+	reset_checksum (gstreamer);
+
+	priv->standby = TRUE;
+	priv->standby_src = g_object_ref (src);
+	priv->standby_sink = g_object_ref (sink);
+	priv->preroll_start = nsc_trace_start ();
+
+	state_ret = gst_element_set_state (priv->pipeline, GST_STATE_PAUSED);
+	if (state_ret == GST_STATE_CHANGE_FAILURE) {
+		GstMessage *msg;
+
+		/* Leave the error for convert_file() to find again */
+		msg = gst_bus_poll (GST_ELEMENT_BUS (priv->pipeline),
+				    GST_MESSAGE_ERROR, 0);
+		if (msg)
+			gst_message_unref (msg);
+
+		drop_standby (gstreamer);
+	}
+}
+
+static void
+nsc_gstreamer_real_cancel_convert (NscGStreamer *gstreamer)
 {
 	NscGStreamerPrivate *priv;
 	GstState             state;
@@ -560,16 +1784,45 @@ nsc_gstreamer_cancel_convert (NscGStreamer *gstreamer)
 
 	priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
 
+	if (priv->standby) {
+		drop_standby (gstreamer);
+		return;
+	}
+
+	/* Converted, but not verified yet */
+	if (priv->verifying != NULL) {
+		g_cancellable_cancel (priv->verifying);
+		g_clear_object (&priv->verifying);
+
+		g_object_get (G_OBJECT (priv->filesink), "file", &sink_file, NULL);
+		g_file_delete (sink_file, NULL, NULL);
+		g_object_unref (sink_file);
+		return;
+	}
+
+	if (priv->pipeline == NULL)
+		return;
+
 	gst_element_get_state (priv->pipeline,
 			       &state,
 			       NULL,
 			       GST_CLOCK_TIME_NONE);
 
-	if (state != GST_STATE_PLAYING) {
+	/* A part of a file is still paused while it is being seeked to */
+	if (state != GST_STATE_PLAYING &&
+	    !priv->seek_pending && !priv->seeking) {
 		return;
 	}
 
+	priv->seek_pending = FALSE;
+	priv->seeking = FALSE;
 	gst_element_set_state (priv->pipeline, GST_STATE_NULL);
+	priv->rebuild_pipeline = TRUE;
+	nsc_trace_instant (gstreamer, "cancel", NULL);
+
+	/* The caller's stream is theirs to clean up */
+	if (priv->streams)
+		return;
 
 	/*
 	 * Remove the file that was being converted
@@ -591,8 +1844,94 @@ nsc_gstreamer_cancel_convert (NscGStreamer *gstreamer)
 		g_object_unref (sink_file);
 
 	g_free (sink_uri);
+}
 
-	priv->rebuild_pipeline = TRUE;
+/*
+ * Public Methods
+ */
+NscGStreamer *
+nsc_gstreamer_new (GstEncodingProfile *profile)
+{
+	return g_object_new (NSC_TYPE_GSTREAMER, "profile", profile, NULL);
+}
+
+void
+nsc_gstreamer_convert_file (NscGStreamer *gstreamer,
+			    GFile        *src,
+			    GFile        *sink,
+			    GError      **error)
+{
+	g_return_if_fail (NSC_IS_GSTREAMER (gstreamer));
+
+	NSC_GSTREAMER_GET_CLASS (gstreamer)->convert_file (gstreamer, src,
+							   sink, error);
+}
+
+/**
+ * Convert everything read from src, writing the result to sink.
+ * Either may be a pipe, so the whole stream is converted and the
+ * "start" and "stop" properties are ignored; neither stream is
+ * closed.  This always runs in the calling process, even for an
+ * NscRemote.
+ */
+void
+nsc_gstreamer_convert_stream (NscGStreamer  *gstreamer,
+			      GInputStream  *src,
+			      GOutputStream *sink,
+			      GError       **error)
+{
+	NscGStreamerPrivate *priv;
+
+	g_return_if_fail (NSC_IS_GSTREAMER (gstreamer));
+	g_return_if_fail (G_IS_INPUT_STREAM (src));
+	g_return_if_fail (G_IS_OUTPUT_STREAM (sink));
+
+	priv = NSC_GSTREAMER_GET_PRIVATE (gstreamer);
+	priv->phase_start = nsc_trace_start ();
+
+	if (!prepare_pipeline (gstreamer, TRUE, error))
+		return;
+
+	gst_element_set_state (priv->filesrc, GST_STATE_NULL);
+	g_object_set (G_OBJECT (priv->filesrc), "stream", src, NULL);
+
+	gst_element_set_state (priv->filesink, GST_STATE_NULL);
+	g_object_set (G_OBJECT (priv->filesink), "stream", sink, NULL);
+
+	/* Streams can't be seeked to a part */
+	priv->start = 0;
+	priv->stop = GST_CLOCK_TIME_NONE;
+
+	reset_usage (gstreamer);
+	reset_checksum (gstreamer);
+	start_pipeline (gstreamer, error);
+}
+
+void
+nsc_gstreamer_cancel_convert (NscGStreamer *gstreamer)
+{
+	g_return_if_fail (NSC_IS_GSTREAMER (gstreamer));
+
+	NSC_GSTREAMER_GET_CLASS (gstreamer)->cancel_convert (gstreamer);
+}
+
+/**
+ * Get ready to convert src to sink, which the next call to
+ * nsc_gstreamer_convert_file() with the same files then starts
+ * without delay.  Set the properties for the file first.  Nothing
+ * is reported until then; a file that fails to preroll is simply
+ * started afresh.  Cancelling drops it and removes sink.
+ */
+void
+nsc_gstreamer_preroll_file (NscGStreamer *gstreamer,
+			    GFile        *src,
+			    GFile        *sink)
+{
+	g_return_if_fail (NSC_IS_GSTREAMER (gstreamer));
+	g_return_if_fail (src != NULL);
+	g_return_if_fail (sink != NULL);
+
+	NSC_GSTREAMER_GET_CLASS (gstreamer)->preroll_file (gstreamer, src, sink);
 }
 
 gboolean
@@ -35,10 +35,10 @@ G_BEGIN_DECLS
 
 #define NSC_TYPE_GSTREAMER            (nsc_gstreamer_get_type ())
 #define NSC_GSTREAMER(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), NSC_TYPE_GSTREAMER, NscGStreamer))
-#define NSC_GSTREAMER_CLASS(klass)    (G_TYPE_CHECK_INSTANCE_TYPE (obj, NSC_TYPE_GSTREAMER, NscGStreamerClass))
+#define NSC_GSTREAMER_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), NSC_TYPE_GSTREAMER, NscGStreamerClass))
 #define NSC_IS_GSTREAMER(obj)         (G_TYPE_CHECK_INSTANCE_TYPE (obj, NSC_TYPE_GSTREAMER))
 #define NSC_IS_GSTREAMER_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), NSC_TYPE_GSTREAMER))
-#define NSC_GSTREAMER_GET_CLASS(obj)  (G_TYPE_CHECK_CLASS_CAST ((obj), NSC_TYPE_GSTREAMER, NscGStreamerClass))
+#define NSC_GSTREAMER_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), NSC_TYPE_GSTREAMER, NscGStreamerClass))
 
 typedef struct NscGStreamerPrivate NscGStreamerPrivate;
 
@@ -55,6 +55,17 @@ typedef struct {
 	void (*duration)   (NscGStreamer *gstreamer, const int seconds);
 	void (*completion) (NscGStreamer *gstreamer);
 	void (*error)      (NscGStreamer *gstreamer, GError *error);
+	void (*replaygain) (NscGStreamer *gstreamer, gdouble gain, gdouble peak);
+
+	/* Virtual methods */
+	void (*convert_file)   (NscGStreamer *gstreamer,
+				GFile        *src,
+				GFile        *sink,
+				GError      **error);
+	void (*cancel_convert) (NscGStreamer *gstreamer);
+	void (*preroll_file)   (NscGStreamer *gstreamer,
+				GFile        *src,
+				GFile        *sink);
 } NscGStreamerClass;
 
 GType         nsc_gstreamer_get_type          (void);
@@ -63,7 +74,14 @@ void          nsc_gstreamer_convert_file      (NscGStreamer    *gstreamer,
 					       GFile           *src,
 					       GFile           *sink,
 					       GError         **error);
+void          nsc_gstreamer_convert_stream    (NscGStreamer    *gstreamer,
+					       GInputStream    *src,
+					       GOutputStream   *sink,
+					       GError         **error);
 void          nsc_gstreamer_cancel_convert    (NscGStreamer    *gstreamer);
+void          nsc_gstreamer_preroll_file      (NscGStreamer    *gstreamer,
+					       GFile           *src,
+					       GFile           *sink);
 gboolean      nsc_gstreamer_supports_profile  (GstEncodingProfile  *profile);
 gboolean      nsc_gstreamer_supports_mp3      (GError         **error);
 gboolean      nsc_gstreamer_supports_wav      (GError         **error);
@@ -0,0 +1,435 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-history.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+/*
+ * The job history is one JSON object per line, appended to
+ * $XDG_DATA_HOME/caja-sound-converter/history.jsonl.  Each line is
+ * written in one go, so the file can be read while jobs are running
+ * and a crash loses at most the line being written.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "nsc-history.h"
+
+#define HISTORY_ATTRIBUTES			\
+	G_FILE_ATTRIBUTE_STANDARD_SIZE ","	\
+	G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE ","	\
+	G_FILE_ATTRIBUTE_ID_FILESYSTEM
+
+/* Serializes the appends of the writer threads */
+G_LOCK_DEFINE_STATIC (history);
+
+/*
+ * Private Methods
+ */
+static void
+append_key (GString *line, const gchar *key)
+{
+	if (line->len > 1)
+		g_string_append (line, ", ");
+	g_string_append_printf (line, "\"%s\": ", key);
+}
+
+static void
+append_string (GString *line, const gchar *key, const gchar *value)
+{
+	const gchar *p;
+
+	if (value == NULL)
+		return;
+
+	append_key (line, key);
+	g_string_append_c (line, '"');
+	for (p = value; *p; p++) {
+		guchar c = *p;
+
+		if (c == '"' || c == '\\')
+			g_string_append_printf (line, "\\%c", c);
+		else if (c < 0x20)
+			g_string_append_printf (line, "\\u%04x", c);
+		else
+			g_string_append_c (line, c);
+	}
+	g_string_append_c (line, '"');
+}
+
+static void
+append_int (GString *line, const gchar *key, gint64 value)
+{
+	append_key (line, key);
+	g_string_append_printf (line, "%" G_GINT64_FORMAT, value);
+}
+
+/* Microseconds as seconds, whatever the locale's decimal point */
+static void
+append_seconds (GString *line, const gchar *key, gint64 usecs)
+{
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+	append_key (line, key);
+	g_string_append (line, g_ascii_formatd (buf, sizeof (buf), "%.3f",
+						(gdouble) usecs / G_USEC_PER_SEC));
+}
+
+static gchar *
+format_record (NscHistoryRecord *record)
+{
+	GFileInfo *info;
+	GString   *line;
+	gchar     *uri;
+
+	line = g_string_new ("{");
+
+	append_int (line, "time", g_get_real_time () / G_USEC_PER_SEC);
+
+	uri = g_file_get_uri (record->src);
+	append_string (line, "source", uri);
+	g_free (uri);
+
+	info = g_file_query_info (record->src, HISTORY_ATTRIBUTES,
+				  G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	if (info != NULL) {
+		append_string (line, "source_type",
+			       g_file_info_get_content_type (info));
+		append_string (line, "device",
+			       g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM));
+	}
+
+	append_string (line, "target", record->target);
+	append_string (line, "target_type", record->target_type);
+	append_string (line, "preset", record->preset);
+	append_int (line, "duration", record->duration);
+	append_seconds (line, "wall", record->wall_time);
+	append_seconds (line, "cpu", record->cpu_time);
+	append_int (line, "peak_rss", record->peak_rss);
+	append_string (line, "pcm_md5", record->pcm_md5);
+
+	/* How much of a disc image a track needed isn't known */
+	if (info != NULL && !record->part)
+		append_int (line, "bytes_read", g_file_info_get_size (info));
+	g_clear_object (&info);
+
+	if (record->error == NULL) {
+		info = g_file_query_info (record->sink,
+					  G_FILE_ATTRIBUTE_STANDARD_SIZE,
+					  G_FILE_QUERY_INFO_NONE, NULL, NULL);
+		if (info != NULL) {
+			append_int (line, "bytes_written", g_file_info_get_size (info));
+			g_object_unref (info);
+		}
+	}
+
+	append_int (line, "concurrency", record->concurrency);
+	append_int (line, "attempt", record->attempt);
+	append_string (line, "outcome",
+		       record->error == NULL ? "ok" :
+		       record->retried ? "retried" : "failed");
+	append_string (line, "error", record->error);
+
+	g_string_append (line, "}\n");
+
+	return g_string_free (line, FALSE);
+}
+
+static void
+write_thread (GTask        *task,
+	      gpointer      source_object,
+	      gpointer      task_data,
+	      GCancellable *cancellable)
+{
+	GFile         *file;
+	GOutputStream *stream;
+	gchar         *path, *dir, *line;
+	GError        *error = NULL;
+
+	line = format_record (task_data);
+	path = nsc_history_get_path ();
+
+	G_LOCK (history);
+
+	dir = g_path_get_dirname (path);
+	g_mkdir_with_parents (dir, 0700);
+	g_free (dir);
+
+	file = g_file_new_for_path (path);
+	stream = G_OUTPUT_STREAM (g_file_append_to (file, G_FILE_CREATE_PRIVATE,
+						    NULL, &error));
+	if (stream != NULL) {
+		g_output_stream_write_all (stream, line, strlen (line),
+					   NULL, NULL, &error);
+		g_output_stream_close (stream, NULL, error ? NULL : &error);
+		g_object_unref (stream);
+	}
+
+	G_UNLOCK (history);
+
+	if (error != NULL) {
+		g_warning ("Unable to record the job in %s: %s",
+			   path, error->message);
+		g_error_free (error);
+	}
+
+	g_object_unref (file);
+	g_free (path);
+	g_free (line);
+}
+
+static void
+skip_space (const gchar **p)
+{
+	while (g_ascii_isspace (**p))
+		(*p)++;
+}
+
+/* Reads a JSON string, leaving p after its closing quote */
+static gchar *
+parse_string (const gchar **p)
+{
+	GString     *str;
+	const gchar *s = *p;
+
+	if (*s != '"')
+		return NULL;
+
+	str = g_string_new (NULL);
+	for (s++; *s != '"'; s++) {
+		if (*s == '\0')
+			goto fail;
+		if (*s != '\\') {
+			g_string_append_c (str, *s);
+			continue;
+		}
+
+		switch (*++s) {
+		case 'b': g_string_append_c (str, '\b'); break;
+		case 'f': g_string_append_c (str, '\f'); break;
+		case 'n': g_string_append_c (str, '\n'); break;
+		case 'r': g_string_append_c (str, '\r'); break;
+		case 't': g_string_append_c (str, '\t'); break;
+		case 'u': {
+			gchar   hex[5];
+			gchar  *end;
+			gulong  c;
+
+			if (strlen (s + 1) < 4)
+				goto fail;
+			memcpy (hex, s + 1, 4);
+			hex[4] = '\0';
+			c = strtoul (hex, &end, 16);
+			if (*end != '\0')
+				goto fail;
+			g_string_append_unichar (str, c);
+			s += 4;
+			break;
+		}
+		case '\0':
+			goto fail;
+		default:
+			g_string_append_c (str, *s);
+			break;
+		}
+	}
+
+	*p = s + 1;
+	return g_string_free (str, FALSE);
+
+fail:
+	g_string_free (str, TRUE);
+	return NULL;
+}
+
+/*
+ * Parses one line into a table of field name to value.  Only the
+ * flat objects written above are understood; anything else is NULL.
+ */
+static GHashTable *
+parse_record (const gchar *line)
+{
+	GHashTable  *record;
+	const gchar *p = line;
+
+	skip_space (&p);
+	if (*p++ != '{')
+		return NULL;
+
+	record = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+	skip_space (&p);
+	if (*p == '}')
+		return record;
+
+	for (;;) {
+		gchar *key, *value;
+
+		skip_space (&p);
+		key = parse_string (&p);
+		if (key == NULL)
+			goto fail;
+
+		skip_space (&p);
+		if (*p++ != ':') {
+			g_free (key);
+			goto fail;
+		}
+		skip_space (&p);
+
+		if (*p == '"') {
+			value = parse_string (&p);
+		} else {
+			const gchar *end = p + strcspn (p, ",}");
+
+			value = g_strstrip (g_strndup (p, end - p));
+			p = end;
+		}
+
+		if (value == NULL || *value == '\0' ||
+		    g_strcmp0 (value, "null") == 0) {
+			g_free (key);
+			g_free (value);
+		} else {
+			g_hash_table_replace (record, key, value);
+		}
+
+		skip_space (&p);
+		if (*p == '}')
+			return record;
+		if (*p++ != ',')
+			goto fail;
+	}
+
+fail:
+	g_hash_table_unref (record);
+	return NULL;
+}
+
+/*
+ * Public Methods
+ */
+gchar *
+nsc_history_get_path (void)
+{
+	return g_build_filename (g_get_user_data_dir (),
+				 "caja-sound-converter",
+				 "history.jsonl",
+				 NULL);
+}
+
+/**
+ * Append the record to the history, taking ownership of it.  The
+ * file is queried and written in a thread, as the source may well
+ * be on a slow network share.
+ */
+void
+nsc_history_add (NscHistoryRecord *record)
+{
+	GTask *task;
+
+	g_return_if_fail (record != NULL);
+	g_return_if_fail (record->src != NULL);
+
+	task = g_task_new (NULL, NULL, NULL, NULL);
+	g_task_set_task_data (task, record,
+			      (GDestroyNotify) nsc_history_record_free);
+	g_task_run_in_thread (task, write_thread);
+	g_object_unref (task);
+}
+
+void
+nsc_history_record_free (NscHistoryRecord *record)
+{
+	if (record == NULL)
+		return;
+
+	g_clear_object (&record->src);
+	g_clear_object (&record->sink);
+	g_free (record->target);
+	g_free (record->target_type);
+	g_free (record->preset);
+	g_free (record->pcm_md5);
+	g_free (record->error);
+	g_free (record);
+}
+
+/**
+ * Call func with each record in the history, oldest first.  Lines
+ * that can't be parsed, e.g. one cut short by a crash, are skipped.
+ * A missing history has no records.
+ */
+gboolean
+nsc_history_foreach (NscHistoryFunc   func,
+		     gpointer         user_data,
+		     GError         **error)
+{
+	GFile            *file;
+	GFileInputStream *stream;
+	GDataInputStream *data;
+	GError           *err = NULL;
+	gchar            *path, *line;
+
+	g_return_val_if_fail (func != NULL, FALSE);
+
+	path = nsc_history_get_path ();
+	file = g_file_new_for_path (path);
+	g_free (path);
+
+	stream = g_file_read (file, NULL, &err);
+	g_object_unref (file);
+	if (stream == NULL) {
+		if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_NOT_FOUND)) {
+			g_error_free (err);
+			return TRUE;
+		}
+		g_propagate_error (error, err);
+		return FALSE;
+	}
+
+	data = g_data_input_stream_new (G_INPUT_STREAM (stream));
+	g_object_unref (stream);
+
+	while ((line = g_data_input_stream_read_line (data, NULL, NULL, &err)) != NULL) {
+		GHashTable *record;
+
+		record = parse_record (line);
+		if (record != NULL) {
+			func (record, user_data);
+			g_hash_table_unref (record);
+		}
+		g_free (line);
+	}
+
+	g_object_unref (data);
+
+	if (err != NULL) {
+		g_propagate_error (error, err);
+		return FALSE;
+	}
+
+	return TRUE;
+}
@@ -0,0 +1,80 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-history.h
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+#ifndef NSC_HISTORY_H
+#define NSC_HISTORY_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/*
+ * What one run of a job cost.  The sizes and the source format are
+ * filled in when the record is written, off the main thread.
+ */
+typedef struct {
+	GFile   *src;
+	GFile   *sink;
+
+	/* Encoding profile name and media type, and encoder preset */
+	gchar   *target;
+	gchar   *target_type;
+	gchar   *preset;
+
+	/* Only a part of src was converted, e.g. a track of a disc image */
+	gboolean part;
+
+	/* Seconds of audio, wall clock and streaming thread CPU time in
+	 * microseconds, and the converting process' peak RSS in KiB */
+	gint     duration;
+	gint64   wall_time;
+	guint64  cpu_time;
+	guint64  peak_rss;
+
+	/* MD5 of the audio given to the encoder, NULL if not known */
+	gchar   *pcm_md5;
+
+	/* Jobs running at the same time, this one included */
+	guint    concurrency;
+	guint    attempt;
+
+	/* NULL if the job succeeded */
+	gchar   *error;
+	gboolean retried;
+} NscHistoryRecord;
+
+/* Called with each record as a table of field name to value string */
+typedef void (*NscHistoryFunc) (GHashTable *record,
+				gpointer    user_data);
+
+gchar   *nsc_history_get_path       (void);
+void     nsc_history_add            (NscHistoryRecord  *record);
+void     nsc_history_record_free    (NscHistoryRecord  *record);
+gboolean nsc_history_foreach        (NscHistoryFunc     func,
+				     gpointer           user_data,
+				     GError           **error);
+
+G_END_DECLS
+
+#endif /* NSC_HISTORY_H */
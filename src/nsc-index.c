@@ -0,0 +1,644 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-index.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+/*
+ * An index of what GstDiscoverer found out about the audio files
+ * that were selected, so that the menu, the scheduler and the ETA
+ * know a file's duration and format without opening it.
+ *
+ * Entries are keyed by inode, size and modification time, which a
+ * file keeps when it is renamed and loses when it is rewritten.  The
+ * index is loaded from $XDG_CACHE_HOME/caja-sound-converter/media-index
+ * once, in a thread, and written back a little after it changes.
+ *
+ * Looking a file up is a hash table lookup and nothing more, so it
+ * can be done for every file of a huge selection.  That is only
+ * safe for files known to be unchanged: an entry is used once it
+ * has been checked against its file since the index was loaded, and
+ * as long as a GFileMonitor watches the file's folder.  Anything else
+ * is queued with nsc_index_scan() and checked, or discovered, in the
+ * background, one file at a time.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <gst/gst.h>
+#include <gst/pbutils/pbutils.h>
+
+#include "nsc-index.h"
+
+#define INDEX_HEADER "# caja-sound-converter media index 1"
+
+#define INDEX_ATTRIBUTES			\
+	G_FILE_ATTRIBUTE_UNIX_INODE ","		\
+	G_FILE_ATTRIBUTE_STANDARD_SIZE ","	\
+	G_FILE_ATTRIBUTE_TIME_MODIFIED
+
+/* Seconds GstDiscoverer may take over a file */
+#define DISCOVER_TIMEOUT 10
+
+/* Seconds to wait for more changes before writing the index */
+#define SAVE_DELAY 10
+
+/* Past these, files are no longer added, or folders watched */
+#define MAX_ENTRIES  200000
+#define MAX_MONITORS 512
+
+typedef struct {
+	guint64 inode;
+	guint64 size;
+	guint64 mtime;
+} Key;
+
+typedef struct {
+	Key           key;
+	gchar        *path;
+	NscMediaInfo  info;
+	/* Checked against the file, and its folder watched since */
+	gboolean      fresh;
+} Entry;
+
+/* Key to Entry, owning the entries */
+static GHashTable    *entries = NULL;
+
+/* Path to the Entry last seen there */
+static GHashTable    *paths = NULL;
+
+/* Folder path to its GFileMonitor */
+static GHashTable    *monitors = NULL;
+
+/* Paths waiting to be scanned, and the set of them */
+static GQueue        *pending = NULL;
+static GHashTable    *queued = NULL;
+
+static GstDiscoverer *discoverer = NULL;
+static gboolean       loaded = FALSE;
+static guint          save_id = 0;
+
+/* The file being scanned, if any */
+static gchar         *scan_path = NULL;
+static Key            scan_key;
+
+static void scan_next (void);
+
+/*
+ * Private Methods
+ */
+static guint
+key_hash (gconstpointer data)
+{
+	const Key *key = data;
+
+	return (guint) (key->inode ^ (key->inode >> 32) ^
+			key->size ^ (key->mtime * 31));
+}
+
+static gboolean
+key_equal (gconstpointer a,
+	   gconstpointer b)
+{
+	const Key *ka = a, *kb = b;
+
+	return ka->inode == kb->inode &&
+		ka->size == kb->size &&
+		ka->mtime == kb->mtime;
+}
+
+static void
+entry_free (Entry *entry)
+{
+	g_free (entry->path);
+	g_free (entry);
+}
+
+static gchar *
+get_index_path (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+				 "caja-sound-converter",
+				 "media-index",
+				 NULL);
+}
+
+static void
+remove_entry (Entry *entry)
+{
+	if (g_hash_table_lookup (paths, entry->path) == entry)
+		g_hash_table_remove (paths, entry->path);
+
+	/* This frees it */
+	g_hash_table_remove (entries, &entry->key);
+}
+
+static void
+add_entry (Entry *entry)
+{
+	Entry *old;
+
+	/* The file at this path had other contents before */
+	old = g_hash_table_lookup (paths, entry->path);
+	if (old != NULL && old != entry)
+		remove_entry (old);
+
+	/* Or these contents were at another path */
+	old = g_hash_table_lookup (entries, &entry->key);
+	if (old != NULL && old != entry)
+		remove_entry (old);
+
+	if (old != entry)
+		g_hash_table_insert (entries, &entry->key, entry);
+	g_hash_table_replace (paths, entry->path, entry);
+}
+
+static void
+forget_path (const gchar *path)
+{
+	Entry *entry;
+
+	entry = g_hash_table_lookup (paths, path);
+	if (entry != NULL)
+		remove_entry (entry);
+}
+
+/*
+ * Entries are written as one line each, with the fields separated
+ * by tabs: inode, size, mtime, duration in nanoseconds or -1, rate,
+ * channels, 1 if the file has audio, the codec or "-", and the
+ * path, escaped.
+ */
+static Entry *
+parse_entry (const gchar *line)
+{
+	Entry  *entry;
+	gchar **fields;
+	gint64  duration;
+
+	fields = g_strsplit (line, "\t", 9);
+	if (g_strv_length (fields) != 9) {
+		g_strfreev (fields);
+		return NULL;
+	}
+
+	entry = g_new0 (Entry, 1);
+	entry->key.inode = g_ascii_strtoull (fields[0], NULL, 10);
+	entry->key.size = g_ascii_strtoull (fields[1], NULL, 10);
+	entry->key.mtime = g_ascii_strtoull (fields[2], NULL, 10);
+	duration = g_ascii_strtoll (fields[3], NULL, 10);
+	entry->info.duration = duration < 0 ? GST_CLOCK_TIME_NONE : (GstClockTime) duration;
+	entry->info.rate = atoi (fields[4]);
+	entry->info.channels = atoi (fields[5]);
+	entry->info.audio = atoi (fields[6]) != 0;
+	entry->info.codec = strcmp (fields[7], "-") == 0 ? NULL : g_intern_string (fields[7]);
+	entry->path = g_strcompress (fields[8]);
+
+	g_strfreev (fields);
+
+	return entry;
+}
+
+static void
+format_entry (GString *out, Entry *entry)
+{
+	gchar *path;
+
+	path = g_strescape (entry->path, NULL);
+	g_string_append_printf (out,
+				"%" G_GUINT64_FORMAT "\t%" G_GUINT64_FORMAT
+				"\t%" G_GUINT64_FORMAT "\t%" G_GINT64_FORMAT
+				"\t%d\t%d\t%d\t%s\t%s\n",
+				entry->key.inode,
+				entry->key.size,
+				entry->key.mtime,
+				GST_CLOCK_TIME_IS_VALID (entry->info.duration) ?
+				(gint64) entry->info.duration : (gint64) -1,
+				entry->info.rate,
+				entry->info.channels,
+				entry->info.audio ? 1 : 0,
+				entry->info.codec ? entry->info.codec : "-",
+				path);
+	g_free (path);
+}
+
+static void
+load_thread (GTask        *task,
+	     gpointer      source_object,
+	     gpointer      task_data,
+	     GCancellable *cancellable)
+{
+	GPtrArray *loaded_entries;
+	gchar     *path, *contents = NULL;
+	gchar    **lines;
+	guint      i;
+
+	loaded_entries = g_ptr_array_new ();
+
+	path = get_index_path ();
+	if (g_file_get_contents (path, &contents, NULL, NULL) &&
+	    g_str_has_prefix (contents, INDEX_HEADER "\n")) {
+		lines = g_strsplit (contents + strlen (INDEX_HEADER "\n"), "\n", -1);
+		for (i = 0; lines[i] != NULL; i++) {
+			Entry *entry = parse_entry (lines[i]);
+
+			if (entry != NULL)
+				g_ptr_array_add (loaded_entries, entry);
+		}
+		g_strfreev (lines);
+	}
+	g_free (contents);
+	g_free (path);
+
+	g_task_return_pointer (task, loaded_entries, NULL);
+}
+
+static void
+load_done_cb (GObject      *source,
+	      GAsyncResult *result,
+	      gpointer      user_data)
+{
+	GPtrArray *loaded_entries;
+	guint      i;
+
+	loaded_entries = g_task_propagate_pointer (G_TASK (result), NULL);
+	for (i = 0; i < loaded_entries->len; i++)
+		add_entry (g_ptr_array_index (loaded_entries, i));
+	g_ptr_array_free (loaded_entries, TRUE);
+
+	loaded = TRUE;
+	scan_next ();
+}
+
+static void
+save_done_cb (GObject      *source,
+	      GAsyncResult *result,
+	      gpointer      user_data)
+{
+	GError *error = NULL;
+
+	if (!g_file_replace_contents_finish (G_FILE (source), result, NULL, &error)) {
+		g_warning ("Unable to write the media index: %s", error->message);
+		g_error_free (error);
+	}
+
+	g_string_free (user_data, TRUE);
+}
+
+static gboolean
+save_cb (gpointer user_data)
+{
+	GHashTableIter  iter;
+	GString        *out;
+	GFile          *file;
+	Entry          *entry;
+	gchar          *path, *dir;
+
+	save_id = 0;
+
+	out = g_string_new (INDEX_HEADER "\n");
+	g_hash_table_iter_init (&iter, entries);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+		format_entry (out, entry);
+
+	path = get_index_path ();
+	dir = g_path_get_dirname (path);
+	g_mkdir_with_parents (dir, 0700);
+
+	/* The buffer has to live until the write is done */
+	file = g_file_new_for_path (path);
+	g_file_replace_contents_async (file, out->str, out->len, NULL, FALSE,
+				       G_FILE_CREATE_PRIVATE, NULL,
+				       save_done_cb, out);
+
+	g_object_unref (file);
+	g_free (dir);
+	g_free (path);
+
+	return FALSE;
+}
+
+static void
+schedule_save (void)
+{
+	if (save_id == 0)
+		save_id = g_timeout_add_seconds (SAVE_DELAY, save_cb, NULL);
+}
+
+static void
+queue_scan (const gchar *path)
+{
+	if (g_hash_table_contains (queued, path))
+		return;
+
+	g_hash_table_add (queued, g_strdup (path));
+	g_queue_push_tail (pending, g_strdup (path));
+	scan_next ();
+}
+
+/*
+ * Whatever happens to a file in a watched folder, its entry can't
+ * be trusted until the file has been looked at again.
+ */
+static void
+monitor_changed_cb (GFileMonitor      *monitor,
+		    GFile             *file,
+		    GFile             *other_file,
+		    GFileMonitorEvent  event,
+		    gpointer           user_data)
+{
+	Entry *entry;
+	gchar *path;
+
+	path = g_file_get_path (file);
+	entry = path ? g_hash_table_lookup (paths, path) : NULL;
+	if (entry == NULL) {
+		g_free (path);
+		return;
+	}
+
+	switch (event) {
+	case G_FILE_MONITOR_EVENT_DELETED:
+	case G_FILE_MONITOR_EVENT_MOVED:
+		forget_path (path);
+		schedule_save ();
+		break;
+	case G_FILE_MONITOR_EVENT_CHANGED:
+		/* More is coming; it is scanned once it is done */
+		entry->fresh = FALSE;
+		break;
+	default:
+		entry->fresh = FALSE;
+		queue_scan (path);
+		break;
+	}
+
+	g_free (path);
+}
+
+/* Returns whether the folder of path is watched */
+static gboolean
+watch_folder (const gchar *path)
+{
+	GFileMonitor *monitor;
+	GFile        *dir;
+	gchar        *dir_path;
+
+	dir_path = g_path_get_dirname (path);
+	if (g_hash_table_contains (monitors, dir_path)) {
+		g_free (dir_path);
+		return TRUE;
+	}
+
+	if (g_hash_table_size (monitors) >= MAX_MONITORS) {
+		g_free (dir_path);
+		return FALSE;
+	}
+
+	dir = g_file_new_for_path (dir_path);
+	monitor = g_file_monitor_directory (dir, G_FILE_MONITOR_NONE, NULL, NULL);
+	g_object_unref (dir);
+
+	if (monitor == NULL) {
+		g_free (dir_path);
+		return FALSE;
+	}
+
+	g_signal_connect (monitor, "changed",
+			  G_CALLBACK (monitor_changed_cb), NULL);
+	g_hash_table_insert (monitors, dir_path, monitor);
+
+	return TRUE;
+}
+
+static void
+scan_done (void)
+{
+	g_hash_table_remove (queued, scan_path);
+	g_free (scan_path);
+	scan_path = NULL;
+
+	scan_next ();
+}
+
+static void
+discovered_cb (GstDiscoverer     *disc,
+	       GstDiscovererInfo *info,
+	       GError            *error,
+	       gpointer           user_data)
+{
+	GList *streams;
+	Entry *entry;
+
+	/* Files it can't make sense of are just left out */
+	if (gst_discoverer_info_get_result (info) != GST_DISCOVERER_OK ||
+	    g_hash_table_size (entries) >= MAX_ENTRIES) {
+		scan_done ();
+		return;
+	}
+
+	entry = g_new0 (Entry, 1);
+	entry->key = scan_key;
+	entry->path = g_strdup (scan_path);
+	entry->info.duration = gst_discoverer_info_get_duration (info);
+
+	streams = gst_discoverer_info_get_audio_streams (info);
+	if (streams != NULL) {
+		GstDiscovererAudioInfo *audio = streams->data;
+		GstCaps                *caps;
+
+		entry->info.audio = TRUE;
+		entry->info.rate = gst_discoverer_audio_info_get_sample_rate (audio);
+		entry->info.channels = gst_discoverer_audio_info_get_channels (audio);
+
+		caps = gst_discoverer_stream_info_get_caps (GST_DISCOVERER_STREAM_INFO (audio));
+		if (caps != NULL) {
+			if (!gst_caps_is_empty (caps))
+				entry->info.codec = g_intern_string (gst_structure_get_name (gst_caps_get_structure (caps, 0)));
+			gst_caps_unref (caps);
+		}
+	}
+	gst_discoverer_stream_info_list_free (streams);
+
+	add_entry (entry);
+	entry->fresh = watch_folder (entry->path);
+	schedule_save ();
+
+	scan_done ();
+}
+
+static void
+query_info_cb (GObject      *source,
+	       GAsyncResult *result,
+	       gpointer      user_data)
+{
+	GFileInfo *info;
+	Entry     *entry;
+	gchar     *uri;
+
+	info = g_file_query_info_finish (G_FILE (source), result, NULL);
+	if (info == NULL) {
+		forget_path (scan_path);
+		scan_done ();
+		return;
+	}
+
+	scan_key.inode = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE);
+	scan_key.size = g_file_info_get_size (info);
+	scan_key.mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	g_object_unref (info);
+
+	/* Known already, maybe under another name */
+	entry = g_hash_table_lookup (entries, &scan_key);
+	if (entry != NULL) {
+		if (strcmp (entry->path, scan_path) != 0) {
+			if (g_hash_table_lookup (paths, entry->path) == entry)
+				g_hash_table_remove (paths, entry->path);
+			g_free (entry->path);
+			entry->path = g_strdup (scan_path);
+			add_entry (entry);
+			schedule_save ();
+		}
+		entry->fresh = watch_folder (entry->path);
+		scan_done ();
+		return;
+	}
+
+	if (discoverer == NULL) {
+		discoverer = gst_discoverer_new (DISCOVER_TIMEOUT * GST_SECOND, NULL);
+		if (discoverer == NULL) {
+			scan_done ();
+			return;
+		}
+		g_signal_connect (discoverer, "discovered",
+				  G_CALLBACK (discovered_cb), NULL);
+		gst_discoverer_start (discoverer);
+	}
+
+	uri = g_file_get_uri (G_FILE (source));
+	if (!gst_discoverer_discover_uri_async (discoverer, uri))
+		scan_done ();
+	g_free (uri);
+}
+
+static void
+scan_next (void)
+{
+	GFile *file;
+
+	if (!loaded || scan_path != NULL || g_queue_is_empty (pending))
+		return;
+
+	scan_path = g_queue_pop_head (pending);
+
+	file = g_file_new_for_path (scan_path);
+	g_file_query_info_async (file, INDEX_ATTRIBUTES,
+				 G_FILE_QUERY_INFO_NONE, G_PRIORITY_LOW,
+				 NULL, query_info_cb, NULL);
+	g_object_unref (file);
+}
+
+static void
+ensure_index (void)
+{
+	GTask *task;
+
+	if (entries != NULL)
+		return;
+
+	entries = g_hash_table_new_full (key_hash, key_equal,
+					 NULL, (GDestroyNotify) entry_free);
+	paths = g_hash_table_new (g_str_hash, g_str_equal);
+	monitors = g_hash_table_new_full (g_str_hash, g_str_equal,
+					  g_free, g_object_unref);
+	pending = g_queue_new ();
+	queued = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	task = g_task_new (NULL, NULL, load_done_cb, NULL);
+	g_task_run_in_thread (task, load_thread);
+	g_object_unref (task);
+}
+
+/*
+ * Public Methods
+ */
+
+/**
+ * Look up what is known about a local file, without any I/O.
+ * Returns FALSE if the file isn't in the index, or may have
+ * changed since it was last looked at.
+ */
+gboolean
+nsc_index_lookup (const gchar  *uri,
+		  NscMediaInfo *info)
+{
+	Entry *entry;
+	gchar *path;
+
+	g_return_val_if_fail (uri != NULL, FALSE);
+	g_return_val_if_fail (info != NULL, FALSE);
+
+	ensure_index ();
+
+	path = g_filename_from_uri (uri, NULL, NULL);
+	if (path == NULL)
+		return FALSE;
+
+	entry = g_hash_table_lookup (paths, path);
+	g_free (path);
+
+	if (entry == NULL || !entry->fresh)
+		return FALSE;
+
+	*info = entry->info;
+
+	return TRUE;
+}
+
+/**
+ * Queue a local file to be checked against its entry, or added to
+ * the index, in the background.  Does nothing for a file whose
+ * entry can be used as it is.
+ */
+void
+nsc_index_scan (const gchar *uri)
+{
+	Entry *entry;
+	gchar *path;
+
+	g_return_if_fail (uri != NULL);
+
+	ensure_index ();
+
+	path = g_filename_from_uri (uri, NULL, NULL);
+	if (path == NULL)
+		return;
+
+	entry = g_hash_table_lookup (paths, path);
+	if (entry == NULL || !entry->fresh)
+		queue_scan (path);
+
+	g_free (path);
+}
@@ -0,0 +1,51 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-index.h
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+#ifndef NSC_INDEX_H
+#define NSC_INDEX_H
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* What is known about a file's audio */
+typedef struct {
+	/* GST_CLOCK_TIME_NONE if not known */
+	GstClockTime  duration;
+	gint          rate;
+	gint          channels;
+	/* The media type of the audio stream, e.g. "audio/mpeg" */
+	const gchar  *codec;
+	/* FALSE if the file turned out to have no audio stream */
+	gboolean      audio;
+} NscMediaInfo;
+
+gboolean nsc_index_lookup (const gchar  *uri,
+			   NscMediaInfo *info);
+void     nsc_index_scan   (const gchar  *uri);
+
+G_END_DECLS
+
+#endif /* NSC_INDEX_H */
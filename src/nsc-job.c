@@ -0,0 +1,61 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-job.c
+ * 
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ * 
+ */
+
+#include <config.h>
+
+#include "nsc-job.h"
+
+/**
+ * Create a job converting all of src to sink.  The job
+ * takes its own references to both files.
+ */
+NscJob *
+nsc_job_new (GFile *src, GFile *sink)
+{
+	NscJob *job;
+
+	g_return_val_if_fail (G_IS_FILE (src), NULL);
+	g_return_val_if_fail (G_IS_FILE (sink), NULL);
+
+	job = g_new0 (NscJob, 1);
+	job->src = g_object_ref (src);
+	job->sink = g_object_ref (sink);
+	job->start = 0;
+	job->stop = GST_CLOCK_TIME_NONE;
+
+	return job;
+}
+
+void
+nsc_job_free (NscJob *job)
+{
+	if (job == NULL)
+		return;
+
+	g_object_unref (job->src);
+	g_object_unref (job->sink);
+	if (job->tags)
+		gst_tag_list_unref (job->tags);
+	g_free (job);
+}
@@ -0,0 +1,60 @@
+/*
+ *  nsc-job.h
+ * 
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ * 
+ */
+
+#ifndef NSC_JOB_H
+#define NSC_JOB_H
+
+#include <gio/gio.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/*
+ * One file to convert, or one part of a file when a disc
+ * image is split along its cue sheet.
+ */
+typedef struct {
+	GFile        *src;
+	GFile        *sink;
+
+	/* The part of src to convert, 0 and GST_CLOCK_TIME_NONE for all of it */
+	GstClockTime  start;
+	GstClockTime  stop;
+
+	/* Tags to write to sink in place of the ones in src, or NULL */
+	GstTagList   *tags;
+
+	/* Set by the batch when sink is one part of a longer file */
+	gpointer      chunks;
+
+	/* Failed attempts so far, when the errors looked transient */
+	guint         attempts;
+} NscJob;
+
+NscJob *nsc_job_new  (GFile  *src,
+		      GFile  *sink);
+void    nsc_job_free (NscJob *job);
+
+G_END_DECLS
+
+#endif /* NSC_JOB_H */
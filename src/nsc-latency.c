@@ -0,0 +1,207 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-latency.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+#include <config.h>
+
+#include "nsc-latency.h"
+
+/*
+ * Samples go into power of two buckets of microseconds, so the
+ * percentiles are upper bounds within a factor of two, which is
+ * plenty to tell a regression from noise.
+ */
+#define N_BUCKETS 32
+
+/* Past this many samples, log every this many */
+#define REPORT_EVERY 1000
+
+typedef struct {
+	guint   count;
+	gint64  max;
+	guint   buckets[N_BUCKETS];
+} Probe;
+
+/* Probe name to Probe, NULL if disabled */
+static GHashTable *probes = NULL;
+
+G_LOCK_DEFINE_STATIC (probes);
+
+/*
+ * Private Methods
+ */
+static gboolean
+latency_enabled (void)
+{
+	static gsize enabled = 0;
+
+	if (g_once_init_enter (&enabled)) {
+		gboolean on = g_getenv ("NSC_LATENCY") != NULL;
+
+		if (on)
+			probes = g_hash_table_new_full (g_str_hash, g_str_equal,
+							NULL, g_free);
+		g_once_init_leave (&enabled, on ? 2 : 1);
+	}
+
+	return enabled == 2;
+}
+
+static guint
+bucket_for (gint64 usecs)
+{
+	guint bucket = 0;
+
+	while (usecs > 1 && bucket < N_BUCKETS - 1) {
+		usecs >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+/* The upper bound of the bucket holding the given fraction of samples */
+static gint64
+percentile (const Probe *probe, gdouble fraction)
+{
+	guint rank, seen = 0, i;
+
+	rank = MAX (1, (guint) (probe->count * fraction + 0.5));
+	for (i = 0; i < N_BUCKETS; i++) {
+		seen += probe->buckets[i];
+		if (seen >= rank)
+			return MIN ((gint64) 1 << (i + 1), probe->max);
+	}
+
+	return probe->max;
+}
+
+static void
+report (const gchar *name, const Probe *probe)
+{
+	g_message ("latency %s: %u samples, p50 %" G_GINT64_FORMAT
+		   " us, p90 %" G_GINT64_FORMAT " us, p99 %" G_GINT64_FORMAT
+		   " us, max %" G_GINT64_FORMAT " us",
+		   name, probe->count,
+		   percentile (probe, 0.5),
+		   percentile (probe, 0.9),
+		   percentile (probe, 0.99),
+		   probe->max);
+}
+
+/*
+ * Public Methods
+ */
+
+/**
+ * The time to pass to nsc_latency_record(), or 0 if the probes
+ * are disabled.
+ */
+gint64
+nsc_latency_start (void)
+{
+	return latency_enabled () ? g_get_monotonic_time () : 0;
+}
+
+/**
+ * Add the time since start to the probe's samples.  The probe name
+ * must be a string literal, as it is kept.  The percentiles are
+ * logged at every power of two samples, then every REPORT_EVERY.
+ */
+void
+nsc_latency_record (const gchar *probe_name, gint64 start)
+{
+	Probe  *probe;
+	gint64  usecs;
+
+	if (start == 0 || !latency_enabled ())
+		return;
+
+	usecs = g_get_monotonic_time () - start;
+
+	G_LOCK (probes);
+
+	probe = g_hash_table_lookup (probes, probe_name);
+	if (probe == NULL) {
+		probe = g_new0 (Probe, 1);
+		g_hash_table_insert (probes, (gpointer) probe_name, probe);
+	}
+
+	probe->count++;
+	probe->max = MAX (probe->max, usecs);
+	probe->buckets[bucket_for (usecs)]++;
+
+	if (probe->count % REPORT_EVERY == 0 ||
+	    (probe->count < REPORT_EVERY &&
+	     (probe->count & (probe->count - 1)) == 0))
+		report (probe_name, probe);
+
+	G_UNLOCK (probes);
+}
+
+/**
+ * The percentiles of the probe's samples so far, in microseconds.
+ * Returns FALSE if the probes are disabled or it has none.
+ */
+gboolean
+nsc_latency_get (const gchar *probe_name,
+		 guint       *count,
+		 gint64      *p50,
+		 gint64      *p90,
+		 gint64      *p99,
+		 gint64      *max)
+{
+	Probe *probe;
+
+	if (!latency_enabled ())
+		return FALSE;
+
+	G_LOCK (probes);
+
+	probe = g_hash_table_lookup (probes, probe_name);
+	if (probe != NULL) {
+		*count = probe->count;
+		*p50 = percentile (probe, 0.5);
+		*p90 = percentile (probe, 0.9);
+		*p99 = percentile (probe, 0.99);
+		*max = probe->max;
+	}
+
+	G_UNLOCK (probes);
+
+	return probe != NULL;
+}
+
+/**
+ * Drop the samples of every probe.
+ */
+void
+nsc_latency_reset (void)
+{
+	if (!latency_enabled ())
+		return;
+
+	G_LOCK (probes);
+	g_hash_table_remove_all (probes);
+	G_UNLOCK (probes);
+}
@@ -0,0 +1,56 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-latency.h
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+#ifndef NSC_LATENCY_H
+#define NSC_LATENCY_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Latency probes for the code Caja waits on.  They cost nothing
+ * unless NSC_LATENCY is set in the environment, in which case each
+ * probe's percentiles are logged as samples come in.
+ *
+ *	gint64 start = nsc_latency_start ();
+ *	...
+ *	nsc_latency_record ("create_new_file", start);
+ */
+gint64 nsc_latency_start  (void);
+void   nsc_latency_record (const gchar *probe,
+			   gint64       start);
+
+/* For the benchmarks */
+gboolean nsc_latency_get   (const gchar *probe,
+			    guint       *count,
+			    gint64      *p50,
+			    gint64      *p90,
+			    gint64      *p99,
+			    gint64      *max);
+void     nsc_latency_reset (void);
+
+G_END_DECLS
+
+#endif /* NSC_LATENCY_H */
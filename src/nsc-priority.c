@@ -0,0 +1,279 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-priority.c
+ * 
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ * 
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+#endif
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <gst/gst.h>
+
+#include "nsc-priority.h"
+
+/* Taken from linux/ioprio.h, which is not always installed */
+#define IOPRIO_CLASS_SHIFT     13
+#define IOPRIO_CLASS_IDLE      3
+#define IOPRIO_WHO_PROCESS     1
+#define IOPRIO_PRIO_VALUE(c,d) (((c) << IOPRIO_CLASS_SHIFT) | (d))
+
+/* The lowest nice value, used when SCHED_IDLE is not available */
+#define BACKGROUND_NICE        19
+
+/* cgroup v2 weights range from 1 to 10000, the default being 100 */
+#define BACKGROUND_CPU_WEIGHT  G_GUINT64_CONSTANT (20)
+#define BACKGROUND_IO_WEIGHT   G_GUINT64_CONSTANT (20)
+
+#define SYSTEMD_DBUS_NAME      "org.freedesktop.systemd1"
+#define SYSTEMD_DBUS_PATH      "/org/freedesktop/systemd1"
+#define SYSTEMD_DBUS_INTERFACE "org.freedesktop.systemd1.Manager"
+
+/*
+ * A task pool that runs each task on a thread of its own, which
+ * lowers itself before the task starts and exits when it ends.  The
+ * default pool takes its threads from GLib's shared pool, where any
+ * other GThreadPool in the process, GIO's included, may pick them up
+ * again later, and raising a thread back out of SCHED_IDLE and nice
+ * 19 takes privileges the desktop session doesn't have.
+ */
+typedef GstTaskPool      BackgroundPool;
+typedef GstTaskPoolClass BackgroundPoolClass;
+
+typedef struct {
+	GstTaskPoolFunction func;
+	gpointer            user_data;
+} BackgroundTask;
+
+static GType background_pool_get_type (void);
+
+G_DEFINE_TYPE (BackgroundPool, background_pool, GST_TYPE_TASK_POOL);
+
+/**
+ * Drop the calling thread to the idle CPU scheduling class and
+ * the idle I/O priority class, so that it only gets the time the
+ * rest of the desktop does not want.  On Linux all of these are
+ * per-thread attributes, so the rest of the process is unaffected.
+ * As there is no way back, it is only for threads that exit when
+ * their conversion ends.
+ *
+ * Returns TRUE if at least the CPU priority could be lowered.
+ */
+gboolean
+nsc_priority_lower_current_thread (void)
+{
+	gboolean lowered = FALSE;
+#ifdef SCHED_IDLE
+	struct sched_param param;
+	int                ret;
+
+	memset (&param, 0, sizeof (param));
+	ret = pthread_setschedparam (pthread_self (), SCHED_IDLE, &param);
+	if (ret == 0)
+		lowered = TRUE;
+	else
+		g_debug ("Could not set SCHED_IDLE: %s", g_strerror (ret));
+#endif
+
+#if defined (HAVE_SYS_RESOURCE_H) && defined (HAVE_SYS_SYSCALL_H) && defined (SYS_gettid)
+	/*
+	 * Even under SCHED_IDLE the nice value is still used to
+	 * weigh threads against each other, so lower that too.
+	 */
+	if (setpriority (PRIO_PROCESS, syscall (SYS_gettid), BACKGROUND_NICE) == 0)
+		lowered = TRUE;
+	else
+		g_debug ("Could not renice thread: %s", g_strerror (errno));
+#endif
+
+#if defined (HAVE_SYS_SYSCALL_H) && defined (SYS_ioprio_set)
+	/* A 'who' of zero means the calling thread */
+	if (syscall (SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+		     IOPRIO_PRIO_VALUE (IOPRIO_CLASS_IDLE, 0)) != 0)
+		g_debug ("Could not set idle I/O priority: %s", g_strerror (errno));
+#endif
+
+	return lowered;
+}
+
+static gpointer
+background_thread (gpointer data)
+{
+	BackgroundTask *task = data;
+
+	nsc_priority_lower_current_thread ();
+	task->func (task->user_data);
+	g_free (task);
+
+	return NULL;
+}
+
+/* Nothing to set up, as there is no shared GThreadPool */
+static void
+background_pool_prepare (GstTaskPool *pool, GError **error)
+{
+}
+
+static void
+background_pool_cleanup (GstTaskPool *pool)
+{
+}
+
+static gpointer
+background_pool_push (GstTaskPool         *pool,
+		      GstTaskPoolFunction  func,
+		      gpointer             user_data,
+		      GError             **error)
+{
+	BackgroundTask *task;
+	GThread        *thread;
+
+	task = g_new (BackgroundTask, 1);
+	task->func = func;
+	task->user_data = user_data;
+
+	thread = g_thread_try_new ("nsc-background", background_thread,
+				   task, error);
+	if (thread == NULL)
+		g_free (task);
+
+	return thread;
+}
+
+static void
+background_pool_join (GstTaskPool *pool, gpointer id)
+{
+	if (id != NULL)
+		g_thread_join (id);
+}
+
+static void
+background_pool_class_init (BackgroundPoolClass *klass)
+{
+	klass->prepare = background_pool_prepare;
+	klass->cleanup = background_pool_cleanup;
+	klass->push    = background_pool_push;
+	klass->join    = background_pool_join;
+}
+
+static void
+background_pool_init (BackgroundPool *pool)
+{
+}
+
+/**
+ * The task pool to give the streaming tasks of a background
+ * conversion, from the stream status CREATE message.  Its threads
+ * run at idle priority and are never reused for anything else.
+ */
+GstTaskPool *
+nsc_priority_get_background_pool (void)
+{
+	static gsize pool = 0;
+
+	if (g_once_init_enter (&pool)) {
+		GstTaskPool *new_pool;
+
+		new_pool = g_object_new (background_pool_get_type (), NULL);
+		gst_object_ref_sink (new_pool);
+		g_once_init_leave (&pool, (gsize) new_pool);
+	}
+
+	return (GstTaskPool *) pool;
+}
+
+static void
+start_transient_unit_cb (GObject      *source,
+			 GAsyncResult *result,
+			 gpointer      user_data)
+{
+	GVariant *ret;
+	GError   *error = NULL;
+
+	ret = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source),
+					     result, &error);
+	if (ret == NULL) {
+		/* Not fatal, the threads still run at idle priority */
+		g_debug ("Could not create a cgroup scope: %s", error->message);
+		g_error_free (error);
+		return;
+	}
+
+	g_variant_unref (ret);
+}
+
+/**
+ * Ask the user's systemd instance to move the whole process into
+ * a transient cgroup v2 scope with low CPU and I/O weights.  This
+ * is only meant for a process that does nothing but convert, since
+ * every thread in it ends up sharing the reduced weights.
+ */
+void
+nsc_priority_enter_scope (GDBusConnection *connection)
+{
+	GVariantBuilder  properties;
+	GVariantBuilder  pids;
+	gchar           *name;
+
+	g_return_if_fail (G_IS_DBUS_CONNECTION (connection));
+
+	name = g_strdup_printf ("caja-sound-converter-%d.scope", (int) getpid ());
+
+	g_variant_builder_init (&pids, G_VARIANT_TYPE ("au"));
+	g_variant_builder_add (&pids, "u", (guint32) getpid ());
+
+	g_variant_builder_init (&properties, G_VARIANT_TYPE ("a(sv)"));
+	g_variant_builder_add (&properties, "(sv)", "Description",
+			       g_variant_new_string ("Caja Sound Converter background conversions"));
+	g_variant_builder_add (&properties, "(sv)", "PIDs",
+			       g_variant_builder_end (&pids));
+	g_variant_builder_add (&properties, "(sv)", "CPUWeight",
+			       g_variant_new_uint64 (BACKGROUND_CPU_WEIGHT));
+	g_variant_builder_add (&properties, "(sv)", "IOWeight",
+			       g_variant_new_uint64 (BACKGROUND_IO_WEIGHT));
+
+	g_dbus_connection_call (connection,
+				SYSTEMD_DBUS_NAME,
+				SYSTEMD_DBUS_PATH,
+				SYSTEMD_DBUS_INTERFACE,
+				"StartTransientUnit",
+				g_variant_new ("(ssa(sv)a(sa(sv)))",
+					       name, "fail", &properties, NULL),
+				G_VARIANT_TYPE ("(o)"),
+				G_DBUS_CALL_FLAGS_NO_AUTO_START,
+				-1,
+				NULL,
+				start_transient_unit_cb,
+				NULL);
+	g_free (name);
+}
@@ -0,0 +1,39 @@
+/*
+ *  nsc-priority.h
+ * 
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ * 
+ */
+
+#ifndef NSC_PRIORITY_H
+#define NSC_PRIORITY_H
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+gboolean     nsc_priority_lower_current_thread (void);
+GstTaskPool *nsc_priority_get_background_pool  (void);
+void         nsc_priority_enter_scope          (GDBusConnection *connection);
+
+G_END_DECLS
+
+#endif /* NSC_PRIORITY_H */
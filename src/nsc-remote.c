@@ -0,0 +1,612 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-remote.c
+ * 
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ * 
+ */
+
+#include <config.h>
+
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <gio/gio.h>
+
+#include "nsc-dbus.h"
+#include "nsc-error.h"
+#include "nsc-remote.h"
+
+struct NscRemotePrivate {
+	GDBusConnection *connection;
+	guint            subscription_id;
+	guint            watch_id;
+
+	/* The daemon instance the jobs go to, see nsc-dbus.h */
+	const gchar     *name;
+
+	/* The daemon's id for the current job, 0 if there is none */
+	guint            job;
+
+	/* A Convert() call is waiting for its reply */
+	gboolean         pending;
+
+	/* Bumped by each Convert() call and by cancelling, so the
+	 * reply to a call that was cancelled meanwhile is recognised */
+	guint            generation;
+
+	/* The job was only prerolled, for these URIs; started says
+	 * Start() is to be called as soon as its id is known */
+	gboolean         standby;
+	gboolean         started;
+	gchar           *standby_src;
+	gchar           *standby_sink;
+};
+
+/* What a Convert() reply needs to know about its call */
+typedef struct {
+	NscRemote   *remote;
+	const gchar *name;
+	guint        generation;
+} ConvertCall;
+
+G_DEFINE_TYPE (NscRemote, nsc_remote, NSC_TYPE_GSTREAMER);
+
+#define NSC_REMOTE_GET_PRIVATE(o)                           \
+	((NscRemotePrivate *)((NSC_REMOTE(o))->priv))
+
+/*
+ * Private Methods
+ */
+static void
+cancel_job (NscRemote *remote, const gchar *name, guint job)
+{
+	NscRemotePrivate *priv = NSC_REMOTE_GET_PRIVATE (remote);
+
+	/* Nobody is interested in the reply */
+	g_dbus_connection_call (priv->connection,
+				name,
+				NSC_DBUS_PATH,
+				NSC_DBUS_INTERFACE,
+				"Cancel",
+				g_variant_new ("(u)", job),
+				NULL,
+				G_DBUS_CALL_FLAGS_NO_AUTO_START,
+				-1,
+				NULL, NULL, NULL);
+}
+
+static void
+start_job (NscRemote *remote, guint job)
+{
+	NscRemotePrivate *priv = NSC_REMOTE_GET_PRIVATE (remote);
+
+	g_dbus_connection_call (priv->connection,
+				priv->name,
+				NSC_DBUS_PATH,
+				NSC_DBUS_INTERFACE,
+				"Start",
+				g_variant_new ("(u)", job),
+				NULL,
+				G_DBUS_CALL_FLAGS_NO_AUTO_START,
+				-1,
+				NULL, NULL, NULL);
+}
+
+static void
+clear_standby (NscRemote *remote)
+{
+	NscRemotePrivate *priv = NSC_REMOTE_GET_PRIVATE (remote);
+
+	priv->standby = FALSE;
+	priv->started = FALSE;
+	g_free (priv->standby_src);
+	g_free (priv->standby_sink);
+	priv->standby_src = NULL;
+	priv->standby_sink = NULL;
+}
+
+static void
+emit_error (NscRemote *remote, GError *error)
+{
+	g_signal_emit_by_name (remote, "error", error);
+}
+
+static void
+signal_cb (GDBusConnection *connection,
+	   const gchar     *sender_name,
+	   const gchar     *object_path,
+	   const gchar     *interface_name,
+	   const gchar     *signal_name,
+	   GVariant        *parameters,
+	   gpointer         user_data)
+{
+	NscRemote        *remote = NSC_REMOTE (user_data);
+	NscRemotePrivate *priv = NSC_REMOTE_GET_PRIVATE (remote);
+	guint             job;
+
+	g_variant_get_child (parameters, 0, "u", &job);
+	if (job == 0 || job != priv->job)
+		return;
+
+	/* Handlers may well drop the last reference */
+	g_object_ref (remote);
+
+	if (g_strcmp0 (signal_name, "Duration") == 0) {
+		gint seconds;
+
+		g_variant_get (parameters, "(ui)", NULL, &seconds);
+		g_signal_emit_by_name (remote, "duration", seconds);
+	} else if (g_strcmp0 (signal_name, "Progress") == 0) {
+		gint seconds;
+
+		g_variant_get (parameters, "(ui)", NULL, &seconds);
+		g_signal_emit_by_name (remote, "progress", seconds);
+	} else if (g_strcmp0 (signal_name, "ReplayGain") == 0) {
+		gdouble gain, peak;
+
+		g_variant_get (parameters, "(udd)", NULL, &gain, &peak);
+		g_signal_emit_by_name (remote, "replaygain", gain, peak);
+	} else if (g_strcmp0 (signal_name, "Usage") == 0) {
+		guint64 cpu_time, peak_rss;
+
+		g_variant_get (parameters, "(utt)", NULL, &cpu_time, &peak_rss);
+		g_object_set (G_OBJECT (remote),
+			      "cpu-time", cpu_time,
+			      "peak-rss", peak_rss,
+			      NULL);
+	} else if (g_strcmp0 (signal_name, "Checksum") == 0) {
+		const gchar *md5;
+
+		g_variant_get (parameters, "(u&s)", NULL, &md5);
+		g_object_set (G_OBJECT (remote), "pcm-md5", md5, NULL);
+	} else if (g_strcmp0 (signal_name, "Completion") == 0) {
+		priv->job = 0;
+		g_signal_emit_by_name (remote, "completion");
+	} else if (g_strcmp0 (signal_name, "Error") == 0) {
+		const gchar *domain, *message;
+		gint         code;
+		GError      *error;
+
+		g_variant_get (parameters, "(u&si&s)", NULL,
+			       &domain, &code, &message);
+		error = g_error_new_literal (g_quark_from_string (domain),
+					     code, message);
+		priv->job = 0;
+		emit_error (remote, error);
+		g_error_free (error);
+	}
+
+	g_object_unref (remote);
+}
+
+static void
+name_vanished_cb (GDBusConnection *connection,
+		  const gchar     *name,
+		  gpointer         user_data)
+{
+	NscRemote        *remote = NSC_REMOTE (user_data);
+	NscRemotePrivate *priv = NSC_REMOTE_GET_PRIVATE (remote);
+	GError           *error;
+
+	/* Also called before the daemon has been activated */
+	if (priv->job == 0)
+		return;
+
+	priv->job = 0;
+
+	error = g_error_new (NSC_ERROR, NSC_ERROR_SERVICE_EXITED,
+			     _("The conversion service exited unexpectedly"));
+	g_object_ref (remote);
+	emit_error (remote, error);
+	g_object_unref (remote);
+	g_error_free (error);
+}
+
+static void
+convert_ready_cb (GObject      *source,
+		  GAsyncResult *result,
+		  gpointer      user_data)
+{
+	ConvertCall      *call = user_data;
+	NscRemote        *remote = call->remote;
+	NscRemotePrivate *priv = NSC_REMOTE_GET_PRIVATE (remote);
+	GVariant         *ret;
+	GError           *error = NULL;
+	gboolean          cancelled;
+	guint             job;
+
+	/* Cancelled, or replaced by another call, before the reply */
+	cancelled = call->generation != priv->generation;
+	if (!cancelled)
+		priv->pending = FALSE;
+
+	ret = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source),
+					     result, &error);
+	if (ret == NULL) {
+		if (!cancelled) {
+			clear_standby (remote);
+			g_dbus_error_strip_remote_error (error);
+			emit_error (remote, error);
+		}
+		g_error_free (error);
+	} else {
+		g_variant_get (ret, "(u)", &job);
+		g_variant_unref (ret);
+
+		if (cancelled) {
+			cancel_job (remote, call->name, job);
+		} else {
+			priv->job = job;
+			if (priv->started) {
+				clear_standby (remote);
+				start_job (remote, job);
+			}
+		}
+	}
+
+	g_object_unref (remote);
+	g_free (call);
+}
+
+static void
+drop_subscription (NscRemote *remote)
+{
+	NscRemotePrivate *priv = NSC_REMOTE_GET_PRIVATE (remote);
+
+	if (priv->name == NULL)
+		return;
+
+	g_dbus_connection_signal_unsubscribe (priv->connection,
+					      priv->subscription_id);
+	g_bus_unwatch_name (priv->watch_id);
+	priv->name = NULL;
+}
+
+/* Connects to the daemon instance for name, which is static */
+static gboolean
+ensure_connection (NscRemote    *remote,
+		   const gchar  *name,
+		   GError      **error)
+{
+	NscRemotePrivate *priv = NSC_REMOTE_GET_PRIVATE (remote);
+
+	if (priv->connection == NULL) {
+		priv->connection = g_bus_get_sync (G_BUS_TYPE_SESSION,
+						   NULL, error);
+		if (priv->connection == NULL)
+			return FALSE;
+	}
+
+	if (priv->name == name)
+		return TRUE;
+
+	/* Switching between foreground and background jobs */
+	if (priv->job != 0) {
+		cancel_job (remote, priv->name, priv->job);
+		priv->job = 0;
+	}
+	drop_subscription (remote);
+	priv->name = name;
+
+	priv->subscription_id =
+		g_dbus_connection_signal_subscribe (priv->connection,
+						    name,
+						    NSC_DBUS_INTERFACE,
+						    NULL,
+						    NSC_DBUS_PATH,
+						    NULL,
+						    G_DBUS_SIGNAL_FLAGS_NONE,
+						    signal_cb,
+						    remote, NULL);
+
+	/* Notice a daemon that crashed in the middle of a job */
+	priv->watch_id =
+		g_bus_watch_name_on_connection (priv->connection,
+						name,
+						G_BUS_NAME_WATCHER_FLAGS_NONE,
+						NULL,
+						name_vanished_cb,
+						remote, NULL);
+
+	return TRUE;
+}
+
+/*
+ * Queue the job in the daemon, either to convert straight away
+ * or, when paused, to preroll until Start() is called.
+ */
+static void
+send_convert (NscRemote *remote,
+	      GFile     *src,
+	      GFile     *sink,
+	      gboolean   paused,
+	      GError   **error)
+{
+	NscRemotePrivate   *priv = NSC_REMOTE_GET_PRIVATE (remote);
+	ConvertCall        *call;
+	GstEncodingProfile *profile;
+	GVariantBuilder     options;
+	gboolean            background, replaygain, checksum, verify;
+	guint64             start, stop;
+	GstTagList         *tags;
+	gchar              *preset;
+	gint                resample_quality;
+	gchar              *src_uri, *sink_uri;
+
+	g_object_get (G_OBJECT (remote),
+		      "profile", &profile,
+		      "background", &background,
+		      "replaygain", &replaygain,
+		      "start", &start,
+		      "stop", &stop,
+		      "tags", &tags,
+		      "preset", &preset,
+		      "resample-quality", &resample_quality,
+		      "checksum", &checksum,
+		      "verify", &verify,
+		      NULL);
+
+	if (!ensure_connection (remote,
+				background ? NSC_DBUS_BACKGROUND_NAME : NSC_DBUS_NAME,
+				error)) {
+		gst_encoding_profile_unref (profile);
+		if (tags != NULL)
+			gst_tag_list_unref (tags);
+		g_free (preset);
+		return;
+	}
+
+	g_variant_builder_init (&options, G_VARIANT_TYPE ("a{sv}"));
+	g_variant_builder_add (&options, "{sv}", "background",
+			       g_variant_new_boolean (background));
+	g_variant_builder_add (&options, "{sv}", "replaygain",
+			       g_variant_new_boolean (replaygain));
+	g_variant_builder_add (&options, "{sv}", "start",
+			       g_variant_new_uint64 (start));
+	g_variant_builder_add (&options, "{sv}", "stop",
+			       g_variant_new_uint64 (stop));
+	g_variant_builder_add (&options, "{sv}", "resample-quality",
+			       g_variant_new_int32 (resample_quality));
+	g_variant_builder_add (&options, "{sv}", "checksum",
+			       g_variant_new_boolean (checksum));
+	g_variant_builder_add (&options, "{sv}", "verify",
+			       g_variant_new_boolean (verify));
+	if (paused)
+		g_variant_builder_add (&options, "{sv}", "paused",
+				       g_variant_new_boolean (TRUE));
+
+	if (tags != NULL) {
+		gchar *str;
+
+		str = gst_tag_list_to_string (tags);
+		g_variant_builder_add (&options, "{sv}", "tags",
+				       g_variant_new_string (str));
+		gst_tag_list_unref (tags);
+		g_free (str);
+	}
+
+	if (preset != NULL) {
+		g_variant_builder_add (&options, "{sv}", "preset",
+				       g_variant_new_string (preset));
+		g_free (preset);
+	}
+
+	src_uri = g_file_get_uri (src);
+	sink_uri = g_file_get_uri (sink);
+
+	/* Until the daemon sends the job's Usage and Checksum */
+	g_object_set (G_OBJECT (remote),
+		      "cpu-time", (guint64) 0,
+		      "peak-rss", (guint64) 0,
+		      "pcm-md5", NULL,
+		      NULL);
+
+	priv->pending = TRUE;
+	call = g_new (ConvertCall, 1);
+	call->remote = g_object_ref (remote);
+	call->name = priv->name;
+	call->generation = ++priv->generation;
+
+	/* This starts the daemon if it isn't running yet */
+	g_dbus_connection_call (priv->connection,
+				priv->name,
+				NSC_DBUS_PATH,
+				NSC_DBUS_INTERFACE,
+				"Convert",
+				g_variant_new ("(sssa{sv})", src_uri, sink_uri,
+					       gst_encoding_profile_get_name (profile),
+					       &options),
+				G_VARIANT_TYPE ("(u)"),
+				G_DBUS_CALL_FLAGS_NONE,
+				-1,
+				NULL,
+				convert_ready_cb,
+				call);
+
+	gst_encoding_profile_unref (profile);
+	g_free (src_uri);
+	g_free (sink_uri);
+}
+
+static void
+nsc_remote_cancel_convert (NscGStreamer *gstreamer)
+{
+	NscRemote        *remote = NSC_REMOTE (gstreamer);
+	NscRemotePrivate *priv = NSC_REMOTE_GET_PRIVATE (remote);
+
+	clear_standby (remote);
+
+	if (priv->pending) {
+		/* The job is cancelled when its id arrives */
+		priv->generation++;
+		priv->pending = FALSE;
+	} else if (priv->job != 0) {
+		/* The daemon removes the partially written file */
+		cancel_job (remote, priv->name, priv->job);
+		priv->job = 0;
+	}
+}
+
+static gboolean
+is_standby (NscRemote *remote, GFile *src, GFile *sink)
+{
+	NscRemotePrivate *priv = NSC_REMOTE_GET_PRIVATE (remote);
+	gchar            *src_uri, *sink_uri;
+	gboolean          same;
+
+	if (!priv->standby)
+		return FALSE;
+
+	src_uri = g_file_get_uri (src);
+	sink_uri = g_file_get_uri (sink);
+	same = g_strcmp0 (src_uri, priv->standby_src) == 0 &&
+		g_strcmp0 (sink_uri, priv->standby_sink) == 0;
+	g_free (src_uri);
+	g_free (sink_uri);
+
+	return same;
+}
+
+static void
+nsc_remote_convert_file (NscGStreamer *gstreamer,
+			 GFile        *src,
+			 GFile        *sink,
+			 GError      **error)
+{
+	NscRemote        *remote = NSC_REMOTE (gstreamer);
+	NscRemotePrivate *priv = NSC_REMOTE_GET_PRIVATE (remote);
+
+	g_return_if_fail (src != NULL);
+	g_return_if_fail (sink != NULL);
+
+	if (is_standby (remote, src, sink)) {
+		/* Prerolled in the daemon already, or about to be */
+		if (priv->pending) {
+			priv->started = TRUE;
+		} else {
+			clear_standby (remote);
+			start_job (remote, priv->job);
+		}
+		return;
+	}
+
+	/* Something else was prerolled */
+	if (priv->standby)
+		nsc_remote_cancel_convert (gstreamer);
+
+	send_convert (remote, src, sink, FALSE, error);
+}
+
+static void
+nsc_remote_preroll_file (NscGStreamer *gstreamer,
+			 GFile        *src,
+			 GFile        *sink)
+{
+	NscRemote        *remote = NSC_REMOTE (gstreamer);
+	NscRemotePrivate *priv = NSC_REMOTE_GET_PRIVATE (remote);
+	GError           *error = NULL;
+	guint64           start, stop;
+
+	g_object_get (G_OBJECT (remote),
+		      "start", &start,
+		      "stop", &stop,
+		      NULL);
+
+	/* Only whole files, and only on an idle converter */
+	if (start != 0 || GST_CLOCK_TIME_IS_VALID (stop) ||
+	    priv->pending || priv->job != 0)
+		return;
+
+	send_convert (remote, src, sink, TRUE, &error);
+	if (error != NULL) {
+		/* convert_file() will run into it again */
+		g_error_free (error);
+		return;
+	}
+
+	priv->standby = TRUE;
+	priv->standby_src = g_file_get_uri (src);
+	priv->standby_sink = g_file_get_uri (sink);
+}
+
+/*
+ * GObject methods
+ */
+static void
+nsc_remote_dispose (GObject *object)
+{
+	NscRemote        *self = NSC_REMOTE (object);
+	NscRemotePrivate *priv = NSC_REMOTE_GET_PRIVATE (self);
+
+	if (priv != NULL && priv->connection != NULL) {
+		if (priv->job != 0) {
+			cancel_job (self, priv->name, priv->job);
+			priv->job = 0;
+		}
+
+		drop_subscription (self);
+
+		g_object_unref (priv->connection);
+		priv->connection = NULL;
+	}
+
+	G_OBJECT_CLASS (nsc_remote_parent_class)->dispose (object);
+}
+
+static void
+nsc_remote_finalize (GObject *object)
+{
+	NscRemote *self = NSC_REMOTE (object);
+
+	clear_standby (self);
+
+	g_free (self->priv);
+	self->priv = NULL;
+
+	G_OBJECT_CLASS (nsc_remote_parent_class)->finalize (object);
+}
+
+static void
+nsc_remote_class_init (NscRemoteClass *klass)
+{
+	GObjectClass      *object_class = G_OBJECT_CLASS (klass);
+	NscGStreamerClass *gstreamer_class = NSC_GSTREAMER_CLASS (klass);
+
+	object_class->dispose  = nsc_remote_dispose;
+	object_class->finalize = nsc_remote_finalize;
+
+	gstreamer_class->convert_file   = nsc_remote_convert_file;
+	gstreamer_class->cancel_convert = nsc_remote_cancel_convert;
+	gstreamer_class->preroll_file   = nsc_remote_preroll_file;
+}
+
+static void
+nsc_remote_init (NscRemote *self)
+{
+	self->priv = g_malloc0 (sizeof (NscRemotePrivate));
+}
+
+/*
+ * Public Methods
+ */
+NscGStreamer *
+nsc_remote_new (GstEncodingProfile *profile)
+{
+	return g_object_new (NSC_TYPE_REMOTE, "profile", profile, NULL);
+}
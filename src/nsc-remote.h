@@ -0,0 +1,60 @@
+/*
+ *  nsc-remote.h
+ * 
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ * 
+ */
+
+#ifndef NSC_REMOTE_H
+#define NSC_REMOTE_H
+
+#include "nsc-gstreamer.h"
+
+G_BEGIN_DECLS
+
+#define NSC_TYPE_REMOTE            (nsc_remote_get_type ())
+#define NSC_REMOTE(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), NSC_TYPE_REMOTE, NscRemote))
+#define NSC_REMOTE_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), NSC_TYPE_REMOTE, NscRemoteClass))
+#define NSC_IS_REMOTE(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), NSC_TYPE_REMOTE))
+#define NSC_IS_REMOTE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), NSC_TYPE_REMOTE))
+#define NSC_REMOTE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), NSC_TYPE_REMOTE, NscRemoteClass))
+
+typedef struct NscRemotePrivate NscRemotePrivate;
+
+/*
+ * An NscGStreamer that hands the conversion over to
+ * caja-sound-converter-daemon, and relays its signals.
+ */
+typedef struct {
+	/* Parent object */
+	NscGStreamer parent;
+	/* Private data pointer */
+	gpointer     priv;
+} NscRemote;
+
+typedef struct {
+	NscGStreamerClass parent_class;
+} NscRemoteClass;
+
+GType         nsc_remote_get_type (void);
+NscGStreamer *nsc_remote_new      (GstEncodingProfile *profile);
+
+G_END_DECLS
+
+#endif /* NSC_REMOTE_H */
@@ -0,0 +1,222 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-replaygain.c
+ * 
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ * 
+ */
+
+#include <config.h>
+
+#include <math.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <gst/gst.h>
+
+#include "nsc-replaygain.h"
+#include "rb-gst-media-types.h"
+
+/*
+ * The gain is only known once the whole file has been analysed,
+ * and most formats keep their tags in a header, so the tags are
+ * written afterwards by remuxing the encoded stream through a tag
+ * setter.  Nothing is decoded or re-encoded.
+ */
+typedef struct {
+	const gchar *media_type;
+	const gchar *pipeline;
+} Retagger;
+
+static const Retagger retaggers[] = {
+	{ RB_GST_MEDIA_TYPE_OGG_VORBIS,
+	  "giosrc name=src ! oggdemux ! vorbisparse ! vorbistag ! oggmux ! giosink name=sink" },
+	{ RB_GST_MEDIA_TYPE_FLAC,
+	  "giosrc name=src ! flacparse ! flactag ! giosink name=sink" },
+	{ RB_GST_MEDIA_TYPE_MP3,
+	  "giosrc name=src ! id3demux ! mpegaudioparse ! id3v2mux ! giosink name=sink" },
+	{ RB_GST_MEDIA_TYPE_AAC,
+	  "giosrc name=src ! qtdemux ! aacparse ! mp4mux ! giosink name=sink" },
+};
+
+typedef struct {
+	GstElement *pipeline;
+	GFile      *file;
+	GFile      *tmp_file;
+} TagJob;
+
+static void
+tag_job_free (TagJob *job)
+{
+	gst_element_set_state (job->pipeline, GST_STATE_NULL);
+	gst_object_unref (job->pipeline);
+	g_object_unref (job->file);
+	g_object_unref (job->tmp_file);
+	g_free (job);
+}
+
+static gboolean
+bus_cb (GstBus     *bus,
+	GstMessage *message,
+	gpointer    user_data)
+{
+	TagJob *job = user_data;
+	GError *error = NULL;
+
+	switch (GST_MESSAGE_TYPE (message)) {
+	case GST_MESSAGE_EOS:
+		gst_element_set_state (job->pipeline, GST_STATE_NULL);
+		if (!g_file_move (job->tmp_file, job->file,
+				  G_FILE_COPY_OVERWRITE,
+				  NULL, NULL, NULL, &error)) {
+			g_warning ("Unable to write ReplayGain tags: %s", error->message);
+			g_error_free (error);
+			g_file_delete (job->tmp_file, NULL, NULL);
+		}
+		break;
+	case GST_MESSAGE_ERROR:
+		gst_message_parse_error (message, &error, NULL);
+		g_warning ("Unable to write ReplayGain tags: %s", error->message);
+		g_error_free (error);
+		gst_element_set_state (job->pipeline, GST_STATE_NULL);
+		g_file_delete (job->tmp_file, NULL, NULL);
+		break;
+	default:
+		return TRUE;
+	}
+
+	/* This removes the watch */
+	tag_job_free (job);
+	return FALSE;
+}
+
+/*
+ * Public Methods
+ */
+NscReplayGainMode
+nsc_replaygain_mode_from_string (const gchar *mode)
+{
+	if (g_strcmp0 (mode, "track") == 0)
+		return NSC_REPLAYGAIN_TRACK;
+	else if (g_strcmp0 (mode, "album") == 0)
+		return NSC_REPLAYGAIN_ALBUM;
+	else
+		return NSC_REPLAYGAIN_NONE;
+}
+
+/**
+ * Combine the track results into the album gain and peak.  The
+ * loudness histograms rganalysis builds are not exposed, so the
+ * album gain is the duration weighted power average of the track
+ * gains, which agrees with a joint analysis to within a fraction
+ * of a dB for tracks mastered together.
+ */
+void
+nsc_replaygain_album (GArray  *tracks,
+		      gdouble *gain,
+		      gdouble *peak)
+{
+	gdouble power = 0, weight = 0;
+	guint   i;
+
+	*gain = 0;
+	*peak = 0;
+
+	for (i = 0; i < tracks->len; i++) {
+		NscReplayGainTrack *track;
+		gdouble             duration;
+
+		track = &g_array_index (tracks, NscReplayGainTrack, i);
+		duration = MAX (track->duration, 1);
+
+		power += duration * pow (10, -track->gain / 10);
+		weight += duration;
+		*peak = MAX (*peak, track->peak);
+	}
+
+	if (weight > 0)
+		*gain = -10 * log10 (power / weight);
+}
+
+/**
+ * Merge the tags into an encoded file in the background.
+ */
+void
+nsc_replaygain_write_tags (GFile       *file,
+			   const gchar *media_type,
+			   GstTagList  *tags)
+{
+	const Retagger *retagger = NULL;
+	GstElement     *src, *sink, *setter;
+	GstBus         *bus;
+	TagJob         *job;
+	GError         *error = NULL;
+	gchar          *uri, *tmp_uri;
+	guint           i;
+
+	g_return_if_fail (G_IS_FILE (file));
+
+	for (i = 0; i < G_N_ELEMENTS (retaggers); i++) {
+		if (g_strcmp0 (media_type, retaggers[i].media_type) == 0) {
+			retagger = &retaggers[i];
+			break;
+		}
+	}
+
+	if (retagger == NULL) {
+		g_debug ("No way to write ReplayGain tags to %s", media_type);
+		return;
+	}
+
+	job = g_new0 (TagJob, 1);
+	job->pipeline = gst_parse_launch (retagger->pipeline, &error);
+	if (job->pipeline == NULL) {
+		g_warning ("Unable to write ReplayGain tags: %s", error->message);
+		g_error_free (error);
+		g_free (job);
+		return;
+	}
+
+	uri = g_file_get_uri (file);
+	tmp_uri = g_strconcat (uri, ".rgtmp", NULL);
+	job->file = g_object_ref (file);
+	job->tmp_file = g_file_new_for_uri (tmp_uri);
+	g_free (tmp_uri);
+	g_free (uri);
+
+	src = gst_bin_get_by_name (GST_BIN (job->pipeline), "src");
+	sink = gst_bin_get_by_name (GST_BIN (job->pipeline), "sink");
+	g_object_set (src, "file", job->file, NULL);
+	g_object_set (sink, "file", job->tmp_file, NULL);
+	gst_object_unref (src);
+	gst_object_unref (sink);
+
+	setter = gst_bin_get_by_interface (GST_BIN (job->pipeline),
+					   GST_TYPE_TAG_SETTER);
+	gst_tag_setter_merge_tags (GST_TAG_SETTER (setter), tags,
+				   GST_TAG_MERGE_REPLACE);
+	gst_object_unref (setter);
+
+	bus = gst_element_get_bus (job->pipeline);
+	gst_bus_add_watch (bus, bus_cb, job);
+	gst_object_unref (bus);
+
+	gst_element_set_state (job->pipeline, GST_STATE_PLAYING);
+}
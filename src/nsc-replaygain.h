@@ -0,0 +1,56 @@
+/*
+ *  nsc-replaygain.h
+ * 
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ * 
+ */
+
+#ifndef NSC_REPLAYGAIN_H
+#define NSC_REPLAYGAIN_H
+
+#include <gio/gio.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+	NSC_REPLAYGAIN_NONE,
+	NSC_REPLAYGAIN_TRACK,
+	NSC_REPLAYGAIN_ALBUM
+} NscReplayGainMode;
+
+/* The result of analysing one converted file */
+typedef struct {
+	GFile   *file;
+	gdouble  gain;
+	gdouble  peak;
+	gint     duration;
+} NscReplayGainTrack;
+
+NscReplayGainMode nsc_replaygain_mode_from_string (const gchar        *mode);
+void              nsc_replaygain_album            (GArray             *tracks,
+						   gdouble            *gain,
+						   gdouble            *peak);
+void              nsc_replaygain_write_tags       (GFile              *file,
+						   const gchar        *media_type,
+						   GstTagList         *tags);
+
+G_END_DECLS
+
+#endif /* NSC_REPLAYGAIN_H */
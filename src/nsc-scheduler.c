@@ -0,0 +1,1432 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-scheduler.c
+ * 
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ * 
+ */
+
+#include <config.h>
+
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib/gi18n.h>
+#include <gio/gio.h>
+#include <gtk/gtk.h>
+#include <gst/gst.h>
+
+#include "nsc-converter.h"
+#include "nsc-engine.h"
+#include "nsc-error.h"
+#include "nsc-gstreamer.h"
+#include "nsc-history.h"
+#include "nsc-index.h"
+#include "nsc-job.h"
+#include "nsc-remote.h"
+#include "nsc-scheduler.h"
+#include "nsc-simulator.h"
+#include "nsc-trace.h"
+#include "nsc-xml.h"
+#include "rb-gst-media-types.h"
+
+typedef struct _NscSchedulerPrivate NscSchedulerPrivate;
+
+/* Signals */
+enum {
+	IDLE,
+	LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
+typedef struct {
+	int            seconds;
+	struct timeval time;
+	int            ripped;
+	int            taken;
+} Progress;
+
+/* One conversion slot */
+typedef struct {
+	NscScheduler    *scheduler;
+
+	/* Position in the workers array, for the trace */
+	guint            index;
+
+	/* GStreamer Object, kept between jobs with the same profile */
+	NscGStreamer    *gst;
+	gchar           *profile_name;
+
+	/* The batch the current job belongs to, NULL if idle */
+	NscConverter    *batch;
+	NscJob          *job;
+
+	/* A second GStreamer object, prerolled on the job to run next
+	 * while the current one finishes, and swapped in when it does */
+	NscGStreamer    *spare;
+	gchar           *spare_profile;
+	NscConverter    *next_batch;
+	NscJob          *next_job;
+
+	/* The duration and position of the file being converted */
+	gint             duration;
+	gint             position;
+
+	/* When the job started, and how many were running then */
+	gint64           started;
+	guint            concurrency;
+
+	/* ReplayGain of the file, if it was analysed */
+	gboolean         has_replaygain;
+	gdouble          gain;
+	gdouble          peak;
+} Worker;
+
+/* A job waiting to be tried again after a transient error */
+typedef struct {
+	NscScheduler    *scheduler;
+	NscConverter    *batch;
+	NscJob          *job;
+	guint            source_id;
+} Retry;
+
+struct _NscSchedulerPrivate {
+	/* Batches with jobs left to start, in round-robin order */
+	GQueue          *batches;
+
+	/* Array of Worker, never longer than max_jobs */
+	GPtrArray       *workers;
+	guint            max_jobs;
+	guint            busy;
+
+	/* Jobs to run at once, moved between 1 and max_jobs by the
+	 * controller when adaptive, max_jobs otherwise */
+	guint            limit;
+	gboolean         adaptive;
+
+	/* The controller's last sample, the throughput it measured in
+	 * seconds of audio per second (negative before the first one at
+	 * the limit), and the way it is moving limit */
+	guint            control_id;
+	gint64           control_time;
+	gint             control_seconds;
+	gdouble          control_rate;
+	gint             control_step;
+
+	/* Convert in caja-sound-converter-daemon instead of in Caja? */
+	gboolean         out_of_process;
+
+	/* Record every job run in the history */
+	gboolean         keep_history;
+
+	/* Decode lossless outputs again to check them */
+	gboolean         verify;
+
+	/* Files in all the batches submitted since the queue was empty */
+	gint             total_files;
+	gint             files_done;
+
+	/* Seconds of audio in the finished files */
+	gint             done_seconds;
+
+	/* Audio files in the batches, cue sheets left out, and the
+	 * seconds of audio in those the media index knows the
+	 * duration of */
+	gint             batch_files;
+	gint             indexed_files;
+	gint64           indexed_seconds;
+
+	/* Pending idle callback to start more jobs */
+	guint            schedule_id;
+
+	/* Jobs waiting out their back off, as Retry */
+	GSList          *retries;
+
+	GtkWidget       *progress_dlg;
+	GtkWidget       *progressbar;
+	GtkWidget       *speedbar;
+	guint            update_id;
+
+	/* Status icon */
+	GtkStatusIcon   *status_icon;
+
+	/* Snapshots of the progress used to calculate the speed and the ETA */
+	Progress         before;
+};
+
+/*
+ * gsettings schema holding the concurrency and out-of-process keys.
+ */
+#define SCHEDULER_SCHEMA "org.mate.caja-sound-converter"
+
+/* How often the progress dialog is refreshed, in milliseconds */
+#define UPDATE_INTERVAL 500
+
+/* Seconds between two throughput samples of the controller, and
+ * the relative change in throughput it takes for noise */
+#define CONTROL_INTERVAL  5
+#define CONTROL_TOLERANCE 0.05
+
+/* Load average per processor past which no more jobs are started */
+#define MAX_LOAD 2.0
+
+/* Seconds before the end of a job at which the next one is prerolled */
+#define PREROLL_AHEAD 2
+
+/* Attempts at a job failing with transient errors, and the first
+ * wait between them in seconds, doubled each time */
+#define MAX_ATTEMPTS 4
+#define RETRY_DELAY  2
+
+#define NSC_SCHEDULER_GET_PRIVATE(o)           \
+	((NscSchedulerPrivate *)((NSC_SCHEDULER(o))->priv))
+
+G_DEFINE_TYPE (NscScheduler, nsc_scheduler, G_TYPE_OBJECT)
+
+static void schedule         (NscScheduler *scheduler);
+static void start_job        (Worker       *worker,
+			      NscConverter *batch,
+			      NscJob       *job);
+static void finish_job       (Worker       *worker,
+			      GError       *error);
+static void preroll_next_job (Worker       *worker);
+
+static void
+worker_drop_gst (Worker *worker, NscGStreamer *gst)
+{
+	if (gst == NULL)
+		return;
+
+	g_signal_handlers_disconnect_matched (gst, G_SIGNAL_MATCH_DATA,
+					      0, 0, NULL, NULL, worker);
+	g_object_unref (gst);
+}
+
+static void
+worker_free (Worker *worker)
+{
+	worker_drop_gst (worker, worker->gst);
+	worker_drop_gst (worker, worker->spare);
+
+	if (worker->next_job != NULL) {
+		g_object_unref (worker->next_batch);
+		nsc_job_free (worker->next_job);
+	}
+
+	g_free (worker->profile_name);
+	g_free (worker->spare_profile);
+	g_free (worker);
+}
+
+static void
+retry_free (Retry *retry)
+{
+	if (retry->source_id)
+		g_source_remove (retry->source_id);
+
+	g_object_unref (retry->batch);
+	nsc_job_free (retry->job);
+	g_free (retry);
+}
+
+static void
+nsc_scheduler_finalize (GObject *object)
+{
+	NscScheduler        *self = (NscScheduler *) object;
+	NscSchedulerPrivate *priv = NSC_SCHEDULER_GET_PRIVATE (self);
+
+	if (priv != NULL) {
+		if (priv->schedule_id)
+			g_source_remove (priv->schedule_id);
+
+		if (priv->update_id)
+			g_source_remove (priv->update_id);
+
+		if (priv->control_id)
+			g_source_remove (priv->control_id);
+
+		g_slist_free_full (priv->retries, (GDestroyNotify) retry_free);
+
+		g_ptr_array_foreach (priv->workers, (GFunc) worker_free, NULL);
+		g_ptr_array_free (priv->workers, TRUE);
+
+		g_queue_foreach (priv->batches, (GFunc) g_object_unref, NULL);
+		g_queue_free (priv->batches);
+
+		g_free (priv);
+
+		(NSC_SCHEDULER (self))->priv = NULL;
+	}
+
+	G_OBJECT_CLASS (nsc_scheduler_parent_class)->finalize (object);
+}
+
+static void
+nsc_scheduler_class_init (NscSchedulerClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = nsc_scheduler_finalize;
+
+	/* Signals */
+	signals[IDLE] =
+		g_signal_new ("idle",
+			      G_TYPE_FROM_CLASS (object_class),
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (NscSchedulerClass, idle),
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__INT,
+			      G_TYPE_NONE, 1, G_TYPE_INT);
+}
+
+static void
+nsc_scheduler_init (NscScheduler *self)
+{
+	NscSchedulerPrivate *priv;
+	GSettings           *gsettings;
+	gint                 max_jobs;
+	guint                processors;
+
+	/* Allocate private data structure */
+	(NSC_SCHEDULER (self))->priv = \
+		(NscSchedulerPrivate *) g_malloc0 (sizeof (NscSchedulerPrivate));
+
+	priv = NSC_SCHEDULER_GET_PRIVATE (self);
+
+	priv->batches = g_queue_new ();
+	priv->workers = g_ptr_array_new ();
+	priv->before.seconds = -1;
+
+	nsc_trace_name_track (self, "scheduler");
+
+	gsettings = g_settings_new (SCHEDULER_SCHEMA);
+	max_jobs = g_settings_get_int (gsettings, "max-jobs");
+	priv->adaptive = g_settings_get_boolean (gsettings, "adaptive-jobs");
+	priv->out_of_process = g_settings_get_boolean (gsettings, "out-of-process");
+	priv->keep_history = g_settings_get_boolean (gsettings, "keep-history");
+	priv->verify = g_settings_get_boolean (gsettings, "verify-output");
+	g_object_unref (gsettings);
+
+	/*
+	 * Zero means one job per processor, or up to two when the
+	 * controller can find out whether more jobs help.
+	 */
+	processors = g_get_num_processors ();
+	if (max_jobs <= 0)
+		max_jobs = priv->adaptive ? 2 * processors : processors;
+	priv->max_jobs = max_jobs;
+	priv->limit = MIN (processors, priv->max_jobs);
+	if (!priv->adaptive)
+		priv->limit = priv->max_jobs;
+}
+
+/*
+ * Progress reporting
+ */
+
+/**
+ * Update progressbar text
+ */
+static void
+update_progressbar_text (NscScheduler *scheduler)
+{
+	NscSchedulerPrivate *priv;
+	gchar               *text;
+
+	priv = NSC_SCHEDULER_GET_PRIVATE (scheduler);
+
+	text = g_strdup_printf (dgettext (GETTEXT_PACKAGE, "Converting: %d of %d"),
+				MIN (priv->files_done + 1, priv->total_files),
+				priv->total_files);
+	gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progressbar),
+				   text);
+	if (priv->status_icon) {
+		gtk_status_icon_set_tooltip_text (priv->status_icon,
+						  text);
+	}
+	g_free (text);
+}
+
+/**
+ * Update the ETA and Speed labels
+ */
+static void
+update_speed_progress (NscScheduler *scheduler,
+		       float         speed,
+		       int           eta)
+{
+	NscSchedulerPrivate *priv;
+	gchar               *eta_str;
+
+	priv = NSC_SCHEDULER_GET_PRIVATE (scheduler);
+
+	if (eta >= 0) {
+		eta_str =
+			g_strdup_printf (dgettext (GETTEXT_PACKAGE, 
+						   "Estimated time left: %d:%02d (at %0.1f\303\227)"),
+					 eta / 60,
+					 eta % 60,
+					 speed);
+	} else {
+		eta_str = g_strdup (dgettext (GETTEXT_PACKAGE, "Estimated time left: unknown"));
+	}
+
+	gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->speedbar),
+				   eta_str);
+	g_free (eta_str);
+}
+
+/**
+ * Seconds of audio converted so far, counting the running jobs.
+ */
+static gint
+get_converted_seconds (NscScheduler *scheduler)
+{
+	NscSchedulerPrivate *priv = NSC_SCHEDULER_GET_PRIVATE (scheduler);
+	gint                 converted;
+	guint                i;
+
+	converted = priv->done_seconds;
+	for (i = 0; i < priv->workers->len; i++) {
+		Worker *worker = g_ptr_array_index (priv->workers, i);
+
+		if (worker->batch != NULL)
+			converted += worker->position;
+	}
+
+	return converted;
+}
+
+/**
+ * Hill-climb the number of jobs run at once: keep moving it the
+ * same way while the throughput improves, turn back when it drops,
+ * and stay put once it no longer changes.  This way the many jobs
+ * of CPU bound encodes from a fast disk end up high, and copies
+ * from a slow share low, without anyone tuning max-jobs.
+ */
+static gboolean
+control_cb (gpointer user_data)
+{
+	NscScheduler        *scheduler = NSC_SCHEDULER (user_data);
+	NscSchedulerPrivate *priv = NSC_SCHEDULER_GET_PRIVATE (scheduler);
+	gint64               now;
+	gint                 converted;
+	gdouble              rate, load = 0;
+	guint                limit;
+
+	now = g_get_monotonic_time ();
+	converted = get_converted_seconds (scheduler);
+
+	/* A retried job gives back the seconds it had converted */
+	rate = (gdouble) MAX (converted - priv->control_seconds, 0) *
+		G_USEC_PER_SEC / (now - priv->control_time);
+	priv->control_time = now;
+	priv->control_seconds = converted;
+
+	/* The throughput says nothing about the limit if it isn't reached */
+	if (priv->busy < priv->limit || g_queue_is_empty (priv->batches)) {
+		priv->control_rate = -1;
+		priv->control_step = 0;
+		return TRUE;
+	}
+
+	if (priv->control_rate < 0) {
+		/* First sample at this limit, see if more jobs help */
+		priv->control_step = 1;
+	} else if (rate > priv->control_rate * (1 + CONTROL_TOLERANCE)) {
+		if (priv->control_step == 0)
+			priv->control_step = 1;
+	} else if (rate < priv->control_rate * (1 - CONTROL_TOLERANCE)) {
+		priv->control_step = priv->control_step > 0 ? -1 : 1;
+	} else {
+		priv->control_step = 0;
+	}
+
+	/* Don't pile more work onto a machine busy with something else */
+	if (getloadavg (&load, 1) == 1 &&
+	    load > MAX_LOAD * g_get_num_processors ())
+		priv->control_step = -1;
+
+	priv->control_rate = rate;
+
+	limit = CLAMP ((gint) priv->limit + priv->control_step,
+		       1, (gint) priv->max_jobs);
+	if (limit == priv->limit) {
+		priv->control_step = 0;
+		return TRUE;
+	}
+
+	g_message ("Converting %u files at once instead of %u, at %.1f seconds of audio per second and a load of %.2f",
+		   limit, priv->limit, rate, load);
+	priv->limit = limit;
+	nsc_trace_counter ("job limit", limit);
+	schedule (scheduler);
+
+	return TRUE;
+}
+
+static void
+start_control (NscScheduler *scheduler)
+{
+	NscSchedulerPrivate *priv = NSC_SCHEDULER_GET_PRIVATE (scheduler);
+
+	if (!priv->adaptive || priv->control_id != 0)
+		return;
+
+	priv->control_time = g_get_monotonic_time ();
+	priv->control_seconds = get_converted_seconds (scheduler);
+	priv->control_rate = -1;
+	priv->control_step = 0;
+	priv->control_id = g_timeout_add_seconds (CONTROL_INTERVAL,
+						  control_cb, scheduler);
+}
+
+/**
+ * Periodically fold the progress of all the running jobs into
+ * the overall fraction, speed and ETA.
+ */
+static gboolean
+update_progress_cb (gpointer user_data)
+{
+	NscScheduler        *scheduler = NSC_SCHEDULER (user_data);
+	NscSchedulerPrivate *priv = NSC_SCHEDULER_GET_PRIVATE (scheduler);
+	gint                 converted, known_duration, known_files;
+	gint                 unstarted, total;
+	guint                i;
+
+	converted = priv->done_seconds;
+	known_duration = priv->done_seconds;
+	known_files = priv->files_done;
+
+	for (i = 0; i < priv->workers->len; i++) {
+		Worker *worker = g_ptr_array_index (priv->workers, i);
+
+		if (worker->batch == NULL || worker->duration == 0)
+			continue;
+
+		converted += worker->position;
+		known_duration += worker->duration;
+		known_files++;
+	}
+
+	if (known_files == 0 || known_duration == 0)
+		return TRUE;
+
+	if (priv->indexed_files > 0) {
+		/* Assume the files the index doesn't know are of average length */
+		total = (gint) (priv->indexed_seconds +
+				priv->indexed_seconds / priv->indexed_files *
+				(priv->batch_files - priv->indexed_files));
+		total = MAX (total, converted);
+	} else {
+		/* Assume the files not started yet are of average length */
+		unstarted = priv->total_files - priv->files_done - priv->busy;
+		total = known_duration + (known_duration / known_files) * MAX (unstarted, 0);
+	}
+
+	/* The index may only know files of no length */
+	if (total <= 0)
+		return TRUE;
+
+	gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (priv->speedbar),
+				       CLAMP ((float) converted / (float) total, 0, 1));
+
+	if (priv->before.seconds == -1) {
+		priv->before.seconds = converted;
+		gettimeofday (&priv->before.time, NULL);
+	} else {
+		struct timeval time;
+		gint           taken;
+		float          speed;
+
+		gettimeofday (&time, NULL);
+		taken = time.tv_sec + (time.tv_usec / 1000000.0)
+			- (priv->before.time.tv_sec + (priv->before.time.tv_usec / 1000000.0));
+
+		if (taken >= 2) {
+			priv->before.taken += taken;
+			priv->before.ripped += converted - priv->before.seconds;
+			speed = (float) priv->before.ripped / (float) priv->before.taken;
+			if (speed > 0)
+				update_speed_progress (scheduler, speed,
+						       (int) ((total - converted) / speed));
+			priv->before.seconds = converted;
+			gettimeofday (&priv->before.time, NULL);
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * Cancel converting the files.
+ */
+static void
+progress_cancel_cb (GtkWidget *widget, gpointer user_data)
+{
+	nsc_scheduler_cancel_all (NSC_SCHEDULER (user_data));
+}
+
+static void
+status_icon_activate_cb (GtkStatusIcon *status_icon,
+			 NscScheduler  *scheduler)
+{
+	NscSchedulerPrivate *priv;
+	gboolean             visible;
+
+	priv = NSC_SCHEDULER_GET_PRIVATE (scheduler);
+
+	g_object_get (priv->progress_dlg,
+		      "visible", &visible,
+		      NULL);
+
+	if (visible && gtk_status_icon_is_embedded (status_icon)) {
+		gtk_widget_hide (priv->progress_dlg);
+	} else {
+		gtk_widget_show_all (priv->progress_dlg);
+	}
+}
+
+/**
+ * Create the progress dialog & status icon
+ */
+static void
+show_progress (NscScheduler *scheduler)
+{
+	NscSchedulerPrivate *priv;
+	GtkWidget           *button;
+
+	priv = NSC_SCHEDULER_GET_PRIVATE (scheduler);
+
+	if (priv->progress_dlg != NULL)
+		return;
+
+	/* Create the gtkbuilder, and grab the widgets */
+	nsc_xml_get_file ("progress.ui",
+			  "progress_dialog", &priv->progress_dlg,
+			  "file_progressbar", &priv->progressbar,
+			  "speed_progressbar", &priv->speedbar,
+			  "cancel_button", &button,
+			  NULL);
+
+	/* Connect the signal for the cancel button */
+	g_signal_connect (G_OBJECT (button), "clicked",
+			  (GCallback) progress_cancel_cb,
+			  scheduler);
+
+	gtk_widget_show_all (priv->progress_dlg);
+
+	priv->status_icon = gtk_status_icon_new_from_icon_name ("gtk-convert");
+	g_signal_connect (priv->status_icon,
+			  "activate",
+			  G_CALLBACK (status_icon_activate_cb),
+			  scheduler);
+	gtk_status_icon_set_visible (priv->status_icon, TRUE);
+
+	gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->speedbar), 
+				   (dgettext (GETTEXT_PACKAGE, "Speed: Unknown")));
+
+	priv->update_id = g_timeout_add (UPDATE_INTERVAL, update_progress_cb,
+					 scheduler);
+}
+
+/**
+ * Log what the process holds once a queue of batches is done, so
+ * that growth over a long session shows with G_MESSAGES_DEBUG set.
+ */
+static void
+log_resources (NscScheduler *scheduler)
+{
+	NscSchedulerPrivate *priv = NSC_SCHEDULER_GET_PRIVATE (scheduler);
+	GDir                *dir;
+	gchar               *statm = NULL;
+	gulong               size, resident = 0;
+	guint                fds = 0;
+
+	if (g_file_get_contents ("/proc/self/statm", &statm, NULL, NULL) &&
+	    sscanf (statm, "%lu %lu", &size, &resident) == 2)
+		resident *= sysconf (_SC_PAGESIZE) / 1024;
+	g_free (statm);
+
+	dir = g_dir_open ("/proc/self/fd", 0, NULL);
+	if (dir != NULL) {
+		while (g_dir_read_name (dir) != NULL)
+			fds++;
+		g_dir_close (dir);
+	}
+
+	g_debug ("Done with %d files; %lu KiB resident, %u open files, %u workers",
+		 priv->files_done, resident, fds, priv->workers->len);
+}
+
+static void
+hide_progress (NscScheduler *scheduler)
+{
+	NscSchedulerPrivate *priv;
+
+	priv = NSC_SCHEDULER_GET_PRIVATE (scheduler);
+
+	log_resources (scheduler);
+	g_signal_emit (scheduler, signals[IDLE], 0, priv->files_done);
+
+	if (priv->update_id) {
+		g_source_remove (priv->update_id);
+		priv->update_id = 0;
+	}
+
+	/* The limit it found is kept for the next batch */
+	if (priv->control_id) {
+		g_source_remove (priv->control_id);
+		priv->control_id = 0;
+	}
+
+	if (priv->progress_dlg) {
+		gtk_widget_destroy (priv->progress_dlg);
+		priv->progress_dlg = NULL;
+		priv->progressbar = NULL;
+		priv->speedbar = NULL;
+	}
+
+	if (priv->status_icon) {
+		g_object_unref (priv->status_icon);
+		priv->status_icon = NULL;
+	}
+
+	/* The next batch starts a fresh count */
+	priv->total_files = 0;
+	priv->files_done = 0;
+	priv->done_seconds = 0;
+	priv->batch_files = 0;
+	priv->indexed_files = 0;
+	priv->indexed_seconds = 0;
+	memset (&priv->before, 0, sizeof (Progress));
+	priv->before.seconds = -1;
+}
+
+/*
+ * Job handling
+ */
+
+/*
+ * The spare GStreamer object of a worker is connected too, but only
+ * the one running the current job is listened to.
+ */
+
+/**
+ * Callback to report errors.  The error passed in does not
+ * need to be freed.
+ */
+static void
+on_error_cb (NscGStreamer *gstream, GError *error, gpointer data)
+{
+	Worker *worker = data;
+
+	if (gstream == worker->gst)
+		finish_job (worker, error);
+}
+
+/**
+ * Callback to report completion.
+ */
+static void
+on_completion_cb (NscGStreamer *gstream, gpointer data)
+{
+	Worker *worker = data;
+
+	if (gstream == worker->gst)
+		finish_job (worker, NULL);
+}
+
+/**
+ * Callback to set file total duration.
+ */
+static void
+on_duration_cb (NscGStreamer *gstream,
+		const int     seconds,
+		gpointer      data)
+{
+	Worker *worker = data;
+
+	if (gstream != worker->gst)
+		return;
+
+	worker->duration = seconds;
+	if (seconds <= PREROLL_AHEAD)
+		preroll_next_job (worker);
+}
+
+/**
+ * Callback to report on file conversion progress.
+ */
+static void
+on_progress_cb (NscGStreamer *gstream,
+		const int     seconds,
+		gpointer      data)
+{
+	Worker *worker = data;
+
+	if (gstream != worker->gst)
+		return;
+
+	worker->position = seconds;
+	if (worker->duration > 0 &&
+	    worker->duration - seconds <= PREROLL_AHEAD)
+		preroll_next_job (worker);
+}
+
+/**
+ * Callback to remember the ReplayGain until the file is complete.
+ */
+static void
+on_replaygain_cb (NscGStreamer *gstream,
+		  gdouble       gain,
+		  gdouble       peak,
+		  gpointer      data)
+{
+	Worker *worker = data;
+
+	if (gstream != worker->gst)
+		return;
+
+	worker->has_replaygain = TRUE;
+	worker->gain = gain;
+	worker->peak = peak;
+}
+
+static NscGStreamer *
+worker_new_gst (Worker *worker, GstEncodingProfile *profile)
+{
+	NscSchedulerPrivate *priv;
+	NscGStreamer        *gst;
+
+	priv = NSC_SCHEDULER_GET_PRIVATE (worker->scheduler);
+
+	if (nsc_simulator_enabled ())
+		gst = nsc_simulator_new (profile);
+	else if (priv->out_of_process)
+		gst = nsc_remote_new (profile);
+	else
+		gst = nsc_engine_new (profile);
+
+	if (nsc_trace_start () != 0) {
+		gchar *name;
+
+		name = g_strdup_printf ("worker %u pipeline", worker->index + 1);
+		nsc_trace_name_track (gst, name);
+		g_free (name);
+	}
+
+	/* The history keeps the MD5 of the audio of each file */
+	g_object_set (G_OBJECT (gst),
+		      "checksum", priv->keep_history,
+		      "verify", priv->verify,
+		      NULL);
+
+	/* Connect to the gstreamer object signals */
+	g_signal_connect (G_OBJECT (gst), "completion",
+			  (GCallback) on_completion_cb,
+			  worker);
+	g_signal_connect (G_OBJECT (gst), "error",
+			  (GCallback) on_error_cb,
+			  worker);
+	g_signal_connect (G_OBJECT (gst), "progress",
+			  (GCallback) on_progress_cb,
+			  worker);
+	g_signal_connect (G_OBJECT (gst), "duration",
+			  (GCallback) on_duration_cb,
+			  worker);
+	g_signal_connect (G_OBJECT (gst), "replaygain",
+			  (GCallback) on_replaygain_cb,
+			  worker);
+
+	return gst;
+}
+
+/**
+ * Make sure the worker has an NscGStreamer set up for the profile,
+ * reusing the one from its previous job if possible.
+ */
+static void
+worker_set_profile (Worker *worker, GstEncodingProfile *profile)
+{
+	const gchar *name;
+
+	name = gst_encoding_profile_get_name (profile);
+
+	if (worker->gst != NULL && g_strcmp0 (worker->profile_name, name) == 0)
+		return;
+
+	worker_drop_gst (worker, worker->gst);
+	worker->gst = worker_new_gst (worker, profile);
+
+	g_free (worker->profile_name);
+	worker->profile_name = g_strdup (name);
+}
+
+/* The same for the spare */
+static void
+worker_set_spare_profile (Worker *worker, GstEncodingProfile *profile)
+{
+	const gchar *name;
+
+	name = gst_encoding_profile_get_name (profile);
+
+	if (worker->spare != NULL && g_strcmp0 (worker->spare_profile, name) == 0)
+		return;
+
+	worker_drop_gst (worker, worker->spare);
+	worker->spare = worker_new_gst (worker, profile);
+
+	g_free (worker->spare_profile);
+	worker->spare_profile = g_strdup (name);
+}
+
+static void
+configure_gst (NscGStreamer *gst,
+	       NscConverter *batch,
+	       NscJob       *job)
+{
+	g_object_set (G_OBJECT (gst),
+		      "background", nsc_converter_get_background (batch),
+		      "replaygain", nsc_converter_get_replaygain (batch),
+		      "preset", nsc_converter_get_preset (batch),
+		      "resample-quality", nsc_converter_get_resample_quality (batch),
+		      "start", job->start,
+		      "stop", job->stop,
+		      "tags", job->tags,
+		      NULL);
+}
+
+static Worker *
+get_idle_worker (NscScheduler *scheduler)
+{
+	NscSchedulerPrivate *priv;
+	Worker              *worker;
+	guint                i;
+
+	priv = NSC_SCHEDULER_GET_PRIVATE (scheduler);
+
+	for (i = 0; i < priv->workers->len; i++) {
+		worker = g_ptr_array_index (priv->workers, i);
+		if (worker->batch == NULL)
+			return worker;
+	}
+
+	worker = g_new0 (Worker, 1);
+	worker->scheduler = scheduler;
+	worker->index = priv->workers->len;
+	g_ptr_array_add (priv->workers, worker);
+
+	if (nsc_trace_start () != 0) {
+		gchar *name;
+
+		name = g_strdup_printf ("worker %u", worker->index + 1);
+		nsc_trace_name_track (worker, name);
+		g_free (name);
+	}
+
+	return worker;
+}
+
+static void
+start_job (Worker       *worker,
+	   NscConverter *batch,
+	   NscJob       *job)
+{
+	NscSchedulerPrivate *priv;
+	GError              *err = NULL;
+
+	priv = NSC_SCHEDULER_GET_PRIVATE (worker->scheduler);
+
+	worker->batch = g_object_ref (batch);
+	worker->job = job;
+	worker->duration = 0;
+	worker->position = 0;
+	worker->has_replaygain = FALSE;
+	priv->busy++;
+	worker->started = g_get_monotonic_time ();
+	worker->concurrency = priv->busy;
+	nsc_trace_counter ("jobs running", priv->busy);
+
+	/* Until the pipeline says, as it only does once it is playing */
+	if (job->start == 0 && !GST_CLOCK_TIME_IS_VALID (job->stop)) {
+		NscMediaInfo  info;
+		gchar        *uri;
+
+		uri = g_file_get_uri (job->src);
+		if (nsc_index_lookup (uri, &info) &&
+		    GST_CLOCK_TIME_IS_VALID (info.duration))
+			worker->duration = info.duration / GST_SECOND;
+		g_free (uri);
+	}
+
+	worker_set_profile (worker, nsc_converter_get_profile (batch));
+	configure_gst (worker->gst, batch, job);
+
+	/* Let's finally get to the fun stuff */
+	nsc_gstreamer_convert_file (worker->gst, job->src, job->sink, &err);
+	if (err != NULL) {
+		finish_job (worker, err);
+		g_error_free (err);
+	}
+}
+
+/**
+ * Take the next job, from each batch in turn so a big batch
+ * cannot starve a small one.  The batch is not referenced.
+ */
+static NscJob *
+take_job (NscScheduler  *scheduler,
+	  NscConverter **batch)
+{
+	NscSchedulerPrivate *priv = NSC_SCHEDULER_GET_PRIVATE (scheduler);
+
+	while (!g_queue_is_empty (priv->batches)) {
+		NscJob *job;
+		gint    total;
+
+		*batch = g_queue_pop_head (priv->batches);
+
+		/* Files only turn into jobs once the batch gets to them */
+		total = nsc_converter_get_total_files (*batch);
+		job = nsc_converter_next_job (*batch);
+		priv->total_files += nsc_converter_get_total_files (*batch) - total;
+
+		if (job != NULL) {
+			g_queue_push_tail (priv->batches, *batch);
+			return job;
+		}
+
+		/* Nothing left to start in this batch */
+		g_object_unref (*batch);
+	}
+
+	return NULL;
+}
+
+/**
+ * Called as the worker's job is about to finish: set the job after
+ * it aside for the worker, and preroll it on the spare so it is
+ * opened and its decoder plugged by the time it is started.
+ */
+static void
+preroll_next_job (Worker *worker)
+{
+	NscSchedulerPrivate *priv = NSC_SCHEDULER_GET_PRIVATE (worker->scheduler);
+	NscConverter        *batch;
+	NscJob              *job;
+
+	if (worker->next_job != NULL)
+		return;
+
+	/* This worker will not get another job when it is done */
+	if (priv->busy > priv->limit)
+		return;
+
+	job = take_job (worker->scheduler, &batch);
+	if (job == NULL)
+		return;
+
+	worker->next_batch = g_object_ref (batch);
+	worker->next_job = job;
+	nsc_trace_instant (worker, "take next job", NULL);
+
+	/* A part of a file still needs its seek, so isn't prerolled */
+	if (job->start != 0 || GST_CLOCK_TIME_IS_VALID (job->stop))
+		return;
+
+	worker_set_spare_profile (worker, nsc_converter_get_profile (batch));
+	configure_gst (worker->spare, batch, job);
+	nsc_gstreamer_preroll_file (worker->spare, job->src, job->sink);
+}
+
+static void
+release_next_job (Worker *worker)
+{
+	NscSchedulerPrivate *priv = NSC_SCHEDULER_GET_PRIVATE (worker->scheduler);
+
+	if (worker->next_job == NULL)
+		return;
+
+	if (worker->spare != NULL)
+		nsc_gstreamer_cancel_convert (worker->spare);
+	nsc_trace_instant (worker, "give back next job", NULL);
+
+	nsc_converter_retry_job (worker->next_batch, worker->next_job);
+	if (g_queue_find (priv->batches, worker->next_batch) == NULL)
+		g_queue_push_tail (priv->batches, g_object_ref (worker->next_batch));
+
+	g_clear_object (&worker->next_batch);
+	worker->next_job = NULL;
+}
+
+/**
+ * Start the job set aside by preroll_next_job() on the spare, unless
+ * there are fewer jobs allowed by now, in which case it goes back.
+ */
+static void
+start_next_job (Worker *worker)
+{
+	NscSchedulerPrivate *priv = NSC_SCHEDULER_GET_PRIVATE (worker->scheduler);
+	NscConverter        *batch;
+	NscJob              *job;
+	NscGStreamer        *gst;
+	gchar               *name;
+
+	if (worker->next_job == NULL)
+		return;
+
+	if (priv->busy >= priv->limit) {
+		release_next_job (worker);
+		return;
+	}
+
+	batch = worker->next_batch;
+	job = worker->next_job;
+	worker->next_batch = NULL;
+	worker->next_job = NULL;
+
+	if (worker->spare != NULL) {
+		gst = worker->gst;
+		worker->gst = worker->spare;
+		worker->spare = gst;
+
+		name = worker->profile_name;
+		worker->profile_name = worker->spare_profile;
+		worker->spare_profile = name;
+	}
+
+	start_job (worker, batch, job);
+	g_object_unref (batch);
+}
+
+static gboolean
+retry_cb (gpointer user_data)
+{
+	Retry               *retry = user_data;
+	NscSchedulerPrivate *priv = NSC_SCHEDULER_GET_PRIVATE (retry->scheduler);
+
+	priv->retries = g_slist_remove (priv->retries, retry);
+
+	nsc_converter_retry_job (retry->batch, retry->job);
+	retry->job = NULL;
+
+	/* The batch may have run out of other jobs meanwhile */
+	if (g_queue_find (priv->batches, retry->batch) == NULL)
+		g_queue_push_tail (priv->batches, g_object_ref (retry->batch));
+
+	schedule (retry->scheduler);
+
+	retry->source_id = 0;
+	g_object_unref (retry->batch);
+	g_free (retry);
+
+	return FALSE;
+}
+
+/**
+ * Try a job again later, waiting twice as long after each failure
+ * so a flaky network share has time to come back.
+ */
+static void
+retry_job (NscScheduler *scheduler,
+	   NscConverter *batch,
+	   NscJob       *job,
+	   GError       *error)
+{
+	NscSchedulerPrivate *priv = NSC_SCHEDULER_GET_PRIVATE (scheduler);
+	Retry               *retry;
+	gchar               *name;
+	guint                delay;
+
+	delay = RETRY_DELAY << job->attempts;
+	job->attempts++;
+
+	name = g_file_get_parse_name (job->src);
+	g_message ("Retrying the conversion of %s in %u seconds: %s",
+		   name, delay, error->message);
+	nsc_trace_instant (scheduler, "retry later", name);
+	g_free (name);
+
+	retry = g_new0 (Retry, 1);
+	retry->scheduler = scheduler;
+	retry->batch = g_object_ref (batch);
+	retry->job = job;
+	retry->source_id = g_timeout_add_seconds (delay, retry_cb, retry);
+	priv->retries = g_slist_prepend (priv->retries, retry);
+}
+
+/**
+ * Add what the job took to the history, whether it worked or not.
+ */
+static void
+record_job (Worker       *worker,
+	    NscConverter *batch,
+	    NscJob       *job,
+	    GError       *error,
+	    gboolean      retried)
+{
+	NscSchedulerPrivate *priv = NSC_SCHEDULER_GET_PRIVATE (worker->scheduler);
+	NscHistoryRecord    *record;
+	GstEncodingProfile  *profile;
+
+	if (!priv->keep_history)
+		return;
+
+	profile = nsc_converter_get_profile (batch);
+
+	record = g_new0 (NscHistoryRecord, 1);
+	record->src = g_object_ref (job->src);
+	record->sink = g_object_ref (job->sink);
+	record->target = g_strdup (gst_encoding_profile_get_name (profile));
+	record->target_type = rb_gst_encoding_profile_get_media_type (profile);
+	record->preset = g_strdup (nsc_converter_get_preset (batch));
+	record->part = job->start != 0 || GST_CLOCK_TIME_IS_VALID (job->stop);
+	record->duration = worker->duration ? worker->duration : worker->position;
+	record->wall_time = g_get_monotonic_time () - worker->started;
+	record->concurrency = worker->concurrency;
+	record->attempt = job->attempts + 1;
+	record->error = error ? g_strdup (error->message) : NULL;
+	record->retried = retried;
+
+	g_object_get (G_OBJECT (worker->gst),
+		      "cpu-time", &record->cpu_time,
+		      "peak-rss", &record->peak_rss,
+		      "pcm-md5", &record->pcm_md5,
+		      NULL);
+
+	nsc_history_add (record);
+}
+
+static void
+finish_job (Worker *worker, GError *error)
+{
+	NscScheduler        *scheduler = worker->scheduler;
+	NscSchedulerPrivate *priv = NSC_SCHEDULER_GET_PRIVATE (scheduler);
+	NscConverter        *batch;
+	NscJob              *job;
+	gboolean             retry;
+
+	g_return_if_fail (worker->batch != NULL);
+
+	batch = worker->batch;
+	job = worker->job;
+
+	worker->batch = NULL;
+	worker->job = NULL;
+	priv->busy--;
+	nsc_trace_counter ("jobs running", priv->busy);
+
+	if (nsc_trace_start () != 0) {
+		gchar *name;
+
+		name = g_file_get_parse_name (job->src);
+		nsc_trace_span (worker, error == NULL ? "job" : "failed job",
+				worker->started, name);
+		g_free (name);
+	}
+
+	retry = nsc_error_is_transient (error) && job->attempts + 1 < MAX_ATTEMPTS;
+	record_job (worker, batch, job, error, retry);
+
+	if (retry) {
+		retry_job (scheduler, batch, job, error);
+		g_object_unref (batch);
+		start_next_job (worker);
+		schedule (scheduler);
+		return;
+	}
+
+	/* Increment converted total */
+	priv->files_done++;
+	priv->done_seconds += worker->duration ? worker->duration : worker->position;
+
+	if (error == NULL && worker->has_replaygain)
+		nsc_converter_job_replaygain (batch, job, worker->gain,
+					      worker->peak, worker->duration);
+	nsc_converter_job_finished (batch, job, error);
+
+	g_object_unref (batch);
+	nsc_job_free (job);
+
+	if (priv->progressbar) {
+		gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (priv->progressbar),
+					       (double) priv->files_done / priv->total_files);
+		update_progressbar_text (scheduler);
+	}
+
+	start_next_job (worker);
+	schedule (scheduler);
+}
+
+/**
+ * Start jobs until all the slots are busy.
+ */
+static gboolean
+schedule_cb (gpointer user_data)
+{
+	NscScheduler        *scheduler = NSC_SCHEDULER (user_data);
+	NscSchedulerPrivate *priv = NSC_SCHEDULER_GET_PRIVATE (scheduler);
+	NscConverter        *batch;
+	NscJob              *job;
+
+	priv->schedule_id = 0;
+
+	while (priv->busy < priv->limit &&
+	       (job = take_job (scheduler, &batch)) != NULL)
+		start_job (get_idle_worker (scheduler), batch, job);
+
+	if (priv->busy == 0 && g_queue_is_empty (priv->batches) &&
+	    priv->retries == NULL)
+		hide_progress (scheduler);
+	else if (priv->progressbar)
+		update_progressbar_text (scheduler);
+
+	return FALSE;
+}
+
+static void
+schedule (NscScheduler *scheduler)
+{
+	NscSchedulerPrivate *priv = NSC_SCHEDULER_GET_PRIVATE (scheduler);
+
+	/*
+	 * Always go through the main loop, so a run of files that fail
+	 * straight away does not recurse through finish_job().
+	 */
+	if (priv->schedule_id == 0)
+		priv->schedule_id = g_idle_add (schedule_cb, scheduler);
+}
+
+/**
+ * Add up the durations the media index knows of the batch's files,
+ * for the ETA.  Cue sheets don't count, their disc images aren't
+ * converted whole.
+ */
+static void
+add_indexed_seconds (NscScheduler *scheduler,
+		     NscConverter *batch)
+{
+	NscSchedulerPrivate *priv = NSC_SCHEDULER_GET_PRIVATE (scheduler);
+	NscFileList         *files = NULL;
+	NscMediaInfo         info;
+	guint                i;
+
+	g_object_get (G_OBJECT (batch), "files", &files, NULL);
+	if (files == NULL)
+		return;
+
+	for (i = 0; i < nsc_file_list_length (files); i++) {
+		if (nsc_file_list_get_flags (files, i) != NSC_FILE_AUDIO)
+			continue;
+
+		priv->batch_files++;
+
+		if (nsc_index_lookup (nsc_file_list_get_uri (files, i), &info) &&
+		    GST_CLOCK_TIME_IS_VALID (info.duration)) {
+			priv->indexed_files++;
+			priv->indexed_seconds += info.duration / GST_SECOND;
+		}
+	}
+}
+
+/*
+ * Public Methods
+ */
+NscScheduler *
+nsc_scheduler_get_default (void)
+{
+	static NscScheduler *scheduler = NULL;
+
+	if (scheduler == NULL)
+		scheduler = g_object_new (NSC_TYPE_SCHEDULER, NULL);
+
+	return scheduler;
+}
+
+void
+nsc_scheduler_add_batch (NscScheduler *scheduler,
+			 NscConverter *batch)
+{
+	NscSchedulerPrivate *priv;
+
+	g_return_if_fail (NSC_IS_SCHEDULER (scheduler));
+	g_return_if_fail (NSC_IS_CONVERTER (batch));
+
+	priv = NSC_SCHEDULER_GET_PRIVATE (scheduler);
+
+	g_queue_push_tail (priv->batches, g_object_ref (batch));
+	priv->total_files += nsc_converter_get_total_files (batch);
+	add_indexed_seconds (scheduler, batch);
+	nsc_trace_instant (scheduler, "add batch", NULL);
+	nsc_trace_counter ("job limit", priv->limit);
+
+	show_progress (scheduler);
+	update_progressbar_text (scheduler);
+	start_control (scheduler);
+
+	schedule (scheduler);
+}
+
+void
+nsc_scheduler_cancel_all (NscScheduler *scheduler)
+{
+	NscSchedulerPrivate *priv;
+	guint                i;
+
+	g_return_if_fail (NSC_IS_SCHEDULER (scheduler));
+
+	priv = NSC_SCHEDULER_GET_PRIVATE (scheduler);
+
+	/* Drop everything that hasn't started */
+	g_queue_foreach (priv->batches, (GFunc) g_object_unref, NULL);
+	g_queue_clear (priv->batches);
+
+	g_slist_free_full (priv->retries, (GDestroyNotify) retry_free);
+	priv->retries = NULL;
+
+	for (i = 0; i < priv->workers->len; i++) {
+		Worker *worker = g_ptr_array_index (priv->workers, i);
+
+		if (worker->next_job != NULL) {
+			if (worker->spare != NULL)
+				nsc_gstreamer_cancel_convert (worker->spare);
+			g_clear_object (&worker->next_batch);
+			nsc_job_free (worker->next_job);
+			worker->next_job = NULL;
+		}
+
+		if (worker->batch == NULL)
+			continue;
+
+		nsc_gstreamer_cancel_convert (worker->gst);
+
+		g_object_unref (worker->batch);
+		nsc_job_free (worker->job);
+		worker->batch = NULL;
+		worker->job = NULL;
+	}
+	priv->busy = 0;
+
+	hide_progress (scheduler);
+}
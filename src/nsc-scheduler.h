@@ -0,0 +1,70 @@
+/*
+ *  nsc-scheduler.h
+ * 
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ * 
+ */
+
+#ifndef NSC_SCHEDULER_H
+#define NSC_SCHEDULER_H
+
+#include <glib-object.h>
+
+#include "nsc-converter.h"
+
+G_BEGIN_DECLS
+
+#define NSC_TYPE_SCHEDULER         (nsc_scheduler_get_type ())
+#define NSC_SCHEDULER(o)           (G_TYPE_CHECK_INSTANCE_CAST ((o), NSC_TYPE_SCHEDULER, NscScheduler))
+#define NSC_SCHEDULER_CLASS(k)     (G_TYPE_CHECK_CLASS_CAST((k), NSC_TYPE_SCHEDULER, NscSchedulerClass))
+#define NSC_IS_SCHEDULER(o)        (G_TYPE_CHECK_INSTANCE_TYPE ((o), NSC_TYPE_SCHEDULER))
+#define NSC_IS_SCHEDULER_CLASS(k)  (G_TYPE_CHECK_CLASS_TYPE ((k), NSC_TYPE_SCHEDULER))
+#define NSC_SCHEDULER_GET_CLASS(o) (G_TYPE_INSTANCE_GET_CLASS ((o), NSC_TYPE_SCHEDULER, NscSchedulerClass))
+
+typedef struct _NscScheduler      NscScheduler;
+typedef struct _NscSchedulerClass NscSchedulerClass;
+
+/*
+ * The process-wide conversion queue.  Every NscConverter is a batch
+ * submitted to it; jobs are taken from the batches in turn and run on
+ * a bounded set of NscGStreamer objects, with one progress dialog
+ * covering everything that is queued.
+ */
+struct _NscScheduler {
+	/* Parent object */
+	GObject  parent;
+	/* Private data pointer */
+	gpointer priv;
+};
+
+struct _NscSchedulerClass {
+	GObjectClass parent_class;
+	/* Everything queued was converted, failed or was cancelled */
+	void (*idle) (NscScheduler *scheduler, gint files);
+};
+
+GType		 nsc_scheduler_get_type    (void);
+NscScheduler	*nsc_scheduler_get_default (void);
+void		 nsc_scheduler_add_batch   (NscScheduler *scheduler,
+					    NscConverter *batch);
+void		 nsc_scheduler_cancel_all  (NscScheduler *scheduler);
+
+G_END_DECLS
+
+#endif /* NSC_SCHEDULER_H */
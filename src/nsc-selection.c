@@ -0,0 +1,243 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-selection.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+#include <config.h>
+
+#include "nsc-gstreamer.h"
+#include "nsc-index.h"
+#include "nsc-latency.h"
+#include "nsc-selection.h"
+
+#include <string.h> /* For strcmp */
+
+/*
+ * These are the formats we require, so
+ * no check of plugin support is needed
+ */
+static gchar *mime_types[] = {
+	"audio/x-flac",
+	"audio/x-vorbis+ogg",
+	"audio/ogg",
+	"audio/x-wav",
+	NULL
+};
+
+/* Files looked at per main loop iteration when filtering a selection */
+#define FILTER_CHUNK 256
+
+struct _NscSelectionFilter {
+	GList       *files;
+	GList       *next;
+	NscFileList *sounds;
+};
+
+/*
+ * Private Methods
+ */
+
+/**
+ * The types we can convert: the ones above, plus those whose
+ * plugins are installed.  Probing for a plugin means creating an
+ * element, so it is only done once.
+ */
+static const gchar * const *
+get_supported_types (void)
+{
+	static GPtrArray *types = NULL;
+	GError           *error = NULL;
+	gint              i;
+
+	if (types != NULL)
+		return (const gchar * const *) types->pdata;
+
+	types = g_ptr_array_new ();
+	for (i = 0; mime_types[i] != NULL; i++)
+		g_ptr_array_add (types, mime_types[i]);
+
+	/* Check for mp3 support */
+	if (nsc_gstreamer_supports_mp3 (&error))
+		g_ptr_array_add (types, "audio/mpeg");
+	else
+		g_clear_error (&error);
+
+	/* Check for aac suppport */
+	if (nsc_gstreamer_supports_aac (&error))
+		g_ptr_array_add (types, "audio/mp4");
+	else
+		g_clear_error (&error);
+
+	/* Check for Musepack support */
+	if (nsc_gstreamer_supports_musepack (&error))
+		g_ptr_array_add (types, "audio/x-musepack");
+	else
+		g_clear_error (&error);
+
+	/* Check for wma support */
+	if (nsc_gstreamer_supports_wma (&error))
+		g_ptr_array_add (types, "audio/x-ms-wma");
+	else
+		g_clear_error (&error);
+
+	g_ptr_array_add (types, NULL);
+
+	return (const gchar * const *) types->pdata;
+}
+
+/*
+ * Public Methods
+ */
+
+/**
+ * Whether the file can be converted, and if so whether it is a
+ * cue sheet, which stands for the disc image it describes.
+ */
+gboolean
+nsc_selection_is_sound (CajaFileInfo *file_info, NscFileFlags *flags)
+{
+	const gchar * const *types;
+	gchar               *scheme;
+	gboolean             sound = FALSE;
+	gint64               start;
+	gint                 i;
+
+	start = nsc_latency_start ();
+
+	/* Is this a file? */
+	scheme = caja_file_info_get_uri_scheme (file_info);
+
+	if (strcmp (scheme, "file") != 0)
+		goto out;
+
+	*flags = NSC_FILE_AUDIO;
+
+	types = get_supported_types ();
+	for (i = 0; types[i] != NULL && !sound; i++)
+		sound = caja_file_info_is_mime_type (file_info, types[i]);
+
+	if (!sound && caja_file_info_is_mime_type (file_info, "application/x-cue")) {
+		*flags = NSC_FILE_CUE;
+		sound = TRUE;
+	}
+
+out:
+	g_free (scheme);
+	nsc_latency_record ("file_is_sound", start);
+
+	return sound;
+}
+
+/**
+ * Whether any of the files can be converted, which is all the
+ * context menu needs to know.
+ */
+gboolean
+nsc_selection_has_sound (GList *files)
+{
+	GList *scan;
+
+	for (scan = files; scan; scan = scan->next) {
+		NscFileFlags flags;
+
+		if (nsc_selection_is_sound (scan->data, &flags))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * Start filtering a copy of files.  Each nsc_selection_filter_step()
+ * looks at a chunk of them, so that Caja stays responsive even with
+ * a six-figure selection.
+ */
+NscSelectionFilter *
+nsc_selection_filter_new (GList *files)
+{
+	NscSelectionFilter *filter;
+
+	filter = g_new0 (NscSelectionFilter, 1);
+	filter->files = caja_file_info_list_copy (files);
+	filter->next = filter->files;
+	filter->sounds = nsc_file_list_new ();
+
+	return filter;
+}
+
+/**
+ * Filter the next chunk of files.  Returns TRUE while there are
+ * more, so it can be used as an idle callback.
+ */
+gboolean
+nsc_selection_filter_step (NscSelectionFilter *filter)
+{
+	gint64 start;
+	guint  n;
+
+	start = nsc_latency_start ();
+
+	for (n = 0; filter->next != NULL && n < FILTER_CHUNK; n++) {
+		CajaFileInfo *file_info = filter->next->data;
+		NscFileFlags  flags;
+
+		if (nsc_selection_is_sound (file_info, &flags)) {
+			NscMediaInfo  info;
+			gchar        *uri;
+
+			uri = caja_file_info_get_uri (file_info);
+
+			/* Leave out the files known to have no audio after all */
+			if (flags != NSC_FILE_AUDIO ||
+			    !nsc_index_lookup (uri, &info) || info.audio)
+				nsc_file_list_add (filter->sounds, uri, flags);
+
+			/* Find out about it in the background, for the ETA */
+			if (flags == NSC_FILE_AUDIO)
+				nsc_index_scan (uri);
+
+			g_free (uri);
+		}
+
+		filter->next = filter->next->next;
+	}
+
+	/* How long Caja is kept waiting at a time */
+	nsc_latency_record ("filter_files_chunk", start);
+
+	return filter->next != NULL;
+}
+
+/**
+ * Free the filter and return the files that can be converted, which
+ * may be none.
+ */
+NscFileList *
+nsc_selection_filter_finish (NscSelectionFilter *filter)
+{
+	NscFileList *sounds = filter->sounds;
+
+	caja_file_info_list_free (filter->files);
+	g_free (filter);
+
+	return sounds;
+}
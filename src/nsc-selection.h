@@ -0,0 +1,51 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-selection.h
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+#ifndef NSC_SELECTION_H
+#define NSC_SELECTION_H
+
+#include <glib.h>
+#include <libcaja-extension/caja-file-info.h>
+
+#include "nsc-file-list.h"
+
+G_BEGIN_DECLS
+
+/*
+ * What of a Caja selection can be converted.  This is the work Caja
+ * waits on while files are selected and "Convert..." is chosen.
+ */
+typedef struct _NscSelectionFilter NscSelectionFilter;
+
+gboolean            nsc_selection_is_sound      (CajaFileInfo       *file_info,
+						 NscFileFlags       *flags);
+gboolean            nsc_selection_has_sound     (GList              *files);
+
+NscSelectionFilter *nsc_selection_filter_new    (GList              *files);
+gboolean            nsc_selection_filter_step   (NscSelectionFilter *filter);
+NscFileList        *nsc_selection_filter_finish (NscSelectionFilter *filter);
+
+G_END_DECLS
+
+#endif /* NSC_SELECTION_H */
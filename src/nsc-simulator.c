@@ -0,0 +1,391 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-simulator.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+/*
+ * The simulation is set up by NSC_SIMULATE, a comma separated list
+ * of KEY=VALUE, e.g.
+ *
+ *   NSC_SIMULATE="cpu=exp:20,io=1-3,length=exp:240,fail=0.01,speed=1000"
+ *
+ * cpu, io and length are the CPU seconds, I/O seconds and seconds of
+ * audio of each file, as a fixed value, "MIN-MAX" for a uniform
+ * distribution or "exp:MEAN" for an exponential one.  fail is the
+ * chance of a file failing, transient the share of failures that
+ * are worth retrying, speed how many times faster than real time
+ * everything runs and seed picks the random numbers.  Each file's
+ * numbers only depend on the seed and its URI, so a run can be
+ * repeated whatever order the files happen to be converted in.
+ *
+ * The CPU time of the files converting at once is shared between
+ * the processors, so more jobs than processors stop paying off.
+ */
+
+#include <config.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "nsc-simulator.h"
+
+/* Progress is reported this many times over a file */
+#define N_STEPS 4
+
+typedef enum {
+	DIST_FIXED,
+	DIST_UNIFORM,
+	DIST_EXPONENTIAL
+} Distribution;
+
+typedef struct {
+	Distribution dist;
+	gdouble      a;
+	gdouble      b;
+} Variable;
+
+typedef struct {
+	Variable cpu;
+	Variable io;
+	Variable length;
+	gdouble  fail;
+	gdouble  transient;
+	gdouble  speed;
+	guint32  seed;
+} Config;
+
+struct NscSimulatorPrivate {
+	/* A file is being converted */
+	gboolean active;
+	guint    timeout_id;
+	guint    step;
+
+	/* Bumped whenever a file is started or stopped, so a signal
+	 * handler that does either is noticed */
+	guint    generation;
+
+	/* Step at which the file fails, 0 if it doesn't */
+	guint    fail_step;
+	gboolean transient;
+
+	gint     length;
+	guint    interval;
+	guint64  cpu_time;
+};
+
+static Config config = {
+	{ DIST_FIXED, 2.0, 0.0 },
+	{ DIST_FIXED, 0.5, 0.0 },
+	{ DIST_FIXED, 240.0, 0.0 },
+	0.0, 0.5, 1.0, 0
+};
+
+/* Simulated files converting at the moment, over all instances */
+static guint running = 0;
+
+G_DEFINE_TYPE (NscSimulator, nsc_simulator, NSC_TYPE_GSTREAMER);
+
+#define NSC_SIMULATOR_GET_PRIVATE(o)                        \
+	((NscSimulatorPrivate *)((NSC_SIMULATOR(o))->priv))
+
+/*
+ * Private Methods
+ */
+static gboolean
+parse_variable (const gchar *value, Variable *var)
+{
+	gchar *end;
+
+	if (g_str_has_prefix (value, "exp:")) {
+		var->dist = DIST_EXPONENTIAL;
+		var->a = g_ascii_strtod (value + 4, &end);
+	} else {
+		var->dist = DIST_FIXED;
+		var->a = g_ascii_strtod (value, &end);
+		if (*end == '-') {
+			var->dist = DIST_UNIFORM;
+			var->b = g_ascii_strtod (end + 1, &end);
+		}
+	}
+
+	return *end == '\0' && var->a >= 0 &&
+		(var->dist != DIST_UNIFORM || var->b >= var->a);
+}
+
+static void
+parse_config (const gchar *spec)
+{
+	gchar **items;
+	guint   i;
+
+	items = g_strsplit (spec, ",", 0);
+	for (i = 0; items[i] != NULL; i++) {
+		gchar    *key = g_strstrip (items[i]);
+		gchar    *value;
+		gboolean  ok = FALSE;
+
+		if (*key == '\0')
+			continue;
+
+		value = strchr (key, '=');
+		if (value != NULL) {
+			*value++ = '\0';
+
+			if (strcmp (key, "cpu") == 0)
+				ok = parse_variable (value, &config.cpu);
+			else if (strcmp (key, "io") == 0)
+				ok = parse_variable (value, &config.io);
+			else if (strcmp (key, "length") == 0)
+				ok = parse_variable (value, &config.length);
+			else if (strcmp (key, "fail") == 0)
+				ok = (config.fail = g_ascii_strtod (value, NULL)) >= 0;
+			else if (strcmp (key, "transient") == 0)
+				ok = (config.transient = g_ascii_strtod (value, NULL)) >= 0;
+			else if (strcmp (key, "speed") == 0)
+				ok = (config.speed = g_ascii_strtod (value, NULL)) > 0;
+			else if (strcmp (key, "seed") == 0)
+				ok = (config.seed = strtoul (value, NULL, 10), TRUE);
+		}
+
+		if (!ok)
+			g_warning ("Ignoring NSC_SIMULATE item \"%s\"", items[i]);
+	}
+	g_strfreev (items);
+
+	if (config.speed <= 0)
+		config.speed = 1.0;
+}
+
+static gdouble
+draw (GRand *rand, const Variable *var)
+{
+	switch (var->dist) {
+	case DIST_UNIFORM:
+		return g_rand_double_range (rand, var->a, var->b);
+	case DIST_EXPONENTIAL:
+		return -var->a * log (1.0 - g_rand_double (rand));
+	default:
+		return var->a;
+	}
+}
+
+static void
+stop_job (NscSimulator *simulator)
+{
+	NscSimulatorPrivate *priv = NSC_SIMULATOR_GET_PRIVATE (simulator);
+
+	priv->generation++;
+	if (!priv->active)
+		return;
+
+	if (priv->timeout_id != 0)
+		g_source_remove (priv->timeout_id);
+	priv->timeout_id = 0;
+	priv->active = FALSE;
+	running--;
+}
+
+static gboolean
+step_cb (gpointer user_data)
+{
+	NscSimulator        *simulator = NSC_SIMULATOR (user_data);
+	NscSimulatorPrivate *priv = NSC_SIMULATOR_GET_PRIVATE (simulator);
+	GError              *error;
+	guint                step, generation;
+
+	priv->timeout_id = 0;
+	step = priv->step++;
+	generation = priv->generation;
+
+	/* Handlers may well drop the last reference */
+	g_object_ref (simulator);
+
+	if (priv->fail_step != 0 && step == priv->fail_step) {
+		priv->active = FALSE;
+		running--;
+
+		if (priv->transient)
+			error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+						     "Simulated transient failure");
+		else
+			error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+						     "Simulated failure");
+		g_signal_emit_by_name (simulator, "error", error);
+		g_error_free (error);
+	} else if (step == N_STEPS) {
+		priv->active = FALSE;
+		running--;
+
+		g_object_set (G_OBJECT (simulator),
+			      "cpu-time", priv->cpu_time,
+			      NULL);
+		g_signal_emit_by_name (simulator, "completion");
+	} else {
+		if (step == 0)
+			g_signal_emit_by_name (simulator, "duration",
+					       priv->length);
+		else
+			g_signal_emit_by_name (simulator, "progress",
+					       priv->length * step / N_STEPS);
+
+		if (priv->generation == generation)
+			priv->timeout_id = g_timeout_add (priv->interval,
+							  step_cb, simulator);
+	}
+
+	g_object_unref (simulator);
+
+	return FALSE;
+}
+
+static void
+nsc_simulator_convert_file (NscGStreamer *gstreamer,
+			    GFile        *src,
+			    GFile        *sink,
+			    GError      **error)
+{
+	NscSimulator        *simulator = NSC_SIMULATOR (gstreamer);
+	NscSimulatorPrivate *priv = NSC_SIMULATOR_GET_PRIVATE (simulator);
+	GRand               *rand;
+	gchar               *uri;
+	gdouble              cpu, io, share;
+
+	g_return_if_fail (src != NULL);
+	g_return_if_fail (sink != NULL);
+
+	stop_job (simulator);
+
+	uri = g_file_get_uri (src);
+	rand = g_rand_new_with_seed (config.seed ^ g_str_hash (uri));
+	g_free (uri);
+
+	cpu = draw (rand, &config.cpu);
+	io = draw (rand, &config.io);
+	priv->length = MAX (1, (gint) draw (rand, &config.length));
+
+	priv->fail_step = 0;
+	if (g_rand_double (rand) < config.fail) {
+		priv->fail_step = g_rand_int_range (rand, 1, N_STEPS + 1);
+		priv->transient = g_rand_double (rand) < config.transient;
+	}
+	g_rand_free (rand);
+
+	/* The processors are shared between the files converting */
+	priv->active = TRUE;
+	running++;
+	share = MAX (1.0, (gdouble) running / g_get_num_processors ());
+
+	priv->cpu_time = cpu * G_USEC_PER_SEC;
+	priv->interval = (io + cpu * share) * 1000 / config.speed / N_STEPS;
+	priv->step = 0;
+
+	g_object_set (G_OBJECT (simulator),
+		      "cpu-time", (guint64) 0,
+		      "peak-rss", (guint64) 0,
+		      "pcm-md5", NULL,
+		      NULL);
+
+	/* Signals are never emitted from within convert_file() */
+	priv->timeout_id = g_idle_add (step_cb, simulator);
+}
+
+static void
+nsc_simulator_cancel_convert (NscGStreamer *gstreamer)
+{
+	stop_job (NSC_SIMULATOR (gstreamer));
+}
+
+/* There is nothing to get ready */
+static void
+nsc_simulator_preroll_file (NscGStreamer *gstreamer,
+			    GFile        *src,
+			    GFile        *sink)
+{
+}
+
+/*
+ * GObject methods
+ */
+static void
+nsc_simulator_dispose (GObject *object)
+{
+	NscSimulator *self = NSC_SIMULATOR (object);
+
+	if (self->priv != NULL)
+		stop_job (self);
+
+	G_OBJECT_CLASS (nsc_simulator_parent_class)->dispose (object);
+}
+
+static void
+nsc_simulator_finalize (GObject *object)
+{
+	NscSimulator *self = NSC_SIMULATOR (object);
+
+	g_free (self->priv);
+	self->priv = NULL;
+
+	G_OBJECT_CLASS (nsc_simulator_parent_class)->finalize (object);
+}
+
+static void
+nsc_simulator_class_init (NscSimulatorClass *klass)
+{
+	GObjectClass      *object_class = G_OBJECT_CLASS (klass);
+	NscGStreamerClass *gstreamer_class = NSC_GSTREAMER_CLASS (klass);
+
+	object_class->dispose  = nsc_simulator_dispose;
+	object_class->finalize = nsc_simulator_finalize;
+
+	gstreamer_class->convert_file   = nsc_simulator_convert_file;
+	gstreamer_class->cancel_convert = nsc_simulator_cancel_convert;
+	gstreamer_class->preroll_file   = nsc_simulator_preroll_file;
+
+	if (nsc_simulator_enabled ())
+		parse_config (g_getenv ("NSC_SIMULATE"));
+}
+
+static void
+nsc_simulator_init (NscSimulator *self)
+{
+	self->priv = g_malloc0 (sizeof (NscSimulatorPrivate));
+}
+
+/*
+ * Public Methods
+ */
+
+/* Whether NSC_SIMULATE asks for simulated conversions */
+gboolean
+nsc_simulator_enabled (void)
+{
+	return g_getenv ("NSC_SIMULATE") != NULL;
+}
+
+NscGStreamer *
+nsc_simulator_new (GstEncodingProfile *profile)
+{
+	return g_object_new (NSC_TYPE_SIMULATOR, "profile", profile, NULL);
+}
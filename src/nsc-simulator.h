@@ -0,0 +1,63 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-simulator.h
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+#ifndef NSC_SIMULATOR_H
+#define NSC_SIMULATOR_H
+
+#include "nsc-gstreamer.h"
+
+G_BEGIN_DECLS
+
+#define NSC_TYPE_SIMULATOR            (nsc_simulator_get_type ())
+#define NSC_SIMULATOR(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), NSC_TYPE_SIMULATOR, NscSimulator))
+#define NSC_SIMULATOR_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), NSC_TYPE_SIMULATOR, NscSimulatorClass))
+#define NSC_IS_SIMULATOR(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), NSC_TYPE_SIMULATOR))
+#define NSC_IS_SIMULATOR_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), NSC_TYPE_SIMULATOR))
+#define NSC_SIMULATOR_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), NSC_TYPE_SIMULATOR, NscSimulatorClass))
+
+typedef struct NscSimulatorPrivate NscSimulatorPrivate;
+
+/*
+ * An NscGStreamer that converts nothing.  It emits the signals a
+ * real conversion would, with made up timings and failures, so the
+ * scheduler can be run against very large batches quickly.
+ */
+typedef struct {
+	/* Parent object */
+	NscGStreamer parent;
+	/* Private data pointer */
+	gpointer     priv;
+} NscSimulator;
+
+typedef struct {
+	NscGStreamerClass parent_class;
+} NscSimulatorClass;
+
+GType         nsc_simulator_get_type (void);
+gboolean      nsc_simulator_enabled  (void);
+NscGStreamer *nsc_simulator_new      (GstEncodingProfile *profile);
+
+G_END_DECLS
+
+#endif /* NSC_SIMULATOR_H */
@@ -0,0 +1,286 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-trace.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+/*
+ * The trace is the JSON array form of the Chrome trace format, one
+ * event per line.  The closing bracket is never written, which the
+ * format allows, so a trace cut short by a crash still loads.  Each
+ * event is flushed as it is written.  Timestamps are the monotonic
+ * clock, so the traces of Caja and the daemon line up.
+ *
+ * With USDT probes built in, e.g.
+ *
+ *   bpftrace -e 'usdt:*:caja_sound_converter:span
+ *                { printf("%s %d us\n", str(arg0), arg3); }'
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#endif
+
+#include "nsc-trace.h"
+
+/* NULL if there is no trace file */
+static FILE *trace = NULL;
+
+/* Track pointer to the tid it is drawn as */
+static GHashTable *tracks = NULL;
+
+G_LOCK_DEFINE_STATIC (trace);
+
+/*
+ * Private Methods
+ */
+static gboolean
+trace_enabled (void)
+{
+	static gsize enabled = 0;
+
+	if (g_once_init_enter (&enabled)) {
+		const gchar *dir = g_getenv ("NSC_TRACE");
+
+		if (dir != NULL) {
+			gchar *name, *path;
+
+			name = g_strdup_printf ("%s-%d.json",
+						g_get_prgname () ? g_get_prgname () : "caja-sound-converter",
+						(gint) getpid ());
+			path = g_build_filename (dir, name, NULL);
+
+			g_mkdir_with_parents (dir, 0700);
+			trace = g_fopen (path, "w");
+			if (trace == NULL)
+				g_warning ("Unable to write the trace to %s", path);
+			else
+				tracks = g_hash_table_new (NULL, NULL);
+
+			g_free (name);
+			g_free (path);
+		}
+		g_once_init_leave (&enabled, trace != NULL ? 2 : 1);
+	}
+
+	return enabled == 2;
+}
+
+static void
+append_escaped (GString *event, const gchar *str)
+{
+	const gchar *p;
+
+	g_string_append_c (event, '"');
+	for (p = str; *p; p++) {
+		guchar c = *p;
+
+		if (c == '"' || c == '\\')
+			g_string_append_printf (event, "\\%c", c);
+		else if (c < 0x20)
+			g_string_append_printf (event, "\\u%04x", c);
+		else
+			g_string_append_c (event, c);
+	}
+	g_string_append_c (event, '"');
+}
+
+/* With the lock held */
+static gint
+track_id (gconstpointer track)
+{
+	gpointer id;
+
+	if (track == NULL)
+		return 0;
+
+	id = g_hash_table_lookup (tracks, track);
+	if (id == NULL) {
+		id = GINT_TO_POINTER (g_hash_table_size (tracks) + 1);
+		g_hash_table_insert (tracks, (gpointer) track, id);
+	}
+
+	return GPOINTER_TO_INT (id);
+}
+
+/* Starts an event, which write_event() finishes */
+static GString *
+begin_event (const gchar *phase, const gchar *name, gint64 ts)
+{
+	GString *event;
+
+	event = g_string_new ("{\"name\": ");
+	append_escaped (event, name);
+	g_string_append_printf (event, ", \"ph\": \"%s\", \"ts\": %"
+				G_GINT64_FORMAT ", \"pid\": %d",
+				phase, ts, (gint) getpid ());
+
+	return event;
+}
+
+/* With the lock held */
+static void
+write_event (GString *event, const gchar *detail)
+{
+	static gboolean first = TRUE;
+
+	if (detail != NULL) {
+		g_string_append (event, ", \"args\": {\"detail\": ");
+		append_escaped (event, detail);
+		g_string_append_c (event, '}');
+	}
+	g_string_append_c (event, '}');
+
+	fputs (first ? "[\n" : ",\n", trace);
+	fputs (event->str, trace);
+	fflush (trace);
+	first = FALSE;
+
+	g_string_free (event, TRUE);
+}
+
+/*
+ * Public Methods
+ */
+
+/**
+ * The time to pass to nsc_trace_span(), or 0 if nothing is traced.
+ */
+gint64
+nsc_trace_start (void)
+{
+#ifdef HAVE_SYS_SDT_H
+	return g_get_monotonic_time ();
+#else
+	return trace_enabled () ? g_get_monotonic_time () : 0;
+#endif
+}
+
+/**
+ * Give the track a name in the trace, e.g. "worker 2".
+ */
+void
+nsc_trace_name_track (gconstpointer track, const gchar *name)
+{
+	GString *event;
+
+	if (!trace_enabled ())
+		return;
+
+	G_LOCK (trace);
+	event = begin_event ("M", "thread_name", 0);
+	g_string_append_printf (event, ", \"tid\": %d, \"args\": {\"name\": ",
+				track_id (track));
+	append_escaped (event, name);
+	g_string_append_c (event, '}');
+	write_event (event, NULL);
+	G_UNLOCK (trace);
+}
+
+/**
+ * Draw name on the track from start until now.  detail, if not
+ * NULL, is shown along with it, e.g. the file being converted.
+ */
+void
+nsc_trace_span (gconstpointer  track,
+		const gchar   *name,
+		gint64         start,
+		const gchar   *detail)
+{
+	GString *event;
+	gint64   now;
+
+	if (start == 0)
+		return;
+
+	now = g_get_monotonic_time ();
+
+#ifdef HAVE_SYS_SDT_H
+	DTRACE_PROBE4 (caja_sound_converter, span,
+		       name, track, start, now - start);
+#endif
+
+	if (!trace_enabled ())
+		return;
+
+	G_LOCK (trace);
+	event = begin_event ("X", name, start);
+	g_string_append_printf (event, ", \"dur\": %" G_GINT64_FORMAT
+				", \"tid\": %d", now - start, track_id (track));
+	write_event (event, detail);
+	G_UNLOCK (trace);
+}
+
+/**
+ * Mark something that happened on the track now, e.g. a decision
+ * the scheduler took.
+ */
+void
+nsc_trace_instant (gconstpointer  track,
+		   const gchar   *name,
+		   const gchar   *detail)
+{
+	GString *event;
+
+#ifdef HAVE_SYS_SDT_H
+	DTRACE_PROBE3 (caja_sound_converter, instant, name, track, detail);
+#endif
+
+	if (!trace_enabled ())
+		return;
+
+	G_LOCK (trace);
+	event = begin_event ("i", name, g_get_monotonic_time ());
+	g_string_append_printf (event, ", \"s\": \"t\", \"tid\": %d",
+				track_id (track));
+	write_event (event, detail);
+	G_UNLOCK (trace);
+}
+
+/**
+ * Record a value that changes over time, e.g. the number of jobs.
+ */
+void
+nsc_trace_counter (const gchar *name, gint64 value)
+{
+	GString *event;
+
+#ifdef HAVE_SYS_SDT_H
+	DTRACE_PROBE2 (caja_sound_converter, counter, name, value);
+#endif
+
+	if (!trace_enabled ())
+		return;
+
+	G_LOCK (trace);
+	event = begin_event ("C", name, g_get_monotonic_time ());
+	g_string_append_printf (event, ", \"args\": {\"value\": %"
+				G_GINT64_FORMAT "}", value);
+	write_event (event, NULL);
+	G_UNLOCK (trace);
+}
@@ -0,0 +1,59 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-trace.h
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+#ifndef NSC_TRACE_H
+#define NSC_TRACE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * A timeline of the conversions.  With NSC_TRACE set to a directory,
+ * each process writes its spans, instants and counters there as a
+ * Chrome trace, which Perfetto and chrome://tracing load.  Events
+ * are drawn on tracks, one per pointer given as track, e.g. one per
+ * worker.  Built with --enable-usdt, the same events are also USDT
+ * probes of the caja_sound_converter provider.
+ *
+ *	gint64 start = nsc_trace_start ();
+ *	...
+ *	nsc_trace_span (worker, "job", start, uri);
+ */
+gint64 nsc_trace_start      (void);
+void   nsc_trace_name_track (gconstpointer  track,
+			     const gchar   *name);
+void   nsc_trace_span       (gconstpointer  track,
+			     const gchar   *name,
+			     gint64         start,
+			     const gchar   *detail);
+void   nsc_trace_instant    (gconstpointer  track,
+			     const gchar   *name,
+			     const gchar   *detail);
+void   nsc_trace_counter    (const gchar   *name,
+			     gint64         value);
+
+G_END_DECLS
+
+#endif /* NSC_TRACE_H */
@@ -0,0 +1,404 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  nsc-watch.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+/*
+ * Watch folders: every audio file that appears in one of the
+ * watch-folders is converted once nothing has happened to it for
+ * STABLE_SECONDS, so a file still being copied in isn't picked up
+ * half written.  The files of a folder that settle together go to
+ * the scheduler as one batch, which runs on the workers' pipelines
+ * left over from the previous one.  Files already in the folders
+ * when Caja starts are left alone.
+ */
+
+#include <config.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "nsc-converter.h"
+#include "nsc-file-list.h"
+#include "nsc-watch.h"
+
+#define WATCH_SCHEMA "org.mate.caja-sound-converter"
+
+/* Quiet seconds after which a new file is taken to be complete */
+#define STABLE_SECONDS 3
+
+#define WATCH_ATTRIBUTES			\
+	G_FILE_ATTRIBUTE_STANDARD_TYPE ","	\
+	G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE ","	\
+	G_FILE_ATTRIBUTE_STANDARD_SIZE
+
+typedef struct {
+	GFile        *dir;
+	GFile        *destination;
+	GFileMonitor *monitor;
+
+	/* URI to Arrival, for the files not settled yet */
+	GHashTable   *arrivals;
+
+	/* Files settled and checked, and checks still running */
+	NscFileList  *ready;
+	guint         checking;
+} Folder;
+
+typedef struct {
+	/* When the file last changed, and whether it is being checked */
+	gint64        changed;
+	gboolean      checking;
+} Arrival;
+
+/* What a check needs to know about the file it was started on */
+typedef struct {
+	Folder       *folder;
+	guint         generation;
+	gchar        *uri;
+	gint64        started;
+} Check;
+
+static GSettings *settings = NULL;
+
+/* Array of Folder */
+static GPtrArray *folders = NULL;
+
+static guint      tick_id = 0;
+
+/* Bumped whenever the folders are reloaded */
+static guint      generation = 0;
+
+/*
+ * Private Methods
+ */
+static void
+folder_free (Folder *folder)
+{
+	g_signal_handlers_disconnect_by_data (folder->monitor, folder);
+	g_file_monitor_cancel (folder->monitor);
+	g_object_unref (folder->monitor);
+	g_object_unref (folder->dir);
+	g_object_unref (folder->destination);
+	g_hash_table_destroy (folder->arrivals);
+	nsc_file_list_free (folder->ready);
+	g_free (folder);
+}
+
+/* Hand the files that have settled to the scheduler */
+static void
+queue_ready (Folder *folder)
+{
+	NscConverter *converter;
+	GError       *error = NULL;
+	gchar        *media_type;
+
+	if (nsc_file_list_length (folder->ready) == 0)
+		return;
+
+	if (!g_file_make_directory_with_parents (folder->destination, NULL, &error)) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_EXISTS))
+			g_warning ("Unable to create the folder for converted files: %s",
+				   error->message);
+		g_error_free (error);
+	}
+
+	/* The batch takes the list over */
+	converter = nsc_converter_new (folder->ready);
+	folder->ready = nsc_file_list_new ();
+
+	media_type = g_settings_get_string (settings, "watch-profile");
+	if (!nsc_converter_start (converter, media_type, folder->destination))
+		g_warning ("No encoding profile for %s to convert the watched files to",
+			   media_type);
+	g_free (media_type);
+
+	g_object_unref (converter);
+}
+
+static void
+check_done_cb (GObject      *source,
+	       GAsyncResult *result,
+	       gpointer      user_data)
+{
+	Check     *check = user_data;
+	Folder    *folder = check->folder;
+	Arrival   *arrival;
+	GFileInfo *info;
+
+	info = g_file_query_info_finish (G_FILE (source), result, NULL);
+
+	/* The folder has been dropped meanwhile */
+	if (check->generation != generation) {
+		g_clear_object (&info);
+		goto out;
+	}
+
+	folder->checking--;
+	arrival = g_hash_table_lookup (folder->arrivals, check->uri);
+
+	if (arrival != NULL && arrival->changed > check->started) {
+		/* Written to again while it was being checked */
+		arrival->checking = FALSE;
+	} else if (arrival != NULL) {
+		g_hash_table_remove (folder->arrivals, check->uri);
+
+		if (info != NULL &&
+		    g_file_info_get_file_type (info) == G_FILE_TYPE_REGULAR &&
+		    g_file_info_get_size (info) > 0 &&
+		    g_file_info_get_content_type (info) != NULL &&
+		    g_str_has_prefix (g_file_info_get_content_type (info), "audio/"))
+			nsc_file_list_add (folder->ready, check->uri, NSC_FILE_AUDIO);
+	}
+	g_clear_object (&info);
+
+	if (folder->checking == 0)
+		queue_ready (folder);
+
+out:
+	g_free (check->uri);
+	g_free (check);
+}
+
+static gboolean
+tick_cb (gpointer user_data)
+{
+	gint64  now;
+	guint   i, waiting = 0;
+
+	now = g_get_monotonic_time ();
+
+	for (i = 0; i < folders->len; i++) {
+		Folder         *folder = g_ptr_array_index (folders, i);
+		GHashTableIter  iter;
+		gpointer        key, value;
+
+		g_hash_table_iter_init (&iter, folder->arrivals);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			Arrival *arrival = value;
+			Check   *check;
+			GFile   *file;
+
+			waiting++;
+			if (arrival->checking ||
+			    now - arrival->changed < STABLE_SECONDS * G_USEC_PER_SEC)
+				continue;
+
+			arrival->checking = TRUE;
+			folder->checking++;
+
+			check = g_new (Check, 1);
+			check->folder = folder;
+			check->generation = generation;
+			check->uri = g_strdup (key);
+			check->started = now;
+
+			file = g_file_new_for_uri (key);
+			g_file_query_info_async (file, WATCH_ATTRIBUTES,
+						 G_FILE_QUERY_INFO_NONE,
+						 G_PRIORITY_DEFAULT, NULL,
+						 check_done_cb, check);
+			g_object_unref (file);
+		}
+	}
+
+	if (waiting == 0) {
+		tick_id = 0;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+monitor_changed_cb (GFileMonitor      *monitor,
+		    GFile             *file,
+		    GFile             *other_file,
+		    GFileMonitorEvent  event,
+		    gpointer           user_data)
+{
+	Folder  *folder = user_data;
+	Arrival *arrival;
+	gchar   *basename, *uri;
+
+	/* Partial downloads and the parts of split files are hidden */
+	basename = g_file_get_basename (file);
+	if (basename == NULL || basename[0] == '.') {
+		g_free (basename);
+		return;
+	}
+	g_free (basename);
+
+	uri = g_file_get_uri (file);
+
+	switch (event) {
+	case G_FILE_MONITOR_EVENT_CREATED:
+	case G_FILE_MONITOR_EVENT_CHANGED:
+	case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+		arrival = g_hash_table_lookup (folder->arrivals, uri);
+		if (arrival == NULL) {
+			/* Only files that are new, not ones touched later */
+			if (event != G_FILE_MONITOR_EVENT_CREATED)
+				break;
+			arrival = g_new0 (Arrival, 1);
+			g_hash_table_insert (folder->arrivals, uri, arrival);
+			uri = NULL;
+		}
+		arrival->changed = g_get_monotonic_time ();
+
+		if (tick_id == 0)
+			tick_id = g_timeout_add_seconds (1, tick_cb, NULL);
+		break;
+	case G_FILE_MONITOR_EVENT_DELETED:
+	case G_FILE_MONITOR_EVENT_MOVED:
+		g_hash_table_remove (folder->arrivals, uri);
+		break;
+	default:
+		break;
+	}
+
+	g_free (uri);
+}
+
+/*
+ * Whether dest is one of the watched dirs, or above one of them.
+ * Converted files going there would be picked up and converted
+ * again, forever.
+ */
+static gboolean
+is_watched (GFile *dest, GPtrArray *dirs)
+{
+	guint i;
+
+	for (i = 0; i < dirs->len; i++) {
+		GFile *dir = g_ptr_array_index (dirs, i);
+
+		if (g_file_equal (dir, dest) || g_file_has_prefix (dir, dest))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void
+watch_folder (GFile *dir, const gchar *destination, GPtrArray *dirs)
+{
+	Folder       *folder;
+	GFileMonitor *monitor;
+	GFile        *dest;
+	GError       *error = NULL;
+	gchar        *name;
+
+	name = g_file_get_parse_name (dir);
+	if (destination != NULL && destination[0] != '\0')
+		dest = g_file_new_for_commandline_arg (destination);
+	else
+		dest = g_file_get_child (dir, "converted");
+
+	if (is_watched (dest, dirs)) {
+		g_warning ("Not watching %s, as the converted files would go "
+			   "to a watched folder", name);
+		goto out;
+	}
+
+	monitor = g_file_monitor_directory (dir, G_FILE_MONITOR_NONE, NULL, &error);
+	if (monitor == NULL) {
+		g_warning ("Unable to watch %s: %s", name, error->message);
+		g_error_free (error);
+		goto out;
+	}
+
+	folder = g_new0 (Folder, 1);
+	folder->dir = g_object_ref (dir);
+	folder->destination = g_object_ref (dest);
+	folder->monitor = monitor;
+	folder->arrivals = g_hash_table_new_full (g_str_hash, g_str_equal,
+						  g_free, g_free);
+	folder->ready = nsc_file_list_new ();
+
+	g_signal_connect (monitor, "changed",
+			  G_CALLBACK (monitor_changed_cb), folder);
+	g_ptr_array_add (folders, folder);
+
+out:
+	g_object_unref (dest);
+	g_free (name);
+}
+
+static void
+load_folders (void)
+{
+	GPtrArray  *dirs;
+	gchar     **names;
+	gchar      *destination;
+	guint       i;
+
+	if (folders != NULL)
+		g_ptr_array_free (folders, TRUE);
+	generation++;
+	folders = g_ptr_array_new_with_free_func ((GDestroyNotify) folder_free);
+
+	names = g_settings_get_strv (settings, "watch-folders");
+	destination = g_settings_get_string (settings, "watch-destination");
+
+	dirs = g_ptr_array_new_with_free_func (g_object_unref);
+	for (i = 0; names[i] != NULL; i++)
+		g_ptr_array_add (dirs, g_file_new_for_commandline_arg (names[i]));
+
+	for (i = 0; i < dirs->len; i++)
+		watch_folder (g_ptr_array_index (dirs, i), destination, dirs);
+
+	g_ptr_array_unref (dirs);
+	g_strfreev (names);
+	g_free (destination);
+}
+
+static void
+settings_changed_cb (GSettings   *gsettings,
+		     const gchar *key,
+		     gpointer     user_data)
+{
+	if (g_strcmp0 (key, "watch-folders") == 0 ||
+	    g_strcmp0 (key, "watch-destination") == 0)
+		load_folders ();
+}
+
+/*
+ * Public Methods
+ */
+
+/**
+ * Start watching the folders in the watch-folders key, and follow
+ * changes to it.  Only the first call does anything.
+ */
+void
+nsc_watch_start (void)
+{
+	if (settings != NULL)
+		return;
+
+	settings = g_settings_new (WATCH_SCHEMA);
+	g_signal_connect (settings, "changed",
+			  G_CALLBACK (settings_changed_cb), NULL);
+
+	load_folders ();
+}
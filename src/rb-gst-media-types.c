@@ -30,16 +30,49 @@
 #define GST_USE_UNSTABLE_API
 
 #include <memory.h>
+#include <string.h>
 
+#include <glib/gstdio.h>
 #include <gst/pbutils/encoding-target.h>
 #include <gst/pbutils/missing-plugins.h>
 
+#include "nsc-latency.h"
 #include "rb-gst-media-types.h"
 
 #define SOURCE_ENCODING_TARGET_FILE "../data/rhythmbox.gep"
 #define INSTALLED_ENCODING_TARGET_FILE DATADIR"/caja-sound-converter/rhythmbox.gep"
+
+/* Site and user profiles, under each XDG data directory */
+#define PROFILE_DIR "caja-sound-converter/profiles"
+
+/* How often the profile files are checked for changes */
+#define REVALIDATE_INTERVAL (5 * G_USEC_PER_SEC)
+
+/* A file or directory the profiles were loaded from */
+typedef struct {
+	char   *path;
+	time_t  mtime;
+} ProfileSource;
+
 static GstEncodingTarget *default_target = NULL;
 
+/* Indexes into default_target, which owns the profiles */
+static GHashTable *profiles_by_name = NULL;
+static GHashTable *profiles_by_media_type = NULL;
+
+/* "preset/element" to the element's property settings for the preset */
+static GHashTable *encoder_presets = NULL;
+
+static GArray *profile_sources = NULL;
+static gint64 last_check = 0;
+
+/*
+ * Guards everything above.  The registry is used from the main
+ * thread, the engine thread and the streaming threads, and can be
+ * rebuilt under any of them.
+ */
+static GMutex registry_lock;
+
 char *
 rb_gst_caps_to_media_type (const GstCaps *caps)
 {
@@ -114,6 +147,8 @@ rb_gst_media_type_to_extension (const char *media_type)
 		return "m4a";
 	} else if (!strcmp (media_type, "audio/x-wavpack")) {
 		return "wv";
+	} else if (!strcmp (media_type, "audio/x-opus")) {
+		return "opus";
 	} else {
 		return NULL;
 	}
@@ -199,47 +234,357 @@ rb_gst_encoding_profile_get_media_type (GstEncodingProfile *profile)
 	}
 }
 
-GstEncodingTarget *
-rb_gst_get_default_encoding_target ()
+static time_t
+get_mtime (const char *path)
 {
-	if (default_target == NULL) {
-		char *target_file;
-		GError *error = NULL;
+	GStatBuf buf;
+
+	if (g_stat (path, &buf) != 0)
+		return 0;
+
+	return buf.st_mtime;
+}
+
+/* Missing files and directories are watched too, in case they appear */
+static void
+add_source (const char *path)
+{
+	ProfileSource source;
+
+	source.path = g_strdup (path);
+	source.mtime = get_mtime (path);
+	g_array_append_val (profile_sources, source);
+}
+
+/*
+ * The [preset-NAME] groups of a .gep file, which GStreamer ignores,
+ * hold "element = property=value ..." settings for that preset.
+ */
+static void
+load_encoder_presets (const char *path)
+{
+	GKeyFile *key_file;
+	char **groups;
+	int i, j;
+
+	key_file = g_key_file_new ();
+	if (!g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, NULL)) {
+		g_key_file_free (key_file);
+		return;
+	}
+
+	groups = g_key_file_get_groups (key_file, NULL);
+	for (i = 0; groups[i] != NULL; i++) {
+		char **keys;
+
+		if (!g_str_has_prefix (groups[i], "preset-")) {
+			continue;
+		}
+
+		keys = g_key_file_get_keys (key_file, groups[i], NULL, NULL);
+		for (j = 0; keys != NULL && keys[j] != NULL; j++) {
+			g_hash_table_insert (encoder_presets,
+					     g_strdup_printf ("%s/%s", groups[i] + strlen ("preset-"), keys[j]),
+					     g_key_file_get_string (key_file, groups[i], keys[j], NULL));
+		}
+		g_strfreev (keys);
+	}
+
+	g_strfreev (groups);
+	g_key_file_free (key_file);
+}
+
+/* Later files replace the profiles of earlier ones with the same name */
+static void
+load_target_file (GPtrArray *profiles, const char *path)
+{
+	GstEncodingTarget *target;
+	const GList *l;
+	GError *error = NULL;
+
+	add_source (path);
+
+	target = gst_encoding_target_load_from_file (path, &error);
+	if (target == NULL) {
+		if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			g_warning ("Unable to load encoding profiles from %s: %s", path, error ? error->message : "no error");
+		g_clear_error (&error);
+		return;
+	}
+
+	for (l = gst_encoding_target_get_profiles (target); l != NULL; l = l->next) {
+		GstEncodingProfile *profile = l->data;
+		guint i;
+
+		for (i = 0; i < profiles->len; i++) {
+			GstEncodingProfile *p = g_ptr_array_index (profiles, i);
+			if (g_strcmp0 (gst_encoding_profile_get_name (p),
+				       gst_encoding_profile_get_name (profile)) == 0) {
+				break;
+			}
+		}
+
+		gst_encoding_profile_ref (profile);
+		if (i < profiles->len) {
+			gst_encoding_profile_unref (g_ptr_array_index (profiles, i));
+			g_ptr_array_index (profiles, i) = profile;
+		} else {
+			g_ptr_array_add (profiles, profile);
+		}
+	}
+
+	gst_encoding_target_unref (target);
+
+	load_encoder_presets (path);
+}
+
+static gint
+compare_paths (gconstpointer a, gconstpointer b)
+{
+	return strcmp (*(const char **) a, *(const char **) b);
+}
+
+static void
+load_profile_dir (GPtrArray *profiles, const char *data_dir)
+{
+	GPtrArray *files;
+	GDir *dir;
+	const char *name;
+	char *path;
+	guint i;
+
+	path = g_build_filename (data_dir, PROFILE_DIR, NULL);
+	add_source (path);
+
+	dir = g_dir_open (path, 0, NULL);
+	if (dir == NULL) {
+		g_free (path);
+		return;
+	}
+
+	/* Sorted, so the same name always wins */
+	files = g_ptr_array_new_with_free_func (g_free);
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		if (g_str_has_suffix (name, ".gep")) {
+			g_ptr_array_add (files, g_build_filename (path, name, NULL));
+		}
+	}
+	g_dir_close (dir);
+	g_free (path);
+
+	g_ptr_array_sort (files, compare_paths);
+	for (i = 0; i < files->len; i++) {
+		load_target_file (profiles, g_ptr_array_index (files, i));
+	}
+	g_ptr_array_unref (files);
+}
+
+static void
+free_registry (void)
+{
+	guint i;
+
+	if (default_target != NULL) {
+		gst_encoding_target_unref (default_target);
+		default_target = NULL;
+	}
+	if (profiles_by_name != NULL) {
+		g_hash_table_destroy (profiles_by_name);
+		profiles_by_name = NULL;
+	}
+	if (profiles_by_media_type != NULL) {
+		g_hash_table_destroy (profiles_by_media_type);
+		profiles_by_media_type = NULL;
+	}
+	if (encoder_presets != NULL) {
+		g_hash_table_destroy (encoder_presets);
+		encoder_presets = NULL;
+	}
+	if (profile_sources != NULL) {
+		for (i = 0; i < profile_sources->len; i++) {
+			g_free (g_array_index (profile_sources, ProfileSource, i).path);
+		}
+		g_array_free (profile_sources, TRUE);
+		profile_sources = NULL;
+	}
+}
+
+/*
+ * Merge the profiles shipped with caja-sound-converter with the
+ * .gep files in the site and user profile directories, in rising
+ * order of precedence, and index them by name and media type.
+ */
+static void
+build_registry (void)
+{
+	const char * const *data_dirs;
+	GPtrArray *profiles;
+	const char *target_file;
+	guint j;
+	int i;
+
+	free_registry ();
 
-		if (g_file_test (SOURCE_ENCODING_TARGET_FILE,
-			         G_FILE_TEST_EXISTS) != FALSE) {
-			target_file = SOURCE_ENCODING_TARGET_FILE;
+	profile_sources = g_array_new (FALSE, FALSE, sizeof (ProfileSource));
+	encoder_presets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	profiles = g_ptr_array_new ();
+
+	if (g_file_test (SOURCE_ENCODING_TARGET_FILE, G_FILE_TEST_EXISTS) != FALSE) {
+		target_file = SOURCE_ENCODING_TARGET_FILE;
+	} else {
+		target_file = INSTALLED_ENCODING_TARGET_FILE;
+	}
+	load_target_file (profiles, target_file);
+
+	data_dirs = g_get_system_data_dirs ();
+	for (i = g_strv_length ((char **) data_dirs) - 1; i >= 0; i--) {
+		load_profile_dir (profiles, data_dirs[i]);
+	}
+	load_profile_dir (profiles, g_get_user_data_dir ());
+
+	last_check = g_get_monotonic_time ();
+
+	if (profiles->len == 0) {
+		g_warning ("No encoding profiles found");
+		g_ptr_array_free (profiles, TRUE);
+		return;
+	}
+
+	default_target = gst_encoding_target_new ("caja-sound-converter",
+						  "muh",
+						  "Encoding profiles for caja-sound-converter",
+						  NULL);
+	profiles_by_name = g_hash_table_new (g_str_hash, g_str_equal);
+	profiles_by_media_type = g_hash_table_new_full (g_str_hash, g_str_equal,
+							g_free, NULL);
+
+	for (j = 0; j < profiles->len; j++) {
+		GstEncodingProfile *profile = g_ptr_array_index (profiles, j);
+		char *media_type;
+
+		/* The target takes the reference */
+		gst_encoding_target_add_profile (default_target, profile);
+		g_hash_table_insert (profiles_by_name,
+				     (char *) gst_encoding_profile_get_name (profile),
+				     profile);
+
+		/* The first profile listed for a media type is its default */
+		media_type = rb_gst_encoding_profile_get_media_type (profile);
+		if (media_type != NULL &&
+		    g_hash_table_lookup (profiles_by_media_type, media_type) == NULL) {
+			g_hash_table_insert (profiles_by_media_type, media_type, profile);
 		} else {
-			target_file = INSTALLED_ENCODING_TARGET_FILE;
+			g_free (media_type);
 		}
+	}
 
-		default_target = gst_encoding_target_load_from_file (target_file, &error);
-		if (default_target == NULL) {
-			g_warning ("Unable to load encoding profiles from %s: %s", target_file, error ? error->message : "no error");
-			g_clear_error (&error);
-			return NULL;
+	g_ptr_array_free (profiles, TRUE);
+}
+
+/*
+ * Rebuild the registry if a profile file was added, changed or
+ * removed, checking at most every few seconds.  Called with
+ * registry_lock held.
+ */
+static void
+ensure_registry (void)
+{
+	guint i;
+
+	if (profile_sources == NULL) {
+		build_registry ();
+		return;
+	}
+
+	if (g_get_monotonic_time () - last_check < REVALIDATE_INTERVAL) {
+		return;
+	}
+	last_check = g_get_monotonic_time ();
+
+	for (i = 0; i < profile_sources->len; i++) {
+		ProfileSource *source = &g_array_index (profile_sources, ProfileSource, i);
+		if (get_mtime (source->path) != source->mtime) {
+			build_registry ();
+			return;
 		}
 	}
+}
+
+/*
+ * The target holding every profile, with a reference that keeps its
+ * profiles alive if the registry is rebuilt meanwhile.
+ */
+GstEncodingTarget *
+rb_gst_get_default_encoding_target ()
+{
+	GstEncodingTarget *target;
+
+	g_mutex_lock (&registry_lock);
+	ensure_registry ();
+	target = default_target ? g_object_ref (default_target) : NULL;
+	g_mutex_unlock (&registry_lock);
 
-	return default_target;
+	return target;
 }
 
 GstEncodingProfile *
 rb_gst_get_encoding_profile (const char *media_type)
 {
+	GstEncodingProfile *profile;
 	const GList *l;
-	GstEncodingTarget *target;
-	target = rb_gst_get_default_encoding_target ();
+	gint64 start;
 
-	for (l = gst_encoding_target_get_profiles (target); l != NULL; l = l->next) {
-		GstEncodingProfile *profile = l->data;
-		if (rb_gst_media_type_matches_profile (profile, media_type)) {
-			gst_encoding_profile_ref (profile);
-			return profile;
+	start = nsc_latency_start ();
+
+	g_mutex_lock (&registry_lock);
+	ensure_registry ();
+	if (default_target == NULL) {
+		g_mutex_unlock (&registry_lock);
+		return NULL;
+	}
+
+	profile = g_hash_table_lookup (profiles_by_media_type, media_type);
+	if (profile == NULL) {
+		profile = g_hash_table_lookup (profiles_by_media_type,
+					       rb_gst_mime_type_to_media_type (media_type));
+	}
+
+	/* Anything else matching by caps is remembered for next time */
+	if (profile == NULL) {
+		for (l = gst_encoding_target_get_profiles (default_target); l != NULL; l = l->next) {
+			if (rb_gst_media_type_matches_profile (l->data, media_type)) {
+				profile = l->data;
+				g_hash_table_insert (profiles_by_media_type,
+						     g_strdup (media_type), profile);
+				break;
+			}
 		}
 	}
 
-	return NULL;
+	if (profile != NULL)
+		gst_encoding_profile_ref (profile);
+	g_mutex_unlock (&registry_lock);
+
+	nsc_latency_record ("get_encoding_profile", start);
+
+	return profile;
+}
+
+GstEncodingProfile *
+rb_gst_get_encoding_profile_by_name (const char *name)
+{
+	GstEncodingProfile *profile = NULL;
+
+	g_mutex_lock (&registry_lock);
+	ensure_registry ();
+	if (default_target != NULL) {
+		profile = g_hash_table_lookup (profiles_by_name, name);
+		if (profile != NULL)
+			gst_encoding_profile_ref (profile);
+	}
+	g_mutex_unlock (&registry_lock);
+
+	return profile;
 }
 
 gboolean
@@ -336,3 +681,44 @@ rb_gst_check_missing_plugins (GstEncodingProfile *profile,
 	gst_object_unref (bus);
 	return ret;
 }
+
+/*
+ * A copy of the property settings preset asks of each encoder, as
+ * space separated "property=value" pairs keyed by element factory
+ * name, or NULL if it asks for none.
+ */
+GHashTable *
+rb_gst_get_encoder_presets (const char *preset)
+{
+	GHashTable *settings = NULL;
+	GHashTableIter iter;
+	gpointer key, value;
+	char *prefix;
+
+	if (preset == NULL) {
+		return NULL;
+	}
+
+	prefix = g_strdup_printf ("%s/", preset);
+	g_mutex_lock (&registry_lock);
+	ensure_registry ();
+	if (encoder_presets != NULL) {
+		g_hash_table_iter_init (&iter, encoder_presets);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			if (!g_str_has_prefix (key, prefix)) {
+				continue;
+			}
+			if (settings == NULL) {
+				settings = g_hash_table_new_full (g_str_hash, g_str_equal,
+								  g_free, g_free);
+			}
+			g_hash_table_insert (settings,
+					     g_strdup ((char *) key + strlen (prefix)),
+					     g_strdup (value));
+		}
+	}
+	g_mutex_unlock (&registry_lock);
+	g_free (prefix);
+
+	return settings;
+}
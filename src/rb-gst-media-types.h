@@ -39,6 +39,7 @@ G_BEGIN_DECLS
 #define RB_GST_MEDIA_TYPE_OGG_VORBIS 	"audio/x-vorbis"
 #define RB_GST_MEDIA_TYPE_FLAC 		"audio/x-flac"
 #define RB_GST_MEDIA_TYPE_AAC 		"audio/x-aac"
+#define RB_GST_MEDIA_TYPE_OPUS 		"audio/x-opus"
 
 /* media type categories */
 typedef enum {
@@ -61,12 +62,14 @@ const char *	rb_gst_media_type_to_mime_type (const char *media_type);
 GstEncodingTarget *rb_gst_get_default_encoding_target (void);
 
 GstEncodingProfile *rb_gst_get_encoding_profile (const char *media_type);
+GstEncodingProfile *rb_gst_get_encoding_profile_by_name (const char *name);
 
 gboolean	rb_gst_media_type_matches_profile (GstEncodingProfile *profile, const char *media_type);
 
 char *		rb_gst_encoding_profile_get_media_type (GstEncodingProfile *profile);
 
 gboolean	rb_gst_media_type_is_lossless (const char *media_type);
+GHashTable *	rb_gst_get_encoder_presets (const char *preset);
 gboolean	rb_gst_check_missing_plugins (GstEncodingProfile *profile,
 					      char ***details,
 					      char ***descriptions);
@@ -0,0 +1,194 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  bench-audio-convert.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+/*
+ * How fast each nscaudioconvert kernel is on this processor, and the
+ * element against audioconvert and audioresample in a pipeline.
+ *
+ *   bench-audio-convert [SECONDS OF AUDIO]
+ */
+#include "nsc-audio-convert.c"
+
+#include <stdlib.h>
+
+#define RATE 44100
+
+typedef struct {
+	const gchar *name;
+	PackFunc     pack;
+	UnpackFunc   unpack;
+	gsize        width;
+} Kernel;
+
+static const Kernel kernels[] = {
+	{ "s16 c", pack_s16_c, unpack_s16_c, 2 },
+	{ "s24_32 c", pack_s24_32_c, unpack_s24_32_c, 4 },
+	{ "s32 c", pack_s32_c, unpack_s32_c, 4 },
+#if defined(__SSE2__)
+	{ "s16 sse2", pack_s16_sse2, unpack_s16_sse2, 2 },
+	{ "s24_32 sse2", pack_s24_32_sse2, unpack_s24_32_sse2, 4 },
+	{ "s32 sse2", pack_s32_sse2, unpack_s32_sse2, 4 },
+#endif
+#if defined(HAVE_AVX2_KERNELS)
+	{ "s16 avx2", pack_s16_avx2, unpack_s16_avx2, 2 },
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+	{ "s16 neon", pack_s16_neon, unpack_s16_neon, 2 },
+#endif
+	{ NULL, NULL, NULL, 0 }
+};
+
+/* The same conversion, S16 stereo to F32 mono, three ways */
+static const gchar *pipelines[] = {
+	"nscaudioconvert ! audioresample",
+	"audioconvert ! audioresample",
+	"audioconvert",
+	NULL
+};
+
+static void
+bench_kernels (guint64 samples)
+{
+	const Kernel *kernel;
+	gfloat       *floats;
+	guint8       *ints;
+	guint         i;
+
+	floats = g_new (gfloat, BLOCK_FRAMES * 2);
+	ints = g_malloc0 (BLOCK_FRAMES * 2 * 4);
+	for (i = 0; i < BLOCK_FRAMES * 2; i++)
+		floats[i] = g_random_double_range (-1.0, 1.0);
+
+	g_print ("%-14s %12s %12s\n", "kernel", "pack MS/s", "unpack MS/s");
+	for (kernel = kernels; kernel->name != NULL; kernel++) {
+		guint64 done;
+		gint64  start, pack_time, unpack_time;
+
+#if defined(HAVE_AVX2_KERNELS)
+		__builtin_cpu_init ();
+		if (kernel->pack == pack_s16_avx2 &&
+		    !__builtin_cpu_supports ("avx2"))
+			continue;
+#endif
+		/* Blocks the size the element converts, as it would */
+		start = g_get_monotonic_time ();
+		for (done = 0; done < samples; done += BLOCK_FRAMES * 2)
+			kernel->pack (floats, ints, BLOCK_FRAMES * 2);
+		pack_time = g_get_monotonic_time () - start;
+
+		start = g_get_monotonic_time ();
+		for (done = 0; done < samples; done += BLOCK_FRAMES * 2)
+			kernel->unpack (ints, floats, BLOCK_FRAMES * 2);
+		unpack_time = g_get_monotonic_time () - start;
+
+		g_print ("%-14s %12.1f %12.1f\n", kernel->name,
+			 (gdouble) samples / MAX (pack_time, 1),
+			 (gdouble) samples / MAX (unpack_time, 1));
+	}
+
+	g_free (floats);
+	g_free (ints);
+}
+
+/* Seconds the pipeline took to reach EOS, or -1 if it failed */
+static gdouble
+run_pipeline (const gchar *conversion, guint64 frames)
+{
+	GstElement *pipeline;
+	GstMessage *message;
+	GError     *error = NULL;
+	gchar      *description;
+	gint64      start;
+	gdouble     seconds;
+
+	description = g_strdup_printf ("audiotestsrc wave=white-noise "
+				       "samplesperbuffer=%u num-buffers=%" G_GUINT64_FORMAT " ! "
+				       "audio/x-raw,format=S16LE,channels=2,rate=%d ! "
+				       "%s ! "
+				       "audio/x-raw,format=F32LE,channels=1,rate=%d ! "
+				       "fakesink",
+				       BLOCK_FRAMES * 4, frames / (BLOCK_FRAMES * 4),
+				       RATE, conversion, RATE);
+	pipeline = gst_parse_launch (description, &error);
+	g_free (description);
+	if (pipeline == NULL) {
+		g_printerr ("%s: %s\n", conversion, error->message);
+		g_error_free (error);
+		return -1;
+	}
+
+	start = g_get_monotonic_time ();
+	gst_element_set_state (pipeline, GST_STATE_PLAYING);
+	message = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+					      GST_CLOCK_TIME_NONE,
+					      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+	seconds = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+
+	if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_ERROR)
+		seconds = -1;
+	gst_message_unref (message);
+	gst_element_set_state (pipeline, GST_STATE_NULL);
+	gst_object_unref (pipeline);
+
+	return seconds;
+}
+
+static void
+bench_pipelines (guint64 frames)
+{
+	guint i;
+
+	g_print ("\n%-34s %10s %10s\n", "pipeline", "seconds", "x realtime");
+	for (i = 0; pipelines[i] != NULL; i++) {
+		gdouble seconds;
+
+		seconds = run_pipeline (pipelines[i], frames);
+		if (seconds < 0) {
+			g_print ("%-34s %10s\n", pipelines[i], "failed");
+			continue;
+		}
+		g_print ("%-34s %10.3f %10.1f\n", pipelines[i], seconds,
+			 frames / (gdouble) RATE / seconds);
+	}
+}
+
+int
+main (int argc, char **argv)
+{
+	guint64 seconds = 600;
+
+	gst_init (&argc, &argv);
+	nsc_audio_convert_register ();
+
+	if (argc > 1)
+		seconds = g_ascii_strtoull (argv[1], NULL, 10);
+	if (seconds == 0) {
+		g_printerr ("Usage: %s [SECONDS OF AUDIO]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	bench_kernels (seconds * RATE * 2);
+	bench_pipelines (seconds * RATE);
+
+	return EXIT_SUCCESS;
+}
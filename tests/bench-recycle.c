@@ -0,0 +1,150 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  bench-recycle.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+/*
+ * Files per second converting many short files with one converter,
+ * which recycles its pipeline between them, against rebuilding the
+ * pipeline for each file and making a new converter for each file.
+ *
+ *   bench-recycle [FILES] [MILLISECONDS PER FILE]
+ */
+#include <config.h>
+
+#include <stdlib.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <gst/gst.h>
+
+#include "nsc-gstreamer.h"
+#include "test-utils.h"
+
+#define RATE     44100
+#define CHANNELS 2
+
+typedef enum {
+	MODE_RECYCLE,
+	MODE_REBUILD,
+	MODE_NEW
+} Mode;
+
+static const gchar *mode_names[] = {
+	"recycle",
+	"rebuild",
+	"new converter"
+};
+
+/* Files converted per second in mode */
+static gdouble
+run (Mode mode, GFile *dir, GPtrArray *sources)
+{
+	GstEncodingProfile *profile;
+	NscGStreamer       *gstreamer = NULL;
+	gint64              start;
+	guint               i;
+
+	profile = test_profile ("audio/x-flac");
+	start = g_get_monotonic_time ();
+
+	for (i = 0; i < sources->len; i++) {
+		GError *error = NULL;
+		GFile  *sink;
+		gchar  *name;
+
+		if (gstreamer == NULL || mode == MODE_NEW) {
+			if (gstreamer != NULL)
+				g_object_unref (gstreamer);
+			gstreamer = nsc_gstreamer_new (profile);
+		} else if (mode == MODE_REBUILD) {
+			/* A new profile always throws the pipeline away */
+			g_object_set (gstreamer, "profile", profile, NULL);
+		}
+
+		name = g_strdup_printf ("out-%u.flac", i);
+		sink = g_file_get_child (dir, name);
+		g_free (name);
+
+		if (!test_convert (gstreamer, g_ptr_array_index (sources, i),
+				   sink, &error)) {
+			g_printerr ("%s: %s\n", mode_names[mode], error->message);
+			exit (EXIT_FAILURE);
+		}
+
+		g_file_delete (sink, NULL, NULL);
+		g_object_unref (sink);
+	}
+
+	g_object_unref (gstreamer);
+	gst_encoding_profile_unref (profile);
+
+	return sources->len / ((g_get_monotonic_time () - start) /
+			       (gdouble) G_USEC_PER_SEC);
+}
+
+int
+main (int argc, char **argv)
+{
+	GPtrArray *sources;
+	GFile     *dir;
+	guint      n_files = 200, ms = 500;
+	guint      i;
+	Mode       mode;
+
+	gst_init (&argc, &argv);
+
+	if (argc > 1)
+		n_files = strtoul (argv[1], NULL, 10);
+	if (argc > 2)
+		ms = strtoul (argv[2], NULL, 10);
+	if (n_files == 0 || ms == 0) {
+		g_printerr ("Usage: %s [FILES] [MILLISECONDS PER FILE]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	test_require_elements ("wavparse", "flacenc", "decodebin", NULL);
+
+	dir = test_make_dir ();
+	sources = g_ptr_array_new_with_free_func (g_object_unref);
+	for (i = 0; i < n_files; i++) {
+		GFile *file;
+		gchar *name;
+
+		name = g_strdup_printf ("in-%u.wav", i);
+		file = g_file_get_child (dir, name);
+		g_free (name);
+
+		g_free (test_write_wav (file, RATE, CHANNELS,
+					(guint64) RATE * ms / 1000, i));
+		g_ptr_array_add (sources, file);
+	}
+
+	g_print ("%u files of %u ms\n", n_files, ms);
+	g_print ("%-14s %10s\n", "pipeline", "files/s");
+	for (mode = MODE_RECYCLE; mode <= MODE_NEW; mode++)
+		g_print ("%-14s %10.1f\n", mode_names[mode], run (mode, dir, sources));
+
+	g_ptr_array_unref (sources);
+	test_remove_dir (dir);
+	g_object_unref (dir);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,380 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  bench-selection.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+/*
+ * Latency percentiles of what Caja waits on for selections of 10 to
+ * 100k files: the context menu, and each file and chunk of filtering
+ * the selection once "Convert..." is chosen; then the dialog's
+ * profile chooser and profile lookups, and naming the new files as
+ * the batch is expanded into jobs.  The files are stubs, and the
+ * scheduler is stubbed out, so nothing is converted.  The profile
+ * chooser is only timed with a display.
+ *
+ *   bench-selection [LARGEST SELECTION]
+ */
+#include <config.h>
+
+#include <stdlib.h>
+#include <gtk/gtk.h>
+#include <gst/gst.h>
+#include <libcaja-extension/caja-file-info.h>
+
+#include "nsc-converter.h"
+#include "nsc-file-list.h"
+#include "nsc-job.h"
+#include "nsc-latency.h"
+#include "nsc-scheduler.h"
+#include "nsc-selection.h"
+#include "rb-gst-media-types.h"
+#include "test-utils.h"
+
+/*
+ * A CajaFileInfo with just a URI and a MIME type
+ */
+typedef struct {
+	GObject  parent;
+	gchar   *uri;
+	gchar   *mime_type;
+} StubFileInfo;
+
+typedef struct {
+	GObjectClass parent_class;
+} StubFileInfoClass;
+
+static void stub_file_info_iface_init (CajaFileInfoIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (StubFileInfo, stub_file_info, G_TYPE_OBJECT,
+			 G_IMPLEMENT_INTERFACE (CAJA_TYPE_FILE_INFO,
+						stub_file_info_iface_init));
+
+static char *
+stub_get_uri (CajaFileInfo *file)
+{
+	return g_strdup (((StubFileInfo *) file)->uri);
+}
+
+static char *
+stub_get_uri_scheme (CajaFileInfo *file)
+{
+	return g_uri_parse_scheme (((StubFileInfo *) file)->uri);
+}
+
+static char *
+stub_get_mime_type (CajaFileInfo *file)
+{
+	return g_strdup (((StubFileInfo *) file)->mime_type);
+}
+
+/* As Caja does it, so subtypes match too */
+static gboolean
+stub_is_mime_type (CajaFileInfo *file, const char *mime_type)
+{
+	return g_content_type_is_a (((StubFileInfo *) file)->mime_type, mime_type);
+}
+
+static void
+stub_file_info_iface_init (CajaFileInfoIface *iface)
+{
+	iface->get_uri = stub_get_uri;
+	iface->get_uri_scheme = stub_get_uri_scheme;
+	iface->get_mime_type = stub_get_mime_type;
+	iface->is_mime_type = stub_is_mime_type;
+}
+
+static void
+stub_file_info_finalize (GObject *object)
+{
+	StubFileInfo *self = (StubFileInfo *) object;
+
+	g_free (self->uri);
+	g_free (self->mime_type);
+
+	G_OBJECT_CLASS (stub_file_info_parent_class)->finalize (object);
+}
+
+static void
+stub_file_info_class_init (StubFileInfoClass *klass)
+{
+	G_OBJECT_CLASS (klass)->finalize = stub_file_info_finalize;
+}
+
+static void
+stub_file_info_init (StubFileInfo *self)
+{
+}
+
+/*
+ * The scheduler, stubbed out: batches are only expanded into jobs,
+ * by the benchmark
+ */
+NscScheduler *
+nsc_scheduler_get_default (void)
+{
+	return NULL;
+}
+
+void
+nsc_scheduler_add_batch (NscScheduler *scheduler, NscConverter *batch)
+{
+}
+
+/*
+ * A selection of n files, mostly audio with some cover art and a
+ * cue sheet now and then, in the order a folder lists them.  If
+ * sound_last is set, only the last file can be converted, which is
+ * the slowest case for the context menu.
+ */
+static GList *
+make_selection (guint n, gboolean sound_last)
+{
+	static const gchar *types[] = {
+		"audio/x-flac", "audio/mpeg", "audio/x-vorbis+ogg",
+		"image/jpeg", "audio/x-flac", "application/x-cue"
+	};
+	GList *files = NULL;
+	guint  i;
+
+	for (i = 0; i < n; i++) {
+		StubFileInfo *file;
+
+		file = g_object_new (stub_file_info_get_type (), NULL);
+		file->uri = g_strdup_printf ("file:///srv/music/album-%04u/track-%02u.flac",
+					     i / 16, i % 16);
+		if (sound_last)
+			file->mime_type = g_strdup (i == n - 1 ? "audio/x-flac"
+						    : "text/plain");
+		else
+			file->mime_type = g_strdup (types[i % G_N_ELEMENTS (types)]);
+		files = g_list_prepend (files, file);
+	}
+
+	return g_list_reverse (files);
+}
+
+/* The probes report as they go; only the table is wanted */
+static void
+drop_message (const gchar    *log_domain,
+	      GLogLevelFlags  log_level,
+	      const gchar    *message,
+	      gpointer        user_data)
+{
+}
+
+static void
+print_probe (const gchar *files, const gchar *probe)
+{
+	gint64 p50, p90, p99, max;
+	guint  count;
+
+	if (!nsc_latency_get (probe, &count, &p50, &p90, &p99, &max))
+		return;
+
+	g_print ("%8s %-22s %8u %8" G_GINT64_FORMAT " %8" G_GINT64_FORMAT
+		 " %8" G_GINT64_FORMAT " %8" G_GINT64_FORMAT "\n",
+		 files, probe, count, p50, p90, p99, max);
+}
+
+/*
+ * Build the profile chooser, if there is a display, and look up
+ * each profile it lists.  Returns the media type of a profile the
+ * batches can convert to, or NULL if there is none.
+ */
+static gchar *
+time_profiles (gboolean display)
+{
+	GstEncodingTarget *target;
+	const GList       *p;
+	gchar             *usable = NULL;
+	guint              i;
+
+	nsc_latency_reset ();
+
+	for (i = 0; display && i < 100; i++) {
+		GtkWidget *chooser;
+
+		chooser = nsc_audio_profile_chooser_new ();
+		g_object_ref_sink (chooser);
+		gtk_widget_destroy (chooser);
+		g_object_unref (chooser);
+	}
+
+	target = rb_gst_get_default_encoding_target ();
+	for (p = target ? gst_encoding_target_get_profiles (target) : NULL;
+	     p != NULL; p = p->next) {
+		gchar *media_type;
+
+		media_type = rb_gst_encoding_profile_get_media_type (p->data);
+		if (media_type == NULL)
+			continue;
+
+		for (i = 0; i < 1000; i++) {
+			GstEncodingProfile *profile;
+
+			profile = rb_gst_get_encoding_profile (media_type);
+			if (usable == NULL && i == 0 && profile != NULL &&
+			    nsc_gstreamer_supports_profile (profile))
+				usable = g_strdup (media_type);
+			if (profile != NULL)
+				gst_encoding_profile_unref (profile);
+		}
+		g_free (media_type);
+	}
+	if (target != NULL)
+		g_object_unref (target);
+
+	print_probe ("-", "profile_chooser_new");
+	print_probe ("-", "get_encoding_profile");
+
+	return usable;
+}
+
+/*
+ * Build the context menu for files, reps times over, when the first
+ * file is audio and when only the last one is.
+ */
+static void
+time_menu (GList *files, GList *last, guint reps)
+{
+	guint i;
+
+	for (i = 0; i < reps; i++) {
+		gboolean sound, sound_last;
+		gint64   start;
+
+		start = nsc_latency_start ();
+		sound = nsc_selection_has_sound (files);
+		nsc_latency_record ("get_file_items", start);
+
+		start = nsc_latency_start ();
+		sound_last = nsc_selection_has_sound (last);
+		nsc_latency_record ("get_file_items_last", start);
+
+		g_assert (sound && sound_last);
+	}
+}
+
+/* Filter files as choosing "Convert..." does, a chunk at a time */
+static NscFileList *
+time_filter (GList *files)
+{
+	NscSelectionFilter *filter;
+
+	filter = nsc_selection_filter_new (files);
+	while (nsc_selection_filter_step (filter))
+		;
+
+	return nsc_selection_filter_finish (filter);
+}
+
+/* Expand the sounds into jobs converting to media_type, as they run */
+static void
+time_new_files (NscFileList *sounds, const gchar *media_type, GFile *dest)
+{
+	NscConverter *converter;
+	NscJob       *job;
+	gboolean      started;
+
+	converter = nsc_converter_new (sounds);
+	started = nsc_converter_start (converter, media_type, dest);
+	g_assert (started);
+
+	while ((job = nsc_converter_next_job (converter)) != NULL)
+		nsc_job_free (job);
+
+	g_object_unref (converter);
+}
+
+int
+main (int argc, char **argv)
+{
+	GFile    *home;
+	gchar    *path, *media_type;
+	gboolean  display;
+	guint     largest = 100000;
+	guint     n;
+
+	/* Keep the media index and history of the stubs to ourselves */
+	home = test_make_dir ();
+	path = g_file_get_path (home);
+	g_setenv ("XDG_DATA_HOME", path, TRUE);
+	g_setenv ("XDG_CACHE_HOME", path, TRUE);
+	g_free (path);
+	g_setenv ("GSETTINGS_SCHEMA_DIR", SCHEMA_DIR, TRUE);
+	g_setenv ("GSETTINGS_BACKEND", "memory", TRUE);
+	g_setenv ("NSC_LATENCY", "1", TRUE);
+
+	g_log_set_handler (G_LOG_DOMAIN, G_LOG_LEVEL_MESSAGE, drop_message, NULL);
+
+	gst_init (&argc, &argv);
+	display = gtk_init_check (&argc, &argv);
+
+	if (argc > 1)
+		largest = strtoul (argv[1], NULL, 10);
+	if (largest == 0) {
+		g_printerr ("Usage: %s [LARGEST SELECTION]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	g_print ("%8s %-22s %8s %8s %8s %8s %8s\n", "files", "probe",
+		 "samples", "p50 us", "p90 us", "p99 us", "max us");
+
+	media_type = time_profiles (display);
+
+	for (n = 10; n <= largest; n *= 10) {
+		GList       *files, *last;
+		NscFileList *sounds;
+		gchar        label[16];
+
+		g_snprintf (label, sizeof (label), "%u", n);
+		files = make_selection (n, FALSE);
+		last = make_selection (n, TRUE);
+
+		/* Repeated for enough samples at the small sizes */
+		nsc_latency_reset ();
+		time_menu (files, last, CLAMP (100000 / n, 5, 1000));
+		print_probe (label, "get_file_items");
+		print_probe (label, "get_file_items_last");
+
+		nsc_latency_reset ();
+		sounds = time_filter (files);
+		print_probe (label, "file_is_sound");
+		print_probe (label, "filter_files_chunk");
+		g_assert_cmpuint (nsc_file_list_length (sounds), >, 0);
+
+		nsc_latency_reset ();
+		if (media_type != NULL)
+			time_new_files (sounds, media_type, home);
+		else
+			nsc_file_list_free (sounds);
+		print_probe (label, "create_new_file");
+
+		caja_file_info_list_free (files);
+		caja_file_info_list_free (last);
+	}
+
+	g_free (media_type);
+	test_remove_dir (home);
+	g_object_unref (home);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,277 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  test-audio-convert.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+/*
+ * Check that every kernel nscaudioconvert can pick on this processor
+ * gives exactly what the scalar ones give, ties and clipping
+ * included.  The kernels are static, so the element is built in.
+ */
+#include "nsc-audio-convert.c"
+
+/* Odd, so the vector kernels leave a tail to the scalar ones */
+#define N_SAMPLES 4099
+
+typedef struct {
+	const gchar *name;
+	gint         format;
+	UnpackFunc   unpack;
+	PackFunc     pack;
+} Kernel;
+
+typedef struct {
+	const gchar *name;
+	MixFunc      downmix;
+	MixFunc      upmix;
+} Mixer;
+
+static const Kernel scalar_kernels[] = {
+	{ "s16", FORMAT_S16, unpack_s16_c, pack_s16_c },
+	{ "s24_32", FORMAT_S24_32, unpack_s24_32_c, pack_s24_32_c },
+	{ "s32", FORMAT_S32, unpack_s32_c, pack_s32_c },
+};
+
+static const Kernel vector_kernels[] = {
+#if defined(__SSE2__)
+	{ "s16-sse2", FORMAT_S16, unpack_s16_sse2, pack_s16_sse2 },
+	{ "s24_32-sse2", FORMAT_S24_32, unpack_s24_32_sse2, pack_s24_32_sse2 },
+	{ "s32-sse2", FORMAT_S32, unpack_s32_sse2, pack_s32_sse2 },
+#endif
+#if defined(HAVE_AVX2_KERNELS)
+	{ "s16-avx2", FORMAT_S16, unpack_s16_avx2, pack_s16_avx2 },
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+	{ "s16-neon", FORMAT_S16, unpack_s16_neon, pack_s16_neon },
+#endif
+	{ NULL, 0, NULL, NULL }
+};
+
+static const Mixer vector_mixers[] = {
+#if defined(__SSE2__)
+	{ "sse2", downmix_sse2, upmix_sse2 },
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+	{ "neon", downmix_neon, upmix_neon },
+#endif
+	{ NULL, NULL, NULL }
+};
+
+/* The full scale of each format, and how wide a tie it can hold */
+static const gfloat scales[] = { 32768.0f, 8388608.0f, 2147483648.0f };
+static const gint32 tie_range[] = { 32768, 1 << 21, 1 << 22 };
+
+static gboolean
+kernel_runs (const Kernel *kernel)
+{
+#if defined(HAVE_AVX2_KERNELS)
+	if (kernel->pack == pack_s16_avx2) {
+		__builtin_cpu_init ();
+		return __builtin_cpu_supports ("avx2");
+	}
+#endif
+	return TRUE;
+}
+
+/*
+ * Samples halfway between two output values, clipping ones and
+ * ordinary ones, for the format.
+ */
+static void
+fill_floats (gfloat *samples, gint format, GRand *rand)
+{
+	guint i;
+
+	for (i = 0; i < N_SAMPLES; i++) {
+		switch (i % 4) {
+		case 0:
+			samples[i] = (g_rand_int_range (rand, -tie_range[format],
+							tie_range[format]) + 0.5f) /
+				scales[format];
+			break;
+		case 1:
+			samples[i] = g_rand_double_range (rand, -1.5, 1.5);
+			break;
+		case 2:
+			samples[i] = g_rand_double_range (rand, -1.0, 1.0);
+			break;
+		default:
+			samples[i] = (i & 8) ? 1.0f : -1.0f;
+			break;
+		}
+	}
+}
+
+static void
+fill_ints (guint8 *data, gint format, GRand *rand)
+{
+	guint i;
+
+	for (i = 0; i < N_SAMPLES; i++) {
+		if (format == FORMAT_S16)
+			((gint16 *) data)[i] = g_rand_int (rand);
+		else
+			((guint32 *) data)[i] = g_rand_int (rand);
+	}
+}
+
+static void
+test_pack (gconstpointer data)
+{
+	const Kernel *kernel = data;
+	const Kernel *scalar = &scalar_kernels[kernel->format];
+	GRand        *rand;
+	gfloat       *samples;
+	guint8       *expected, *got;
+	guint         i;
+
+	if (!kernel_runs (kernel)) {
+		g_test_message ("Not supported by this processor");
+		return;
+	}
+
+	rand = g_rand_new_with_seed (kernel->format);
+	samples = g_new (gfloat, N_SAMPLES);
+	expected = g_malloc0 (N_SAMPLES * 4);
+	got = g_malloc0 (N_SAMPLES * 4);
+
+	fill_floats (samples, kernel->format, rand);
+	/* Every offset, so misaligned loads and each tail length run */
+	for (i = 0; i < 16; i++) {
+		memset (got, 0, N_SAMPLES * 4);
+		kernel->pack (samples + i, got, N_SAMPLES - i);
+		scalar->pack (samples + i, expected, N_SAMPLES - i);
+		g_assert (memcmp (got, expected, (N_SAMPLES - i) *
+				  (kernel->format == FORMAT_S16 ? 2 : 4)) == 0);
+	}
+
+	g_free (samples);
+	g_free (expected);
+	g_free (got);
+	g_rand_free (rand);
+}
+
+static void
+test_unpack (gconstpointer data)
+{
+	const Kernel *kernel = data;
+	const Kernel *scalar = &scalar_kernels[kernel->format];
+	GRand        *rand;
+	guint8       *ints;
+	gfloat       *expected, *got;
+
+	if (!kernel_runs (kernel)) {
+		g_test_message ("Not supported by this processor");
+		return;
+	}
+
+	rand = g_rand_new_with_seed (kernel->format);
+	ints = g_malloc (N_SAMPLES * 4);
+	expected = g_new (gfloat, N_SAMPLES);
+	got = g_new (gfloat, N_SAMPLES);
+
+	fill_ints (ints, kernel->format, rand);
+	scalar->unpack (ints, expected, N_SAMPLES);
+	kernel->unpack (ints, got, N_SAMPLES);
+	g_assert (memcmp (got, expected, N_SAMPLES * sizeof (gfloat)) == 0);
+
+	g_free (ints);
+	g_free (expected);
+	g_free (got);
+	g_rand_free (rand);
+}
+
+static void
+test_mix (gconstpointer data)
+{
+	const Mixer *mixer = data;
+	GRand       *rand;
+	gfloat      *stereo, *expected, *got;
+	guint        frames = N_SAMPLES / 2, i;
+
+	rand = g_rand_new_with_seed (3);
+	stereo = g_new (gfloat, frames * 2);
+	expected = g_new (gfloat, frames * 2);
+	got = g_new (gfloat, frames * 2);
+	for (i = 0; i < frames * 2; i++)
+		stereo[i] = g_rand_double_range (rand, -1.0, 1.0);
+
+	downmix_c (stereo, expected, frames);
+	mixer->downmix (stereo, got, frames);
+	g_assert (memcmp (got, expected, frames * sizeof (gfloat)) == 0);
+
+	upmix_c (stereo, expected, frames);
+	mixer->upmix (stereo, got, frames);
+	g_assert (memcmp (got, expected, frames * 2 * sizeof (gfloat)) == 0);
+
+	g_free (stereo);
+	g_free (expected);
+	g_free (got);
+	g_rand_free (rand);
+}
+
+/* The scalar kernels themselves round ties to even */
+static void
+test_ties (void)
+{
+	const gfloat samples[] = { 0.5f, 1.5f, 2.5f, -0.5f, -1.5f, -2.5f };
+	const gint16 expected[] = { 0, 2, 2, 0, -2, -2 };
+	gfloat       scaled[G_N_ELEMENTS (samples)];
+	gint16       got[G_N_ELEMENTS (samples)];
+	guint        i;
+
+	for (i = 0; i < G_N_ELEMENTS (samples); i++)
+		scaled[i] = samples[i] / 32768.0f;
+	pack_s16_c (scaled, (guint8 *) got, G_N_ELEMENTS (samples));
+
+	for (i = 0; i < G_N_ELEMENTS (samples); i++)
+		g_assert_cmpint (got[i], ==, expected[i]);
+}
+
+int
+main (int argc, char **argv)
+{
+	const Kernel *kernel;
+	const Mixer  *mixer;
+
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/audio-convert/ties", test_ties);
+	for (kernel = vector_kernels; kernel->name != NULL; kernel++) {
+		gchar *path;
+
+		path = g_strdup_printf ("/audio-convert/pack/%s", kernel->name);
+		g_test_add_data_func (path, kernel, test_pack);
+		g_free (path);
+		path = g_strdup_printf ("/audio-convert/unpack/%s", kernel->name);
+		g_test_add_data_func (path, kernel, test_unpack);
+		g_free (path);
+	}
+	for (mixer = vector_mixers; mixer->name != NULL; mixer++) {
+		gchar *path;
+
+		path = g_strdup_printf ("/audio-convert/mix/%s", mixer->name);
+		g_test_add_data_func (path, mixer, test_mix);
+		g_free (path);
+	}
+
+	return g_test_run ();
+}
@@ -0,0 +1,239 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  test-concat.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+#include <config.h>
+
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <gst/gst.h>
+
+#include "nsc-concat.h"
+#include "nsc-error.h"
+#include "nsc-gstreamer.h"
+#include "test-utils.h"
+
+#define RATE     44100
+#define CHANNELS 2
+#define SECONDS  20
+#define FRAMES   ((guint64) RATE * SECONDS)
+#define N_PARTS  3
+
+typedef struct {
+	GMainLoop *loop;
+	GError    *error;
+} Join;
+
+static void
+concat_ready_cb (GObject      *source,
+		 GAsyncResult *result,
+		 gpointer      user_data)
+{
+	Join *join = user_data;
+
+	nsc_concat_files_finish (result, &join->error);
+	g_main_loop_quit (join->loop);
+}
+
+static void
+convert (GFile *src, GFile *sink, guint64 start, guint64 stop)
+{
+	GstEncodingProfile *profile;
+	NscGStreamer       *gstreamer;
+	GError             *error = NULL;
+
+	profile = test_profile ("audio/x-flac");
+	gstreamer = nsc_gstreamer_new (profile);
+	g_object_set (gstreamer, "start", start, "stop", stop, NULL);
+
+	test_convert (gstreamer, src, sink, &error);
+	g_assert_no_error (error);
+
+	g_object_unref (gstreamer);
+	gst_encoding_profile_unref (profile);
+}
+
+/* Convert src in parts cut at the given sample positions, and join them */
+static gboolean
+convert_parts (GFile          *dir,
+	       GFile          *src,
+	       GFile          *sink,
+	       const guint64  *cuts,
+	       guint           n_parts,
+	       GError        **error)
+{
+	GPtrArray *parts;
+	Join       join = { NULL, NULL };
+	guint      i;
+
+	parts = g_ptr_array_new_with_free_func (g_object_unref);
+	for (i = 0; i < n_parts; i++) {
+		GFile *part;
+		gchar *name;
+
+		name = g_strdup_printf ("part-%u.flac", i);
+		part = g_file_get_child (dir, name);
+		g_free (name);
+
+		convert (src, part,
+			 gst_util_uint64_scale_int_ceil (cuts[i], GST_SECOND, RATE),
+			 i < n_parts - 1 ?
+			 gst_util_uint64_scale_int_ceil (cuts[i + 1], GST_SECOND, RATE) :
+			 GST_CLOCK_TIME_NONE);
+		g_ptr_array_add (parts, part);
+	}
+
+	join.loop = g_main_loop_new (NULL, FALSE);
+	nsc_concat_files_async (parts, sink, "audio/x-flac", NULL,
+				concat_ready_cb, &join);
+	g_main_loop_run (join.loop);
+	g_main_loop_unref (join.loop);
+	g_ptr_array_unref (parts);
+
+	if (join.error != NULL) {
+		g_propagate_error (error, join.error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Read the smallest block size and the length from the STREAMINFO */
+static void
+read_streaminfo (GFile *file, guint *min_block, guint64 *samples)
+{
+	GError *error = NULL;
+	gchar  *contents;
+	gsize   length;
+	guint8 *info;
+
+	g_file_load_contents (file, NULL, &contents, &length, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (length, >, 4 + 4 + 34);
+	g_assert (memcmp (contents, "fLaC", 4) == 0);
+
+	info = (guint8 *) contents + 8;
+	*min_block = (info[0] << 8) | info[1];
+	*samples = ((guint64) (info[13] & 0x0f) << 32) |
+		((guint64) info[14] << 24) | (info[15] << 16) |
+		(info[16] << 8) | info[17];
+
+	g_free (contents);
+}
+
+/*
+ * Parts cut where the converter cuts them join into a file that
+ * decodes to the same samples as one converted in one go.
+ */
+static void
+test_concat_sample_exact (void)
+{
+	GFile   *dir, *src, *whole, *joined;
+	GstCaps *caps;
+	GError  *error = NULL;
+	guint64  cuts[N_PARTS];
+	guint64  samples;
+	gchar   *pcm_md5, *whole_md5, *joined_md5;
+	guint    min_block, i;
+
+	dir = test_make_dir ();
+	src = g_file_get_child (dir, "source.wav");
+	whole = g_file_get_child (dir, "whole.flac");
+	joined = g_file_get_child (dir, "joined.flac");
+	caps = test_pcm_caps (RATE, CHANNELS);
+
+	pcm_md5 = test_write_wav (src, RATE, CHANNELS, FRAMES, 1);
+
+	convert (src, whole, 0, GST_CLOCK_TIME_NONE);
+
+	for (i = 0; i < N_PARTS; i++) {
+		guint64 start;
+
+		start = nsc_concat_boundary (SECONDS * GST_SECOND, RATE, i, N_PARTS);
+		cuts[i] = gst_util_uint64_scale_int (start, RATE, GST_SECOND);
+		g_assert_cmpuint (cuts[i] % NSC_CONCAT_BLOCK, ==, 0);
+	}
+	convert_parts (dir, src, joined, cuts, N_PARTS, &error);
+	g_assert_no_error (error);
+
+	whole_md5 = test_checksum (whole, caps, &error);
+	g_assert_no_error (error);
+	joined_md5 = test_checksum (joined, caps, &error);
+	g_assert_no_error (error);
+
+	g_assert_cmpstr (whole_md5, ==, pcm_md5);
+	g_assert_cmpstr (joined_md5, ==, whole_md5);
+
+	read_streaminfo (joined, &min_block, &samples);
+	g_assert_cmpuint (min_block, >=, 16);
+	g_assert_cmpuint (samples, ==, FRAMES);
+
+	g_free (pcm_md5);
+	g_free (whole_md5);
+	g_free (joined_md5);
+	gst_caps_unref (caps);
+	g_object_unref (src);
+	g_object_unref (whole);
+	g_object_unref (joined);
+	test_remove_dir (dir);
+	g_object_unref (dir);
+}
+
+/* A part ending a few samples into a block can't be joined */
+static void
+test_concat_short_block (void)
+{
+	GFile   *dir, *src, *joined;
+	GError  *error = NULL;
+	guint64  cuts[2] = { 0, NSC_CONCAT_BLOCK * 10 + 5 };
+
+	dir = test_make_dir ();
+	src = g_file_get_child (dir, "source.wav");
+	joined = g_file_get_child (dir, "joined.flac");
+
+	g_free (test_write_wav (src, RATE, CHANNELS, RATE * 2, 2));
+
+	g_assert (!convert_parts (dir, src, joined, cuts, 2, &error));
+	g_assert_error (error, NSC_ERROR, NSC_ERROR_INTERNAL_ERROR);
+	g_clear_error (&error);
+
+	g_object_unref (src);
+	g_object_unref (joined);
+	test_remove_dir (dir);
+	g_object_unref (dir);
+}
+
+int
+main (int argc, char **argv)
+{
+	gst_init (&argc, &argv);
+	g_test_init (&argc, &argv, NULL);
+
+	test_require_elements ("wavparse", "flacenc", "flacdec", "flacparse",
+			       "decodebin", NULL);
+
+	g_test_add_func ("/concat/sample-exact", test_concat_sample_exact);
+	g_test_add_func ("/concat/short-block", test_concat_short_block);
+
+	return g_test_run ();
+}
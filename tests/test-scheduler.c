@@ -0,0 +1,238 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  test-scheduler.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+/*
+ * Run batches through NscScheduler with NscSimulator in place of real
+ * conversions: queueing, the job limit, failures, transient failures
+ * and their retries, and cancelling.  The simulated files only exist
+ * by name.
+ *
+ * It needs a display for the progress dialog, and skips without one.
+ */
+#include <config.h>
+
+#include <stdlib.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <gtk/gtk.h>
+#include <gst/gst.h>
+
+#include "nsc-converter.h"
+#include "nsc-file-list.h"
+#include "nsc-scheduler.h"
+#include "test-utils.h"
+
+/*
+ * A tenth of the files fail and half of those are retried; everything
+ * runs ten thousand times faster than real time.  The retries still
+ * wait out their back off in real time.
+ */
+#define SIMULATION "cpu=exp:60,io=0-5,length=exp:240,fail=0.1,transient=0.5,speed=10000,seed=7"
+
+/* Longer than the back off of a job retried until it gives up */
+#define TIMEOUT 60
+
+typedef struct {
+	GMainLoop *loop;
+	GFile     *dir;
+	gint       idle;
+	gint       files;
+} Run;
+
+static void
+idle_cb (NscScheduler *scheduler, gint files, gpointer user_data)
+{
+	Run *run = user_data;
+
+	run->idle++;
+	run->files += files;
+	g_main_loop_quit (run->loop);
+}
+
+static gboolean
+timeout_cb (gpointer user_data)
+{
+	g_error ("The scheduler didn't finish in %d seconds", TIMEOUT);
+
+	return FALSE;
+}
+
+static gboolean
+cancel_cb (gpointer user_data)
+{
+	nsc_scheduler_cancel_all (nsc_scheduler_get_default ());
+
+	return FALSE;
+}
+
+static void
+run_init (Run *run)
+{
+	run->loop = g_main_loop_new (NULL, FALSE);
+	run->dir = test_make_dir ();
+	run->idle = 0;
+	run->files = 0;
+
+	g_signal_connect (nsc_scheduler_get_default (), "idle",
+			  G_CALLBACK (idle_cb), run);
+}
+
+static void
+run_wait (Run *run)
+{
+	guint timeout;
+
+	timeout = g_timeout_add_seconds (TIMEOUT, timeout_cb, NULL);
+	g_main_loop_run (run->loop);
+	g_source_remove (timeout);
+
+	g_signal_handlers_disconnect_by_func (nsc_scheduler_get_default (),
+					      idle_cb, run);
+}
+
+static void
+run_clear (Run *run)
+{
+	g_main_loop_unref (run->loop);
+	test_remove_dir (run->dir);
+	g_object_unref (run->dir);
+}
+
+/* Queue a batch of n made up files */
+static void
+add_batch (Run *run, const gchar *name, guint n)
+{
+	NscConverter *converter;
+	NscFileList  *files;
+	guint         i;
+
+	files = nsc_file_list_new ();
+	for (i = 0; i < n; i++) {
+		gchar *uri;
+
+		uri = g_strdup_printf ("file:///srv/music/%s/track-%05u.flac",
+				       name, i);
+		nsc_file_list_add (files, uri, NSC_FILE_AUDIO);
+		g_free (uri);
+	}
+
+	converter = nsc_converter_new (files);
+	g_assert (nsc_converter_start (converter, "audio/x-flac", run->dir));
+	g_object_unref (converter);
+}
+
+/* Every file is finished once, whether it converted, failed or was retried */
+static void
+test_scheduler_batch (void)
+{
+	Run run;
+
+	run_init (&run);
+	add_batch (&run, "batch", 1000);
+	run_wait (&run);
+
+	g_assert_cmpint (run.idle, ==, 1);
+	g_assert_cmpint (run.files, ==, 1000);
+
+	run_clear (&run);
+}
+
+/* Batches queued together are run as one */
+static void
+test_scheduler_batches (void)
+{
+	Run run;
+
+	run_init (&run);
+	add_batch (&run, "first", 300);
+	add_batch (&run, "second", 200);
+	add_batch (&run, "third", 1);
+	run_wait (&run);
+
+	g_assert_cmpint (run.idle, ==, 1);
+	g_assert_cmpint (run.files, ==, 501);
+
+	run_clear (&run);
+}
+
+/* Cancelling drops what is left, and leaves the scheduler usable */
+static void
+test_scheduler_cancel (void)
+{
+	Run run;
+
+	run_init (&run);
+	add_batch (&run, "cancelled", 100000);
+	g_timeout_add (100, cancel_cb, NULL);
+	run_wait (&run);
+
+	g_assert_cmpint (run.idle, ==, 1);
+	g_assert_cmpint (run.files, <, 100000);
+	run_clear (&run);
+
+	run_init (&run);
+	add_batch (&run, "after", 50);
+	run_wait (&run);
+
+	g_assert_cmpint (run.files, ==, 50);
+	run_clear (&run);
+}
+
+int
+main (int argc, char **argv)
+{
+	GFile *home;
+	gchar *path;
+	int    status;
+
+	/* Settings, history and media index of the test's own */
+	home = test_make_dir ();
+	path = g_file_get_path (home);
+	g_setenv ("XDG_DATA_HOME", path, TRUE);
+	g_setenv ("XDG_CACHE_HOME", path, TRUE);
+	g_free (path);
+	g_setenv ("GSETTINGS_SCHEMA_DIR", SCHEMA_DIR, TRUE);
+	g_setenv ("GSETTINGS_BACKEND", "memory", TRUE);
+	g_setenv ("NSC_SIMULATE", SIMULATION, TRUE);
+
+	gst_init (&argc, &argv);
+	if (!gtk_init_check (&argc, &argv)) {
+		g_printerr ("Skipping, as there is no display\n");
+		return 77;
+	}
+	g_test_init (&argc, &argv, NULL);
+
+	/* The profile has to be usable, even if nothing is encoded */
+	test_require_elements ("flacenc", "encodebin", NULL);
+
+	g_test_add_func ("/scheduler/batch", test_scheduler_batch);
+	g_test_add_func ("/scheduler/batches", test_scheduler_batches);
+	g_test_add_func ("/scheduler/cancel", test_scheduler_cancel);
+
+	status = g_test_run ();
+
+	test_remove_dir (home);
+	g_object_unref (home);
+
+	return status;
+}
@@ -0,0 +1,258 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  test-soak.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+/*
+ * Convert the same short files over and over, recycling, rebuilding,
+ * failing and cancelling pipelines and replacing the converter now
+ * and then, and fail if the process keeps growing once it has warmed
+ * up: in resident size, in open files, or in live pipelines, buses
+ * and converters.
+ *
+ * "make check" runs a few hundred conversions.  A real soak takes
+ * tens of thousands, with -m slow or NSC_SOAK_CONVERSIONS set:
+ *   NSC_SOAK_CONVERSIONS=50000 GOBJECT_DEBUG=instance-count tests/test-soak
+ *
+ * Instances are only counted with GOBJECT_DEBUG=instance-count, which
+ * "make check" sets, and GLib 2.44 or newer.
+ */
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <gst/gst.h>
+
+#include "nsc-gstreamer.h"
+#include "test-utils.h"
+
+#define RATE           44100
+#define CHANNELS       2
+#define N_SOURCES      4
+#define WARM_UP        30
+
+/* Conversions after warming up, normally and with -m slow */
+#define CONVERSIONS      300
+#define SLOW_CONVERSIONS 20000
+
+/* A new converter, a missing source and a cancel this often */
+#define NEW_EVERY      50
+#define FAIL_EVERY     10
+#define CANCEL_EVERY   7
+
+/* How much growth after warming up is put down to noise */
+#define MAX_RSS_GROWTH (8 * 1024)
+#define MAX_FD_GROWTH  2
+
+/* The objects a leaked pipeline would leave behind */
+static const gchar *counted_types[] = {
+	"NscGStreamer",
+	"GstPipeline",
+	"GstBus",
+	"GstDecodeBin",
+	"GstEncodeBin",
+	NULL
+};
+
+typedef struct {
+	gulong rss;
+	guint  fds;
+	gint   instances;
+} Usage;
+
+static gulong
+resident_kib (void)
+{
+	gchar  *statm = NULL;
+	gulong  size, resident = 0;
+
+	if (g_file_get_contents ("/proc/self/statm", &statm, NULL, NULL) &&
+	    sscanf (statm, "%lu %lu", &size, &resident) == 2)
+		resident *= sysconf (_SC_PAGESIZE) / 1024;
+	g_free (statm);
+
+	return resident;
+}
+
+static guint
+open_fds (void)
+{
+	GDir  *dir;
+	guint  fds = 0;
+
+	dir = g_dir_open ("/proc/self/fd", 0, NULL);
+	if (dir != NULL) {
+		while (g_dir_read_name (dir) != NULL)
+			fds++;
+		g_dir_close (dir);
+	}
+
+	return fds;
+}
+
+/* Live instances of counted_types, or -1 if they aren't counted */
+static gint
+live_instances (void)
+{
+#if GLIB_CHECK_VERSION(2, 44, 0)
+	const gchar *debug = g_getenv ("GOBJECT_DEBUG");
+	gint         count = 0;
+	guint        i;
+
+	if (debug == NULL || strstr (debug, "instance-count") == NULL)
+		return -1;
+
+	for (i = 0; counted_types[i] != NULL; i++) {
+		GType type = g_type_from_name (counted_types[i]);
+
+		if (type != 0)
+			count += g_type_get_instance_count (type);
+	}
+
+	return count;
+#else
+	return -1;
+#endif
+}
+
+static void
+sample (Usage *usage)
+{
+	usage->rss = resident_kib ();
+	usage->fds = open_fds ();
+	usage->instances = live_instances ();
+}
+
+static void
+convert_one (NscGStreamer       **gstreamer,
+	     GstEncodingProfile  *profile,
+	     GFile               *dir,
+	     GFile              **sources,
+	     guint                i)
+{
+	GError *error = NULL;
+	GFile  *src, *sink;
+
+	if (*gstreamer == NULL || i % NEW_EVERY == 0) {
+		if (*gstreamer != NULL)
+			g_object_unref (*gstreamer);
+		*gstreamer = nsc_gstreamer_new (profile);
+	} else if (i % 3 == 0) {
+		/* Throw the pipeline away rather than recycle it */
+		g_object_set (*gstreamer, "profile", profile, NULL);
+	}
+
+	sink = g_file_get_child (dir, "out.flac");
+
+	if (i % FAIL_EVERY == FAIL_EVERY - 1) {
+		src = g_file_get_child (dir, "missing.wav");
+		g_assert (!test_convert (*gstreamer, src, sink, &error));
+		g_clear_error (&error);
+	} else if (i % CANCEL_EVERY == CANCEL_EVERY - 1) {
+		/* Too short a file may be done before it can be */
+		src = g_object_ref (sources[i % N_SOURCES]);
+		test_convert_cancel (*gstreamer, src, sink);
+	} else {
+		src = g_object_ref (sources[i % N_SOURCES]);
+		test_convert (*gstreamer, src, sink, &error);
+		g_assert_no_error (error);
+	}
+
+	g_file_delete (sink, NULL, NULL);
+	g_object_unref (sink);
+	g_object_unref (src);
+}
+
+static void
+test_soak (void)
+{
+	GstEncodingProfile *profile;
+	NscGStreamer       *gstreamer = NULL;
+	GFile              *dir;
+	GFile              *sources[N_SOURCES];
+	Usage               before, after;
+	const gchar        *count;
+	guint               conversions, i;
+
+	dir = test_make_dir ();
+	for (i = 0; i < N_SOURCES; i++) {
+		gchar *name;
+
+		name = g_strdup_printf ("in-%u.wav", i);
+		sources[i] = g_file_get_child (dir, name);
+		g_free (name);
+
+		/* Mono and stereo, so the conversion elements change */
+		g_free (test_write_wav (sources[i], RATE, 1 + i % CHANNELS,
+					RATE / 5, i));
+	}
+
+	count = g_getenv ("NSC_SOAK_CONVERSIONS");
+	if (count != NULL)
+		conversions = strtoul (count, NULL, 10);
+	else
+		conversions = g_test_slow () ? SLOW_CONVERSIONS : CONVERSIONS;
+
+	profile = test_profile ("audio/x-flac");
+
+	for (i = 0; i < WARM_UP; i++)
+		convert_one (&gstreamer, profile, dir, sources, i);
+	sample (&before);
+
+	for (; i < WARM_UP + conversions; i++)
+		convert_one (&gstreamer, profile, dir, sources, i);
+	sample (&after);
+
+	g_test_message ("After %u conversions: %lu -> %lu KiB resident, "
+			"%u -> %u open files, %d -> %d instances",
+			conversions, before.rss, after.rss,
+			before.fds, after.fds,
+			before.instances, after.instances);
+
+	g_assert_cmpuint (after.rss, <=, before.rss + MAX_RSS_GROWTH);
+	g_assert_cmpuint (after.fds, <=, before.fds + MAX_FD_GROWTH);
+	if (before.instances >= 0)
+		g_assert_cmpint (after.instances, <=, before.instances);
+
+	g_object_unref (gstreamer);
+	gst_encoding_profile_unref (profile);
+	for (i = 0; i < N_SOURCES; i++)
+		g_object_unref (sources[i]);
+	test_remove_dir (dir);
+	g_object_unref (dir);
+}
+
+int
+main (int argc, char **argv)
+{
+	gst_init (&argc, &argv);
+	g_test_init (&argc, &argv, NULL);
+
+	test_require_elements ("wavparse", "flacenc", "decodebin", NULL);
+
+	g_test_add_func ("/soak/convert", test_soak);
+
+	return g_test_run ();
+}
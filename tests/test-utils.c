@@ -0,0 +1,369 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  test-utils.c
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+#include <config.h>
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <gst/gst.h>
+
+#include "nsc-checksum.h"
+#include "test-utils.h"
+
+typedef struct {
+	GMainLoop *loop;
+	GError    *error;
+	gchar     *md5;
+	gboolean   done;
+	gboolean   started;
+} Wait;
+
+/*
+ * Private Methods
+ */
+static void
+wait_run (Wait *wait)
+{
+	if (!wait->done)
+		g_main_loop_run (wait->loop);
+	g_main_loop_unref (wait->loop);
+}
+
+static void
+wait_done (Wait *wait)
+{
+	wait->done = TRUE;
+	g_main_loop_quit (wait->loop);
+}
+
+static void
+completion_cb (NscGStreamer *gstreamer, gpointer user_data)
+{
+	wait_done (user_data);
+}
+
+static void
+duration_cb (NscGStreamer *gstreamer, gint seconds, gpointer user_data)
+{
+	Wait *wait = user_data;
+
+	wait->started = TRUE;
+	wait_done (wait);
+}
+
+static void
+error_cb (NscGStreamer *gstreamer, GError *error, gpointer user_data)
+{
+	Wait *wait = user_data;
+
+	wait->error = g_error_copy (error);
+	wait_done (wait);
+}
+
+static void
+checksum_ready_cb (GObject      *source,
+		   GAsyncResult *result,
+		   gpointer      user_data)
+{
+	Wait *wait = user_data;
+
+	wait->md5 = nsc_checksum_file_finish (result, &wait->error);
+	wait_done (wait);
+}
+
+static void
+write_le (guint8 *p, guint32 value, guint bytes)
+{
+	guint i;
+
+	for (i = 0; i < bytes; i++)
+		p[i] = value >> (8 * i);
+}
+
+/*
+ * Public Methods
+ */
+
+/**
+ * Exit with 77, which the test driver takes as a skip, unless the
+ * GStreamer elements named are all there.
+ */
+void
+test_require_elements (const gchar *first, ...)
+{
+	const gchar *name;
+	va_list      args;
+
+	va_start (args, first);
+	for (name = first; name != NULL; name = va_arg (args, const gchar *)) {
+		GstElementFactory *factory;
+
+		factory = gst_element_factory_find (name);
+		if (factory == NULL) {
+			g_printerr ("Skipping, as the %s element is missing\n", name);
+			exit (77);
+		}
+		gst_object_unref (factory);
+	}
+	va_end (args);
+}
+
+GFile *
+test_make_dir (void)
+{
+	GFile  *dir;
+	GError *error = NULL;
+	gchar  *path;
+
+	path = g_dir_make_tmp ("nsc-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	dir = g_file_new_for_path (path);
+	g_free (path);
+
+	return dir;
+}
+
+/* Removes a directory from test_make_dir(), and everything in it */
+void
+test_remove_dir (GFile *dir)
+{
+	GFileEnumerator *children;
+	GFileInfo       *info;
+
+	children = g_file_enumerate_children (dir,
+					      G_FILE_ATTRIBUTE_STANDARD_NAME ","
+					      G_FILE_ATTRIBUTE_STANDARD_TYPE,
+					      G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+					      NULL, NULL);
+	if (children != NULL) {
+		while ((info = g_file_enumerator_next_file (children, NULL, NULL)) != NULL) {
+			GFile *child;
+
+			child = g_file_get_child (dir, g_file_info_get_name (info));
+			if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+				test_remove_dir (child);
+			else
+				g_file_delete (child, NULL, NULL);
+			g_object_unref (child);
+			g_object_unref (info);
+		}
+		g_object_unref (children);
+	}
+
+	g_file_delete (dir, NULL, NULL);
+}
+
+/**
+ * Write a 16 bit WAV file of a tone with some noise, the same for
+ * the same seed.  Returns the MD5 of its samples.
+ */
+gchar *
+test_write_wav (GFile   *file,
+		guint    rate,
+		guint    channels,
+		guint64  frames,
+		guint32  seed)
+{
+	GOutputStream *out;
+	GChecksum     *checksum;
+	GRand         *rand;
+	GError        *error = NULL;
+	guint8         header[44];
+	gint16        *block;
+	guint64        frame = 0;
+	gchar         *md5;
+	guint32        data_size;
+
+	data_size = frames * channels * 2;
+
+	memcpy (header, "RIFF", 4);
+	write_le (header + 4, 36 + data_size, 4);
+	memcpy (header + 8, "WAVEfmt ", 8);
+	write_le (header + 16, 16, 4);
+	write_le (header + 20, 1, 2);
+	write_le (header + 22, channels, 2);
+	write_le (header + 24, rate, 4);
+	write_le (header + 28, rate * channels * 2, 4);
+	write_le (header + 32, channels * 2, 2);
+	write_le (header + 34, 16, 2);
+	memcpy (header + 36, "data", 4);
+	write_le (header + 40, data_size, 4);
+
+	out = G_OUTPUT_STREAM (g_file_replace (file, NULL, FALSE,
+					       G_FILE_CREATE_NONE, NULL, &error));
+	g_assert_no_error (error);
+	g_output_stream_write_all (out, header, sizeof (header), NULL, NULL, &error);
+	g_assert_no_error (error);
+
+	checksum = g_checksum_new (G_CHECKSUM_MD5);
+	rand = g_rand_new_with_seed (seed);
+	block = g_new (gint16, 4096 * channels);
+
+	while (frame < frames) {
+		guint n, i, c;
+
+		n = MIN (4096, frames - frame);
+		for (i = 0; i < n; i++, frame++)
+			for (c = 0; c < channels; c++) {
+				gdouble v;
+
+				v = 12000 * sin (2 * G_PI * 440 * (c + 1) * frame / rate) +
+					g_rand_double_range (rand, -2000, 2000);
+				block[i * channels + c] = GINT16_TO_LE ((gint16) v);
+			}
+
+		g_checksum_update (checksum, (const guchar *) block, n * channels * 2);
+		g_output_stream_write_all (out, block, n * channels * 2,
+					   NULL, NULL, &error);
+		g_assert_no_error (error);
+	}
+
+	g_output_stream_close (out, NULL, &error);
+	g_assert_no_error (error);
+
+	md5 = g_strdup (g_checksum_get_string (checksum));
+
+	g_object_unref (out);
+	g_checksum_free (checksum);
+	g_rand_free (rand);
+	g_free (block);
+
+	return md5;
+}
+
+/* The format test_write_wav() writes, for test_checksum() */
+GstCaps *
+test_pcm_caps (guint rate, guint channels)
+{
+	return gst_caps_new_simple ("audio/x-raw",
+				    "format", G_TYPE_STRING, "S16LE",
+				    "layout", G_TYPE_STRING, "interleaved",
+				    "rate", G_TYPE_INT, (gint) rate,
+				    "channels", G_TYPE_INT, (gint) channels,
+				    NULL);
+}
+
+/*
+ * A profile with just the encoder for media_type, so the tests
+ * don't depend on the installed rhythmbox.gep.
+ */
+GstEncodingProfile *
+test_profile (const gchar *media_type)
+{
+	GstEncodingProfile *profile;
+	GstCaps            *caps;
+
+	caps = gst_caps_from_string (media_type);
+	profile = GST_ENCODING_PROFILE (gst_encoding_audio_profile_new (caps, NULL, NULL, 1));
+	gst_caps_unref (caps);
+
+	return profile;
+}
+
+/* Convert, with the properties already set on gstreamer */
+gboolean
+test_convert (NscGStreamer  *gstreamer,
+	      GFile         *src,
+	      GFile         *sink,
+	      GError       **error)
+{
+	Wait wait = { NULL, NULL, NULL, FALSE, FALSE };
+
+	wait.loop = g_main_loop_new (NULL, FALSE);
+	g_signal_connect (gstreamer, "completion",
+			  G_CALLBACK (completion_cb), &wait);
+	g_signal_connect (gstreamer, "error",
+			  G_CALLBACK (error_cb), &wait);
+
+	nsc_gstreamer_convert_file (gstreamer, src, sink, &wait.error);
+	if (wait.error != NULL)
+		wait.done = TRUE;
+	wait_run (&wait);
+
+	g_signal_handlers_disconnect_matched (gstreamer, G_SIGNAL_MATCH_DATA,
+					      0, 0, NULL, NULL, &wait);
+
+	if (wait.error != NULL) {
+		g_propagate_error (error, wait.error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Start converting src to sink, and cancel as soon as it is running.
+ * Returns FALSE if it was done or failed before it could be.
+ */
+gboolean
+test_convert_cancel (NscGStreamer *gstreamer,
+		     GFile        *src,
+		     GFile        *sink)
+{
+	Wait wait = { NULL, NULL, NULL, FALSE, FALSE };
+
+	wait.loop = g_main_loop_new (NULL, FALSE);
+	g_signal_connect (gstreamer, "completion",
+			  G_CALLBACK (completion_cb), &wait);
+	g_signal_connect (gstreamer, "error",
+			  G_CALLBACK (error_cb), &wait);
+	g_signal_connect (gstreamer, "duration",
+			  G_CALLBACK (duration_cb), &wait);
+
+	nsc_gstreamer_convert_file (gstreamer, src, sink, &wait.error);
+	if (wait.error != NULL)
+		wait.done = TRUE;
+	wait_run (&wait);
+
+	g_signal_handlers_disconnect_matched (gstreamer, G_SIGNAL_MATCH_DATA,
+					      0, 0, NULL, NULL, &wait);
+
+	if (wait.started)
+		nsc_gstreamer_cancel_convert (gstreamer);
+	g_clear_error (&wait.error);
+
+	return wait.started;
+}
+
+/* The MD5 of the audio of file, decoded to caps */
+gchar *
+test_checksum (GFile *file, GstCaps *caps, GError **error)
+{
+	Wait wait = { NULL, NULL, NULL, FALSE, FALSE };
+
+	wait.loop = g_main_loop_new (NULL, FALSE);
+	nsc_checksum_file_async (file, caps, NULL, checksum_ready_cb, &wait);
+	wait_run (&wait);
+
+	if (wait.error != NULL)
+		g_propagate_error (error, wait.error);
+
+	return wait.md5;
+}
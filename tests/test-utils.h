@@ -0,0 +1,65 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ *  test-utils.h
+ *
+ *  Copyright (C) 2026 agent
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ *  Author: agent <agent@local>
+ *
+ */
+
+#ifndef TEST_UTILS_H
+#define TEST_UTILS_H
+
+#include <gio/gio.h>
+#include <gst/gst.h>
+#include <gst/pbutils/encoding-profile.h>
+
+#include "nsc-gstreamer.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Helpers shared by the tests and benchmarks.  Everything runs the
+ * default main context until the asynchronous call is done.
+ */
+void                test_require_elements (const gchar         *first,
+					   ...) G_GNUC_NULL_TERMINATED;
+GFile              *test_make_dir         (void);
+void                test_remove_dir       (GFile               *dir);
+gchar              *test_write_wav        (GFile               *file,
+					   guint                rate,
+					   guint                channels,
+					   guint64              frames,
+					   guint32              seed);
+GstCaps            *test_pcm_caps         (guint                rate,
+					   guint                channels);
+GstEncodingProfile *test_profile          (const gchar         *media_type);
+gboolean            test_convert          (NscGStreamer        *gstreamer,
+					   GFile               *src,
+					   GFile               *sink,
+					   GError             **error);
+gboolean            test_convert_cancel   (NscGStreamer        *gstreamer,
+					   GFile               *src,
+					   GFile               *sink);
+gchar              *test_checksum         (GFile               *file,
+					   GstCaps             *caps,
+					   GError             **error);
+
+G_END_DECLS
+
+#endif /* TEST_UTILS_H */